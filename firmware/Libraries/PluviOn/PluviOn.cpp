@@ -11,50 +11,124 @@
  *       SITE: https://www.pluvion.com.br
  */
 #include <FS.h> // FS must be the first
+#include <stddef.h>
 
 #define PLV_DEBUG_ENABLED true
 #include "PluviOn.h"
 
+boolean       PluviOn::_mounted           = false;
+unsigned long PluviOn::_mountRequests     = 0;
+unsigned long PluviOn::_mountCount        = 0;
+unsigned long PluviOn::_mountTimeInMicros = 0;
+uint32_t      PluviOn::_epoch             = 0;
+boolean       PluviOn::_reclaimPending    = false;
+const char   *PluviOn::_keep[PLV_FS_KEEP_MAX];
+uint8_t       PluviOn::_keepCount         = 0;
+PluviOnFSOpStats PluviOn::_opStats[PLV_FS_OP_COUNT];
+unsigned long PluviOn::_bytesWritten      = 0;
+
+// Operation names, as printed by FSPrintStats
+static const char *FS_OP_NAMES[PLV_FS_OP_COUNT] = {
+    "mount", "open", "read", "write", "remove", "rename", "exists", "openDir", "format"
+};
+
 PluviOn::PluviOn() {}
 
 /**
- * Create a file in File System
- * 
- * @param directory Directory path
- * @param filename File Name
- * @return true if file was created successfully, otherwise false.
+ * Mount the file system for the whole session.
+ *
+ * @return true if the file system is mounted, otherwise false.
  */
-boolean PluviOn::FSCreateFile(String directory, String filename){
+boolean PluviOn::begin() {
 
-    PLV_DEBUG_(F("Creating file: \""));
-    PLV_DEBUG_(directory);
-    PLV_DEBUG_(F("/"));
-    PLV_DEBUG_(filename);
-    PLV_DEBUG(F("\""));
+    _mountRequests++;
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
-        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+    if (_mounted) {
+        return true;
     }
 
-    boolean success = true;
+    unsigned long start = micros();
+    _mounted = PLV_FS.begin();
+    _mountTimeInMicros += micros() - start;
+    _mountCount++;
+    FSRecordOp(PLV_FS_OP_MOUNT, micros() - start);
 
-    // Mount filepath
-    String filepath  = directory;
-           filepath += "/";
-           filepath += filename;
+    // Storage epoch (first thing read after mounting)
+    if (_mounted) {
+        FSLoadEpoch();
+    }
 
-    // Open/Create file
-    File f = SPIFFS.open(filepath, "w");
-    if (f) {
-        PLV_DEBUG(F("SUCCESS: File created."));
-        f.close();
-    } else {
-        success = false;
-        PLV_DEBUG(F("ERROR: Fail creating file."));
+    return _mounted;
+}
+
+/**
+ * Unmount the file system (call before restart or sleep)
+ */
+void PluviOn::end() {
+
+    if (_mounted) {
+        PLV_FS.end();
+        _mounted = false;
     }
+}
 
-    return success;
+/**
+ * @return true if the file system is currently mounted.
+ */
+boolean PluviOn::isMounted() {
+    return _mounted;
+}
+
+/**
+ * Number of mount requests (calls to begin()) since the last reset of the stats
+ */
+unsigned long PluviOn::FSMountRequests() {
+    return _mountRequests;
+}
+
+/**
+ * Number of real file system mounts since the last reset of the stats
+ */
+unsigned long PluviOn::FSMountCount() {
+    return _mountCount;
+}
+
+/**
+ * Time spent mounting the file system since the last reset of the stats
+ */
+unsigned long PluviOn::FSMountTimeInMicros() {
+    return _mountTimeInMicros;
+}
+
+/**
+ * Reset the mount stats (call at the beginning of each loop() iteration)
+ */
+void PluviOn::FSResetMountStats() {
+    _mountRequests     = 0;
+    _mountCount        = 0;
+    _mountTimeInMicros = 0;
+}
+
+/**
+ * Create a file in File System
+ * 
+ * @param directory Directory path
+ * @param filename File Name
+ * @return true if file was created successfully, otherwise false.
+ */
+boolean PluviOn::FSCreateFile(const String &directory, const String &filename){
+    return FSCreateFile(directory.c_str(), filename.c_str());
+}
+
+/**
+ * Create a file in File System
+ * 
+ * @param directory Directory path
+ * @param filename File Name
+ * @return true if file was created successfully, otherwise false.
+ */
+boolean PluviOn::FSCreateFile(const String &directory, int filename){
+    return FSCreateFile(directory.c_str(), filename);
 }
 
 /**
@@ -64,7 +138,18 @@ boolean PluviOn::FSCreateFile(String directory, String filename){
  * @param filename File Name
  * @return true if file was created successfully, otherwise false.
  */
-boolean PluviOn::FSCreateFile(String directory, int filename){
+boolean PluviOn::FSCreateFile(const String &directory, unsigned long filename){
+    return FSCreateFile(directory.c_str(), filename);
+}
+
+/**
+ * Create a file in File System (the path is built on the stack, no heap allocation)
+ * 
+ * @param directory Directory path
+ * @param filename File Name
+ * @return true if file was created successfully, otherwise false.
+ */
+boolean PluviOn::FSCreateFile(const char *directory, const char *filename){
 
     PLV_DEBUG_(F("Creating file: \""));
     PLV_DEBUG_(directory);
@@ -72,20 +157,21 @@ boolean PluviOn::FSCreateFile(String directory, int filename){
     PLV_DEBUG_(filename);
     PLV_DEBUG(F("\""));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
-    boolean success = true;
-
     // Mount filepath
-    String filepath  = directory;
-           filepath += "/";
-           filepath += filename;
+    char filepath[PLV_FS_PATH_SIZE];
+    if (!FSPath(filepath, directory, filename)) {
+        return false;
+    }
+
+    boolean success = true;
 
     // Open/Create file
-    File f = SPIFFS.open(filepath, "w");
+    File f = FSOpen(filepath, "w");
     if (f) {
         PLV_DEBUG(F("SUCCESS: File created."));
         f.close();
@@ -98,43 +184,49 @@ boolean PluviOn::FSCreateFile(String directory, int filename){
 }
 
 /**
- * Create a file in File System
+ * Create a file in File System (the path is built on the stack, no heap allocation)
  * 
  * @param directory Directory path
  * @param filename File Name
  * @return true if file was created successfully, otherwise false.
  */
-boolean PluviOn::FSCreateFile(String directory, unsigned long filename){
+boolean PluviOn::FSCreateFile(const char *directory, int filename){
 
-    PLV_DEBUG_(F("Creating file: \""));
-    PLV_DEBUG_(directory);
-    PLV_DEBUG_(F("/"));
-    PLV_DEBUG_(filename);
-    PLV_DEBUG(F("\""));
+    char name[12];
+    snprintf(name, sizeof(name), "%d", filename);
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
-        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
-    }
+    return FSCreateFile(directory, name);
+}
 
-    boolean success = true;
+/**
+ * Create a file in File System (the path is built on the stack, no heap allocation)
+ * 
+ * @param directory Directory path
+ * @param filename File Name
+ * @return true if file was created successfully, otherwise false.
+ */
+boolean PluviOn::FSCreateFile(const char *directory, unsigned long filename){
 
-    // Mount filepath
-    String filepath  = directory;
-           filepath += "/";
-           filepath += filename;
+    char name[12];
+    snprintf(name, sizeof(name), "%lu", filename);
 
-    // Open/Create file
-    File f = SPIFFS.open(filepath, "w");
-    if (f) {
-        PLV_DEBUG(F("SUCCESS: File created."));
-        f.close();
-    } else {
-        success = false;
-        PLV_DEBUG(F("ERROR: Fail creating file."));
-    }
+    return FSCreateFile(directory, name);
+}
 
-    return success;
+/**
+ * Create a file in File System (the path is built on the stack, no heap allocation)
+ * 
+ * @param directory Directory path (flash string, F("..."))
+ * @param filename File Name
+ * @return true if file was created successfully, otherwise false.
+ */
+boolean PluviOn::FSCreateFile(const __FlashStringHelper *directory, const char *filename){
+
+    char dir[PLV_FS_PATH_SIZE];
+    strncpy_P(dir, (PGM_P) directory, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+
+    return FSCreateFile(dir, filename);
 }
 
 /**
@@ -145,49 +237,175 @@ boolean PluviOn::FSCreateFile(String directory, unsigned long filename){
  * @param content File Content
  * @return true if content was created successfully, otherwise false.
  */
-boolean PluviOn::FSWriteToFile(String directory, int filename, String content) {
-
-    PLV_DEBUG_(F("Creating file: \""));
-    PLV_DEBUG_(directory);
-    PLV_DEBUG_(F("/"));
-    PLV_DEBUG_(filename);
-    PLV_DEBUG(F("\""));
+boolean PluviOn::FSWriteToFile(const String &directory, int filename, const String &content) {
 
     PLV_DEBUG_(F("Content to write: \""));
     PLV_DEBUG_(content);
 	PLV_DEBUG(F("\""));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    char name[12];
+    snprintf(name, sizeof(name), "%d", filename);
+
+    // Written with a line ending, as it always was (println)
+    return FSWriteContent(directory.c_str(), name, (const uint8_t *) content.c_str(), content.length(), true);
+}
+
+/**
+ * Write a buffer to a file (written as is, no line ending is added)
+ * 
+ * @param directory Directory path
+ * @param filename File Name
+ * @param content Content buffer
+ * @param length Content length in bytes
+ * @return true if content was created successfully, otherwise false.
+ */
+boolean PluviOn::FSWriteToFile(const char *directory, const char *filename, const uint8_t *content, size_t length) {
+    return FSWriteContent(directory, filename, content, length, false);
+}
+
+/**
+ * Write a buffer to a file (written as is, no line ending is added)
+ * 
+ * @param directory Directory path
+ * @param filename File Name
+ * @param content Content buffer
+ * @param length Content length in bytes
+ * @return true if content was created successfully, otherwise false.
+ */
+boolean PluviOn::FSWriteToFile(const char *directory, int filename, const uint8_t *content, size_t length) {
+
+    char name[12];
+    snprintf(name, sizeof(name), "%d", filename);
+
+    return FSWriteContent(directory, name, content, length, false);
+}
+
+/**
+ * Write a buffer to a file (written as is, no line ending is added)
+ * 
+ * @param directory Directory path (flash string, F("..."))
+ * @param filename File Name
+ * @param content Content buffer
+ * @param length Content length in bytes
+ * @return true if content was created successfully, otherwise false.
+ */
+boolean PluviOn::FSWriteToFile(const __FlashStringHelper *directory, const char *filename, const uint8_t *content, size_t length) {
+
+    char dir[PLV_FS_PATH_SIZE];
+    strncpy_P(dir, (PGM_P) directory, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+
+    return FSWriteContent(dir, filename, content, length, false);
+}
+
+/**
+ * Replace a file content, power loss safe.
+ *
+ * @param filepath File path
+ * @param content Content buffer
+ * @param length Content length in bytes
+ * @return true if the content was written successfully, otherwise false.
+ */
+boolean PluviOn::FSWriteAtomic(const char *filepath, const uint8_t *content, size_t length) {
+
+    PLV_DEBUG_(F("Writing file (atomic): \""));
+    PLV_DEBUG_(filepath);
+    PLV_DEBUG_(F("\" ("));
+    PLV_DEBUG_(length);
+    PLV_DEBUG(F(" bytes)"));
+
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
     }
 
-    boolean success = true;
+    char tmppath[PLV_FS_PATH_SIZE];
+    if (!FSTmpPath(tmppath, filepath)) {
+        return false;
+    }
 
-    // Mount filepath
-    String filepath  = directory;
-           filepath += "/";
-           filepath += filename;
+    // 1. Write the whole content to the temporary file
+    File f = FSOpen(tmppath, "w");
+    if (!f) {
+        PLV_DEBUG(F("ERROR: Fail creating temporary file."));
+        return false;
+    }
 
-    // Open/Create file
-    File f = SPIFFS.open(filepath, "w");
-    if (f) {
-        PLV_DEBUG(F("SUCCESS: File created."));
+    boolean success = FSWrite(f, content, length) == length;
+    f.close();
 
-		// Check if the content was saved successfully
-		if (f.println(content)) {
-			PLV_DEBUG(F("SUCCESS: Content saved to file."));
-		} else {
-			success = false;
-		}
+    if (!success) {
+        PLV_DEBUG(F("ERROR: Fail writing temporary file."));
+        FSRemove(tmppath);
+        return false;
+    }
 
-        f.close();
-    } else {
-        success = false;
-        PLV_DEBUG(F("ERROR: Fail creating file."));
+    // 2. Move it over the file (SPIFFS can't rename over an existing file).
+    // A reset between remove and rename leaves only the complete temporary
+    // file, which FSRecoverAtomic() moves in place at boot.
+    if (FSExists(filepath) && !FSRemove(filepath)) {
+        PLV_DEBUG(F("ERROR: Fail removing old file."));
+        FSRemove(tmppath);
+        return false;
     }
 
-    return success;
+    if (!FSRename(tmppath, filepath)) {
+        PLV_DEBUG(F("ERROR: Fail renaming temporary file."));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Finish or discard a FSWriteAtomic() interrupted by a reset
+ *
+ * @param filepath File path
+ * @return true if the file is consistent, otherwise false.
+ */
+boolean PluviOn::FSRecoverAtomic(const char *filepath) {
+
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    char tmppath[PLV_FS_PATH_SIZE];
+    if (!FSTmpPath(tmppath, filepath)) {
+        return false;
+    }
+
+    // Nothing was interrupted
+    if (!FSExists(tmppath)) {
+        return true;
+    }
+
+    // The old file is still there: the temporary file may be incomplete, drop it
+    if (FSExists(filepath)) {
+        PLV_DEBUG_(F("Recovery: discarding interrupted write of \""));
+        PLV_DEBUG_(filepath);
+        PLV_DEBUG(F("\""));
+        return FSRemove(tmppath);
+    }
+
+    // The old file was already removed: the temporary file is complete, finish the move
+    PLV_DEBUG_(F("Recovery: finishing interrupted write of \""));
+    PLV_DEBUG_(filepath);
+    PLV_DEBUG(F("\""));
+    return FSRename(tmppath, filepath);
+}
+
+/**
+ * Deletes all files from the given directory.
+ * 
+ * @param directory Directory absolute path
+ *
+ * @return true if all files was deleted successfully, otherwise false.
+ */
+boolean PluviOn::FSDeleteFiles(const String &directory){
+    return FSDeleteFiles(directory.c_str());
 }
 
 /**
@@ -197,29 +415,35 @@ boolean PluviOn::FSWriteToFile(String directory, int filename, String content) {
  *
  * @return true if all files was deleted successfully, otherwise false.
  */
-boolean PluviOn::FSDeleteFiles(String directory){
+boolean PluviOn::FSDeleteFiles(const char *directory){
     
     PLV_DEBUG_(F("Deleting files from directory: \""));
     PLV_DEBUG_(directory);
     PLV_DEBUG(F("\""));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
     boolean success = true;
 
     // Open directory
-    Dir dir = SPIFFS.openDir(directory);
+    Dir dir = FSOpenDir(directory);
 
     // Remove all files
     while (dir.next()) {
 
+        char filepath[PLV_FS_PATH_SIZE];
+        if (!FSEntryPath(filepath, directory, dir)) {
+            success = false;
+            continue;
+        }
+
         PLV_DEBUG_(F("Removing file : "));
-        PLV_DEBUG(dir.fileName());
+        PLV_DEBUG(filepath);
         
-        if (!SPIFFS.remove(dir.fileName())) {
+        if (!FSRemove(filepath)) {
             PLV_DEBUG(F("ERROR during file deletion!"));
             success = false;
         }
@@ -236,7 +460,19 @@ boolean PluviOn::FSDeleteFiles(String directory){
  *
  * @return true if file was deleted successfully, otherwise false.
  */
-boolean PluviOn::FSDeleteFile(String directory, int filename) {
+boolean PluviOn::FSDeleteFile(const String &directory, int filename) {
+    return FSDeleteFile(directory.c_str(), filename);
+}
+
+/**
+ * Delete file (the path is built on the stack, no heap allocation).
+ * 
+ * @param directory Directory absolute path
+ * @param filename Filename
+ *
+ * @return true if file was deleted successfully, otherwise false.
+ */
+boolean PluviOn::FSDeleteFile(const char *directory, int filename) {
 
     PLV_DEBUG_(F("Deleting file: \""));
     PLV_DEBUG_(directory);
@@ -244,23 +480,27 @@ boolean PluviOn::FSDeleteFile(String directory, int filename) {
     PLV_DEBUG_(filename);
     PLV_DEBUG(F("\""));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
-    boolean success = true;
-
     // Mount filepath
-    String filepath  = directory;
-           filepath += "/";
-           filepath += filename;
+    char name[12];
+    snprintf(name, sizeof(name), "%d", filename);
+
+    char filepath[PLV_FS_PATH_SIZE];
+    if (!FSPath(filepath, directory, name)) {
+        return false;
+    }
+
+    boolean success = true;
 
     PLV_DEBUG_(F("Removing file : "));
 	PLV_DEBUG(filepath);
 
     // Remove file
-    if (!SPIFFS.remove(filepath)) {
+    if (!FSRemove(filepath)) {
     	success = false;
         PLV_DEBUG(F("ERROR: Fail deleting file."));
     }
@@ -274,19 +514,19 @@ boolean PluviOn::FSDeleteFile(String directory, int filename) {
  * @param filepath Directory filepath
  * @return The number readed, or 0 if it fails
  */
-unsigned int PluviOn::FSReadInt(String filepath){
+unsigned int PluviOn::FSReadInt(const String &filepath){
 
     PLV_DEBUG_(F("Reading unsigned int from filepath: \""));
     PLV_DEBUG_(filepath);
     PLV_DEBUG(F("\"")); 
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
     // Open the longitude directory
-    Dir dir = SPIFFS.openDir(filepath);
+    Dir dir = FSOpenDir(filepath.c_str());
 
     if(dir.next()){
 
@@ -294,7 +534,7 @@ unsigned int PluviOn::FSReadInt(String filepath){
 	    PLV_DEBUG_(dir.fileName());
 	    PLV_DEBUG(F("\""));
 
-        return dir.fileName().substring(filepath.length() + 1).toInt();
+        return FSEntryName(filepath, dir).toInt();
     } else {
         PLV_DEBUG(F("EMPTY DIRECTORY."));
     }
@@ -308,19 +548,19 @@ unsigned int PluviOn::FSReadInt(String filepath){
  * @param filepath Directory filepath
  * @return The number readed, or 0 if it fails
  */
-float PluviOn::FSReadFloat(String filepath){
+float PluviOn::FSReadFloat(const String &filepath){
 
     PLV_DEBUG_(F("Reading float from filepath: \""));
     PLV_DEBUG_(filepath);
     PLV_DEBUG(F("\"")); 
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
     // Open the longitude directory
-    Dir dir = SPIFFS.openDir(filepath);
+    Dir dir = FSOpenDir(filepath.c_str());
 
     if(dir.next()){
 
@@ -328,7 +568,7 @@ float PluviOn::FSReadFloat(String filepath){
 	    PLV_DEBUG_(dir.fileName());
 	    PLV_DEBUG(F("\""));
 
-        return dir.fileName().substring(filepath.length() + 1).toFloat();
+        return FSEntryName(filepath, dir).toFloat();
     } else {
         PLV_DEBUG(F("EMPTY DIRECTORY."));
     }
@@ -342,19 +582,19 @@ float PluviOn::FSReadFloat(String filepath){
  * @param filepath Directory filepath
  * @return The number readed, or 0 if it fails
  */
-unsigned long PluviOn::FSReadULong(String filepath){
+unsigned long PluviOn::FSReadULong(const String &filepath){
 
     PLV_DEBUG_(F("Reading unsigned long from filepath: \""));
     PLV_DEBUG_(filepath);
     PLV_DEBUG(F("\"")); 
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
     // Open the longitude directory
-    Dir dir = SPIFFS.openDir(filepath);
+    Dir dir = FSOpenDir(filepath.c_str());
 
     if(dir.next()){
 
@@ -362,7 +602,7 @@ unsigned long PluviOn::FSReadULong(String filepath){
 	    PLV_DEBUG_(dir.fileName());
 	    PLV_DEBUG(F("\""));
 
-        return strtoul(dir.fileName().substring(filepath.length() + 1).c_str(), NULL, 10);
+        return strtoul(FSEntryName(filepath, dir).c_str(), NULL, 10);
     } else {
         PLV_DEBUG(F("EMPTY DIRECTORY."));
     }
@@ -376,19 +616,19 @@ unsigned long PluviOn::FSReadULong(String filepath){
  * @param filepath Directory filepath
  * @return The String readed, or "" (blank) if it fails
  */
-String PluviOn::FSReadString(String filepath){
+String PluviOn::FSReadString(const String &filepath){
 
     PLV_DEBUG_(F("Reading String from filepath: \""));
     PLV_DEBUG_(filepath);
     PLV_DEBUG(F("\"")); 
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
         PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
     // Open the longitude directory
-    Dir dir = SPIFFS.openDir(filepath);
+    Dir dir = FSOpenDir(filepath.c_str());
 
     if(dir.next()){
 
@@ -396,7 +636,7 @@ String PluviOn::FSReadString(String filepath){
 	    PLV_DEBUG_(dir.fileName());
 	    PLV_DEBUG(F("\""));
 
-        return dir.fileName().substring(filepath.length() + 1);
+        return FSEntryName(filepath, dir);
     } else {
         PLV_DEBUG(F("EMPTY DIRECTORY."));
     }
@@ -412,21 +652,89 @@ void PluviOn::FSPrintFileList() {
     PLV_DEBUG(F("\n\nFILE LIST"));
     PLV_DEBUG(F("==========================================="));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
     	PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
-    Dir dir = SPIFFS.openDir("/");
     int fc = 0;
+    FSPrintDir("/", fc);
+}
+
+/**
+ * Print the files of a directory (and of its subdirectories, LittleFS only)
+ */
+void PluviOn::FSPrintDir(const char *directory, int &count) {
+
+    Dir dir = FSOpenDir(directory);
     while (dir.next()) {
-        ++fc;
-        PLV_DEBUG_(fc);
+
+        char filepath[PLV_FS_PATH_SIZE];
+        if (!FSEntryPath(filepath, directory, dir)) {
+            continue;
+        }
+
+        if (dir.isDirectory()) {
+            FSPrintDir(filepath, count);
+            continue;
+        }
+
+        ++count;
+        PLV_DEBUG_(count);
         PLV_DEBUG_(" - ");
-        PLV_DEBUG(dir.fileName());
+        PLV_DEBUG(filepath);
     }
 }
 
+/**
+ * Full path of a directory entry (SPIFFS returns full paths, LittleFS only the entry name)
+ *
+ * @param filepath Buffer (PLV_FS_PATH_SIZE bytes) for the full path
+ * @param directory Directory opened with openDir()
+ * @param dir Directory entry
+ * @return true if the path fits in the buffer, otherwise false.
+ */
+boolean PluviOn::FSEntryPath(char *filepath, const char *directory, Dir &dir) {
+
+    String name = dir.fileName();
+    int length;
+
+    if (name[0] == '/') {
+        length = snprintf(filepath, PLV_FS_PATH_SIZE, "%s", name.c_str());
+    } else if (strcmp(directory, "/") == 0) {
+        length = snprintf(filepath, PLV_FS_PATH_SIZE, "/%s", name.c_str());
+    } else {
+        length = snprintf(filepath, PLV_FS_PATH_SIZE, "%s/%s", directory, name.c_str());
+    }
+
+    if (length < 0 || length >= PLV_FS_PATH_SIZE) {
+        PLV_DEBUG(F("ERROR: File path too long."));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Name of a directory entry (the full path without the directory, on any backend)
+ *
+ * @param directory Directory opened with openDir()
+ * @param dir Directory entry
+ * @return The entry name
+ */
+String PluviOn::FSEntryName(const String &directory, Dir &dir) {
+
+    String name = dir.fileName();
+
+    // SPIFFS: "/stt/lat/-23.5"
+    if (name[0] == '/') {
+        return name.substring(directory.length() + 1);
+    }
+
+    // LittleFS: "-23.5"
+    return name;
+}
+
 /**
  * Format file system
  */
@@ -435,8 +743,8 @@ void PluviOn::FSFormat() {
     PLV_DEBUG(F("\n\nFORMATTING FILE SYSTEM"));
     PLV_DEBUG(F("==========================================="));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
     	PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
     }
 
@@ -445,7 +753,14 @@ void PluviOn::FSFormat() {
     PLV_DEBUG(F("Ok, \"a while\" is  -- uh -- too much generic, it takes 1m 20sec on average. Better, no? ;)"));
 
     int start = millis();
-    if (SPIFFS.format()) {
+    unsigned long startInMicros = micros();
+    boolean formatted = PLV_FS.format();
+    FSRecordOp(PLV_FS_OP_FORMAT, micros() - startInMicros);
+
+    if (formatted) {
+        _epoch          = 0;
+        _reclaimPending = false;
+
 	    PLV_DEBUG(F("SUCCESS: File system formatted successfully."));
 	    PLV_DEBUG_(F("Total time: "));
 	    PLV_DEBUG_((millis() - start));
@@ -456,20 +771,630 @@ void PluviOn::FSFormat() {
 }
 
 /**
- * Convert bytes in to KB and MB.
- *
- * @param bytes float number to be converted
- * @param prefix the unit to be converted.
- * @return the number formatted acording to the specified unit
+ * Instrumented open
  */
-float PluviOn::bytesConverter(float bytes, char prefix) {
+File PluviOn::FSOpen(const char *filepath, const char *mode) {
 
-    // Kilobyte (KB)
-    if (prefix == 'K') {
-	    return bytes / 1000;
+    // A file of an older epoch is gone for the readers, removed before a write
+    if (_reclaimPending && !FSIsKept(filepath)) {
+
+        if (mode[0] == 'r' && mode[1] != '+') {
+            if (!FSIsFresh(filepath)) {
+                return File();
+            }
+        } else {
+            FSFresh(filepath);
+        }
+    }
+
+    unsigned long start = micros();
+    File f = PLV_FS.open(filepath, mode);
+    FSRecordOp(PLV_FS_OP_OPEN, micros() - start);
+    return f;
+}
+
+/**
+ * Instrumented remove
+ */
+boolean PluviOn::FSRemove(const char *filepath) {
+    unsigned long start = micros();
+    boolean success = PLV_FS.remove(filepath);
+    FSRecordOp(PLV_FS_OP_REMOVE, micros() - start);
+    return success;
+}
+
+/**
+ * Instrumented rename
+ */
+boolean PluviOn::FSRename(const char *from, const char *to) {
+
+    if (_reclaimPending) {
+        FSFresh(to);
+    }
+
+    unsigned long start = micros();
+    boolean success = PLV_FS.rename(from, to);
+    FSRecordOp(PLV_FS_OP_RENAME, micros() - start);
+    return success;
+}
+
+/**
+ * Instrumented exists
+ */
+boolean PluviOn::FSExists(const char *filepath) {
+    unsigned long start = micros();
+    boolean exists = PLV_FS.exists(filepath);
+    FSRecordOp(PLV_FS_OP_EXISTS, micros() - start);
+
+    // A file of an older epoch waiting for the reclaim
+    if (exists && _reclaimPending && !FSIsKept(filepath) && !FSIsFresh(filepath)) {
+        return false;
+    }
+
+    return exists;
+}
+
+/**
+ * Instrumented openDir
+ */
+Dir PluviOn::FSOpenDir(const char *directory) {
+    unsigned long start = micros();
+    Dir dir = PLV_FS.openDir(directory);
+    FSRecordOp(PLV_FS_OP_OPENDIR, micros() - start);
+    return dir;
+}
+
+/**
+ * Instrumented read
+ */
+size_t PluviOn::FSRead(File &f, void *buffer, size_t length) {
+    unsigned long start = micros();
+    size_t read = f.read((uint8_t *) buffer, length);
+    FSRecordOp(PLV_FS_OP_READ, micros() - start);
+    return read;
+}
+
+/**
+ * Instrumented write (also counts the bytes written)
+ */
+size_t PluviOn::FSWrite(File &f, const void *buffer, size_t length) {
+    unsigned long start = micros();
+    size_t written = f.write((const uint8_t *) buffer, length);
+    FSRecordOp(PLV_FS_OP_WRITE, micros() - start);
+    _bytesWritten += written;
+    return written;
+}
+
+/**
+ * Account one operation
+ *
+ * @param op Operation type
+ * @param elapsedInMicros Operation latency
+ */
+void PluviOn::FSRecordOp(PluviOnFSOp op, unsigned long elapsedInMicros) {
+
+    if (op >= PLV_FS_OP_COUNT) {
+        return;
+    }
+
+    PluviOnFSOpStats &stats = _opStats[op];
+
+    if (!stats.count || elapsedInMicros < stats.minInMicros) {
+        stats.minInMicros = elapsedInMicros;
+    }
+
+    if (elapsedInMicros > stats.maxInMicros) {
+        stats.maxInMicros = elapsedInMicros;
+    }
+
+    stats.count++;
+    stats.totalInMicros += elapsedInMicros;
+
+    // log2 bucket
+    uint8_t bucket = 0;
+    while (elapsedInMicros && bucket < PLV_FS_HISTOGRAM_BUCKETS - 1) {
+        elapsedInMicros >>= 1;
+        bucket++;
+    }
+
+    if (stats.histogram[bucket] < 0xFFFF) {
+        stats.histogram[bucket]++;
+    }
+}
+
+/**
+ * @param op Operation type
+ * @return The counters and latency histogram of the operation type
+ */
+const PluviOnFSOpStats &PluviOn::FSOpStats(PluviOnFSOp op) {
+    return _opStats[op < PLV_FS_OP_COUNT ? op : 0];
+}
+
+/**
+ * Latency percentile, from the histogram (upper bound of the bucket)
+ *
+ * @param op Operation type
+ * @param percent Percentile (e.g. 99)
+ * @return The latency in us, or 0 if there are no samples
+ */
+unsigned long PluviOn::FSOpPercentile(PluviOnFSOp op, uint8_t percent) {
+
+    const PluviOnFSOpStats &stats = FSOpStats(op);
+
+    unsigned long samples = 0;
+    for (uint8_t bucket = 0; bucket < PLV_FS_HISTOGRAM_BUCKETS; bucket++) {
+        samples += stats.histogram[bucket];
+    }
+
+    if (!samples) {
+        return 0;
+    }
+
+    // Rank of the percentile sample (rounded up)
+    unsigned long rank = (samples * percent + 99) / 100;
+    unsigned long seen = 0;
+
+    for (uint8_t bucket = 0; bucket < PLV_FS_HISTOGRAM_BUCKETS - 1; bucket++) {
+
+        seen += stats.histogram[bucket];
+        if (seen >= rank) {
+            // Never above the slowest sample seen
+            return min((1UL << bucket) - 1, stats.maxInMicros);
+        }
+    }
+
+    return stats.maxInMicros;
+}
+
+/**
+ * Bytes written since the last reset of the stats
+ */
+unsigned long PluviOn::FSBytesWritten() {
+    return _bytesWritten;
+}
+
+/**
+ * Estimated flash erase blocks written since the last reset of the stats
+ */
+unsigned long PluviOn::FSEraseBlocks() {
+    return (_bytesWritten + PLV_FS_ERASE_BLOCK_SIZE - 1) / PLV_FS_ERASE_BLOCK_SIZE;
+}
+
+/**
+ * Print count, min/avg/p99/max latency of each operation type, bytes written and erase blocks
+ */
+void PluviOn::FSPrintStats() {
+
+    PLV_DEBUG(F("\n\nFILE SYSTEM STATS"));
+    PLV_DEBUG(F("==========================================="));
+    PLV_DEBUG(F("op        count     min(us)   avg(us)   p99(us)   max(us)"));
+
+    for (uint8_t op = 0; op < PLV_FS_OP_COUNT; op++) {
+
+        const PluviOnFSOpStats &stats = _opStats[op];
+
+        char line[80];
+        snprintf(line, sizeof(line), "%-9s %-9lu %-9lu %-9lu %-9lu %lu",
+            FS_OP_NAMES[op],
+            stats.count,
+            stats.minInMicros,
+            stats.count ? stats.totalInMicros / stats.count : 0,
+            FSOpPercentile((PluviOnFSOp) op, 99),
+            stats.maxInMicros);
+
+        PLV_DEBUG(line);
+    }
+
+    PLV_DEBUG_(F("Bytes written: "));
+    PLV_DEBUG(_bytesWritten);
+    PLV_DEBUG_(F("Erase blocks (estimated): "));
+    PLV_DEBUG(FSEraseBlocks());
+}
+
+/**
+ * Reset the operation stats
+ */
+void PluviOn::FSResetStats() {
+    memset(_opStats, 0, sizeof(_opStats));
+    _bytesWritten = 0;
+}
+
+/**
+ * Logical wipe: bump the storage epoch so the data of older epochs is
+ * ignored right away, then reclaim its space with FSReclaimStep().
+ *
+ * @return true if the new epoch was saved successfully, otherwise false.
+ */
+boolean PluviOn::FSWipe() {
+
+    PLV_DEBUG(F("\n\nWIPING FILE SYSTEM"));
+    PLV_DEBUG(F("==========================================="));
+
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    unsigned long start = micros();
+
+    // No file written in the new epoch yet (the ones written while an
+    // unfinished reclaim was pending belong to an older epoch now)
+    File fresh = FSOpen(PLV_FS_FRESH_FILE, "w");
+    uint32_t epoch = _epoch + 1;
+
+    if (!fresh || FSWrite(fresh, &epoch, sizeof(epoch)) != sizeof(epoch)) {
+        PLV_DEBUG(F("ERROR: Fail writing the list of new files."));
+        return false;
+    }
+
+    fresh.close();
+
+    _epoch          = epoch;
+    _reclaimPending = true;
+
+    if (!FSSaveEpoch()) {
+        PLV_DEBUG(F("ERROR: Fail saving storage epoch."));
+        return false;
+    }
+
+    PLV_DEBUG_(F("SUCCESS: Storage epoch "));
+    PLV_DEBUG_(_epoch);
+    PLV_DEBUG_(F(" started in "));
+    PLV_DEBUG_(micros() - start);
+    PLV_DEBUG(F(" us, older files are reclaimed in background."));
+
+    return true;
+}
+
+/**
+ * Remove one file left by an older epoch (call once per loop() iteration)
+ *
+ * @return true while there are files left to reclaim, otherwise false.
+ */
+boolean PluviOn::FSReclaimStep() {
+
+    if (!_reclaimPending) {
+        return false;
+    }
+
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    char filepath[PLV_FS_PATH_SIZE];
+
+    if (FSFindStale("/", filepath)) {
+
+        PLV_DEBUG_(F("Reclaiming: "));
+        PLV_DEBUG(filepath);
+
+        if (FSRemove(filepath)) {
+            return true;
+        }
+
+        PLV_DEBUG(F("ERROR: Fail reclaiming file, giving up."));
+    }
+
+    // Nothing left (or stuck), the reclaim is over
+    _reclaimPending = false;
+    FSSaveEpoch();
+    FSRemove(PLV_FS_FRESH_FILE);
+
+    PLV_DEBUG(F("SUCCESS: Reclaim finished."));
+
+    return false;
+}
+
+/**
+ * @return true while files of older epochs are left on the file system
+ */
+boolean PluviOn::FSReclaimPending() {
+    return _reclaimPending;
+}
+
+/**
+ * Current storage epoch
+ */
+uint32_t PluviOn::FSEpoch() {
+    return _epoch;
+}
+
+/**
+ * Keep the files under a path prefix when reclaiming
+ *
+ * @param prefix Path prefix (must remain valid, e.g. a literal)
+ */
+void PluviOn::FSKeep(const char *prefix) {
+
+    for (uint8_t i = 0; i < _keepCount; i++) {
+        if (strcmp(_keep[i], prefix) == 0) {
+            return;
+        }
+    }
+
+    if (_keepCount < PLV_FS_KEEP_MAX) {
+        _keep[_keepCount++] = prefix;
+    } else {
+        PLV_DEBUG(F("ERROR: Too many kept paths (PLV_FS_KEEP_MAX)."));
+    }
+}
+
+/**
+ * Convert bytes in to KB and MB.
+ *
+ * @param bytes float number to be converted
+ * @param prefix the unit to be converted.
+ * @return the number formatted acording to the specified unit
+ */
+float PluviOn::bytesConverter(float bytes, char prefix) {
+
+    // Kilobyte (KB)
+    if (prefix == 'K') {
+	    return bytes / 1000;
 
     // Megabyte (MB)
     } else if (prefix == 'M') {
     	return bytes / 1000000;
     }
-}
\ No newline at end of file
+
+    // Unknown prefix, bytes
+    return bytes;
+}
+
+/**
+ * CRC32 (IEEE 802.3) checksum
+ *
+ * @param data Data buffer
+ * @param length Buffer length in bytes
+ * @param crc Previous CRC, to checksum data in several calls
+ * @return the CRC32 of the data
+ */
+uint32_t PluviOn::crc32(const void *data, size_t length, uint32_t crc) {
+
+    const uint8_t *bytes = (const uint8_t *) data;
+
+    crc = ~crc;
+    while (length--) {
+        crc ^= *bytes++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+/**
+ * Build "directory/filename" into a PLV_FS_PATH_SIZE stack buffer
+ *
+ * @return true if the path fits in the buffer, otherwise false.
+ */
+boolean PluviOn::FSPath(char *filepath, const char *directory, const char *filename) {
+
+    int length = snprintf(filepath, PLV_FS_PATH_SIZE, "%s/%s", directory, filename);
+
+    if (length < 0 || length >= PLV_FS_PATH_SIZE) {
+        PLV_DEBUG(F("ERROR: File path too long."));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Build filepath + PLV_FS_TMP_SUFFIX into a PLV_FS_PATH_SIZE stack buffer
+ *
+ * @return true if the path fits in the buffer, otherwise false.
+ */
+boolean PluviOn::FSTmpPath(char *tmppath, const char *filepath) {
+
+    int length = snprintf(tmppath, PLV_FS_PATH_SIZE, "%s%s", filepath, PLV_FS_TMP_SUFFIX);
+
+    if (length < 0 || length >= PLV_FS_PATH_SIZE) {
+        PLV_DEBUG(F("ERROR: File path too long."));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Create (or truncate) a file and write a buffer to it
+ *
+ * @param newline true to end the content with "\r\n" (println)
+ */
+boolean PluviOn::FSWriteContent(const char *directory, const char *filename, const uint8_t *content, size_t length, boolean newline) {
+
+    PLV_DEBUG_(F("Creating file: \""));
+    PLV_DEBUG_(directory);
+    PLV_DEBUG_(F("/"));
+    PLV_DEBUG_(filename);
+    PLV_DEBUG_(F("\" ("));
+    PLV_DEBUG_(length);
+    PLV_DEBUG(F(" bytes)"));
+
+    // Mounts SPIFFS file system (once per session)
+    if (!begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+    }
+
+    // Mount filepath
+    char filepath[PLV_FS_PATH_SIZE];
+    if (!FSPath(filepath, directory, filename)) {
+        return false;
+    }
+
+    boolean success = true;
+
+    // Open/Create file
+    File f = FSOpen(filepath, "w");
+    if (f) {
+        PLV_DEBUG(F("SUCCESS: File created."));
+
+        // Check if the content was saved successfully
+        if (FSWrite(f, content, length) == length && (!newline || FSWrite(f, (const uint8_t *) "\r\n", 2) == 2)) {
+            PLV_DEBUG(F("SUCCESS: Content saved to file."));
+        } else {
+            success = false;
+        }
+
+        f.close();
+    } else {
+        success = false;
+        PLV_DEBUG(F("ERROR: Fail creating file."));
+    }
+
+    return success;
+}
+
+/**
+ * Read the storage epoch file (finishing an interrupted save)
+ */
+void PluviOn::FSLoadEpoch() {
+
+    _epoch          = 0;
+    _reclaimPending = false;
+
+    FSRecoverAtomic(PLV_FS_EPOCH_FILE);
+
+    File f = FSOpen(PLV_FS_EPOCH_FILE, "r");
+    if (!f) {
+        return;
+    }
+
+    PluviOnEpochData data;
+    size_t read = FSRead(f, (uint8_t *) &data, sizeof(data));
+    f.close();
+
+    if (read != sizeof(data) || data.magic != PLV_FS_EPOCH_MAGIC ||
+        data.crc != crc32(&data, offsetof(PluviOnEpochData, crc))) {
+        PLV_DEBUG(F("ERROR: Invalid storage epoch file."));
+        return;
+    }
+
+    _epoch          = data.epoch;
+    _reclaimPending = data.reclaim;
+}
+
+/**
+ * Write the storage epoch file
+ */
+boolean PluviOn::FSSaveEpoch() {
+
+    PluviOnEpochData data;
+    data.magic   = PLV_FS_EPOCH_MAGIC;
+    data.epoch   = _epoch;
+    data.reclaim = _reclaimPending;
+    data.crc     = crc32(&data, offsetof(PluviOnEpochData, crc));
+
+    return FSWriteAtomic(PLV_FS_EPOCH_FILE, (const uint8_t *) &data, sizeof(data));
+}
+
+/**
+ * Find the first file of an older epoch (recursing into LittleFS directories)
+ *
+ * @return true if a file was found, otherwise false.
+ */
+boolean PluviOn::FSFindStale(const char *directory, char *filepath) {
+
+    Dir dir = FSOpenDir(directory);
+    while (dir.next()) {
+
+        if (!FSEntryPath(filepath, directory, dir) || FSIsKept(filepath)) {
+            continue;
+        }
+
+        if (!dir.isDirectory()) {
+            if (FSIsFresh(filepath)) {
+                continue;
+            }
+            return true;
+        }
+
+        char subdirectory[PLV_FS_PATH_SIZE];
+        strcpy(subdirectory, filepath);
+
+        if (FSFindStale(subdirectory, filepath)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @return true if the file was written in the current epoch while the
+ *         reclaim is pending (listed in PLV_FS_FRESH_FILE)
+ */
+boolean PluviOn::FSIsFresh(const char *filepath) {
+
+    File fresh = FSOpen(PLV_FS_FRESH_FILE, "r");
+    if (!fresh) {
+        return false;
+    }
+
+    char     entry[PLV_FS_PATH_SIZE];
+    uint32_t epoch = 0;
+    boolean  found = false;
+
+    // A list of another epoch: the wipe was interrupted before saving the epoch
+    if (FSRead(fresh, &epoch, sizeof(epoch)) == sizeof(epoch) && epoch == _epoch) {
+
+        while (!found && FSRead(fresh, entry, sizeof(entry)) == sizeof(entry)) {
+            entry[sizeof(entry) - 1] = '\0';
+            found = strcmp(entry, filepath) == 0;
+        }
+    }
+
+    fresh.close();
+
+    return found;
+}
+
+/**
+ * Written in the current epoch while the reclaim is pending: remove the
+ * file of the older epoch first (so an append or an update doesn't bring
+ * its content back) and list it as new, so the reclaim doesn't remove it
+ */
+void PluviOn::FSFresh(const char *filepath) {
+
+    if (FSIsKept(filepath) || FSIsFresh(filepath)) {
+        return;
+    }
+
+    if (PLV_FS.exists(filepath)) {
+        FSRemove(filepath);
+    }
+
+    char entry[PLV_FS_PATH_SIZE];
+    memset(entry, 0, sizeof(entry));
+    strncpy(entry, filepath, sizeof(entry) - 1);
+
+    File fresh = FSOpen(PLV_FS_FRESH_FILE, "a");
+    if (!fresh || FSWrite(fresh, entry, sizeof(entry)) != sizeof(entry)) {
+        PLV_DEBUG(F("ERROR: Fail listing new file."));
+    }
+
+    fresh.close();
+}
+
+/**
+ * @return true if the file survives the reclaim
+ */
+boolean PluviOn::FSIsKept(const char *filepath) {
+
+    if (strncmp(filepath, PLV_FS_EPOCH_FILE, strlen(PLV_FS_EPOCH_FILE)) == 0) {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < _keepCount; i++) {
+        if (strncmp(filepath, _keep[i], strlen(_keep[i])) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -13,9 +13,39 @@
 #ifndef PluviOn_h
 #define PluviOn_h
 
+#ifdef ESP8266
 extern "C" {
     #include "user_interface.h"
 }
+#endif
+
+// Storage backends
+#define PLV_FS_SPIFFS   0
+#define PLV_FS_LITTLEFS 1
+
+// Storage backend, chosen at compile time. The library is compiled apart from
+// the sketch, so set it with a build flag (-DPLV_FS_BACKEND=PLV_FS_LITTLEFS)
+// or here, not with a #define in the sketch.
+#ifndef PLV_FS_BACKEND
+#define PLV_FS_BACKEND PLV_FS_SPIFFS
+#endif
+
+// File system used by the library (and the sketches). Define it to use any
+// other fs::FS instance (e.g. an off-target emulation backed by a local directory).
+#ifndef PLV_FS
+#if PLV_FS_BACKEND == PLV_FS_LITTLEFS
+#include <LittleFS.h>
+#define PLV_FS      LittleFS
+#define PLV_FS_NAME "LittleFS"
+#else
+#define PLV_FS      SPIFFS
+#define PLV_FS_NAME "SPIFFS"
+#endif
+#endif
+
+#ifndef PLV_FS_NAME
+#define PLV_FS_NAME "custom"
+#endif
 
 #if PLV_DEBUG_ENABLED
 #define PLV_DEBUG_(text) { Serial.print( (text) ); }
@@ -35,6 +65,78 @@ extern "C" {
 #define PLV_DEBUG(text) {}
 #endif
 
+// Maximum file path length, including the terminating NUL (SPIFFS_OBJ_NAME_LEN)
+#ifndef PLV_FS_PATH_SIZE
+#define PLV_FS_PATH_SIZE 32
+#endif
+
+// Suffix of the temporary file written by FSWriteAtomic (the journal checked by FSRecoverAtomic)
+#ifndef PLV_FS_TMP_SUFFIX
+#define PLV_FS_TMP_SUFFIX ".tmp"
+#endif
+
+// Storage epoch file (survives FSWipe, everything else belongs to an epoch)
+#define PLV_FS_EPOCH_FILE  "/epoch"
+#define PLV_FS_EPOCH_MAGIC 0x45564C50 // "PLVE"
+
+// Files written in the current epoch while the reclaim is pending: the epoch
+// FSWipe() started, then a PLV_FS_PATH_SIZE record per file. Every other file
+// that isn't kept (see FSKeep) belongs to an older epoch. Kept by the reclaim,
+// as every "/epoch" path.
+#define PLV_FS_FRESH_FILE "/epoch.fresh"
+
+// Maximum number of path prefixes kept by the reclaim (see FSKeep)
+#ifndef PLV_FS_KEEP_MAX
+#define PLV_FS_KEEP_MAX 4
+#endif
+
+/**
+ * Storage epoch file image
+ */
+struct PluviOnEpochData {
+    uint32_t magic;
+    uint32_t epoch;
+    uint32_t reclaim;  // 1 while the files of older epochs are being removed
+    uint32_t crc;      // CRC32 of the fields above
+};
+
+// Flash erase block size, used to estimate the erase blocks written
+#ifndef PLV_FS_ERASE_BLOCK_SIZE
+#define PLV_FS_ERASE_BLOCK_SIZE 4096
+#endif
+
+// Latency histogram buckets: bucket 0 = 0 us, bucket i = [2^(i-1), 2^i) us, the last one catches the rest
+#ifndef PLV_FS_HISTOGRAM_BUCKETS
+#define PLV_FS_HISTOGRAM_BUCKETS 20
+#endif
+
+/**
+ * Instrumented file system operations
+ */
+enum PluviOnFSOp {
+    PLV_FS_OP_MOUNT = 0,
+    PLV_FS_OP_OPEN,
+    PLV_FS_OP_READ,
+    PLV_FS_OP_WRITE,
+    PLV_FS_OP_REMOVE,
+    PLV_FS_OP_RENAME,
+    PLV_FS_OP_EXISTS,
+    PLV_FS_OP_OPENDIR,
+    PLV_FS_OP_FORMAT,
+    PLV_FS_OP_COUNT
+};
+
+/**
+ * Counters and latency histogram of one operation type
+ */
+struct PluviOnFSOpStats {
+    unsigned long count;
+    unsigned long totalInMicros;
+    unsigned long minInMicros;
+    unsigned long maxInMicros;
+    uint16_t      histogram[PLV_FS_HISTOGRAM_BUCKETS]; // Saturates at 65535
+};
+
 // Serial debug
 #if PLV_DEBUG_ENABLED
 #define PLV_DEBUG_SETUP(baudrate) { Serial.begin( (baudrate) ); }
@@ -47,6 +149,46 @@ class PluviOn
     public:
         PluviOn();
 
+        /**
+         * Mount the file system for the whole session.
+         *
+         * The mount state is shared by every PluviOn instance (and by the
+         * WiFiManager config getters), so calling it again while the file
+         * system is mounted costs nothing.
+         *
+         * @return true if the file system is mounted, otherwise false.
+         */
+        static boolean       begin();
+
+        /**
+         * Unmount the file system (call before restart or sleep)
+         */
+        static void          end();
+
+        /**
+         * @return true if the file system is currently mounted.
+         */
+        static boolean       isMounted();
+
+        /**
+         * Number of mount requests (calls to begin()) since the last reset of the stats
+         */
+        static unsigned long FSMountRequests();
+
+        /**
+         * Number of real file system mounts since the last reset of the stats
+         */
+        static unsigned long FSMountCount();
+
+        /**
+         * Time spent mounting the file system since the last reset of the stats
+         */
+        static unsigned long FSMountTimeInMicros();
+
+        /**
+         * Reset the mount stats (call at the beginning of each loop() iteration)
+         */
+        static void          FSResetMountStats();
 
         /**
          * Create a file in File System
@@ -55,7 +197,7 @@ class PluviOn
          * @param filename File Name
          * @return true if file was created successfully, otherwise false.
          */
-        boolean       FSCreateFile(String directory, String filename);
+        boolean       FSCreateFile(const String &directory, const String &filename);
 
         /**
          * Create a file in File System
@@ -64,7 +206,7 @@ class PluviOn
          * @param filename File Name
          * @return true if file was created successfully, otherwise false.
          */
-        boolean       FSCreateFile(String directory, int filename);
+        boolean       FSCreateFile(const String &directory, int filename);
 
         /**
          * Create a file in File System
@@ -73,7 +215,43 @@ class PluviOn
          * @param filename File Name
          * @return true if file was created successfully, otherwise false.
          */
-        boolean       FSCreateFile(String directory, unsigned long filename);
+        boolean       FSCreateFile(const String &directory, unsigned long filename);
+
+        /**
+         * Create a file in File System (the path is built on the stack, no heap allocation)
+         * 
+         * @param directory Directory path
+         * @param filename File Name
+         * @return true if file was created successfully, otherwise false.
+         */
+        boolean       FSCreateFile(const char *directory, const char *filename);
+
+        /**
+         * Create a file in File System (the path is built on the stack, no heap allocation)
+         * 
+         * @param directory Directory path
+         * @param filename File Name
+         * @return true if file was created successfully, otherwise false.
+         */
+        boolean       FSCreateFile(const char *directory, int filename);
+
+        /**
+         * Create a file in File System (the path is built on the stack, no heap allocation)
+         * 
+         * @param directory Directory path
+         * @param filename File Name
+         * @return true if file was created successfully, otherwise false.
+         */
+        boolean       FSCreateFile(const char *directory, unsigned long filename);
+
+        /**
+         * Create a file in File System (the path is built on the stack, no heap allocation)
+         * 
+         * @param directory Directory path (flash string, F("..."))
+         * @param filename File Name
+         * @return true if file was created successfully, otherwise false.
+         */
+        boolean       FSCreateFile(const __FlashStringHelper *directory, const char *filename);
 
         /**
          * Write content to a file
@@ -83,7 +261,63 @@ class PluviOn
          * @param content File Content
          * @return true if content was created successfully, otherwise false.
          */
-        boolean       FSWriteToFile(String directory, int filename, String content);
+        boolean       FSWriteToFile(const String &directory, int filename, const String &content);
+
+        /**
+         * Write a buffer to a file (written as is, no line ending is added)
+         * 
+         * @param directory Directory path
+         * @param filename File Name
+         * @param content Content buffer
+         * @param length Content length in bytes
+         * @return true if content was created successfully, otherwise false.
+         */
+        boolean       FSWriteToFile(const char *directory, const char *filename, const uint8_t *content, size_t length);
+
+        /**
+         * Write a buffer to a file (written as is, no line ending is added)
+         * 
+         * @param directory Directory path
+         * @param filename File Name
+         * @param content Content buffer
+         * @param length Content length in bytes
+         * @return true if content was created successfully, otherwise false.
+         */
+        boolean       FSWriteToFile(const char *directory, int filename, const uint8_t *content, size_t length);
+
+        /**
+         * Write a buffer to a file (written as is, no line ending is added)
+         * 
+         * @param directory Directory path (flash string, F("..."))
+         * @param filename File Name
+         * @param content Content buffer
+         * @param length Content length in bytes
+         * @return true if content was created successfully, otherwise false.
+         */
+        boolean       FSWriteToFile(const __FlashStringHelper *directory, const char *filename, const uint8_t *content, size_t length);
+
+        /**
+         * Replace a file content, power loss safe.
+         *
+         * The content is written to filepath + PLV_FS_TMP_SUFFIX first and only
+         * then moved over the file, so the file always holds either the old or
+         * the new content. Call FSRecoverAtomic() at boot to finish (or discard)
+         * a replacement interrupted by a reset.
+         *
+         * @param filepath File path
+         * @param content Content buffer
+         * @param length Content length in bytes
+         * @return true if the content was written successfully, otherwise false.
+         */
+        static boolean FSWriteAtomic(const char *filepath, const uint8_t *content, size_t length);
+
+        /**
+         * Finish or discard a FSWriteAtomic() interrupted by a reset
+         *
+         * @param filepath File path
+         * @return true if the file is consistent, otherwise false.
+         */
+        static boolean FSRecoverAtomic(const char *filepath);
 
         /**
          * Deletes all files from the given directory.
@@ -92,7 +326,16 @@ class PluviOn
          *
          * @return true if all files was deleted successfully, otherwise false.
          */
-        boolean       FSDeleteFiles(String directory);
+        boolean       FSDeleteFiles(const String &directory);
+
+        /**
+         * Deletes all files from the given directory.
+         * 
+         * @param directory Directory absolute path
+         *
+         * @return true if all files was deleted successfully, otherwise false.
+         */
+        boolean       FSDeleteFiles(const char *directory);
 
         /**
          * Delete file.
@@ -102,7 +345,17 @@ class PluviOn
          *
          * @return true if file was deleted successfully, otherwise false.
          */
-        boolean       FSDeleteFile(String directory, int filename);
+        boolean       FSDeleteFile(const String &directory, int filename);
+
+        /**
+         * Delete file (the path is built on the stack, no heap allocation).
+         * 
+         * @param directory Directory absolute path
+         * @param filename Filename
+         *
+         * @return true if file was deleted successfully, otherwise false.
+         */
+        boolean       FSDeleteFile(const char *directory, int filename);
 
         /**
          * Read int value from File System
@@ -110,7 +363,7 @@ class PluviOn
          * @param filepath Directory filepath
          * @return The number readed, or 0 if it fails
          */
-        unsigned int  FSReadInt(String filepath);
+        unsigned int  FSReadInt(const String &filepath);
 
         /**
          * Read float value from File System
@@ -118,7 +371,7 @@ class PluviOn
          * @param filepath Directory filepath
          * @return The number readed, or 0 if it fails
          */
-        float         FSReadFloat(String filepath);
+        float         FSReadFloat(const String &filepath);
 
         /**
          * Read unsigned long value from File System
@@ -126,7 +379,7 @@ class PluviOn
          * @param filepath Directory filepath
          * @return The number readed, or 0 if it fails
          */
-        unsigned long FSReadULong(String filepath);
+        unsigned long FSReadULong(const String &filepath);
 
         /**
          * Read String value from File System
@@ -134,17 +387,139 @@ class PluviOn
          * @param filepath Directory filepath
          * @return The String readed, or "" (blank) if it fails
          */
-        String        FSReadString(String filepath);
+        String        FSReadString(const String &filepath);
 
         /**
          * Print the system's file list
          */
         void           FSPrintFileList();
 
+        /**
+         * Full path of a directory entry.
+         *
+         * SPIFFS has a flat namespace and returns full paths ("/stt/lat/-23.5"),
+         * LittleFS has real directories and returns only the entry name ("-23.5").
+         *
+         * @param filepath Buffer (PLV_FS_PATH_SIZE bytes) for the full path
+         * @param directory Directory opened with openDir()
+         * @param dir Directory entry
+         * @return true if the path fits in the buffer, otherwise false.
+         */
+        static boolean FSEntryPath(char *filepath, const char *directory, Dir &dir);
+
+        /**
+         * Name of a directory entry (the full path without the directory, on any backend)
+         *
+         * @param directory Directory opened with openDir()
+         * @param dir Directory entry
+         * @return The entry name
+         */
+        static String  FSEntryName(const String &directory, Dir &dir);
+
         /**
          * Format file system
          */
-        void           FSFormat();        
+        void           FSFormat();
+
+        /**
+         * Instrumented file system calls (same as the PLV_FS ones, timed and counted)
+         */
+        static File    FSOpen(const char *filepath, const char *mode);
+        static boolean FSRemove(const char *filepath);
+        static boolean FSRename(const char *from, const char *to);
+        static boolean FSExists(const char *filepath);
+        static Dir     FSOpenDir(const char *directory);
+        static size_t  FSRead(File &f, void *buffer, size_t length);
+        static size_t  FSWrite(File &f, const void *buffer, size_t length);
+
+        /**
+         * Account one operation (for file system calls made outside PluviOn)
+         *
+         * @param op Operation type
+         * @param elapsedInMicros Operation latency
+         */
+        static void    FSRecordOp(PluviOnFSOp op, unsigned long elapsedInMicros);
+
+        /**
+         * @param op Operation type
+         * @return The counters and latency histogram of the operation type
+         */
+        static const PluviOnFSOpStats &FSOpStats(PluviOnFSOp op);
+
+        /**
+         * Latency percentile, from the histogram (upper bound of the bucket)
+         *
+         * @param op Operation type
+         * @param percent Percentile (e.g. 99)
+         * @return The latency in us, or 0 if there are no samples
+         */
+        static unsigned long FSOpPercentile(PluviOnFSOp op, uint8_t percent);
+
+        /**
+         * Bytes written since the last reset of the stats
+         */
+        static unsigned long FSBytesWritten();
+
+        /**
+         * Estimated flash erase blocks written since the last reset of the stats
+         */
+        static unsigned long FSEraseBlocks();
+
+        /**
+         * Print count, min/avg/p99/max latency of each operation type, bytes written and erase blocks
+         */
+        static void    FSPrintStats();
+
+        /**
+         * Reset the operation stats
+         */
+        static void    FSResetStats();
+
+        /**
+         * Logical wipe: bump the storage epoch so the data of older epochs is
+         * ignored right away, then reclaim its space with FSReclaimStep().
+         * Takes two small file writes (no file is listed), where FSFormat()
+         * takes more than a minute.
+         *
+         * Until the reclaim is over, the files of the older epochs outside
+         * the FSKeep() prefixes (e.g. the legacy /weather files, the WiFi
+         * firmware's /data) are gone for FSOpen() and FSExists(), but still
+         * listed by FSOpenDir().
+         *
+         * @return true if the new epoch was saved successfully, otherwise false.
+         */
+        static boolean FSWipe();
+
+        /**
+         * Remove one file left by an older epoch (call once per loop() iteration).
+         * A file written since the wipe (FSOpen() for writing, FSRename() onto
+         * it) belongs to the current epoch and stays, whether its writer
+         * called FSKeep() or not; writing a file of an older epoch removes it
+         * first, so an append doesn't bring its content back.
+         *
+         * @return true while there are files left to reclaim, otherwise false.
+         */
+        static boolean FSReclaimStep();
+
+        /**
+         * @return true while files of older epochs are left on the file system
+         */
+        static boolean FSReclaimPending();
+
+        /**
+         * Current storage epoch (mix it into the CRC of epoch aware data, so the
+         * data of older epochs fails validation)
+         */
+        static uint32_t FSEpoch();
+
+        /**
+         * Keep the files under a path prefix when reclaiming (for files that
+         * are epoch aware or rewritten in the current epoch, e.g. the config
+         * file and the message log)
+         *
+         * @param prefix Path prefix (must remain valid, e.g. a literal)
+         */
+        static void    FSKeep(const char *prefix);
 
         /**
          * Convert bytes in to KB and MB.
@@ -154,6 +529,39 @@ class PluviOn
          * @return the number formatted acording to the specified unit
          */
         float          bytesConverter(float bytes, char prefix);
+
+        /**
+         * CRC32 (IEEE 802.3) checksum
+         *
+         * @param data Data buffer
+         * @param length Buffer length in bytes
+         * @param crc Previous CRC, to checksum data in several calls
+         * @return the CRC32 of the data
+         */
+        static uint32_t crc32(const void *data, size_t length, uint32_t crc = 0);
+
+    private:
+        static boolean       FSPath(char *filepath, const char *directory, const char *filename);
+        static boolean       FSTmpPath(char *tmppath, const char *filepath);
+        static void          FSLoadEpoch();
+        static boolean       FSSaveEpoch();
+        static boolean       FSFindStale(const char *directory, char *filepath);
+        static boolean       FSIsFresh(const char *filepath);
+        static void          FSFresh(const char *filepath);
+        static boolean       FSIsKept(const char *filepath);
+        void                 FSPrintDir(const char *directory, int &count);
+        static boolean       FSWriteContent(const char *directory, const char *filename, const uint8_t *content, size_t length, boolean newline);
+
+        static boolean       _mounted;
+        static unsigned long _mountRequests;
+        static unsigned long _mountCount;
+        static unsigned long _mountTimeInMicros;
+        static uint32_t      _epoch;
+        static boolean       _reclaimPending;
+        static const char   *_keep[PLV_FS_KEEP_MAX];
+        static uint8_t       _keepCount;
+        static PluviOnFSOpStats _opStats[PLV_FS_OP_COUNT];
+        static unsigned long _bytesWritten;
 };
 
 #endif
@@ -0,0 +1,431 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnConfigStore.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+#include <stddef.h>
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnConfigStore.h"
+
+// Slot types
+#define PLV_CFG_TYPE_INT    0
+#define PLV_CFG_TYPE_FLOAT  1
+#define PLV_CFG_TYPE_STRING 2
+
+/**
+ * Fixed typed slot of a config key
+ */
+struct PluviOnConfigSlot {
+    uint8_t     type;
+    uint8_t     offset;    // Offset in PluviOnConfigData
+    uint8_t     size;      // Slot size in bytes
+    const char *legacyDir; // Directory where the value was encoded in the file name (migration only)
+};
+
+static const PluviOnConfigSlot CONFIG_SLOTS[PLV_CFG_KEY_COUNT] = {
+    { PLV_CFG_TYPE_INT,    offsetof(PluviOnConfigData, messageID),       sizeof(int32_t),                                    "/msgcnt"        },
+    { PLV_CFG_TYPE_INT,    offsetof(PluviOnConfigData, stationTime),     sizeof(int32_t),                                    "/stt/time"      },
+    { PLV_CFG_TYPE_INT,    offsetof(PluviOnConfigData, timeToReset),     sizeof(int32_t),                                    "/stt/ttr"       },
+    { PLV_CFG_TYPE_FLOAT,  offsetof(PluviOnConfigData, bucketVolume),    sizeof(float),                                      "/stt/bucketvol" },
+    { PLV_CFG_TYPE_STRING, offsetof(PluviOnConfigData, latitude),        sizeof(((PluviOnConfigData *) 0)->latitude),        "/stt/lat"       },
+    { PLV_CFG_TYPE_STRING, offsetof(PluviOnConfigData, longitude),       sizeof(((PluviOnConfigData *) 0)->longitude),       "/stt/lon"       },
+    { PLV_CFG_TYPE_STRING, offsetof(PluviOnConfigData, stationName),     sizeof(((PluviOnConfigData *) 0)->stationName),     "/stt/name"      },
+    { PLV_CFG_TYPE_STRING, offsetof(PluviOnConfigData, stationID),       sizeof(((PluviOnConfigData *) 0)->stationID),       "/stt/id"        },
+    { PLV_CFG_TYPE_STRING, offsetof(PluviOnConfigData, firmwareVersion), sizeof(((PluviOnConfigData *) 0)->firmwareVersion), "/fmwver"        }
+};
+
+PluviOnConfigStore::PluviOnConfigStore(PluviOn &pluvion) : _pluvion(pluvion), _writeCount(0), _dirty(false),
+    _dirtySinceInMillis(0), _commitDelayInMillis(PLV_CONFIG_COMMIT_DELAY) {
+    reset();
+}
+
+/**
+ * Load the config file into RAM.
+ *
+ * @return true if the config was loaded (or migrated) successfully, otherwise false.
+ */
+boolean PluviOnConfigStore::begin() {
+
+    PLV_DEBUG_(F("Loading config file: \""));
+    PLV_DEBUG_(F(PLV_CONFIG_FILE));
+    PLV_DEBUG(F("\""));
+
+    // Mounts SPIFFS file system (once per session)
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    // The config file is rewritten in the current epoch, never reclaimed
+    PluviOn::FSKeep(PLV_CONFIG_FILE);
+
+    // Finish (or discard) a save interrupted by a reset
+    PluviOn::FSRecoverAtomic(PLV_CONFIG_FILE);
+
+    if (load()) {
+        PLV_DEBUG(F("SUCCESS: Config loaded."));
+        return true;
+    }
+
+    reset();
+
+    // Legacy directories left by a wipe belong to an older epoch, ignore them
+    if (PluviOn::FSReclaimPending()) {
+        PLV_DEBUG(F("Config file not found (storage wiped). Starting with no values."));
+        return true;
+    }
+
+    PLV_DEBUG(F("Config file not found or corrupted. Migrating legacy config..."));
+
+    migrate();
+
+    if (!save()) {
+        return false;
+    }
+
+    // The legacy directories are only removed once the config file is safe
+    for (uint8_t key = 0; key < PLV_CFG_KEY_COUNT; key++) {
+        _pluvion.FSDeleteFiles(CONFIG_SLOTS[key].legacyDir);
+    }
+
+    return true;
+}
+
+/**
+ * Forget all values, in RAM and on the file system
+ */
+void PluviOnConfigStore::clear() {
+
+    PLV_DEBUG(F("Clearing config..."));
+
+    reset();
+    _dirty = false;
+
+    // Mounts SPIFFS file system (once per session)
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return;
+    }
+
+    PluviOn::FSRemove(PLV_CONFIG_FILE);
+    PluviOn::FSRemove(PLV_CONFIG_FILE PLV_FS_TMP_SUFFIX);
+}
+
+/**
+ * @param key Config key
+ * @return true if the key has a value
+ */
+boolean PluviOnConfigStore::has(PluviOnConfigKey key) {
+    return key < PLV_CFG_KEY_COUNT && (_data.present & (1 << key));
+}
+
+/**
+ * Read int value
+ *
+ * @param key Config key
+ * @return The value, or 0 if the key has no value
+ */
+long PluviOnConfigStore::getInt(PluviOnConfigKey key) {
+
+    if (!has(key) || CONFIG_SLOTS[key].type != PLV_CFG_TYPE_INT) {
+        return 0;
+    }
+
+    int32_t value;
+    memcpy(&value, (uint8_t *) &_data + CONFIG_SLOTS[key].offset, sizeof(value));
+
+    return value;
+}
+
+/**
+ * Read float value
+ *
+ * @param key Config key
+ * @return The value, or 0 if the key has no value
+ */
+float PluviOnConfigStore::getFloat(PluviOnConfigKey key) {
+
+    if (!has(key) || CONFIG_SLOTS[key].type != PLV_CFG_TYPE_FLOAT) {
+        return 0;
+    }
+
+    float value;
+    memcpy(&value, (uint8_t *) &_data + CONFIG_SLOTS[key].offset, sizeof(value));
+
+    return value;
+}
+
+/**
+ * Read String value
+ *
+ * @param key Config key
+ * @return The value, or "" (blank) if the key has no value
+ */
+const char *PluviOnConfigStore::getString(PluviOnConfigKey key) {
+
+    if (!has(key) || CONFIG_SLOTS[key].type != PLV_CFG_TYPE_STRING) {
+        return "";
+    }
+
+    return (const char *) &_data + CONFIG_SLOTS[key].offset;
+}
+
+/**
+ * Stage int value in RAM (written by commit() or flush(), only if the value changes)
+ *
+ * @param key Config key
+ * @param value Value
+ * @return true if the value was staged successfully, otherwise false.
+ */
+boolean PluviOnConfigStore::setInt(PluviOnConfigKey key, long value) {
+
+    if (key >= PLV_CFG_KEY_COUNT || CONFIG_SLOTS[key].type != PLV_CFG_TYPE_INT) {
+        return false;
+    }
+
+    int32_t v = value;
+    return set(key, &v, sizeof(v));
+}
+
+/**
+ * Stage float value in RAM (written by commit() or flush(), only if the value changes)
+ *
+ * @param key Config key
+ * @param value Value
+ * @return true if the value was staged successfully, otherwise false.
+ */
+boolean PluviOnConfigStore::setFloat(PluviOnConfigKey key, float value) {
+
+    if (key >= PLV_CFG_KEY_COUNT || CONFIG_SLOTS[key].type != PLV_CFG_TYPE_FLOAT) {
+        return false;
+    }
+
+    return set(key, &value, sizeof(value));
+}
+
+/**
+ * Stage String value in RAM (written by commit() or flush(), only if the value changes)
+ *
+ * @param key Config key
+ * @param value Value (truncated to the slot size, logged)
+ * @return true if the value was staged successfully, otherwise false.
+ */
+boolean PluviOnConfigStore::setString(PluviOnConfigKey key, const char *value) {
+
+    if (key >= PLV_CFG_KEY_COUNT || CONFIG_SLOTS[key].type != PLV_CFG_TYPE_STRING) {
+        return false;
+    }
+
+    value = value ? value : "";
+
+    if (strlen(value) >= CONFIG_SLOTS[key].size) {
+        PLV_DEBUG_(F("ERROR: Config value too long, truncated: "));
+        PLV_DEBUG(value);
+    }
+
+    // Zero padded, always NUL terminated
+    char slot[sizeof(((PluviOnConfigData *) 0)->stationID)];
+    memset(slot, 0, sizeof(slot));
+    strncpy(slot, value, CONFIG_SLOTS[key].size - 1);
+
+    return set(key, slot, CONFIG_SLOTS[key].size);
+}
+
+/**
+ * Write the staged changes, all at once, if the commit delay has passed
+ * since the first of them (call once per loop() iteration)
+ *
+ * @return true if there is nothing left to write, otherwise false.
+ */
+boolean PluviOnConfigStore::commit() {
+
+    if (!_dirty) {
+        return true;
+    }
+
+    if (millis() - _dirtySinceInMillis < _commitDelayInMillis) {
+        return false;
+    }
+
+    return flush();
+}
+
+/**
+ * Write the staged changes now (call before restart or sleep)
+ *
+ * @return true if there is nothing left to write, otherwise false.
+ */
+boolean PluviOnConfigStore::flush() {
+
+    if (!_dirty) {
+        return true;
+    }
+
+    // Keep the changes staged if the write fails, the next commit retries it
+    if (!save()) {
+        return false;
+    }
+
+    _dirty = false;
+
+    return true;
+}
+
+/**
+ * Set how long a staged change may wait before commit() writes it
+ *
+ * @param delayInMillis Delay in ms (0 = write on every commit() call)
+ */
+void PluviOnConfigStore::setCommitDelay(unsigned long delayInMillis) {
+    _commitDelayInMillis = delayInMillis;
+}
+
+/**
+ * @return true if there are staged changes not written yet
+ */
+boolean PluviOnConfigStore::isDirty() {
+    return _dirty;
+}
+
+/**
+ * Number of config file writes since boot
+ */
+unsigned long PluviOnConfigStore::writeCount() {
+    return _writeCount;
+}
+
+/**
+ * Copy the value into its slot and stage the change if anything changed
+ */
+boolean PluviOnConfigStore::set(PluviOnConfigKey key, const void *value, size_t size) {
+
+    uint8_t *slot = (uint8_t *) &_data + CONFIG_SLOTS[key].offset;
+
+    // Nothing changed, nothing to write
+    if (has(key) && memcmp(slot, value, size) == 0) {
+        return true;
+    }
+
+    memcpy(slot, value, size);
+    _data.present |= (1 << key);
+
+    // The first staged change starts the commit delay
+    if (!_dirty) {
+        _dirty = true;
+        _dirtySinceInMillis = millis();
+    }
+
+    return true;
+}
+
+/**
+ * Write the RAM mirror to the config file
+ */
+boolean PluviOnConfigStore::save() {
+
+    // Mounts SPIFFS file system (once per session)
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    _data.crc = checksum();
+
+    // Written to a temporary file and moved in place, a reset never leaves a partial config
+    boolean success = PluviOn::FSWriteAtomic(PLV_CONFIG_FILE, (const uint8_t *) &_data, sizeof(_data));
+
+    _writeCount++;
+
+    if (!success) {
+        PLV_DEBUG(F("ERROR: Fail writing config file."));
+    }
+
+    return success;
+}
+
+/**
+ * Read the config file into the RAM mirror
+ *
+ * @return true if the file exists and is valid, otherwise false.
+ */
+boolean PluviOnConfigStore::load() {
+
+    File f = PluviOn::FSOpen(PLV_CONFIG_FILE, "r");
+    if (!f) {
+        return false;
+    }
+
+    PluviOnConfigData data;
+    size_t read = PluviOn::FSRead(f, (uint8_t *) &data, sizeof(data));
+    f.close();
+
+    if (read != sizeof(data) || data.magic != PLV_CONFIG_MAGIC || data.version != PLV_CONFIG_VERSION) {
+        PLV_DEBUG(F("ERROR: Invalid config file."));
+        return false;
+    }
+
+    if (data.crc != PluviOn::crc32(&data, offsetof(PluviOnConfigData, crc), PluviOn::FSEpoch())) {
+        PLV_DEBUG(F("ERROR: Config file CRC mismatch."));
+        return false;
+    }
+
+    _data = data;
+
+    return true;
+}
+
+/**
+ * Reset the RAM mirror (no values)
+ */
+void PluviOnConfigStore::reset() {
+
+    memset(&_data, 0, sizeof(_data));
+    _data.magic   = PLV_CONFIG_MAGIC;
+    _data.version = PLV_CONFIG_VERSION;
+}
+
+/**
+ * Import the values encoded in file names by previous firmware versions
+ */
+void PluviOnConfigStore::migrate() {
+
+    for (uint8_t key = 0; key < PLV_CFG_KEY_COUNT; key++) {
+
+        const PluviOnConfigSlot &slot = CONFIG_SLOTS[key];
+
+        String value = _pluvion.FSReadString(slot.legacyDir);
+
+        if (value.length()) {
+
+            uint8_t *dst = (uint8_t *) &_data + slot.offset;
+
+            if (slot.type == PLV_CFG_TYPE_INT) {
+                int32_t v = strtol(value.c_str(), NULL, 10);
+                memcpy(dst, &v, sizeof(v));
+            } else if (slot.type == PLV_CFG_TYPE_FLOAT) {
+                float v = value.toFloat();
+                memcpy(dst, &v, sizeof(v));
+            } else {
+                strncpy((char *) dst, value.c_str(), slot.size - 1);
+            }
+
+            _data.present |= (1 << key);
+        }
+    }
+}
+
+/**
+ * CRC32 of the RAM mirror (seeded with the storage epoch, a config file of an older epoch is invalid)
+ */
+uint32_t PluviOnConfigStore::checksum() {
+    return PluviOn::crc32(&_data, offsetof(PluviOnConfigData, crc), PluviOn::FSEpoch());
+}
@@ -0,0 +1,188 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnConfigStore.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnConfigStore_h
+#define PluviOnConfigStore_h
+
+#include "PluviOn.h"
+
+// Config file path and layout version
+#define PLV_CONFIG_FILE    "/cfg"
+#define PLV_CONFIG_MAGIC   0x43564C50 // "PLVC"
+#define PLV_CONFIG_VERSION 2
+
+// Default time a staged change may wait before commit() writes it (0 = every commit() call)
+#ifndef PLV_CONFIG_COMMIT_DELAY
+#define PLV_CONFIG_COMMIT_DELAY 0
+#endif
+
+/**
+ * Config keys, one fixed typed slot each
+ */
+enum PluviOnConfigKey {
+    PLV_CFG_MESSAGE_ID = 0,     // int
+    PLV_CFG_STATION_TIME,       // int
+    PLV_CFG_TIME_TO_RESET,      // int
+    PLV_CFG_BUCKET_VOLUME,      // float
+    PLV_CFG_LATITUDE,           // string
+    PLV_CFG_LONGITUDE,          // string
+    PLV_CFG_STATION_NAME,       // string
+    PLV_CFG_STATION_ID,         // string
+    PLV_CFG_FIRMWARE_VERSION,   // string
+    PLV_CFG_KEY_COUNT
+};
+
+/**
+ * Config file image (also the RAM mirror)
+ */
+struct PluviOnConfigData {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t present;             // One bit per key, set when the key has a value
+    int32_t  messageID;
+    int32_t  stationTime;
+    int32_t  timeToReset;
+    float    bucketVolume;
+    char     latitude[16];
+    char     longitude[16];
+    char     stationName[22];     // The legacy limit: a PLV_FS_PATH_SIZE path in "/stt/name/"
+    char     stationID[24];
+    char     firmwareVersion[12];
+    uint32_t crc;                 // CRC32 of all the fields above (seeded with the storage epoch)
+};
+
+class PluviOnConfigStore
+{
+    public:
+        PluviOnConfigStore(PluviOn &pluvion);
+
+        /**
+         * Load the config file into RAM.
+         *
+         * If there is no valid config file, the values are migrated from the
+         * legacy "value encoded in filename" directories (/msgcnt, /stt/...).
+         *
+         * @return true if the config was loaded (or migrated) successfully, otherwise false.
+         */
+        boolean       begin();
+
+        /**
+         * Forget all values, in RAM and on the file system
+         */
+        void          clear();
+
+        /**
+         * @param key Config key
+         * @return true if the key has a value
+         */
+        boolean       has(PluviOnConfigKey key);
+
+        /**
+         * Read int value
+         *
+         * @param key Config key
+         * @return The value, or 0 if the key has no value
+         */
+        long          getInt(PluviOnConfigKey key);
+
+        /**
+         * Read float value
+         *
+         * @param key Config key
+         * @return The value, or 0 if the key has no value
+         */
+        float         getFloat(PluviOnConfigKey key);
+
+        /**
+         * Read String value
+         *
+         * @param key Config key
+         * @return The value, or "" (blank) if the key has no value
+         */
+        const char   *getString(PluviOnConfigKey key);
+
+        /**
+         * Stage int value in RAM (written by commit() or flush(), only if the value changes)
+         *
+         * @param key Config key
+         * @param value Value
+         * @return true if the value was staged successfully, otherwise false.
+         */
+        boolean       setInt(PluviOnConfigKey key, long value);
+
+        /**
+         * Stage float value in RAM (written by commit() or flush(), only if the value changes)
+         *
+         * @param key Config key
+         * @param value Value
+         * @return true if the value was staged successfully, otherwise false.
+         */
+        boolean       setFloat(PluviOnConfigKey key, float value);
+
+        /**
+         * Stage String value in RAM (written by commit() or flush(), only if the value changes)
+         *
+         * @param key Config key
+         * @param value Value (truncated to the slot size, logged)
+         * @return true if the value was staged successfully, otherwise false.
+         */
+        boolean       setString(PluviOnConfigKey key, const char *value);
+
+        /**
+         * Write the staged changes, all at once, if the commit delay has passed
+         * since the first of them (call once per loop() iteration)
+         *
+         * @return true if there is nothing left to write, otherwise false.
+         */
+        boolean       commit();
+
+        /**
+         * Write the staged changes now (call before restart or sleep)
+         *
+         * @return true if there is nothing left to write, otherwise false.
+         */
+        boolean       flush();
+
+        /**
+         * Set how long a staged change may wait before commit() writes it
+         *
+         * @param delayInMillis Delay in ms (0 = write on every commit() call)
+         */
+        void          setCommitDelay(unsigned long delayInMillis);
+
+        /**
+         * @return true if there are staged changes not written yet
+         */
+        boolean       isDirty();
+
+        /**
+         * Number of config file writes since boot
+         */
+        unsigned long writeCount();
+
+    private:
+        PluviOn           &_pluvion;
+        PluviOnConfigData  _data;
+        unsigned long      _writeCount;
+        boolean            _dirty;
+        unsigned long      _dirtySinceInMillis;
+        unsigned long      _commitDelayInMillis;
+
+        boolean       set(PluviOnConfigKey key, const void *value, size_t size);
+        boolean       save();
+        boolean       load();
+        void          reset();
+        void          migrate();
+        uint32_t      checksum();
+};
+
+#endif
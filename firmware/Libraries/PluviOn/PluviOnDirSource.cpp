@@ -0,0 +1,148 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnDirSource.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnDirSource.h"
+
+PluviOnDirSource::PluviOnDirSource() : _directory(NULL), _last('\n'), _files(0) {
+}
+
+/**
+ * Start a new stream
+ *
+ * @param directory Directory absolute path (kept, not copied)
+ */
+void PluviOnDirSource::begin(const char *directory) {
+
+    end();
+
+    _directory = directory;
+    _dir       = PluviOn::FSOpenDir(directory);
+    _last      = '\n';
+    _files     = 0;
+}
+
+/**
+ * Stream the next bytes
+ *
+ * @return Bytes written, 0 at the end of the stream, or PLV_UPLOAD_SOURCE_ERROR if a file can't be opened
+ */
+size_t PluviOnDirSource::read(uint8_t *buffer, size_t size) {
+
+    if (!_directory || !size) {
+        return 0;
+    }
+
+    while (true) {
+
+        if (_file) {
+
+            size_t length = _file.available() ? PluviOn::FSRead(_file, buffer, size) : 0;
+
+            if (length > 0) {
+                _last = buffer[length - 1];
+                return length;
+            }
+
+            _file.close();
+            _file = File();
+
+            // Terminate the last line
+            if (_last != '\n') {
+                _last = '\n';
+                buffer[0] = '\n';
+                return 1;
+            }
+        }
+
+        // Next file
+        if (!_dir.next()) {
+            return 0;
+        }
+
+        char filepath[PLV_FS_PATH_SIZE];
+
+        if (PluviOn::FSEntryPath(filepath, _directory, _dir)) {
+            _file = PluviOn::FSOpen(filepath, "r");
+        }
+
+        _last = '\n';
+
+        if (!_file) {
+            // Partial stream, the caller keeps the files for the next attempt
+            PLV_DEBUG_(F("ERROR: Unable to open for reading: "));
+            PLV_DEBUG(_dir.fileName());
+            return PLV_UPLOAD_SOURCE_ERROR;
+        }
+
+        _files++;
+    }
+}
+
+/**
+ * Close the file being streamed (after a failed upload)
+ */
+void PluviOnDirSource::end() {
+
+    _file.close();
+    _file = File();
+    _dir  = Dir();
+}
+
+/**
+ * Upload content source reading a PluviOnDirSource (context = the source)
+ */
+size_t PluviOnDirSource::source(uint8_t *buffer, size_t size, void *context) {
+    return ((PluviOnDirSource *) context)->read(buffer, size);
+}
+
+/**
+ * Bytes a stream of the directory holds: every file, plus the '\n' added
+ * to a file that doesn't end with one
+ */
+size_t PluviOnDirSource::length(const char *directory) {
+
+    size_t length = 0;
+
+    Dir dir = PluviOn::FSOpenDir(directory);
+    while (dir.next()) {
+
+        char filepath[PLV_FS_PATH_SIZE];
+        if (!PluviOn::FSEntryPath(filepath, directory, dir)) {
+            continue;
+        }
+
+        File f = PluviOn::FSOpen(filepath, "r");
+
+        if (f && f.size() > 0) {
+            length += f.size();
+
+            uint8_t last = '\n';
+            if (f.seek(f.size() - 1, SeekSet) && PluviOn::FSRead(f, &last, 1) == 1 && last != '\n') {
+                length++;
+            }
+        }
+
+        f.close();
+    }
+
+    return length;
+}
+
+/**
+ * @return Files opened by the stream
+ */
+unsigned long PluviOnDirSource::files() {
+    return _files;
+}
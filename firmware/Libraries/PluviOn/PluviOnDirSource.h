@@ -0,0 +1,75 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnDirSource.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnDirSource_h
+#define PluviOnDirSource_h
+
+#include "PluviOn.h"
+#include "PluviOnUploader.h"
+
+/**
+ * Upload content source streaming every file of a directory, one after the
+ * other, each one ending with '\n' (one message per line). RAM doesn't
+ * depend on the backlog: one Dir, one File and the uploader chunk buffer.
+ */
+class PluviOnDirSource
+{
+    public:
+        PluviOnDirSource();
+
+        /**
+         * Start a new stream
+         *
+         * @param directory Directory absolute path (kept, not copied)
+         */
+        void               begin(const char *directory);
+
+        /**
+         * Stream the next bytes
+         *
+         * @param buffer Buffer for the content
+         * @param size Buffer size in bytes
+         * @return Bytes written, 0 at the end of the stream, or PLV_UPLOAD_SOURCE_ERROR if a file can't be opened
+         */
+        size_t             read(uint8_t *buffer, size_t size);
+
+        /**
+         * Close the file being streamed (after a failed upload)
+         */
+        void               end();
+
+        /**
+         * Upload content source reading a PluviOnDirSource (context = the source)
+         */
+        static size_t      source(uint8_t *buffer, size_t size, void *context);
+
+        /**
+         * Bytes a stream of the directory holds (reads the last byte of every file)
+         *
+         * @param directory Directory absolute path
+         */
+        static size_t      length(const char *directory);
+
+        /**
+         * @return Files opened by the stream
+         */
+        unsigned long      files();
+
+    private:
+        const char        *_directory;
+        Dir                _dir;
+        File               _file;
+        uint8_t            _last;           // Last byte streamed from the file
+        unsigned long      _files;
+};
+
+#endif
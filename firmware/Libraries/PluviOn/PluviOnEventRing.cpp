@@ -0,0 +1,73 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnEventRing.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnEventRing.h"
+
+#if (PLV_EVENT_RING_SIZE & (PLV_EVENT_RING_SIZE - 1)) || PLV_EVENT_RING_SIZE > 128
+#error "PLV_EVENT_RING_SIZE must be a power of 2, up to 128"
+#endif
+
+// Head and tail run free (uint8_t wraps), the slot is the low bits
+#define PLV_EVENT_RING_MASK (PLV_EVENT_RING_SIZE - 1)
+
+PluviOnEventRing::PluviOnEventRing() : _head(0), _tail(0), _overflows(0) {
+}
+
+/**
+ * Store an event (ISR side, no flash access)
+ */
+void IRAM_ATTR PluviOnEventRing::push(uint32_t timestampInMicros) {
+
+    uint8_t head = _head;
+
+    if ((uint8_t) (head - _tail) >= PLV_EVENT_RING_SIZE) {
+        _overflows++;
+        return;
+    }
+
+    _events[head & PLV_EVENT_RING_MASK] = timestampInMicros;
+
+    // Publish the slot only once it's written
+    _head = head + 1;
+}
+
+/**
+ * Take the oldest event (loop side)
+ *
+ * @return false if there is no event
+ */
+boolean PluviOnEventRing::pop(uint32_t &timestampInMicros) {
+
+    uint8_t tail = _tail;
+
+    if (tail == _head) {
+        return false;
+    }
+
+    timestampInMicros = _events[tail & PLV_EVENT_RING_MASK];
+
+    // Hand the slot back only once it's read
+    _tail = tail + 1;
+
+    return true;
+}
+
+uint8_t PluviOnEventRing::available() {
+    return _head - _tail;
+}
+
+unsigned long PluviOnEventRing::overflows() {
+    return _overflows;
+}
@@ -0,0 +1,73 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnEventRing.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnEventRing_h
+#define PluviOnEventRing_h
+
+#include "PluviOn.h"
+
+// |------------------------------------------|
+// |         Interrupt Event Ring             |
+// |------------------------------------------|
+// | ISR (producer) -> push(micros())         |
+// | loop (consumer) -> pop()                 |
+// |------------------------------------------|
+//
+// Single producer, single consumer: only the ISR moves the head and only the
+// loop moves the tail, so neither side disables interrupts. The ISR does
+// nothing but store the timestamp (push() lives in IRAM); everything else,
+// debouncing included, runs in the loop. When the loop falls behind the new
+// events are dropped and counted in overflows().
+
+// Events kept (power of 2, up to 128)
+#ifndef PLV_EVENT_RING_SIZE
+#define PLV_EVENT_RING_SIZE 32
+#endif
+
+class PluviOnEventRing
+{
+    public:
+        PluviOnEventRing();
+
+        /**
+         * Store an event (ISR side)
+         *
+         * @param timestampInMicros Event time, micros()
+         */
+        void                   push(uint32_t timestampInMicros);
+
+        /**
+         * Take the oldest event (loop side)
+         *
+         * @param timestampInMicros Event time
+         * @return false if there is no event
+         */
+        boolean                pop(uint32_t &timestampInMicros);
+
+        /**
+         * @return Events waiting in the ring
+         */
+        uint8_t                available();
+
+        /**
+         * @return Events dropped with the ring full (since boot)
+         */
+        unsigned long          overflows();
+
+    private:
+        volatile uint32_t      _events[PLV_EVENT_RING_SIZE];
+        volatile uint8_t       _head;       // Written by the ISR only
+        volatile uint8_t       _tail;       // Written by the loop only
+        volatile unsigned long _overflows;
+};
+
+#endif
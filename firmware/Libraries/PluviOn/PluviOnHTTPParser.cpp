@@ -0,0 +1,249 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnHTTPParser.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnHTTPParser.h"
+
+PluviOnHTTPParser::PluviOnHTTPParser() {
+    begin();
+}
+
+/**
+ * Expect an HTTP/1.x response
+ */
+void PluviOnHTTPParser::begin() {
+
+    _state         = PLV_HTTP_STATUS;
+    _line          = false;
+    _lineLength    = 0;
+    _status        = 0;
+    _contentLength = -1;
+    _bodyLeft      = -1;
+    _keepAlive     = false;
+    _bodyLength    = 0;
+
+    _body[0]           = '\0';
+    _acceptEncoding[0] = '\0';
+}
+
+/**
+ * Expect a single line reply, ended by '\r' (or by the server closing)
+ */
+void PluviOnHTTPParser::beginLine() {
+    begin();
+    _line  = true;
+    _state = PLV_HTTP_BODY;
+}
+
+/**
+ * Parse the next bytes of the response
+ *
+ * @return Bytes used (less than length once the response is complete)
+ */
+size_t PluviOnHTTPParser::feed(const uint8_t *data, size_t length) {
+
+    size_t used = 0;
+
+    while (used < length && _state != PLV_HTTP_DONE && _state != PLV_HTTP_ERROR) {
+
+        if (_state == PLV_HTTP_BODY) {
+            used += feedBody(data + used, length - used);
+        } else {
+            used += feedLine(data + used, length - used);
+        }
+    }
+
+    return used;
+}
+
+/**
+ * The server closed the connection
+ */
+void PluviOnHTTPParser::finish() {
+
+    if (_state == PLV_HTTP_DONE) {
+        return;
+    }
+
+    // Body without Content-Length, or a line reply without its '\r'
+    boolean complete =
+        _state == PLV_HTTP_BODY &&
+        (_line ? _bodyLength > 0 : _bodyLeft < 0);
+
+    _state = complete ? PLV_HTTP_DONE : PLV_HTTP_ERROR;
+}
+
+PluviOnHTTPParserState PluviOnHTTPParser::state() {
+    return _state;
+}
+
+boolean PluviOnHTTPParser::done() {
+    return _state == PLV_HTTP_DONE;
+}
+
+int PluviOnHTTPParser::status() {
+    return _status;
+}
+
+long PluviOnHTTPParser::contentLength() {
+    return _contentLength;
+}
+
+boolean PluviOnHTTPParser::keepAlive() {
+    return _keepAlive;
+}
+
+const char *PluviOnHTTPParser::body() {
+    return _body;
+}
+
+const char *PluviOnHTTPParser::acceptEncoding() {
+    return _acceptEncoding;
+}
+
+/**
+ * Status line or header bytes, up to the end of the line
+ *
+ * @return Bytes used
+ */
+size_t PluviOnHTTPParser::feedLine(const uint8_t *data, size_t length) {
+
+    const uint8_t *end = (const uint8_t *) memchr(data, '\n', length);
+    size_t count = end ? end - data : length;
+
+    // Past PLV_HTTP_LINE_SIZE the line is cut (the headers in use are short)
+    size_t room = sizeof(_lineBuffer) - 1 - _lineLength;
+    size_t copy = min(count, room);
+    memcpy(_lineBuffer + _lineLength, data, copy);
+    _lineLength += copy;
+
+    if (!end) {
+        return length;
+    }
+
+    // Line complete (without the '\r')
+    if (_lineLength > 0 && _lineBuffer[_lineLength - 1] == '\r') {
+        _lineLength--;
+    }
+    _lineBuffer[_lineLength] = '\0';
+
+    processLine();
+    _lineLength = 0;
+
+    return count + 1;
+}
+
+/**
+ * Body bytes, up to its Content-Length (or the line reply, up to '\r')
+ *
+ * @return Bytes used
+ */
+size_t PluviOnHTTPParser::feedBody(const uint8_t *data, size_t length) {
+
+    if (_line) {
+
+        const uint8_t *end = (const uint8_t *) memchr(data, '\r', length);
+        size_t count = end ? end - data : length;
+
+        appendBody(data, count);
+
+        if (!end) {
+            return length;
+        }
+
+        _state = PLV_HTTP_DONE;
+        return count + 1;
+    }
+
+    size_t count = length;
+
+    if (_bodyLeft >= 0 && (unsigned long) _bodyLeft < count) {
+        count = _bodyLeft;
+    }
+
+    appendBody(data, count);
+
+    if (_bodyLeft >= 0) {
+        _bodyLeft -= count;
+
+        if (_bodyLeft == 0) {
+            _state = PLV_HTTP_DONE;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * HTTP status line or header
+ */
+void PluviOnHTTPParser::processLine() {
+
+    if (_state == PLV_HTTP_STATUS) {
+
+        // HTTP/1.1 200 OK
+        _state = PLV_HTTP_HEADERS;
+
+        // HTTP/1.1 keeps the connection unless told otherwise
+        _keepAlive = strncmp(_lineBuffer, "HTTP/1.1", 8) == 0;
+
+        if (strncmp(_lineBuffer, "HTTP/", 5) == 0) {
+            const char *code = strchr(_lineBuffer, ' ');
+            _status = code ? atoi(code + 1) : 0;
+        }
+
+        return;
+    }
+
+    // Empty line, end of the headers
+    if (_lineLength == 0) {
+        _bodyLeft = _contentLength;
+        _state = _contentLength == 0 ? PLV_HTTP_DONE : PLV_HTTP_BODY;
+        return;
+    }
+
+    if (strncasecmp(_lineBuffer, "Content-Length:", 15) == 0) {
+        _contentLength = atol(_lineBuffer + 15);
+    } else if (strncasecmp(_lineBuffer, "Connection:", 11) == 0) {
+        const char *value = _lineBuffer + 11;
+        while (*value == ' ') {
+            value++;
+        }
+        _keepAlive = strncasecmp(value, "close", 5) != 0;
+    } else if (strncasecmp(_lineBuffer, "Accept-Encoding:", 16) == 0) {
+        const char *value = _lineBuffer + 16;
+        while (*value == ' ') {
+            value++;
+        }
+        strncpy(_acceptEncoding, value, sizeof(_acceptEncoding) - 1);
+        _acceptEncoding[sizeof(_acceptEncoding) - 1] = '\0';
+    }
+}
+
+/**
+ * Keep body bytes (line breaks dropped, bytes past the buffer ignored)
+ */
+void PluviOnHTTPParser::appendBody(const uint8_t *data, size_t length) {
+
+    for (size_t i = 0; i < length && _bodyLength < sizeof(_body) - 1; i++) {
+
+        if (data[i] == '\r' || data[i] == '\n') {
+            continue;
+        }
+
+        _body[_bodyLength++] = data[i];
+    }
+
+    _body[_bodyLength] = '\0';
+}
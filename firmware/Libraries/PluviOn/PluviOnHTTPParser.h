@@ -0,0 +1,129 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnHTTPParser.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnHTTPParser_h
+#define PluviOnHTTPParser_h
+
+#include "PluviOn.h"
+
+// |------------------------------------------|
+// |        Response parser states            |
+// |------------------------------------------|
+// | HTTP: STATUS -> HEADERS -> BODY -> DONE  |
+// | LINE: BODY (up to '\r') -> DONE          |
+// |------------------------------------------|
+//
+// Fed with the bytes as they arrive, in chunks of any size (no per line
+// allocation). Only the status line, the headers it uses and the body are
+// kept; the body is kept without its line breaks, up to PLV_HTTP_BODY_SIZE.
+
+// Longest status/header line kept (the rest of the line is ignored)
+#define PLV_HTTP_LINE_SIZE 64
+
+// Body kept (the rest is dropped)
+#ifndef PLV_HTTP_BODY_SIZE
+#define PLV_HTTP_BODY_SIZE 128
+#endif
+
+// Accept-Encoding header value kept (request content codings the server decodes)
+#define PLV_HTTP_ACCEPT_ENCODING_SIZE 32
+
+enum PluviOnHTTPParserState {
+    PLV_HTTP_STATUS = 0,
+    PLV_HTTP_HEADERS,
+    PLV_HTTP_BODY,
+    PLV_HTTP_DONE,
+    PLV_HTTP_ERROR              // The connection closed before the end of the response
+};
+
+class PluviOnHTTPParser
+{
+    public:
+        PluviOnHTTPParser();
+
+        /**
+         * Expect an HTTP/1.x response
+         */
+        void                   begin();
+
+        /**
+         * Expect a single line reply, ended by '\r' (or by the server closing)
+         */
+        void                   beginLine();
+
+        /**
+         * Parse the next bytes of the response
+         *
+         * @param data Received bytes
+         * @param length Received length in bytes
+         * @return Bytes used (less than length once the response is complete)
+         */
+        size_t                 feed(const uint8_t *data, size_t length);
+
+        /**
+         * The server closed the connection: ends a body without Content-Length
+         * (or a line reply), anything else is an incomplete response
+         */
+        void                   finish();
+
+        PluviOnHTTPParserState state();
+
+        /**
+         * @return true once the response is complete
+         */
+        boolean                done();
+
+        /**
+         * @return HTTP status code (0 for a line reply or if not received)
+         */
+        int                    status();
+
+        /**
+         * @return Content-Length, or -1 if the body ends when the server closes
+         */
+        long                   contentLength();
+
+        /**
+         * @return true if the server keeps the connection (HTTP/1.1 without "Connection: close")
+         */
+        boolean                keepAlive();
+
+        /**
+         * @return Body (or line reply) without line breaks
+         */
+        const char            *body();
+
+        /**
+         * @return Accept-Encoding header ("" if not sent)
+         */
+        const char            *acceptEncoding();
+
+    private:
+        PluviOnHTTPParserState _state;
+        boolean                _line;           // Line reply
+        char                   _lineBuffer[PLV_HTTP_LINE_SIZE];
+        size_t                 _lineLength;
+        int                    _status;
+        long                   _contentLength;
+        long                   _bodyLeft;       // Content-Length still to read
+        boolean                _keepAlive;
+        char                   _body[PLV_HTTP_BODY_SIZE];
+        size_t                 _bodyLength;
+        char                   _acceptEncoding[PLV_HTTP_ACCEPT_ENCODING_SIZE];
+
+        size_t                 feedLine(const uint8_t *data, size_t length);
+        size_t                 feedBody(const uint8_t *data, size_t length);
+        void                   processLine();
+        void                   appendBody(const uint8_t *data, size_t length);
+};
+
+#endif
@@ -0,0 +1,308 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnLZSS.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnLZSS.h"
+
+PluviOnLZSS::PluviOnLZSS()
+    : _source(NULL), _context(NULL), _eof(true), _error(false),
+      _base(0), _pos(0), _end(0), _groupLength(0), _groupOffset(0),
+      _bytesIn(0), _bytesOut(0) {
+}
+
+/**
+ * Start a new stream
+ *
+ * @param source Input source (as an upload content source)
+ * @param context Passed to the source
+ */
+void PluviOnLZSS::begin(PluviOnUploadSource source, void *context) {
+
+    _source  = source;
+    _context = context;
+    _eof     = false;
+    _error   = false;
+
+    _base = 0;
+    _pos  = 0;
+    _end  = 0;
+
+    // Stale entries are harmless, every candidate is compared before use
+    memset(_head, 0, sizeof(_head));
+    memset(_prev, 0, sizeof(_prev));
+
+    _groupLength = 0;
+    _groupOffset = 0;
+
+    _bytesIn  = 0;
+    _bytesOut = 0;
+}
+
+/**
+ * Compress the next bytes
+ *
+ * @return Bytes written, 0 at the end of the stream, or PLV_UPLOAD_SOURCE_ERROR if the source failed
+ */
+size_t PluviOnLZSS::read(uint8_t *buffer, size_t size) {
+
+    size_t written = 0;
+
+    while (written < size) {
+
+        // Pending bytes of the current group
+        if (_groupOffset < _groupLength) {
+            size_t length = min(size - written, _groupLength - _groupOffset);
+            memcpy(buffer + written, _group + _groupOffset, length);
+            _groupOffset += length;
+            written += length;
+            continue;
+        }
+
+        encodeGroup();
+
+        if (_error) {
+            return PLV_UPLOAD_SOURCE_ERROR;
+        }
+
+        // End of the stream
+        if (_groupLength == 0) {
+            break;
+        }
+    }
+
+    _bytesOut += written;
+
+    return written;
+}
+
+/**
+ * Upload content source reading a PluviOnLZSS (context = the encoder)
+ */
+size_t PluviOnLZSS::source(uint8_t *buffer, size_t size, void *context) {
+    return ((PluviOnLZSS *) context)->read(buffer, size);
+}
+
+/**
+ * Decompress a whole stream
+ *
+ * @return Original length in bytes, or -1 if the stream is invalid or doesn't fit
+ */
+long PluviOnLZSS::decompress(const uint8_t *data, size_t length, uint8_t *buffer, size_t size) {
+
+    size_t in  = 0;
+    size_t out = 0;
+
+    while (in < length) {
+
+        uint8_t flags = data[in++];
+
+        for (uint8_t item = 0; item < 8 && in < length; item++) {
+
+            // Literal
+            if (!(flags & (1 << item))) {
+
+                if (out >= size) {
+                    return -1;
+                }
+
+                buffer[out++] = data[in++];
+                continue;
+            }
+
+            // Match
+            if (in + 2 > length) {
+                return -1;
+            }
+
+            uint16_t token = data[in] | (data[in + 1] << 8);
+            in += 2;
+
+            size_t distance = (token & (PLV_LZSS_WINDOW_SIZE - 1)) + 1;
+            size_t count    = (token >> 9) + PLV_LZSS_MIN_MATCH;
+
+            if (distance > out || out + count > size) {
+                return -1;
+            }
+
+            // Byte by byte, a match may overlap its own output
+            while (count--) {
+                buffer[out] = buffer[out - distance];
+                out++;
+            }
+        }
+    }
+
+    return out;
+}
+
+unsigned long PluviOnLZSS::bytesIn() {
+    return _bytesIn;
+}
+
+unsigned long PluviOnLZSS::bytesOut() {
+    return _bytesOut;
+}
+
+/**
+ * Read the source until a full match is available ahead (or the input ends),
+ * sliding the buffer to keep only the window behind
+ *
+ * @return false if the source failed
+ */
+boolean PluviOnLZSS::fill() {
+
+    while (!_eof && _end - _pos < PLV_LZSS_MAX_MATCH) {
+
+        if (_end == sizeof(_data)) {
+            size_t shift = _pos - PLV_LZSS_WINDOW_SIZE;
+            memmove(_data, _data + shift, _end - shift);
+            _pos  -= shift;
+            _end  -= shift;
+            _base += shift;
+        }
+
+        size_t length = _source(_data + _end, sizeof(_data) - _end, _context);
+
+        if (length == PLV_UPLOAD_SOURCE_ERROR) {
+            _error = true;
+            return false;
+        }
+
+        if (length == 0) {
+            _eof = true;
+        }
+
+        _end     += length;
+        _bytesIn += length;
+    }
+
+    return true;
+}
+
+/**
+ * Encode up to 8 items (a flag byte and its literals and matches) in _group
+ * (_groupLength is 0 at the end of the stream)
+ */
+void PluviOnLZSS::encodeGroup() {
+
+    _group[0]    = 0;
+    _groupLength = 1;
+    _groupOffset = 0;
+
+    for (uint8_t item = 0; item < 8; item++) {
+
+        if (!fill() || _pos >= _end) {
+            break;
+        }
+
+        size_t distance = 0;
+        size_t length = findMatch(distance);
+
+        if (length >= PLV_LZSS_MIN_MATCH) {
+
+            uint16_t token = (distance - 1) | ((length - PLV_LZSS_MIN_MATCH) << 9);
+
+            _group[0] |= 1 << item;
+            _group[_groupLength++] = token & 0xFF;
+            _group[_groupLength++] = token >> 8;
+
+        } else {
+            length = 1;
+            _group[_groupLength++] = _data[_pos];
+        }
+
+        while (length--) {
+            insert(_pos++);
+        }
+    }
+
+    // Flag byte alone: nothing left
+    if (_groupLength == 1) {
+        _groupLength = 0;
+    }
+}
+
+/**
+ * Longest match for the bytes at _pos, following the hash chain
+ *
+ * @param distance Match distance (output)
+ * @return Match length (less than PLV_LZSS_MIN_MATCH if there is none)
+ */
+size_t PluviOnLZSS::findMatch(size_t &distance) {
+
+    size_t available = _end - _pos;
+
+    if (available < PLV_LZSS_MIN_MATCH) {
+        return 0;
+    }
+
+    size_t maxLength = min((size_t) PLV_LZSS_MAX_MATCH, available);
+    uint16_t current = (uint16_t) (_base + _pos);
+    uint16_t candidate = _head[hash(_pos)];
+    size_t best = 0;
+    size_t last = 0;
+
+    for (uint8_t depth = 0; depth < PLV_LZSS_CHAIN_DEPTH; depth++) {
+
+        size_t d = (uint16_t) (current - candidate);
+
+        // Chains only go back; past the window (or the buffer) they are stale
+        if (d <= last || d > PLV_LZSS_WINDOW_SIZE || d > _pos) {
+            break;
+        }
+
+        const uint8_t *a = _data + _pos - d;
+        const uint8_t *b = _data + _pos;
+        size_t length = 0;
+
+        while (length < maxLength && a[length] == b[length]) {
+            length++;
+        }
+
+        if (length > best) {
+            best = length;
+            distance = d;
+
+            if (best == maxLength) {
+                break;
+            }
+        }
+
+        last = d;
+        candidate = _prev[candidate % PLV_LZSS_WINDOW_SIZE];
+    }
+
+    return best;
+}
+
+/**
+ * Add the position to its hash chain
+ */
+void PluviOnLZSS::insert(size_t pos) {
+
+    // Needs the 3 hashed bytes
+    if (pos + PLV_LZSS_MIN_MATCH > _end) {
+        return;
+    }
+
+    uint16_t position = (uint16_t) (_base + pos);
+    uint8_t h = hash(pos);
+
+    _prev[position % PLV_LZSS_WINDOW_SIZE] = _head[h];
+    _head[h] = position;
+}
+
+uint8_t PluviOnLZSS::hash(size_t pos) {
+    return (_data[pos] * 961 + _data[pos + 1] * 31 + _data[pos + 2]) & (PLV_LZSS_HASH_SIZE - 1);
+}
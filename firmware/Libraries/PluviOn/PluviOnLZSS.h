@@ -0,0 +1,125 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnLZSS.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnLZSS_h
+#define PluviOnLZSS_h
+
+#include "PluviOn.h"
+#include "PluviOnUploader.h"
+
+// |------------------------------------------|
+// |         LZSS Compressed Stream           |
+// |------------------------------------------|
+// | Groups of up to 8 items, each group      |
+// | starting with a flag byte (bit i, LSB    |
+// | first, set = item i is a match).         |
+// |                                          |
+// | Literal: 1 byte                          |
+// | Match:   2 bytes, little endian          |
+// |          bits 0..8  = distance - 1       |
+// |          bits 9..15 = length - 3         |
+// |                                          |
+// | The stream ends with the input (no end   |
+// | marker, the last group may be short).    |
+// |------------------------------------------|
+//
+// Encoder RAM: PLV_LZSS_BUFFER_SIZE + 2 x PLV_LZSS_HASH_SIZE + 2 x PLV_LZSS_WINDOW_SIZE
+// bytes (2.5 KB by default). A weather message is ~250 bytes, so the window
+// holds the previous message or two, where the repeated fields are.
+
+// HTTP content coding name (Content-Encoding / Accept-Encoding)
+#define PLV_LZSS_ENCODING       "x-plv-lzss"
+
+#define PLV_LZSS_WINDOW_SIZE    512  // Max match distance (9 bits)
+#define PLV_LZSS_MIN_MATCH      3
+#define PLV_LZSS_MAX_MATCH      130  // 7 bits + PLV_LZSS_MIN_MATCH
+#define PLV_LZSS_BUFFER_SIZE    1024 // Window + lookahead, slid when full
+#define PLV_LZSS_HASH_SIZE      256  // Hash chain heads (3 byte hash)
+
+// Chain candidates tried per position (speed against ratio)
+#ifndef PLV_LZSS_CHAIN_DEPTH
+#define PLV_LZSS_CHAIN_DEPTH    16
+#endif
+
+/**
+ * Streaming LZSS encoder: pulls the input from a content source and
+ * returns the compressed bytes in chunks, so it can feed an upload.
+ */
+class PluviOnLZSS
+{
+    public:
+        PluviOnLZSS();
+
+        /**
+         * Start a new stream
+         *
+         * @param source Input source (as an upload content source)
+         * @param context Passed to the source
+         */
+        void               begin(PluviOnUploadSource source, void *context);
+
+        /**
+         * Compress the next bytes
+         *
+         * @param buffer Buffer for the compressed bytes
+         * @param size Buffer size in bytes
+         * @return Bytes written, 0 at the end of the stream, or PLV_UPLOAD_SOURCE_ERROR if the source failed
+         */
+        size_t             read(uint8_t *buffer, size_t size);
+
+        /**
+         * Upload content source reading a PluviOnLZSS (context = the encoder)
+         */
+        static size_t      source(uint8_t *buffer, size_t size, void *context);
+
+        /**
+         * Decompress a whole stream
+         *
+         * @param data Compressed bytes
+         * @param length Compressed length in bytes
+         * @param buffer Buffer for the original bytes
+         * @param size Buffer size in bytes
+         * @return Original length in bytes, or -1 if the stream is invalid or doesn't fit
+         */
+        static long        decompress(const uint8_t *data, size_t length, uint8_t *buffer, size_t size);
+
+        unsigned long      bytesIn();
+        unsigned long      bytesOut();
+
+    private:
+        PluviOnUploadSource _source;
+        void               *_context;
+        boolean             _eof;
+        boolean             _error;
+
+        uint8_t             _data[PLV_LZSS_BUFFER_SIZE];
+        unsigned long       _base;          // Stream position of _data[0]
+        size_t              _pos;           // Next byte to encode (index in _data)
+        size_t              _end;           // Bytes in _data
+        uint16_t            _head[PLV_LZSS_HASH_SIZE];
+        uint16_t            _prev[PLV_LZSS_WINDOW_SIZE];
+
+        uint8_t             _group[1 + 8 * 2];
+        size_t              _groupLength;
+        size_t              _groupOffset;
+
+        unsigned long       _bytesIn;
+        unsigned long       _bytesOut;
+
+        boolean             fill();
+        void                encodeGroup();
+        size_t              findMatch(size_t &distance);
+        void                insert(size_t pos);
+        uint8_t             hash(size_t pos);
+};
+
+#endif
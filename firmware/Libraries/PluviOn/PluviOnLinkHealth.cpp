@@ -0,0 +1,196 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnLinkHealth.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnLinkHealth.h"
+
+PluviOnLinkHealth::PluviOnLinkHealth()
+    : _state(PLV_LINK_CLOSED), _threshold(PLV_LINK_FAILURE_THRESHOLD),
+      _openMin(PLV_LINK_OPEN_MIN), _openMax(PLV_LINK_OPEN_MAX), _jitter(PLV_BACKOFF_JITTER),
+      _openTime(0), _openWait(0), _openedInMillis(0),
+      _successes(0), _failures(0), _failuresInARow(0), _opens(0), _probes(0), _skips(0) {
+}
+
+/**
+ * @param failures Failures in a row that open the breaker
+ */
+void PluviOnLinkHealth::setThreshold(uint8_t failures) {
+    _threshold = max(failures, (uint8_t) 1);
+}
+
+/**
+ * Open time after the breaker opens, doubled on every failed probe up to the max
+ */
+void PluviOnLinkHealth::setBackoff(unsigned long minInMillis, unsigned long maxInMillis) {
+    _openMin = minInMillis;
+    _openMax = max(minInMillis, maxInMillis);
+}
+
+/**
+ * @param percent Random part of the open time (+/-)
+ */
+void PluviOnLinkHealth::setJitter(uint8_t percent) {
+    _jitter = min(percent, (uint8_t) 100);
+}
+
+/**
+ * Ask before any radio work
+ *
+ * @return true if closed, or if this is the half open probe
+ */
+boolean PluviOnLinkHealth::allow() {
+
+    if (_state == PLV_LINK_CLOSED) {
+        return true;
+    }
+
+    // One probe at a time
+    if (_state == PLV_LINK_HALF_OPEN || waitInMillis() > 0) {
+        _skips++;
+        return false;
+    }
+
+    PLV_DEBUG(F("Link: Half open, probing."));
+
+    _state = PLV_LINK_HALF_OPEN;
+    _probes++;
+
+    return true;
+}
+
+void PluviOnLinkHealth::success() {
+
+    _successes++;
+    _failuresInARow = 0;
+
+    if (_state != PLV_LINK_CLOSED) {
+        PLV_DEBUG(F("Link: Closed, back to normal."));
+    }
+
+    _state    = PLV_LINK_CLOSED;
+    _openTime = 0;
+}
+
+void PluviOnLinkHealth::failure() {
+
+    _failures++;
+
+    if (_failuresInARow < 255) {
+        _failuresInARow++;
+    }
+
+    if (_state == PLV_LINK_HALF_OPEN || _failuresInARow >= _threshold) {
+        open();
+    }
+}
+
+/**
+ * The allowed radio work didn't run: a half open probe is given back
+ */
+void PluviOnLinkHealth::skip() {
+
+    if (_state == PLV_LINK_HALF_OPEN) {
+        _state = PLV_LINK_OPEN;
+        _probes--;
+    }
+}
+
+PluviOnLinkState PluviOnLinkHealth::state() {
+    return _state;
+}
+
+const char *PluviOnLinkHealth::stateName() {
+
+    switch (_state) {
+        case PLV_LINK_OPEN:
+            return "open";
+        case PLV_LINK_HALF_OPEN:
+            return "half open";
+        default:
+            return "closed";
+    }
+}
+
+/**
+ * @return Time left until the next probe (0 unless open)
+ */
+unsigned long PluviOnLinkHealth::waitInMillis() {
+
+    if (_state != PLV_LINK_OPEN) {
+        return 0;
+    }
+
+    unsigned long elapsed = millis() - _openedInMillis;
+
+    return elapsed < _openWait ? _openWait - elapsed : 0;
+}
+
+unsigned long PluviOnLinkHealth::successes() {
+    return _successes;
+}
+
+unsigned long PluviOnLinkHealth::failures() {
+    return _failures;
+}
+
+uint8_t PluviOnLinkHealth::failuresInARow() {
+    return _failuresInARow;
+}
+
+unsigned long PluviOnLinkHealth::opens() {
+    return _opens;
+}
+
+unsigned long PluviOnLinkHealth::probes() {
+    return _probes;
+}
+
+unsigned long PluviOnLinkHealth::skips() {
+    return _skips;
+}
+
+/**
+ * @return value with a random jitter of +/- percent
+ */
+unsigned long PluviOnLinkHealth::jitter(unsigned long value, uint8_t percent) {
+
+    // Split so value * percent can't overflow
+    unsigned long span = value / 100 * percent + value % 100 * percent / 100;
+
+    if (!span) {
+        return value;
+    }
+
+    return value - span + random(2 * span + 1);
+}
+
+/**
+ * Open (or open again) the breaker: first open time, or double the last one
+ */
+void PluviOnLinkHealth::open() {
+
+    // Already open (failures reported by work started before it opened)
+    if (_state == PLV_LINK_OPEN) {
+        return;
+    }
+
+    _openTime       = _openTime ? min(_openTime * 2, _openMax) : _openMin;
+    _openWait       = jitter(_openTime, _jitter);
+    _openedInMillis = millis();
+    _state          = PLV_LINK_OPEN;
+    _opens++;
+
+    PLV_DEBUG_(F("Link: Open, radio work skipped for (ms): "));
+    PLV_DEBUG(_openWait);
+}
@@ -0,0 +1,130 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnLinkHealth.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnLinkHealth_h
+#define PluviOnLinkHealth_h
+
+#include "PluviOn.h"
+
+// |------------------------------------------|
+// |        Link Health (circuit breaker)     |
+// |------------------------------------------|
+// | CLOSED -> OPEN       threshold failures  |
+// |                      in a row            |
+// | OPEN -> HALF_OPEN    open time elapsed   |
+// |                      (one probe allowed) |
+// | HALF_OPEN -> CLOSED  probe succeeded     |
+// | HALF_OPEN -> OPEN    probe failed, open  |
+// |                      time doubled        |
+// |------------------------------------------|
+//
+// While open no radio work is allowed (no DNS lookup, connect or handshake),
+// instead of every user retrying on its own against a dead AP or server.
+// The open time grows up to the max and gets a random jitter, so stations
+// that lost the same AP don't all probe it at the same moment.
+
+// Random part of the backoff times, in percent (+/-)
+#ifndef PLV_BACKOFF_JITTER
+#define PLV_BACKOFF_JITTER 20
+#endif
+
+// Defaults
+#define PLV_LINK_FAILURE_THRESHOLD 3       // Failures in a row that open the breaker
+#define PLV_LINK_OPEN_MIN          30000   // First open time (ms)
+#define PLV_LINK_OPEN_MAX          1800000 // Max open time (ms)
+
+enum PluviOnLinkState {
+    PLV_LINK_CLOSED = 0,        // Healthy, radio work allowed
+    PLV_LINK_OPEN,              // Down, radio work skipped until the open time elapses
+    PLV_LINK_HALF_OPEN          // A probe is running
+};
+
+class PluviOnLinkHealth
+{
+    public:
+        PluviOnLinkHealth();
+
+        /**
+         * @param failures Failures in a row that open the breaker
+         */
+        void             setThreshold(uint8_t failures);
+
+        /**
+         * Open time after the breaker opens, doubled on every failed probe up to the max
+         */
+        void             setBackoff(unsigned long minInMillis, unsigned long maxInMillis);
+
+        /**
+         * @param percent Random part of the open time (+/-)
+         */
+        void             setJitter(uint8_t percent);
+
+        /**
+         * Ask before any radio work; when true, report the outcome with
+         * success() or failure()
+         *
+         * @return true if closed, or if this is the half open probe
+         */
+        boolean          allow();
+
+        void             success();
+        void             failure();
+
+        /**
+         * The allowed radio work didn't run (no outcome): a half open
+         * probe is given back, the next allow() probes again
+         */
+        void             skip();
+
+        PluviOnLinkState state();
+        const char      *stateName();
+
+        /**
+         * @return Time left until the next probe (0 unless open)
+         */
+        unsigned long    waitInMillis();
+
+        unsigned long    successes();
+        unsigned long    failures();
+        uint8_t          failuresInARow();
+        unsigned long    opens();           // Times the breaker opened
+        unsigned long    probes();
+        unsigned long    skips();           // Radio work skipped while open
+
+        /**
+         * @param value Base time
+         * @param percent Random part (+/-)
+         * @return value with a random jitter
+         */
+        static unsigned long jitter(unsigned long value, uint8_t percent);
+
+    private:
+        PluviOnLinkState _state;
+        uint8_t          _threshold;
+        unsigned long    _openMin;
+        unsigned long    _openMax;
+        uint8_t          _jitter;
+        unsigned long    _openTime;         // Open time before the jitter (0 = never opened)
+        unsigned long    _openWait;         // Open time with the jitter
+        unsigned long    _openedInMillis;
+
+        unsigned long    _successes;
+        unsigned long    _failures;
+        uint8_t          _failuresInARow;
+        unsigned long    _opens;
+        unsigned long    _probes;
+        unsigned long    _skips;
+
+        void             open();
+};
+
+#endif
@@ -0,0 +1,784 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnMessageLog.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+#include <stddef.h>
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnMessageLog.h"
+
+PluviOnMessageLog::PluviOnMessageLog() : _head(1), _tail(1), _dropped(0), _segments(PLV_LOG_MIN_SEGMENTS) {
+    memset(_acked, 0, sizeof(_acked));
+    memset(_marks, 0, sizeof(_marks));
+}
+
+/**
+ * Preallocate the segment files (sized from the file system the first
+ * time) and recover head and tail by scanning the segment and record
+ * headers.
+ *
+ * @return true if the log is ready, otherwise false.
+ */
+boolean PluviOnMessageLog::begin() {
+
+    PLV_DEBUG(F("Recovering message log..."));
+
+    // Mounts SPIFFS file system (once per session)
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    // Segments are reused in the current epoch, never reclaimed
+    PluviOn::FSKeep(PLV_LOG_DIR);
+
+    _head = 1;
+    _tail = 1;
+    memset(_acked, 0, sizeof(_acked));
+    memset(_marks, 0, sizeof(_marks));
+
+    // The segments in use, or as many as the file system allows for a new log
+    _segments = existingSegments();
+    if (_segments < PLV_LOG_MIN_SEGMENTS) {
+        _segments = sizeSegments();
+    }
+
+    PLV_DEBUG_(F("Log segments: "));
+    PLV_DEBUG_(_segments);
+    PLV_DEBUG_(F(", capacity: "));
+    PLV_DEBUG(capacity());
+
+    // Segment headers (the ones of older epochs fail validation)
+    unsigned long baseSeqs[PLV_LOG_SEGMENTS];
+    unsigned long newest = 0;
+
+    for (uint8_t segment = 0; segment < _segments; segment++) {
+
+        if (!prepareSegment(segment)) {
+            PLV_DEBUG(F("ERROR: Fail preallocating log segment."));
+            return false;
+        }
+
+        PluviOnLogSegmentHeader header;
+        baseSeqs[segment] = readSegmentHeader(segment, header) ? header.baseSeq : 0;
+
+        if (baseSeqs[segment] > newest) {
+            newest = baseSeqs[segment];
+        }
+    }
+
+    if (!prepareFile(PLV_LOG_SPARE_FILE, PLV_LOG_RECORD_SIZE)) {
+        PLV_DEBUG(F("ERROR: Fail preallocating log spare record."));
+        return false;
+    }
+
+    // Empty log
+    if (!newest) {
+        PLV_DEBUG(F("SUCCESS: Empty message log."));
+        return resize();
+    }
+
+    // Head: first missing (or torn) record of the newest segment, a record
+    // torn by update() is put back from the spare copy
+    _head = newest;
+    while (_head < newest + PLV_LOG_SEGMENT_RECORDS) {
+
+        uint8_t payload[PLV_LOG_PAYLOAD_SIZE];
+
+        if (readRecord(_head, payload, sizeof(payload)) < 0 && !recoverRecord(_head)) {
+            break;
+        }
+
+        _head++;
+    }
+
+    // Tail: walk back while the previous segments are contiguous
+    unsigned long oldest = newest;
+    while (oldest > PLV_LOG_SEGMENT_RECORDS && (newest - oldest) < (capacity() - PLV_LOG_SEGMENT_RECORDS)) {
+
+        unsigned long previous = oldest - PLV_LOG_SEGMENT_RECORDS;
+        if (baseSeqs[segmentOf(previous)] != previous) {
+            break;
+        }
+
+        oldest = previous;
+    }
+
+    // Rebuild the acknowledgement map (missing records count as acknowledged) and the marks
+    _tail = oldest;
+    for (unsigned long seq = oldest; seq < _head; seq++) {
+
+        PluviOnLogRecordHeader header;
+        boolean valid = readRecordHeader(seq, header);
+
+        setAcked(seq, !valid || header.acked);
+        _marks[(seq - 1) % PLV_LOG_CAPACITY] = valid ? header.marks : 0;
+    }
+
+    advanceTail();
+
+    PLV_DEBUG_(F("SUCCESS: Message log recovered. Tail: "));
+    PLV_DEBUG_(_tail);
+    PLV_DEBUG_(F(", head: "));
+    PLV_DEBUG_(_head);
+    PLV_DEBUG_(F(", pending: "));
+    PLV_DEBUG(pending());
+
+    return resize();
+}
+
+/**
+ * Append a message to the log (drops the oldest segment when full)
+ *
+ * @param payload Message content
+ * @param length Message length in bytes (up to PLV_LOG_PAYLOAD_SIZE)
+ * @return The record sequence number, or 0 if it fails
+ */
+unsigned long PluviOnMessageLog::append(const void *payload, size_t length) {
+
+    if (length > PLV_LOG_PAYLOAD_SIZE) {
+        PLV_DEBUG(F("ERROR: Message too long for the message log."));
+        return 0;
+    }
+
+    // Mounts SPIFFS file system (once per session)
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return 0;
+    }
+
+    unsigned long seq = _head;
+
+    // First record of a segment: reuse the segment, dropping what it held
+    if ((seq - 1) % PLV_LOG_SEGMENT_RECORDS == 0) {
+
+        if (seq > capacity()) {
+
+            unsigned long reusedEnd = seq - capacity() + PLV_LOG_SEGMENT_RECORDS;
+
+            for (; _tail < reusedEnd; _tail++) {
+                if (!isAcked(_tail)) {
+                    _dropped++;
+                }
+            }
+        }
+
+        for (unsigned long s = seq; s < seq + PLV_LOG_SEGMENT_RECORDS; s++) {
+            setAcked(s, false);
+            _marks[(s - 1) % PLV_LOG_CAPACITY] = 0;
+        }
+
+        if (!writeSegmentHeader(segmentOf(seq), seq)) {
+            PLV_DEBUG(F("ERROR: Fail writing log segment header."));
+            return 0;
+        }
+    }
+
+    if (!writeRecord(seq, payload, length)) {
+        return 0;
+    }
+
+    _head++;
+
+    return seq;
+}
+
+/**
+ * Rewrite the newest record while no sink delivered it (e.g. a sample
+ * block that gets one more sample). The new copy is written to the spare
+ * record and checked before the record is rewritten in place: a reset
+ * while writing the spare keeps the old copy, a reset while rewriting the
+ * record leaves the spare one for begin().
+ *
+ * @param seq Record sequence number
+ * @param payload New message content
+ * @param length New message length in bytes (up to PLV_LOG_PAYLOAD_SIZE)
+ * @return true if rewritten, false if the record is not the newest pending one, is marked, or it fails
+ */
+boolean PluviOnMessageLog::update(unsigned long seq, const void *payload, size_t length) {
+
+    if (length > PLV_LOG_PAYLOAD_SIZE || seq + 1 != _head || seq < _tail || isAcked(seq) || marks(seq)) {
+        return false;
+    }
+
+    uint8_t check[PLV_LOG_PAYLOAD_SIZE];
+
+    if (!writeRecordAt(PLV_LOG_SPARE_FILE, 0, seq, payload, length) ||
+        readRecordAt(PLV_LOG_SPARE_FILE, 0, seq, check, sizeof(check)) != (int) length) {
+        PLV_DEBUG(F("ERROR: Fail writing log spare record."));
+        return false;
+    }
+
+    return writeRecord(seq, payload, length);
+}
+
+/**
+ * Acknowledge (remove) a record
+ *
+ * @param seq Record sequence number
+ * @return true if the record was pending and is now acknowledged, otherwise false.
+ */
+boolean PluviOnMessageLog::ack(unsigned long seq) {
+
+    if (seq < _tail || seq >= _head || isAcked(seq)) {
+        return false;
+    }
+
+    if (!writeRecordByte(seq, offsetof(PluviOnLogRecordHeader, acked), 1)) {
+        PLV_DEBUG(F("ERROR: Fail acknowledging log record."));
+        return false;
+    }
+
+    setAcked(seq, true);
+    advanceTail();
+
+    return true;
+}
+
+/**
+ * Mark a pending record (kept in its header, across resets)
+ *
+ * @param seq Record sequence number
+ * @param marks Bits to set (e.g. the sinks that delivered it)
+ * @return true if the record is pending and marked, otherwise false.
+ */
+boolean PluviOnMessageLog::mark(unsigned long seq, uint8_t marks) {
+
+    if (seq < _tail || seq >= _head || isAcked(seq)) {
+        return false;
+    }
+
+    uint8_t &current = _marks[(seq - 1) % PLV_LOG_CAPACITY];
+
+    // Already set, no flash write
+    if ((current | marks) == current) {
+        return true;
+    }
+
+    if (!writeRecordByte(seq, offsetof(PluviOnLogRecordHeader, marks), current | marks)) {
+        PLV_DEBUG(F("ERROR: Fail marking log record."));
+        return false;
+    }
+
+    current |= marks;
+
+    return true;
+}
+
+/**
+ * @param seq Record sequence number
+ * @return The marks of a pending record (0 if it is not pending)
+ */
+uint8_t PluviOnMessageLog::marks(unsigned long seq) {
+
+    if (seq < _tail || seq >= _head || isAcked(seq)) {
+        return 0;
+    }
+
+    return _marks[(seq - 1) % PLV_LOG_CAPACITY];
+}
+
+/**
+ * Read a record
+ *
+ * @param seq Record sequence number
+ * @param payload Buffer for the message content
+ * @param size Buffer size in bytes
+ * @return The message length in bytes, or -1 if the record is not pending or invalid
+ */
+int PluviOnMessageLog::read(unsigned long seq, void *payload, size_t size) {
+
+    if (seq < _tail || seq >= _head || isAcked(seq)) {
+        return -1;
+    }
+
+    return readRecord(seq, payload, size);
+}
+
+/**
+ * Read and validate a record, pending or not
+ *
+ * @return The message length in bytes, or -1 if the slot doesn't hold a valid record
+ */
+int PluviOnMessageLog::readRecord(unsigned long seq, void *payload, size_t size) {
+
+    char path[16];
+    segmentPath(segmentOf(seq), path, sizeof(path));
+
+    return readRecordAt(path, offsetOf(seq), seq, payload, size);
+}
+
+/**
+ * Read and validate the record at a file offset (its slot or the spare one)
+ *
+ * @return The message length in bytes, or -1 if it doesn't hold a valid record
+ */
+int PluviOnMessageLog::readRecordAt(const char *path, size_t offset, unsigned long seq, void *payload, size_t size) {
+
+    File f = PluviOn::FSOpen(path, "r");
+    if (!f) {
+        return -1;
+    }
+
+    PluviOnLogRecordHeader header;
+    boolean success =
+        f.seek(offset, SeekSet) &&
+        PluviOn::FSRead(f, (uint8_t *) &header, sizeof(header)) == sizeof(header) &&
+        header.seq == seq &&
+        header.length <= PLV_LOG_PAYLOAD_SIZE &&
+        header.length <= size &&
+        PluviOn::FSRead(f, (uint8_t *) payload, header.length) == header.length;
+
+    f.close();
+
+    if (!success) {
+        return -1;
+    }
+
+    uint32_t crc = PluviOn::crc32(&header.seq, sizeof(header.seq), PluviOn::FSEpoch());
+    crc = PluviOn::crc32(&header.length, sizeof(header.length), crc);
+    crc = PluviOn::crc32(payload, header.length, crc);
+
+    return crc == header.crc ? header.length : -1;
+}
+
+/**
+ * Oldest pending record
+ *
+ * @return The record sequence number, or 0 if the log is empty
+ */
+unsigned long PluviOnMessageLog::first() {
+
+    advanceTail();
+
+    return _tail < _head ? _tail : 0;
+}
+
+/**
+ * Next pending record
+ *
+ * @param seq Current record sequence number
+ * @return The next record sequence number, or 0 if there is none
+ */
+unsigned long PluviOnMessageLog::next(unsigned long seq) {
+
+    for (seq = max(seq + 1, _tail); seq < _head; seq++) {
+        if (!isAcked(seq)) {
+            return seq;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Drop all the records
+ *
+ * @return true if the log was cleared successfully, otherwise false.
+ */
+boolean PluviOnMessageLog::clear() {
+
+    PLV_DEBUG(F("Clearing message log..."));
+
+    // Mounts SPIFFS file system (once per session)
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    boolean success = true;
+
+    // Segments past the ones in use too (left by a bigger log)
+    for (uint8_t segment = 0; segment < PLV_LOG_SEGMENTS; segment++) {
+
+        char path[16];
+        segmentPath(segment, path, sizeof(path));
+
+        PluviOn::FSRemove(path);
+
+        if (segment < _segments) {
+            success = prepareSegment(segment) && success;
+        }
+    }
+
+    // The spare copy of a record numbered as the next ones
+    PluviOn::FSRemove(PLV_LOG_SPARE_FILE);
+    success = prepareFile(PLV_LOG_SPARE_FILE, PLV_LOG_RECORD_SIZE) && success;
+
+    _head = 1;
+    _tail = 1;
+    memset(_acked, 0, sizeof(_acked));
+    memset(_marks, 0, sizeof(_marks));
+
+    return success;
+}
+
+/**
+ * Number of pending records
+ */
+unsigned long PluviOnMessageLog::pending() {
+
+    unsigned long count = 0;
+
+    for (unsigned long seq = _tail; seq < _head; seq++) {
+        if (!isAcked(seq)) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Number of unacknowledged records dropped because the log was full (since boot)
+ */
+unsigned long PluviOnMessageLog::dropped() {
+    return _dropped;
+}
+
+/**
+ * Records the log holds before dropping the oldest segment
+ */
+unsigned long PluviOnMessageLog::capacity() {
+    return (unsigned long) _segments * PLV_LOG_SEGMENT_RECORDS;
+}
+
+/**
+ * Segment files with their final size, from the first one
+ */
+uint8_t PluviOnMessageLog::existingSegments() {
+
+    uint8_t segments = 0;
+
+    for (; segments < PLV_LOG_SEGMENTS; segments++) {
+
+        char path[16];
+        segmentPath(segments, path, sizeof(path));
+
+        File f = PluviOn::FSOpen(path, "r");
+        size_t size = f ? f.size() : 0;
+        f.close();
+
+        if (size != PLV_LOG_SEGMENT_SIZE) {
+            break;
+        }
+    }
+
+    return segments;
+}
+
+/**
+ * Segments the file system allows: PLV_LOG_FS_SHARE percent of it, counting
+ * the segments in use as free, between PLV_LOG_MIN_SEGMENTS and PLV_LOG_SEGMENTS
+ */
+uint8_t PluviOnMessageLog::sizeSegments() {
+
+    FSInfo info;
+    if (!PLV_FS.info(info)) {
+        return max(_segments, (uint8_t) PLV_LOG_MIN_SEGMENTS);
+    }
+
+    size_t share = info.totalBytes / 100 * PLV_LOG_FS_SHARE;
+    size_t free  = info.totalBytes - info.usedBytes + existingSegments() * PLV_LOG_SEGMENT_SIZE;
+
+    size_t segments = min(share, free) / PLV_LOG_SEGMENT_SIZE;
+
+    return constrain(segments, (size_t) PLV_LOG_MIN_SEGMENTS, (size_t) PLV_LOG_SEGMENTS);
+}
+
+/**
+ * Grow an empty log to the segments the file system allows now (e.g. the
+ * log of an older firmware, or of a fuller file system)
+ *
+ * @return true if the log is ready, otherwise false.
+ */
+boolean PluviOnMessageLog::resize() {
+
+    uint8_t segments = sizeSegments();
+
+    if (pending() || segments <= _segments) {
+        return true;
+    }
+
+    PLV_DEBUG_(F("Growing empty message log to "));
+    PLV_DEBUG_(segments);
+    PLV_DEBUG(F(" segments."));
+
+    _segments = segments;
+
+    return clear();
+}
+
+/**
+ * Create the segment file with its final size, if it doesn't exist yet
+ */
+boolean PluviOnMessageLog::prepareSegment(uint8_t segment) {
+
+    char path[16];
+    segmentPath(segment, path, sizeof(path));
+
+    return prepareFile(path, PLV_LOG_SEGMENT_SIZE);
+}
+
+/**
+ * Create a file of the log with its final size, if it doesn't exist yet
+ */
+boolean PluviOnMessageLog::prepareFile(const char *path, size_t size) {
+
+    File f = PluviOn::FSOpen(path, "r");
+    if (f) {
+        size_t current = f.size();
+        f.close();
+
+        if (current == size) {
+            return true;
+        }
+    }
+
+    PLV_DEBUG_(F("Preallocating log file: \""));
+    PLV_DEBUG_(path);
+    PLV_DEBUG(F("\""));
+
+    f = PluviOn::FSOpen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    uint8_t zeros[64];
+    memset(zeros, 0, sizeof(zeros));
+
+    size_t remaining = size;
+    while (remaining) {
+
+        size_t chunk = min(remaining, sizeof(zeros));
+        if (PluviOn::FSWrite(f, zeros, chunk) != chunk) {
+            break;
+        }
+
+        remaining -= chunk;
+    }
+
+    f.close();
+
+    return remaining == 0;
+}
+
+/**
+ * Write the segment header (the segment starts holding records from baseSeq)
+ */
+boolean PluviOnMessageLog::writeSegmentHeader(uint8_t segment, unsigned long baseSeq) {
+
+    PluviOnLogSegmentHeader header;
+    header.magic   = PLV_LOG_MAGIC;
+    header.version = PLV_LOG_VERSION;
+    header.records = PLV_LOG_SEGMENT_RECORDS;
+    header.baseSeq = baseSeq;
+    header.crc     = segmentChecksum(header);
+
+    char path[16];
+    segmentPath(segment, path, sizeof(path));
+
+    File f = PluviOn::FSOpen(path, "r+");
+    if (!f) {
+        return false;
+    }
+
+    boolean success = PluviOn::FSWrite(f, (const uint8_t *) &header, sizeof(header)) == sizeof(header);
+    f.close();
+
+    return success;
+}
+
+/**
+ * Read and validate the segment header
+ */
+boolean PluviOnMessageLog::readSegmentHeader(uint8_t segment, PluviOnLogSegmentHeader &header) {
+
+    char path[16];
+    segmentPath(segment, path, sizeof(path));
+
+    File f = PluviOn::FSOpen(path, "r");
+    if (!f) {
+        return false;
+    }
+
+    boolean success = PluviOn::FSRead(f, (uint8_t *) &header, sizeof(header)) == sizeof(header);
+    f.close();
+
+    return success &&
+        header.magic == PLV_LOG_MAGIC &&
+        header.version == PLV_LOG_VERSION &&
+        header.records == PLV_LOG_SEGMENT_RECORDS &&
+        header.crc == segmentChecksum(header) &&
+        header.baseSeq > 0 &&
+        (header.baseSeq - 1) % PLV_LOG_SEGMENT_RECORDS == 0 &&
+        segmentOf(header.baseSeq) == segment;
+}
+
+/**
+ * Read the record header
+ *
+ * @return true if the slot holds the given record, otherwise false.
+ */
+boolean PluviOnMessageLog::readRecordHeader(unsigned long seq, PluviOnLogRecordHeader &header) {
+
+    char path[16];
+    segmentPath(segmentOf(seq), path, sizeof(path));
+
+    File f = PluviOn::FSOpen(path, "r");
+    if (!f) {
+        return false;
+    }
+
+    boolean success =
+        f.seek(offsetOf(seq), SeekSet) &&
+        PluviOn::FSRead(f, (uint8_t *) &header, sizeof(header)) == sizeof(header);
+
+    f.close();
+
+    return success && header.seq == seq && header.length <= PLV_LOG_PAYLOAD_SIZE;
+}
+
+/**
+ * Write a whole record (header and payload), unmarked and pending
+ */
+boolean PluviOnMessageLog::writeRecord(unsigned long seq, const void *payload, size_t length) {
+
+    char path[16];
+    segmentPath(segmentOf(seq), path, sizeof(path));
+
+    return writeRecordAt(path, offsetOf(seq), seq, payload, length);
+}
+
+/**
+ * Write a whole record at a file offset (its slot or the spare one)
+ */
+boolean PluviOnMessageLog::writeRecordAt(const char *path, size_t offset, unsigned long seq, const void *payload, size_t length) {
+
+    PluviOnLogRecordHeader header;
+    header.seq      = seq;
+    header.length   = length;
+    header.acked    = 0;
+    header.marks    = 0;
+    header.crc      = PluviOn::crc32(&header.seq, sizeof(header.seq), PluviOn::FSEpoch());
+    header.crc      = PluviOn::crc32(&header.length, sizeof(header.length), header.crc);
+    header.crc      = PluviOn::crc32(payload, length, header.crc);
+
+    File f = PluviOn::FSOpen(path, "r+");
+    if (!f) {
+        PLV_DEBUG(F("ERROR: Fail opening log segment."));
+        return false;
+    }
+
+    boolean success =
+        f.seek(offset, SeekSet) &&
+        PluviOn::FSWrite(f, (const uint8_t *) &header, sizeof(header)) == sizeof(header) &&
+        PluviOn::FSWrite(f, (const uint8_t *) payload, length) == length;
+
+    f.close();
+
+    if (!success) {
+        PLV_DEBUG(F("ERROR: Fail writing log record."));
+    }
+
+    return success;
+}
+
+/**
+ * Put back a record torn by update() from the spare copy
+ *
+ * @return true if the spare record holds a valid copy and it was written back, otherwise false.
+ */
+boolean PluviOnMessageLog::recoverRecord(unsigned long seq) {
+
+    uint8_t payload[PLV_LOG_PAYLOAD_SIZE];
+
+    int length = readRecordAt(PLV_LOG_SPARE_FILE, 0, seq, payload, sizeof(payload));
+    if (length < 0) {
+        return false;
+    }
+
+    PLV_DEBUG_(F("Recovering log record from the spare copy: "));
+    PLV_DEBUG(seq);
+
+    return writeRecord(seq, payload, length);
+}
+
+/**
+ * Write one byte of a record header in place (fields not covered by the CRC)
+ */
+boolean PluviOnMessageLog::writeRecordByte(unsigned long seq, size_t offset, uint8_t value) {
+
+    // Mounts SPIFFS file system (once per session)
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+        return false;
+    }
+
+    char path[16];
+    segmentPath(segmentOf(seq), path, sizeof(path));
+
+    File f = PluviOn::FSOpen(path, "r+");
+    if (!f) {
+        PLV_DEBUG(F("ERROR: Fail opening log segment."));
+        return false;
+    }
+
+    boolean success =
+        f.seek(offsetOf(seq) + offset, SeekSet) &&
+        PluviOn::FSWrite(f, &value, sizeof(value)) == sizeof(value);
+
+    f.close();
+
+    return success;
+}
+
+boolean PluviOnMessageLog::isAcked(unsigned long seq) {
+    unsigned long bit = (seq - 1) % PLV_LOG_CAPACITY;
+    return _acked[bit / 8] & (1 << (bit % 8));
+}
+
+void PluviOnMessageLog::setAcked(unsigned long seq, boolean acked) {
+
+    unsigned long bit = (seq - 1) % PLV_LOG_CAPACITY;
+
+    if (acked) {
+        _acked[bit / 8] |= (1 << (bit % 8));
+    } else {
+        _acked[bit / 8] &= ~(1 << (bit % 8));
+    }
+}
+
+/**
+ * Move the tail past the acknowledged records
+ */
+void PluviOnMessageLog::advanceTail() {
+    while (_tail < _head && isAcked(_tail)) {
+        _tail++;
+    }
+}
+
+void PluviOnMessageLog::segmentPath(uint8_t segment, char *path, size_t size) {
+    snprintf(path, size, "%s/%u", PLV_LOG_DIR, segment);
+}
+
+uint8_t PluviOnMessageLog::segmentOf(unsigned long seq) {
+    return ((seq - 1) / PLV_LOG_SEGMENT_RECORDS) % _segments;
+}
+
+size_t PluviOnMessageLog::offsetOf(unsigned long seq) {
+    return sizeof(PluviOnLogSegmentHeader) + ((seq - 1) % PLV_LOG_SEGMENT_RECORDS) * PLV_LOG_RECORD_SIZE;
+}
+
+uint32_t PluviOnMessageLog::segmentChecksum(const PluviOnLogSegmentHeader &header) {
+    return PluviOn::crc32(&header, offsetof(PluviOnLogSegmentHeader, crc), PluviOn::FSEpoch());
+}
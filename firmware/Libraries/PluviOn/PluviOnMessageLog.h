@@ -0,0 +1,237 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnMessageLog.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnMessageLog_h
+#define PluviOnMessageLog_h
+
+#include "PluviOn.h"
+
+// |------------------------------------------|
+// |           Message Log Layout             |
+// |------------------------------------------|
+// | PLV_LOG_SEGMENTS preallocated files      |
+// | (PLV_LOG_DIR/0, PLV_LOG_DIR/1, ...)      |
+// | each one with a segment header followed  |
+// | by PLV_LOG_SEGMENT_RECORDS fixed size    |
+// | records (header + PLV_LOG_PAYLOAD_SIZE). |
+// |------------------------------------------|
+//
+// The number of segments is chosen by the first begin(): PLV_LOG_FS_SHARE
+// percent of the file system (bounded by its free space), between
+// PLV_LOG_MIN_SEGMENTS and PLV_LOG_SEGMENTS. It's kept while the log holds
+// records, and grows when a later begin() finds the log empty.
+//
+// Default: up to 32 segments x 32 records x 512 bytes = 512 KB of flash
+// (preallocated once, taking a few seconds), 1024 messages. At one weather
+// message every 10 minutes (DHT_SENSOR_READING_DELAY) plus ~200 tip messages
+// on a rainy day, that's ~72 hours of backlog (~170 hours without rain).
+// A 1 MB file system holds 31 segments. When the log is full the oldest
+// segment is dropped (drop-oldest policy).
+//
+// PLV_LOG_SPARE_FILE holds one more record: update() writes the new copy
+// there first, so a reset while rewriting a record in place leaves a valid
+// copy that begin() puts back.
+
+#ifndef PLV_LOG_DIR
+#define PLV_LOG_DIR             "/log"
+#endif
+
+#define PLV_LOG_SPARE_FILE      PLV_LOG_DIR "/spare"
+
+// Maximum number of segments (the RAM kept per record is sized for it)
+#ifndef PLV_LOG_SEGMENTS
+#define PLV_LOG_SEGMENTS        32
+#endif
+
+#ifndef PLV_LOG_MIN_SEGMENTS
+#define PLV_LOG_MIN_SEGMENTS    2
+#endif
+
+// Percent of the file system the log may take
+#ifndef PLV_LOG_FS_SHARE
+#define PLV_LOG_FS_SHARE        50
+#endif
+
+#ifndef PLV_LOG_SEGMENT_RECORDS
+#define PLV_LOG_SEGMENT_RECORDS 32
+#endif
+
+#ifndef PLV_LOG_PAYLOAD_SIZE
+#define PLV_LOG_PAYLOAD_SIZE    500
+#endif
+
+#define PLV_LOG_MAGIC           0x4C4C5650 // "PVLL"
+#define PLV_LOG_VERSION         1
+#define PLV_LOG_CAPACITY        (PLV_LOG_SEGMENTS * PLV_LOG_SEGMENT_RECORDS) // Maximum, see capacity()
+
+/**
+ * Segment file header
+ */
+struct PluviOnLogSegmentHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t records;  // Records per segment
+    uint32_t baseSeq;  // Sequence number of the first record of the segment
+    uint32_t crc;      // CRC32 of the fields above (seeded with the storage epoch)
+};
+
+/**
+ * Record header (followed by PLV_LOG_PAYLOAD_SIZE bytes of payload)
+ */
+struct PluviOnLogRecordHeader {
+    uint32_t seq;      // Record sequence number (0 = empty)
+    uint32_t crc;      // CRC32 of seq, length and payload (seeded with the storage epoch)
+    uint16_t length;   // Payload length in bytes
+    uint8_t  acked;    // 1 when the record was acknowledged (not covered by the CRC)
+    uint8_t  marks;    // Delivery marks, one bit per sink (not covered by the CRC)
+};
+
+#define PLV_LOG_RECORD_SIZE  (sizeof(PluviOnLogRecordHeader) + PLV_LOG_PAYLOAD_SIZE)
+#define PLV_LOG_SEGMENT_SIZE (sizeof(PluviOnLogSegmentHeader) + PLV_LOG_SEGMENT_RECORDS * PLV_LOG_RECORD_SIZE)
+
+class PluviOnMessageLog
+{
+    public:
+        PluviOnMessageLog();
+
+        /**
+         * Preallocate the segment files (sized from the file system the
+         * first time) and recover head and tail by scanning the segment
+         * and record headers.
+         *
+         * @return true if the log is ready, otherwise false.
+         */
+        boolean       begin();
+
+        /**
+         * Append a message to the log (drops the oldest segment when full)
+         *
+         * @param payload Message content
+         * @param length Message length in bytes (up to PLV_LOG_PAYLOAD_SIZE)
+         * @return The record sequence number, or 0 if it fails
+         */
+        unsigned long append(const void *payload, size_t length);
+
+        /**
+         * Rewrite the newest record while no sink delivered it (e.g. a sample
+         * block that gets one more sample). The new copy goes to the spare
+         * record first: a reset while rewriting keeps either copy.
+         *
+         * @param seq Record sequence number (the last append())
+         * @param payload New message content
+         * @param length New message length in bytes (up to PLV_LOG_PAYLOAD_SIZE)
+         * @return true if rewritten, false if the record is not the newest pending one, is marked, or it fails
+         */
+        boolean       update(unsigned long seq, const void *payload, size_t length);
+
+        /**
+         * Acknowledge (remove) a record
+         *
+         * @param seq Record sequence number
+         * @return true if the record was pending and is now acknowledged, otherwise false.
+         */
+        boolean       ack(unsigned long seq);
+
+        /**
+         * Mark a pending record (kept in its header, across resets)
+         *
+         * @param seq Record sequence number
+         * @param marks Bits to set (e.g. the sinks that delivered it)
+         * @return true if the record is pending and marked, otherwise false.
+         */
+        boolean       mark(unsigned long seq, uint8_t marks);
+
+        /**
+         * @param seq Record sequence number
+         * @return The marks of a pending record (0 if it is not pending)
+         */
+        uint8_t       marks(unsigned long seq);
+
+        /**
+         * Read a record
+         *
+         * @param seq Record sequence number
+         * @param payload Buffer for the message content
+         * @param size Buffer size in bytes
+         * @return The message length in bytes, or -1 if the record is not pending or invalid
+         */
+        int           read(unsigned long seq, void *payload, size_t size);
+
+        /**
+         * Oldest pending record
+         *
+         * @return The record sequence number, or 0 if the log is empty
+         */
+        unsigned long first();
+
+        /**
+         * Next pending record
+         *
+         * @param seq Current record sequence number
+         * @return The next record sequence number, or 0 if there is none
+         */
+        unsigned long next(unsigned long seq);
+
+        /**
+         * Drop all the records
+         *
+         * @return true if the log was cleared successfully, otherwise false.
+         */
+        boolean       clear();
+
+        /**
+         * Number of pending records
+         */
+        unsigned long pending();
+
+        /**
+         * Number of unacknowledged records dropped because the log was full (since boot)
+         */
+        unsigned long dropped();
+
+        /**
+         * Records the log holds before dropping the oldest segment
+         */
+        unsigned long capacity();
+
+    private:
+        unsigned long _head;        // Sequence number of the next record
+        unsigned long _tail;        // Sequence number of the oldest pending record
+        unsigned long _dropped;
+        uint8_t       _segments;    // Segment files in use
+        uint8_t       _acked[(PLV_LOG_CAPACITY + 7) / 8];
+        uint8_t       _marks[PLV_LOG_CAPACITY];
+
+        uint8_t       existingSegments();
+        uint8_t       sizeSegments();
+        boolean       resize();
+        boolean       prepareSegment(uint8_t segment);
+        boolean       prepareFile(const char *path, size_t size);
+        boolean       writeSegmentHeader(uint8_t segment, unsigned long baseSeq);
+        boolean       readSegmentHeader(uint8_t segment, PluviOnLogSegmentHeader &header);
+        boolean       readRecordHeader(unsigned long seq, PluviOnLogRecordHeader &header);
+        boolean       writeRecord(unsigned long seq, const void *payload, size_t length);
+        boolean       writeRecordAt(const char *path, size_t offset, unsigned long seq, const void *payload, size_t length);
+        boolean       recoverRecord(unsigned long seq);
+        boolean       writeRecordByte(unsigned long seq, size_t offset, uint8_t value);
+        int           readRecord(unsigned long seq, void *payload, size_t size);
+        int           readRecordAt(const char *path, size_t offset, unsigned long seq, void *payload, size_t size);
+        boolean       isAcked(unsigned long seq);
+        void          setAcked(unsigned long seq, boolean acked);
+        void          advanceTail();
+        void          segmentPath(uint8_t segment, char *path, size_t size);
+        uint8_t       segmentOf(unsigned long seq);
+        size_t        offsetOf(unsigned long seq);
+        uint32_t      segmentChecksum(const PluviOnLogSegmentHeader &header);
+};
+
+#endif
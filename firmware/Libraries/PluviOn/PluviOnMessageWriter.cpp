@@ -0,0 +1,184 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnMessageWriter.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnMessageWriter.h"
+
+PluviOnMessageWriter::PluviOnMessageWriter(char *buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(0), _overflow(false) {
+
+    if (_size) {
+        _buffer[0] = '\0';
+    }
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(const char *value) {
+
+    if (value) {
+        append(value, strlen(value));
+    }
+
+    return *this;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(const __FlashStringHelper *value) {
+
+    PGM_P p = reinterpret_cast<PGM_P>(value);
+    size_t length = strlen_P(p);
+
+    if (_length + length >= _size) {
+        _overflow = true;
+        return *this;
+    }
+
+    memcpy_P(_buffer + _length, p, length);
+    _length += length;
+    _buffer[_length] = '\0';
+
+    return *this;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(const String &value) {
+    append(value.c_str(), value.length());
+    return *this;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(char value) {
+    append(&value, 1);
+    return *this;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(int value) {
+    return *this += (long) value;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(unsigned int value) {
+    return *this += (unsigned long) value;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(long value) {
+
+    // Negate as unsigned, so LONG_MIN doesn't overflow
+    if (value < 0) {
+        appendNumber(0UL - (unsigned long) value, true);
+    } else {
+        appendNumber(value, false);
+    }
+
+    return *this;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(unsigned long value) {
+    appendNumber(value, false);
+    return *this;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(float value) {
+    append(value, 2);
+    return *this;
+}
+
+PluviOnMessageWriter &PluviOnMessageWriter::operator+=(double value) {
+    append(value, 2);
+    return *this;
+}
+
+/**
+ * Append raw bytes
+ *
+ * @param data Bytes to append
+ * @param length Length in bytes
+ * @return true if they fit in the buffer
+ */
+boolean PluviOnMessageWriter::append(const char *data, size_t length) {
+
+    // Keep room for the NUL
+    if (_length + length >= _size) {
+        _overflow = true;
+        return false;
+    }
+
+    memcpy(_buffer + _length, data, length);
+    _length += length;
+    _buffer[_length] = '\0';
+
+    return true;
+}
+
+/**
+ * Append a float with the given number of decimals (as String(value, decimals))
+ */
+boolean PluviOnMessageWriter::append(double value, uint8_t decimals) {
+
+    // Same call as String, so rounding, "nan" and "inf" match it
+    // (buffer size as in String::String(float), on the stack instead of the heap)
+    char number[33];
+
+    if (decimals > 9) {
+        decimals = 9;
+    }
+
+    dtostrf(value, decimals + 2, decimals, number);
+
+    return append(number, strlen(number));
+}
+
+/**
+ * Empty the message (and clear the overflow flag)
+ */
+void PluviOnMessageWriter::clear() {
+
+    _length   = 0;
+    _overflow = false;
+
+    if (_size) {
+        _buffer[0] = '\0';
+    }
+}
+
+const char *PluviOnMessageWriter::c_str() const {
+    return _buffer;
+}
+
+size_t PluviOnMessageWriter::length() const {
+    return _length;
+}
+
+/**
+ * @return true if an append didn't fit in the buffer
+ */
+boolean PluviOnMessageWriter::overflow() const {
+    return _overflow;
+}
+
+/**
+ * Append an integer in decimal (as ltoa/ultoa)
+ */
+boolean PluviOnMessageWriter::appendNumber(unsigned long value, boolean negative) {
+
+    // Digits are generated backwards, from the end of the scratch buffer
+    char number[24];
+    char *p = number + sizeof(number);
+
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    if (negative) {
+        *--p = '-';
+    }
+
+    return append(p, number + sizeof(number) - p);
+}
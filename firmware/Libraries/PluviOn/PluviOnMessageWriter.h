@@ -0,0 +1,83 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnMessageWriter.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnMessageWriter_h
+#define PluviOnMessageWriter_h
+
+#include "PluviOn.h"
+
+/**
+ * Builds a text message in a caller provided buffer, without heap allocations.
+ *
+ * The += operators format values exactly like String += does (integers in
+ * decimal, floats with 2 decimals through dtostrf), so a message built with
+ * it is byte-identical to the same message built with String. The buffer is
+ * always NUL terminated; an append that doesn't fit is dropped and sets the
+ * overflow flag.
+ */
+class PluviOnMessageWriter
+{
+    public:
+        /**
+         * @param buffer Message buffer
+         * @param size Buffer size in bytes (including the NUL)
+         */
+        PluviOnMessageWriter(char *buffer, size_t size);
+
+        PluviOnMessageWriter &operator+=(const char *value);
+        PluviOnMessageWriter &operator+=(const __FlashStringHelper *value);
+        PluviOnMessageWriter &operator+=(const String &value);
+        PluviOnMessageWriter &operator+=(char value);
+        PluviOnMessageWriter &operator+=(int value);
+        PluviOnMessageWriter &operator+=(unsigned int value);
+        PluviOnMessageWriter &operator+=(long value);
+        PluviOnMessageWriter &operator+=(unsigned long value);
+        PluviOnMessageWriter &operator+=(float value);
+        PluviOnMessageWriter &operator+=(double value);
+
+        /**
+         * Append raw bytes
+         *
+         * @param data Bytes to append
+         * @param length Length in bytes
+         * @return true if they fit in the buffer
+         */
+        boolean             append(const char *data, size_t length);
+
+        /**
+         * Append a float with the given number of decimals (as String(value, decimals))
+         */
+        boolean             append(double value, uint8_t decimals);
+
+        /**
+         * Empty the message (and clear the overflow flag)
+         */
+        void                clear();
+
+        const char         *c_str() const;
+        size_t              length() const;
+
+        /**
+         * @return true if an append didn't fit in the buffer
+         */
+        boolean             overflow() const;
+
+    private:
+        char               *_buffer;
+        size_t              _size;
+        size_t              _length;
+        boolean             _overflow;
+
+        boolean             appendNumber(unsigned long value, boolean negative);
+};
+
+#endif
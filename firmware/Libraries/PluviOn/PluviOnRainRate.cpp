@@ -0,0 +1,150 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnRainRate.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnRainRate.h"
+
+#if 60 % PLV_RAIN_SLOT_SECONDS
+#error "PLV_RAIN_SLOT_SECONDS must divide 60"
+#endif
+
+#define PLV_RAIN_SLOT_MILLIS (PLV_RAIN_SLOT_SECONDS * 1000UL)
+
+static const uint8_t PLV_RAIN_WINDOW_MINUTES[PLV_RAIN_WINDOWS] = { 1, 5, 15, 60 };
+
+PluviOnRainRate::PluviOnRainRate() : _mmPerTip(0), _slotStartInMillis(0), _started(false), _tips(0) {
+    clear();
+    resetPeriod();
+}
+
+/**
+ * @param bucketVolumeInMl Calibrated bucket volume
+ * @param contributionAreaInMm2 Funnel area
+ */
+void PluviOnRainRate::setBucket(float bucketVolumeInMl, float contributionAreaInMm2) {
+    _mmPerTip = contributionAreaInMm2 > 0 ? bucketVolumeInMl * 1000 / contributionAreaInMm2 : 0;
+}
+
+/**
+ * Count a tip
+ */
+void PluviOnRainRate::tip(unsigned long timeInMillis) {
+
+    update(timeInMillis);
+
+    _tips++;
+
+    // Out of reach of any bucket (25 tips/s), keeps the sums consistent
+    if (_slots[_current] == 255) {
+        return;
+    }
+
+    _slots[_current]++;
+
+    for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++) {
+        _sums[w]++;
+        _max[w] = max(_max[w], _sums[w]);
+    }
+}
+
+/**
+ * Move the windows to the given time: every slot started since the last
+ * call leaves each window its oldest slot
+ */
+void PluviOnRainRate::update(unsigned long timeInMillis) {
+
+    if (!_started) {
+        _slotStartInMillis = timeInMillis;
+        _started = true;
+        return;
+    }
+
+    unsigned long elapsed = timeInMillis - _slotStartInMillis;
+
+    // Older than the current slot (a tip taken late): counted in the current one
+    if ((long) elapsed < (long) PLV_RAIN_SLOT_MILLIS) {
+        return;
+    }
+
+    unsigned long steps = elapsed / PLV_RAIN_SLOT_MILLIS;
+    _slotStartInMillis += steps * PLV_RAIN_SLOT_MILLIS;
+
+    // An hour or more since the last update: every window is empty
+    if (steps >= PLV_RAIN_SLOTS) {
+        clear();
+        return;
+    }
+
+    while (steps--) {
+
+        uint16_t next = (_current + 1) % PLV_RAIN_SLOTS;
+
+        for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++) {
+            uint16_t slots = PLV_RAIN_WINDOW_MINUTES[w] * 60 / PLV_RAIN_SLOT_SECONDS;
+            _sums[w] -= _slots[(next + PLV_RAIN_SLOTS - slots) % PLV_RAIN_SLOTS];
+        }
+
+        _slots[next] = 0;
+        _current = next;
+    }
+}
+
+/**
+ * @return Rain in the window (mm)
+ */
+float PluviOnRainRate::rainInMm(PluviOnRainWindow window) {
+    return _sums[window] * _mmPerTip;
+}
+
+/**
+ * @return Rain intensity over the window (mm/h)
+ */
+float PluviOnRainRate::intensity(PluviOnRainWindow window) {
+    return toIntensity(_sums[window], window);
+}
+
+/**
+ * @return Highest intensity of the window since resetPeriod() (mm/h)
+ */
+float PluviOnRainRate::maxIntensity(PluviOnRainWindow window) {
+    return toIntensity(_max[window], window);
+}
+
+/**
+ * Start a new reporting period
+ */
+void PluviOnRainRate::resetPeriod() {
+    memcpy(_max, _sums, sizeof(_max));
+}
+
+unsigned long PluviOnRainRate::tips() {
+    return _tips;
+}
+
+uint8_t PluviOnRainRate::windowMinutes(PluviOnRainWindow window) {
+    return PLV_RAIN_WINDOW_MINUTES[window];
+}
+
+/**
+ * Empty every slot and window
+ */
+void PluviOnRainRate::clear() {
+    memset(_slots, 0, sizeof(_slots));
+    memset(_sums, 0, sizeof(_sums));
+    _current = 0;
+}
+
+float PluviOnRainRate::toIntensity(uint16_t tips, PluviOnRainWindow window) {
+    return tips * _mmPerTip * 60 / PLV_RAIN_WINDOW_MINUTES[window];
+}
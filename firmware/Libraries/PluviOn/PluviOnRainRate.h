@@ -0,0 +1,119 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnRainRate.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnRainRate_h
+#define PluviOnRainRate_h
+
+#include "PluviOn.h"
+
+// |------------------------------------------|
+// |         Rain Rate Windows                |
+// |------------------------------------------|
+// |  WINDOW  |  SLOTS  |  INTENSITY          |
+// |----------|---------|---------------------|
+// |   1 min  |     6   |  mm in 1 min x 60   |
+// |   5 min  |    30   |  mm in 5 min x 12   |
+// |  15 min  |    90   |  mm in 15 min x 4   |
+// |  60 min  |   360   |  mm in 60 min       |
+// |------------------------------------------|
+//
+// The last hour of tips is kept as a ring of PLV_RAIN_SLOT_SECONDS slots
+// (one tip count per slot) and every window keeps the sum of its slots: a
+// tip adds to every sum, a new slot subtracts the one leaving each window.
+// Both are O(1), whatever the rain rate. Intensities are in mm/h, the mm per
+// tip come from the bucket volume and the contribution area.
+//
+// The max of every window since resetPeriod() is the peak intensity of the
+// reporting period (the windows only grow on a tip, so it's tracked there).
+
+// Slot length (seconds, divides 60)
+#ifndef PLV_RAIN_SLOT_SECONDS
+#define PLV_RAIN_SLOT_SECONDS 10
+#endif
+
+#define PLV_RAIN_SLOTS (3600 / PLV_RAIN_SLOT_SECONDS)
+
+enum PluviOnRainWindow {
+    PLV_RAIN_1_MIN = 0,
+    PLV_RAIN_5_MIN,
+    PLV_RAIN_15_MIN,
+    PLV_RAIN_60_MIN,
+    PLV_RAIN_WINDOWS
+};
+
+class PluviOnRainRate
+{
+    public:
+        PluviOnRainRate();
+
+        /**
+         * @param bucketVolumeInMl Calibrated bucket volume
+         * @param contributionAreaInMm2 Funnel area
+         */
+        void          setBucket(float bucketVolumeInMl, float contributionAreaInMm2);
+
+        /**
+         * Count a tip
+         *
+         * @param timeInMillis Tip time, millis()
+         */
+        void          tip(unsigned long timeInMillis);
+
+        /**
+         * Move the windows to the given time (before reading them)
+         *
+         * @param timeInMillis Current time, millis()
+         */
+        void          update(unsigned long timeInMillis);
+
+        /**
+         * @return Rain in the window (mm)
+         */
+        float         rainInMm(PluviOnRainWindow window);
+
+        /**
+         * @return Rain intensity over the window (mm/h)
+         */
+        float         intensity(PluviOnRainWindow window);
+
+        /**
+         * @return Highest intensity of the window since resetPeriod() (mm/h)
+         */
+        float         maxIntensity(PluviOnRainWindow window);
+
+        /**
+         * Start a new reporting period (the max intensities restart from the current ones)
+         */
+        void          resetPeriod();
+
+        /**
+         * @return Tips counted since boot
+         */
+        unsigned long tips();
+
+        static uint8_t windowMinutes(PluviOnRainWindow window);
+
+    private:
+        float         _mmPerTip;
+        uint8_t       _slots[PLV_RAIN_SLOTS];  // Tips per slot
+        uint16_t      _current;                // Slot of _slotStartInMillis
+        unsigned long _slotStartInMillis;
+        boolean       _started;
+        uint16_t      _sums[PLV_RAIN_WINDOWS]; // Tips per window
+        uint16_t      _max[PLV_RAIN_WINDOWS];  // Highest sum in the period
+        unsigned long _tips;
+
+        void          clear();
+        float         toIntensity(uint16_t tips, PluviOnRainWindow window);
+};
+
+#endif
@@ -0,0 +1,390 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnSink.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnSink.h"
+
+PluviOnSink::PluviOnSink(const char *name, PluviOnSinkStart start, PluviOnSinkStep step, void *context)
+    : _name(name), _registry(NULL), _mark(0), _start(start), _step(step), _context(context), _health(NULL),
+      _enabled(true), _latestOnly(false), _busy(false), _started(false),
+      _stale(false), _delivered(0), _rateLimit(0), _backoffMin(0), _backoffMax(0), _backoff(0), _backoffWait(0),
+      _lastStartInMillis(0), _lastEndInMillis(0), _deliveries(0), _failures(0), _failuresInARow(0) {
+}
+
+const char *PluviOnSink::name() {
+    return _name;
+}
+
+void PluviOnSink::setEnabled(boolean enabled) {
+    _enabled = enabled;
+}
+
+boolean PluviOnSink::enabled() {
+    return _enabled;
+}
+
+/**
+ * Minimum time between two delivery starts
+ */
+void PluviOnSink::setRateLimit(unsigned long intervalInMillis) {
+    _rateLimit = intervalInMillis;
+}
+
+/**
+ * Wait after a failure, doubled on every failure in a row up to the max
+ */
+void PluviOnSink::setBackoff(unsigned long minInMillis, unsigned long maxInMillis) {
+    _backoffMin = minInMillis;
+    _backoffMax = max(minInMillis, maxInMillis);
+}
+
+/**
+ * Link the sink delivers through (NULL for local sinks)
+ */
+void PluviOnSink::setLinkHealth(PluviOnLinkHealth *health) {
+    _health = health;
+}
+
+/**
+ * Deliver only the newest message, skipping the backlog
+ */
+void PluviOnSink::setLatestOnly(boolean latestOnly) {
+    _latestOnly = latestOnly;
+}
+
+boolean PluviOnSink::latestOnly() {
+    return _latestOnly;
+}
+
+/**
+ * The message was delivered: marked in its log record
+ *
+ * @param seq Message log seq
+ * @return true if marked, false if the message is gone (or the log was reset during the delivery)
+ */
+boolean PluviOnSink::deliver(unsigned long seq) {
+
+    // Same seq, different message: the log was reset since the start
+    if (!_registry || _stale) {
+        return false;
+    }
+
+    if (!_registry->_log.mark(seq, _mark)) {
+        return false;
+    }
+
+    _delivered++;
+
+    return true;
+}
+
+/**
+ * @param seq Message log seq
+ * @return Next pending message log seq after seq not delivered by this sink, or 0 if there is none
+ */
+unsigned long PluviOnSink::next(unsigned long seq) {
+
+    if (!_registry) {
+        return 0;
+    }
+
+    PluviOnMessageLog &log = _registry->_log;
+
+    do {
+        seq = log.next(seq);
+    } while (seq && (log.marks(seq) & _mark));
+
+    return seq;
+}
+
+/**
+ * @return Pending messages not delivered by this sink
+ */
+unsigned long PluviOnSink::pending() {
+
+    if (!_registry) {
+        return 0;
+    }
+
+    unsigned long count = 0;
+
+    for (unsigned long seq = next(0); seq; seq = next(seq)) {
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * @return true while a delivery is in progress
+ */
+boolean PluviOnSink::busy() {
+    return _busy;
+}
+
+/**
+ * @return Time left until the next delivery may start (rate limit or backoff)
+ */
+unsigned long PluviOnSink::waitInMillis() {
+
+    if (_busy || !_started) {
+        return 0;
+    }
+
+    unsigned long now = millis();
+    unsigned long wait = 0;
+
+    // Rate limit counts from the last start, backoff from the failure
+    if ((now - _lastStartInMillis) < _rateLimit) {
+        wait = _rateLimit - (now - _lastStartInMillis);
+    }
+
+    if (_backoffWait && (now - _lastEndInMillis) < _backoffWait) {
+        wait = max(wait, _backoffWait - (now - _lastEndInMillis));
+    }
+
+    return wait;
+}
+
+unsigned long PluviOnSink::deliveries() {
+    return _deliveries;
+}
+
+unsigned long PluviOnSink::failures() {
+    return _failures;
+}
+
+uint8_t PluviOnSink::failuresInARow() {
+    return _failuresInARow;
+}
+
+/**
+ * End of a delivery: reset or grow the backoff
+ *
+ * @param delivered true if messages were delivered
+ */
+void PluviOnSink::done(boolean delivered) {
+
+    _busy = false;
+    _lastEndInMillis = millis();
+
+    if (delivered) {
+        _deliveries++;
+        _failuresInARow = 0;
+        _backoff = 0;
+        _backoffWait = 0;
+        return;
+    }
+
+    _failures++;
+
+    if (_failuresInARow < 255) {
+        _failuresInARow++;
+    }
+
+    _backoff = _backoff ? min(_backoff * 2, _backoffMax) : _backoffMin;
+    _backoffWait = PluviOnLinkHealth::jitter(_backoff, PLV_BACKOFF_JITTER);
+}
+
+PluviOnSinks::PluviOnSinks(PluviOnMessageLog &log) : _log(log), _count(0) {
+}
+
+/**
+ * Register a sink (at setup)
+ *
+ * @return true if registered, false if the registry is full
+ */
+boolean PluviOnSinks::add(PluviOnSink &sink) {
+
+    if (_count >= PLV_SINKS_MAX) {
+        PLV_DEBUG_(F("ERROR: Sink registry is full, not registered: "));
+        PLV_DEBUG(sink.name());
+        return false;
+    }
+
+    sink._registry = this;
+    sink._mark = 1 << _count;
+    _sinks[_count++] = &sink;
+
+    return true;
+}
+
+uint8_t PluviOnSinks::count() {
+    return _count;
+}
+
+PluviOnSink *PluviOnSinks::get(uint8_t index) {
+    return index < _count ? _sinks[index] : NULL;
+}
+
+/**
+ * @return The sink with this name, or NULL
+ */
+PluviOnSink *PluviOnSinks::find(const char *name) {
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (strcmp(_sinks[i]->name(), name) == 0) {
+            return _sinks[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Run one step of every sink, then acknowledge the delivered messages
+ */
+void PluviOnSinks::step() {
+
+    for (uint8_t i = 0; i < _count; i++) {
+        stepSink(*_sinks[i]);
+    }
+
+    release();
+}
+
+/**
+ * Start the sink if it's due and has pending messages, or step its delivery
+ */
+void PluviOnSinks::stepSink(PluviOnSink &sink) {
+
+    // A disabled sink finishes its delivery, but doesn't start a new one
+    if (sink._busy) {
+
+        PluviOnSinkStatus status = sink._step(sink, sink._context);
+
+        if (status == PLV_SINK_DONE) {
+
+            // The server answered: the link works, even if nothing was accepted
+            if (sink._health) {
+                sink._health->success();
+            }
+
+            // Done without delivering anything (e.g. nothing acknowledged) backs off the sink only
+            sink.done(sink._delivered > 0);
+
+        } else if (status == PLV_SINK_FAILED) {
+
+            if (sink._health) {
+                sink._health->failure();
+            }
+
+            sink.done(false);
+        }
+
+        return;
+    }
+
+    if (!sink._enabled || sink.waitInMillis() > 0) {
+        return;
+    }
+
+    unsigned long seq = pendingFor(sink);
+
+    if (!seq) {
+        return;
+    }
+
+    // Link down: skipped, not a failure of the sink
+    if (sink._health && !sink._health->allow()) {
+        return;
+    }
+
+    sink._started = true;
+    sink._stale = false;
+    sink._delivered = 0;
+    sink._lastStartInMillis = millis();
+
+    if (sink._start(sink, seq, sink._context)) {
+        sink._busy = true;
+        return;
+    }
+
+    // Not started (nothing went on the link)
+    if (sink._health) {
+        sink._health->skip();
+    }
+
+    sink.done(false);
+}
+
+/**
+ * The log was cleared or recovered again: the deliveries in progress can't mark their seqs
+ */
+void PluviOnSinks::reset() {
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_sinks[i]->_busy) {
+            _sinks[i]->_stale = true;
+        }
+    }
+}
+
+/**
+ * @return Oldest pending message log seq the sink didn't deliver (the newest
+ *         one for latest only sinks), or 0 if there is none
+ */
+unsigned long PluviOnSinks::pendingFor(PluviOnSink &sink) {
+
+    if (sink._latestOnly) {
+
+        unsigned long seq = _log.first();
+        unsigned long newest = 0;
+
+        for (; seq; seq = _log.next(seq)) {
+            newest = seq;
+        }
+
+        return (newest && !(_log.marks(newest) & sink._mark)) ? newest : 0;
+    }
+
+    unsigned long seq = _log.first();
+
+    return (seq && (_log.marks(seq) & sink._mark)) ? sink.next(seq) : seq;
+}
+
+/**
+ * @return Marks of the sinks holding the messages (enabled, not latest only)
+ */
+uint8_t PluviOnSinks::holding() {
+
+    uint8_t marks = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_sinks[i]->_enabled && !_sinks[i]->_latestOnly) {
+            marks |= _sinks[i]->_mark;
+        }
+    }
+
+    return marks;
+}
+
+/**
+ * Acknowledge in the log the messages every enabled sink delivered
+ * (latest only sinks don't hold messages; without a sink holding them, they stay)
+ */
+void PluviOnSinks::release() {
+
+    uint8_t marks = holding();
+
+    if (!marks) {
+        return;
+    }
+
+    for (unsigned long seq = _log.first(); seq; seq = _log.next(seq)) {
+        if ((_log.marks(seq) & marks) == marks) {
+            _log.ack(seq);
+        }
+    }
+}
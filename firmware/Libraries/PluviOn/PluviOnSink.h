@@ -0,0 +1,228 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnSink.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnSink_h
+#define PluviOnSink_h
+
+#include "PluviOn.h"
+#include "PluviOnMessageLog.h"
+#include "PluviOnLinkHealth.h"
+
+// |------------------------------------------|
+// |            Telemetry Sinks               |
+// |------------------------------------------|
+// | Every sink reads the same message log,   |
+// | with its own rate limit and backoff. A   |
+// | delivered record gets the sink bit in    |
+// | its header marks (bit = registration     |
+// | order), and is acknowledged in the log   |
+// | once every enabled sink delivered it     |
+// | (latest only sinks never hold it).       |
+// |------------------------------------------|
+//
+// The marks are kept in the log, so after a reset no sink delivers a record
+// again, and a record delivered out of order is not posted again either.
+// Register the sinks in the same order on every boot.
+//
+// The backoff gets a random jitter of PLV_BACKOFF_JITTER percent, and
+// grows on failures and on deliveries done without delivering anything (a
+// server refusing the messages). The PluviOnLinkHealth of a sink only hears
+// about the transport: PLV_SINK_FAILED is a failure, PLV_SINK_DONE a
+// success whatever the server answered. Give each server its own, so a
+// server down doesn't stop the sinks of the others.
+
+// Max sinks in a registry (one mark bit each)
+#ifndef PLV_SINKS_MAX
+#define PLV_SINKS_MAX 4
+#endif
+
+#if PLV_SINKS_MAX > 8
+#error "PLV_SINKS_MAX: the log record marks hold 8 sinks"
+#endif
+
+enum PluviOnSinkStatus {
+    PLV_SINK_IDLE = 0,
+    PLV_SINK_BUSY,              // Delivery in progress
+    PLV_SINK_DONE,              // Delivery ended (deliver() told what was delivered)
+    PLV_SINK_FAILED             // Transport failure (connection, timeout): counts against the link
+};
+
+class PluviOnSink;
+class PluviOnSinks;
+
+/**
+ * Start delivering the pending messages from seq (the sink picks how many)
+ *
+ * @param sink Sink being started
+ * @param seq Oldest pending message log seq for this sink (newest, for latest only sinks)
+ * @param context Caller context given to the sink
+ * @return true if started, otherwise false (backs off the sink, not a link failure)
+ */
+typedef boolean (*PluviOnSinkStart)(PluviOnSink &sink, unsigned long seq, void *context);
+
+/**
+ * Run one bounded step of the delivery. Before returning PLV_SINK_DONE the
+ * sink tells the delivered messages with deliver().
+ *
+ * @return PLV_SINK_BUSY, PLV_SINK_DONE or PLV_SINK_FAILED
+ */
+typedef PluviOnSinkStatus (*PluviOnSinkStep)(PluviOnSink &sink, void *context);
+
+class PluviOnSink
+{
+    public:
+        /**
+         * @param name Sink name (status and commands)
+         * @param start Delivery start function
+         * @param step Delivery step function
+         * @param context Passed to the functions
+         */
+        PluviOnSink(const char *name, PluviOnSinkStart start, PluviOnSinkStep step, void *context = NULL);
+
+        const char        *name();
+
+        void               setEnabled(boolean enabled);
+        boolean            enabled();
+
+        /**
+         * Minimum time between two delivery starts
+         */
+        void               setRateLimit(unsigned long intervalInMillis);
+
+        /**
+         * Wait after a failure, doubled on every failure in a row up to the max
+         */
+        void               setBackoff(unsigned long minInMillis, unsigned long maxInMillis);
+
+        /**
+         * Link the sink delivers through: asked before every start, told
+         * about the transport outcome of every delivery (NULL for local sinks)
+         */
+        void               setLinkHealth(PluviOnLinkHealth *health);
+
+        /**
+         * Deliver only the newest message, skipping the backlog
+         */
+        void               setLatestOnly(boolean latestOnly);
+        boolean            latestOnly();
+
+        /**
+         * The message was delivered: marked in its log record
+         *
+         * @param seq Message log seq
+         * @return true if marked, false if the message is gone (or the log was reset during the delivery)
+         */
+        boolean            deliver(unsigned long seq);
+
+        /**
+         * @param seq Message log seq
+         * @return Next pending message log seq after seq not delivered by this sink, or 0 if there is none
+         */
+        unsigned long      next(unsigned long seq);
+
+        /**
+         * @return Pending messages not delivered by this sink
+         */
+        unsigned long      pending();
+
+        /**
+         * @return true while a delivery is in progress
+         */
+        boolean            busy();
+
+        /**
+         * @return Time left until the next delivery may start (rate limit or backoff)
+         */
+        unsigned long      waitInMillis();
+
+        unsigned long      deliveries();
+        unsigned long      failures();
+        uint8_t            failuresInARow();
+
+    private:
+        friend class PluviOnSinks;
+
+        const char        *_name;
+        PluviOnSinks      *_registry;
+        uint8_t            _mark;           // Bit in the log record marks
+        PluviOnSinkStart   _start;
+        PluviOnSinkStep    _step;
+        void              *_context;
+        PluviOnLinkHealth *_health;
+        boolean            _enabled;
+        boolean            _latestOnly;
+        boolean            _busy;
+        boolean            _started;        // Started at least once
+        boolean            _stale;          // The log was reset during the delivery
+        unsigned long      _delivered;      // Messages delivered by the current delivery
+        unsigned long      _rateLimit;
+        unsigned long      _backoffMin;
+        unsigned long      _backoffMax;
+        unsigned long      _backoff;        // Current wait after a failure (0 = none)
+        unsigned long      _backoffWait;    // _backoff with the jitter
+        unsigned long      _lastStartInMillis;
+        unsigned long      _lastEndInMillis;
+        unsigned long      _deliveries;
+        unsigned long      _failures;
+        uint8_t            _failuresInARow;
+
+        void               done(boolean delivered);
+};
+
+class PluviOnSinks
+{
+    public:
+        PluviOnSinks(PluviOnMessageLog &log);
+
+        /**
+         * Register a sink (at setup)
+         *
+         * @return true if registered, false if the registry is full
+         */
+        boolean            add(PluviOnSink &sink);
+
+        uint8_t            count();
+        PluviOnSink       *get(uint8_t index);
+
+        /**
+         * @return The sink with this name, or NULL
+         */
+        PluviOnSink       *find(const char *name);
+
+        /**
+         * Run one step of every sink: start the ones that are due and have
+         * pending messages, step the busy ones, then acknowledge in the log
+         * the messages every sink delivered (call once per loop() iteration)
+         */
+        void               step();
+
+        /**
+         * The log was cleared or recovered again (call after clear() or
+         * begin()): the deliveries in progress finish, but the seqs they
+         * hold are gone and are not marked
+         */
+        void               reset();
+
+    private:
+        friend class PluviOnSink;
+
+        PluviOnMessageLog &_log;
+        PluviOnSink       *_sinks[PLV_SINKS_MAX];
+        uint8_t            _count;
+
+        void               stepSink(PluviOnSink &sink);
+        unsigned long      pendingFor(PluviOnSink &sink);
+        uint8_t            holding();
+        void               release();
+};
+
+#endif
@@ -0,0 +1,488 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnTelemetry.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnTelemetry.h"
+
+// x100 value of a float that can't be represented (NaN, infinite or out of range)
+#define PLV_TLM_INVALID_FIXED ((int32_t) 0x80000000)
+
+/**
+ * Bounds checked frame writer
+ */
+struct PluviOnTelemetryWriter {
+    uint8_t *buffer;
+    size_t   size;
+    size_t   length;
+    boolean  overflow;
+};
+
+static void writeByte(PluviOnTelemetryWriter &w, uint8_t value) {
+
+    if (w.length >= w.size) {
+        w.overflow = true;
+        return;
+    }
+
+    w.buffer[w.length++] = value;
+}
+
+// Unsigned LEB128 varint
+static void writeUVarint(PluviOnTelemetryWriter &w, uint32_t value) {
+
+    while (value >= 0x80) {
+        writeByte(w, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    writeByte(w, value);
+}
+
+// Zigzag encoded signed varint (small negative values stay small)
+static void writeSVarint(PluviOnTelemetryWriter &w, int32_t value) {
+    writeUVarint(w, ((uint32_t) value << 1) ^ (uint32_t) (value >> 31));
+}
+
+// Float as a x100 fixed point signed varint (2 decimals, as in the text message)
+static void writeFixed(PluviOnTelemetryWriter &w, float value) {
+
+    float scaled = value * 100;
+
+    if (isnan(scaled) || scaled > 2147483000.0 || scaled < -2147483000.0) {
+        writeSVarint(w, PLV_TLM_INVALID_FIXED);
+        return;
+    }
+
+    writeSVarint(w, (int32_t) (scaled < 0 ? scaled - 0.5 : scaled + 0.5));
+}
+
+static void writeString(PluviOnTelemetryWriter &w, const char *value) {
+
+    if (!value) {
+        value = "";
+    }
+
+    size_t length = strlen(value);
+    writeUVarint(w, length);
+
+    while (length--) {
+        writeByte(w, *value++);
+    }
+}
+
+// Float as a x10 fixed point integer (sample blocks, 1 decimal as the DHT22)
+static int32_t fixed10(float value) {
+
+    float scaled = value * 10;
+
+    if (isnan(scaled) || scaled > 32767.0 || scaled < -32767.0) {
+        return PLV_BLK_INVALID_FIXED;
+    }
+
+    return (int32_t) (scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+static float unfixed10(int32_t value) {
+    return value == PLV_BLK_INVALID_FIXED ? NAN : value / 10.0;
+}
+
+/**
+ * Bounds checked block reader
+ */
+struct PluviOnTelemetryReader {
+    const uint8_t *data;
+    size_t         length;
+    size_t         pos;
+    boolean        invalid;
+};
+
+static uint8_t readByte(PluviOnTelemetryReader &r) {
+
+    if (r.pos >= r.length) {
+        r.invalid = true;
+        return 0;
+    }
+
+    return r.data[r.pos++];
+}
+
+static uint32_t readUVarint(PluviOnTelemetryReader &r) {
+
+    uint32_t value = 0;
+
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+
+        uint8_t b = readByte(r);
+        value |= (uint32_t) (b & 0x7F) << shift;
+
+        if (!(b & 0x80)) {
+            return value;
+        }
+    }
+
+    // Longer than a 32 bit value
+    r.invalid = true;
+    return 0;
+}
+
+static int32_t readSVarint(PluviOnTelemetryReader &r) {
+    uint32_t value = readUVarint(r);
+    return (int32_t) ((value >> 1) ^ (0 - (value & 1)));
+}
+
+PluviOnTelemetry::PluviOnTelemetry() : _configCrc(0), _sinceKeyframe(0), _forceKeyframe(true) {}
+
+/**
+ * Encode a frame.
+ *
+ * @param stationID Station ID
+ * @param sample Sample fields
+ * @param config Config fields
+ * @param buffer Frame buffer
+ * @param size Buffer size in bytes
+ * @return The frame length in bytes, or 0 if it doesn't fit in the buffer
+ */
+size_t PluviOnTelemetry::encode(const char *stationID, const PluviOnTelemetrySample &sample,
+                                const PluviOnTelemetryConfig &config, uint8_t *buffer, size_t size) {
+
+    uint32_t configCrc = configChecksum(config);
+
+    boolean keyframe =
+        _forceKeyframe ||
+        configCrc != _configCrc ||
+        _sinceKeyframe + 1 >= PLV_TLM_KEYFRAME_INTERVAL;
+
+    uint8_t flags = 0;
+    if (keyframe) {
+        flags |= PLV_TLM_FLAG_KEYFRAME;
+    }
+    if (sample.reset) {
+        flags |= PLV_TLM_FLAG_RESET;
+    }
+
+    PluviOnTelemetryWriter w = { buffer, size, 0, false };
+
+    // Header
+    writeByte(w, PLV_TLM_MAGIC);
+    writeByte(w, PLV_TLM_SCHEMA_VERSION);
+    writeByte(w, flags);
+    writeString(w, stationID);
+
+    // Sample fields
+    writeUVarint(w, sample.messageID);
+    writeSVarint(w, sample.stationTime);
+    writeFixed(w, sample.rainVolume);
+    writeUVarint(w, sample.tipCount);
+    writeFixed(w, sample.temperature);
+    writeFixed(w, sample.humidity);
+    writeFixed(w, sample.heatIndex);
+    writeUVarint(w, sample.freeHeap);
+    writeUVarint(w, sample.freeDiskBytes);
+    writeFixed(w, sample.freeDiskPercent);
+    writeSVarint(w, sample.rssi);
+    writeUVarint(w, sample.vcc);
+    writeSVarint(w, sample.timeToReset);
+
+    // Config fields
+    if (keyframe) {
+        writeString(w, config.stationName);
+        writeString(w, config.latitude);
+        writeString(w, config.longitude);
+        writeFixed(w, config.bucketVolume);
+        writeUVarint(w, config.dhtReadingDelay);
+        writeUVarint(w, config.hallDebounceDelay);
+        writeString(w, config.firmwareVersion);
+        writeString(w, config.resetReason);
+        writeString(w, config.ssid);
+        writeString(w, config.localIp);
+        writeString(w, config.hostname);
+        writeString(w, config.macAddr);
+    }
+
+    if (w.overflow) {
+        PLV_DEBUG(F("ERROR: Telemetry frame doesn't fit in the buffer."));
+        return 0;
+    }
+
+    // Only count the frame once it was encoded
+    if (keyframe) {
+        _configCrc     = configCrc;
+        _sinceKeyframe = 0;
+        _forceKeyframe = false;
+    } else {
+        _sinceKeyframe++;
+    }
+
+    return w.length;
+}
+
+/**
+ * Make the next frame a keyframe
+ */
+void PluviOnTelemetry::forceKeyframe() {
+    _forceKeyframe = true;
+}
+
+/**
+ * @return true if the buffer holds a binary frame (and not a text message)
+ */
+boolean PluviOnTelemetry::isFrame(const uint8_t *buffer, size_t length) {
+    return length >= 3 && buffer[0] == PLV_TLM_MAGIC;
+}
+
+/**
+ * Flag a frame as sent from the offline queue
+ */
+void PluviOnTelemetry::markOffline(uint8_t *buffer, size_t length) {
+
+    if (isFrame(buffer, length)) {
+        buffer[2] |= PLV_TLM_FLAG_OFFLINE;
+    }
+}
+
+/**
+ * CRC32 of the config fields (a change triggers a keyframe)
+ */
+uint32_t PluviOnTelemetry::configChecksum(const PluviOnTelemetryConfig &config) {
+
+    const char *strings[] = {
+        config.stationName, config.latitude, config.longitude, config.firmwareVersion,
+        config.resetReason, config.ssid, config.localIp, config.hostname, config.macAddr
+    };
+
+    uint32_t crc = 0;
+
+    for (uint8_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        const char *value = strings[i] ? strings[i] : "";
+        crc = PluviOn::crc32(value, strlen(value) + 1, crc);
+    }
+
+    crc = PluviOn::crc32(&config.bucketVolume, sizeof(config.bucketVolume), crc);
+    crc = PluviOn::crc32(&config.dhtReadingDelay, sizeof(config.dhtReadingDelay), crc);
+    crc = PluviOn::crc32(&config.hallDebounceDelay, sizeof(config.hallDebounceDelay), crc);
+
+    return crc;
+}
+
+PluviOnSampleBlock::PluviOnSampleBlock(uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(0) {
+    memset(_previous, 0, sizeof(_previous));
+}
+
+/**
+ * Start an empty block
+ *
+ * @param stationID Station ID
+ * @return false if the header doesn't fit in the buffer
+ */
+boolean PluviOnSampleBlock::begin(const char *stationID) {
+
+    PluviOnTelemetryWriter w = { _buffer, _size, 0, false };
+
+    writeByte(w, PLV_BLK_MAGIC);
+    writeByte(w, PLV_BLK_SCHEMA_VERSION);
+    writeByte(w, 0);
+    writeByte(w, 0);
+    writeString(w, stationID);
+
+    if (w.overflow) {
+        PLV_DEBUG(F("ERROR: Sample block header doesn't fit in the buffer."));
+        _length = 0;
+        return false;
+    }
+
+    _length = w.length;
+
+    return true;
+}
+
+/**
+ * Continue a block already in the buffer, to add more samples to it
+ *
+ * @param length Block length in bytes
+ * @return false if the buffer doesn't hold a valid block
+ */
+boolean PluviOnSampleBlock::resume(size_t length) {
+
+    _length = 0;
+
+    if (length > _size || !isBlock(_buffer, length) || _buffer[1] != PLV_BLK_SCHEMA_VERSION) {
+        return false;
+    }
+
+    PluviOnTelemetryReader r = { _buffer, length, 4, false };
+    uint8_t count = _buffer[3];
+
+    // Station ID
+    uint32_t idLength = readUVarint(r);
+
+    if (r.invalid || idLength > length - r.pos) {
+        return false;
+    }
+
+    r.pos += idLength;
+
+    // Fields of the last sample, for the next delta
+    for (uint8_t n = 0; n < count; n++) {
+
+        if (n == 0) {
+            _previous[0] = readUVarint(r);
+            _previous[1] = (uint32_t) readSVarint(r);
+            _previous[2] = readUVarint(r);
+            _previous[3] = (uint32_t) readSVarint(r);
+            _previous[4] = (uint32_t) readSVarint(r);
+        } else {
+            for (uint8_t i = 0; i < 5; i++) {
+                _previous[i] += (uint32_t) readSVarint(r);
+            }
+        }
+
+        if (r.invalid) {
+            return false;
+        }
+    }
+
+    // Nothing after the last sample
+    if (r.pos != length) {
+        return false;
+    }
+
+    _length = length;
+
+    return true;
+}
+
+/**
+ * Add a sample (the block is unchanged if it doesn't fit)
+ *
+ * @param sample Sample
+ * @return false if the buffer or the block is full
+ */
+boolean PluviOnSampleBlock::add(const PluviOnSample &sample) {
+
+    if (!_length || count() >= PLV_BLK_MAX_SAMPLES) {
+        return false;
+    }
+
+    uint32_t fields[5] = {
+        sample.messageID,
+        (uint32_t) sample.stationTime,
+        sample.tipCount,
+        (uint32_t) fixed10(sample.temperature),
+        (uint32_t) fixed10(sample.humidity)
+    };
+
+    PluviOnTelemetryWriter w = { _buffer, _size, _length, false };
+
+    if (count() == 0) {
+        // Base sample
+        writeUVarint(w, fields[0]);
+        writeSVarint(w, (int32_t) fields[1]);
+        writeUVarint(w, fields[2]);
+        writeSVarint(w, (int32_t) fields[3]);
+        writeSVarint(w, (int32_t) fields[4]);
+    } else {
+        for (uint8_t i = 0; i < 5; i++) {
+            writeSVarint(w, (int32_t) (fields[i] - _previous[i]));
+        }
+    }
+
+    if (w.overflow) {
+        return false;
+    }
+
+    memcpy(_previous, fields, sizeof(_previous));
+    _length = w.length;
+    _buffer[3]++;
+
+    return true;
+}
+
+size_t PluviOnSampleBlock::length() {
+    return _length;
+}
+
+uint8_t PluviOnSampleBlock::count() {
+    return _length ? _buffer[3] : 0;
+}
+
+/**
+ * @return true if the buffer holds a sample block (and not a text message or a frame)
+ */
+boolean PluviOnSampleBlock::isBlock(const uint8_t *buffer, size_t length) {
+    return length >= 4 && buffer[0] == PLV_BLK_MAGIC;
+}
+
+/**
+ * Decode the samples of a block
+ *
+ * @return Samples in the block (only the first size are decoded), or -1 if it's invalid
+ */
+int PluviOnSampleBlock::decode(const uint8_t *data, size_t length, PluviOnSample *samples, uint8_t size) {
+
+    if (!isBlock(data, length) || data[1] != PLV_BLK_SCHEMA_VERSION) {
+        return -1;
+    }
+
+    PluviOnTelemetryReader r = { data, length, 4, false };
+    uint8_t count = data[3];
+
+    // Station ID
+    uint32_t idLength = readUVarint(r);
+
+    if (r.invalid || idLength > length - r.pos) {
+        return -1;
+    }
+
+    r.pos += idLength;
+
+    uint32_t fields[5];
+
+    for (uint8_t n = 0; n < count && n < size; n++) {
+
+        if (n == 0) {
+            fields[0] = readUVarint(r);
+            fields[1] = (uint32_t) readSVarint(r);
+            fields[2] = readUVarint(r);
+            fields[3] = (uint32_t) readSVarint(r);
+            fields[4] = (uint32_t) readSVarint(r);
+        } else {
+            for (uint8_t i = 0; i < 5; i++) {
+                fields[i] += (uint32_t) readSVarint(r);
+            }
+        }
+
+        if (r.invalid || r.pos > length) {
+            return -1;
+        }
+
+        samples[n].messageID   = fields[0];
+        samples[n].stationTime = (int32_t) fields[1];
+        samples[n].tipCount    = fields[2];
+        samples[n].temperature = unfixed10((int32_t) fields[3]);
+        samples[n].humidity    = unfixed10((int32_t) fields[4]);
+    }
+
+    return count;
+}
+
+/**
+ * Flag a block as sent from the offline queue
+ */
+void PluviOnSampleBlock::markOffline(uint8_t *buffer, size_t length) {
+
+    if (isBlock(buffer, length)) {
+        buffer[2] |= PLV_TLM_FLAG_OFFLINE;
+    }
+}
@@ -0,0 +1,238 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnTelemetry.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnTelemetry_h
+#define PluviOnTelemetry_h
+
+#include "PluviOn.h"
+
+// |------------------------------------------|
+// |       Binary Telemetry Frame (v1)        |
+// |------------------------------------------|
+// | u8     magic (PLV_TLM_MAGIC)             |
+// | u8     schema version                    |
+// | u8     flags (PLV_TLM_FLAG_*)            |
+// | str    station id                        |
+// | sample fields, in PluviOnTelemetrySample |
+// | order (uvarint, or zigzag svarint for    |
+// | signed values, floats as x100 integers)  |
+// | config fields, in PluviOnTelemetryConfig |
+// | order (keyframes only)                   |
+// |------------------------------------------|
+//
+// str = uvarint length followed by the bytes (no NUL).
+// Decoder: firmware/tools/pluvion_telemetry.py
+
+#define PLV_TLM_MAGIC          0xB1 // Never the first byte of a text message
+#define PLV_TLM_SCHEMA_VERSION 1
+
+#define PLV_TLM_FLAG_KEYFRAME  0x01 // Config fields follow the sample fields
+#define PLV_TLM_FLAG_RESET     0x02 // First message after a system reset
+#define PLV_TLM_FLAG_OFFLINE   0x04 // Sent from the offline queue
+
+// Config fields are resent at least every PLV_TLM_KEYFRAME_INTERVAL frames
+#ifndef PLV_TLM_KEYFRAME_INTERVAL
+#define PLV_TLM_KEYFRAME_INTERVAL 48
+#endif
+
+/**
+ * Sample fields, sent in every frame
+ */
+struct PluviOnTelemetrySample {
+    uint32_t messageID;
+    int32_t  stationTime;
+    float    rainVolume;
+    uint32_t tipCount;
+    float    temperature;
+    float    humidity;
+    float    heatIndex;
+    uint32_t freeHeap;
+    uint32_t freeDiskBytes;
+    float    freeDiskPercent;
+    int32_t  rssi;
+    uint32_t vcc;
+    int32_t  timeToReset;
+    boolean  reset;
+};
+
+/**
+ * Config and infrastructure fields, sent only in keyframes
+ */
+struct PluviOnTelemetryConfig {
+    const char *stationName;
+    const char *latitude;
+    const char *longitude;
+    float       bucketVolume;
+    uint32_t    dhtReadingDelay;
+    uint32_t    hallDebounceDelay;
+    const char *firmwareVersion;
+    const char *resetReason;
+    const char *ssid;
+    const char *localIp;
+    const char *hostname;
+    const char *macAddr;
+};
+
+class PluviOnTelemetry
+{
+    public:
+        PluviOnTelemetry();
+
+        /**
+         * Encode a frame. It is a keyframe if the config changed since the
+         * last keyframe, after PLV_TLM_KEYFRAME_INTERVAL frames, or if one
+         * was requested with forceKeyframe().
+         *
+         * @param stationID Station ID
+         * @param sample Sample fields
+         * @param config Config fields
+         * @param buffer Frame buffer
+         * @param size Buffer size in bytes
+         * @return The frame length in bytes, or 0 if it doesn't fit in the buffer
+         */
+        size_t         encode(const char *stationID, const PluviOnTelemetrySample &sample,
+                              const PluviOnTelemetryConfig &config, uint8_t *buffer, size_t size);
+
+        /**
+         * Make the next frame a keyframe
+         */
+        void           forceKeyframe();
+
+        /**
+         * @return true if the buffer holds a binary frame (and not a text message)
+         */
+        static boolean isFrame(const uint8_t *buffer, size_t length);
+
+        /**
+         * Flag a frame as sent from the offline queue
+         */
+        static void    markOffline(uint8_t *buffer, size_t length);
+
+    private:
+        uint32_t       _configCrc;
+        uint16_t       _sinceKeyframe;
+        boolean        _forceKeyframe;
+
+        uint32_t       configChecksum(const PluviOnTelemetryConfig &config);
+};
+
+// |------------------------------------------|
+// |        Sensor Sample Block (v1)          |
+// |------------------------------------------|
+// | u8     magic (PLV_BLK_MAGIC)             |
+// | u8     schema version                    |
+// | u8     flags (PLV_TLM_FLAG_OFFLINE)      |
+// | u8     sample count                      |
+// | str    station id                        |
+// | base sample, in PluviOnSample order      |
+// | (uvarint, or zigzag svarint for signed   |
+// | values, floats as x10 integers)          |
+// | each next sample: zigzag svarint delta   |
+// | of every field from the previous sample  |
+// |------------------------------------------|
+//
+// Only the sensor readings: a sample takes ~14 bytes alone and ~6 bytes as
+// a delta (a text message takes ~250). Deltas are 32 bit wrapping differences.
+// Decoder: firmware/tools/pluvion_telemetry.py
+
+#define PLV_BLK_MAGIC          0xB2 // Never the first byte of a text message
+#define PLV_BLK_SCHEMA_VERSION 1
+#define PLV_BLK_MAX_SAMPLES    255
+
+// x10 value of a reading that can't be represented (failed sensor reading)
+#define PLV_BLK_INVALID_FIXED  -32768
+
+/**
+ * Sensor sample, stored in a block (temperature and humidity with the
+ * DHT22 resolution, 0.1)
+ */
+struct PluviOnSample {
+    uint32_t messageID;
+    int32_t  stationTime;
+    uint32_t tipCount;
+    float    temperature;
+    float    humidity;
+};
+
+/**
+ * Block of sensor samples: a base sample followed by the deltas of the next
+ * ones, built in a caller buffer.
+ */
+class PluviOnSampleBlock
+{
+    public:
+        PluviOnSampleBlock(uint8_t *buffer, size_t size);
+
+        /**
+         * Start an empty block
+         *
+         * @param stationID Station ID
+         * @return false if the header doesn't fit in the buffer
+         */
+        boolean        begin(const char *stationID);
+
+        /**
+         * Continue a block already in the buffer (e.g. read back from the
+         * message log), to add more samples to it
+         *
+         * @param length Block length in bytes
+         * @return false if the buffer doesn't hold a valid block
+         */
+        boolean        resume(size_t length);
+
+        /**
+         * Add a sample (the block is unchanged if it doesn't fit)
+         *
+         * @param sample Sample
+         * @return false if the buffer or the block is full
+         */
+        boolean        add(const PluviOnSample &sample);
+
+        /**
+         * @return Block length in bytes
+         */
+        size_t         length();
+
+        /**
+         * @return Samples in the block
+         */
+        uint8_t        count();
+
+        /**
+         * @return true if the buffer holds a sample block (and not a text message or a frame)
+         */
+        static boolean isBlock(const uint8_t *buffer, size_t length);
+
+        /**
+         * Decode the samples of a block
+         *
+         * @param data Block bytes
+         * @param length Block length in bytes
+         * @param samples Decoded samples
+         * @param size Max samples to decode
+         * @return Samples in the block (only the first size are decoded), or -1 if it's invalid
+         */
+        static int     decode(const uint8_t *data, size_t length, PluviOnSample *samples, uint8_t size);
+
+        /**
+         * Flag a block as sent from the offline queue
+         */
+        static void    markOffline(uint8_t *buffer, size_t length);
+
+    private:
+        uint8_t       *_buffer;
+        size_t         _size;
+        size_t         _length;
+        uint32_t       _previous[5]; // Fields of the last sample, as encoded
+};
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnTipDebouncer.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnTipDebouncer.h"
+
+PluviOnTipDebouncer::PluviOnTipDebouncer()
+    : _activeLevel(LOW), _minPulseWidth(PLV_TIP_MIN_PULSE_WIDTH), _refractory(PLV_TIP_REFRACTORY),
+      _state(PLV_TIP_IDLE), _pulseStart(0), _lastTip(0), _tipped(false),
+      _tips(0), _glitches(0), _bounces(0) {
+}
+
+/**
+ * @param level Pin level while the magnet is over the sensor
+ */
+void PluviOnTipDebouncer::setActiveLevel(uint8_t level) {
+    _activeLevel = level ? HIGH : LOW;
+}
+
+void PluviOnTipDebouncer::setMinPulseWidth(unsigned long widthInMicros) {
+    _minPulseWidth = widthInMicros;
+}
+
+void PluviOnTipDebouncer::setRefractory(unsigned long periodInMicros) {
+    _refractory = periodInMicros;
+}
+
+/**
+ * Refractory period of a bucket that tips at most this often
+ */
+void PluviOnTipDebouncer::setMaxTipRate(float tipsPerSecond) {
+
+    if (tipsPerSecond > 0) {
+        _refractory = 1000000 / tipsPerSecond;
+    }
+}
+
+/**
+ * Start from the current pin level (a sensor active at boot counts on its release)
+ */
+void PluviOnTipDebouncer::begin(uint8_t level) {
+
+    _state = level == _activeLevel ? PLV_TIP_PULSE : PLV_TIP_IDLE;
+    _pulseStart = PLV_EDGE_TIME(micros());
+}
+
+/**
+ * Process the next edge
+ *
+ * @return true if the edge completes a tip
+ */
+boolean PluviOnTipDebouncer::edge(uint32_t timestampInMicros, uint8_t level) {
+
+    boolean active = (level ? HIGH : LOW) == _activeLevel;
+
+    if (_state == PLV_TIP_IDLE) {
+
+        // Release without its active edge (lost with the ring full)
+        if (!active) {
+            return false;
+        }
+
+        if (_tipped && (timestampInMicros - _lastTip) < _refractory) {
+            _bounces++;
+            return false;
+        }
+
+        _state = PLV_TIP_PULSE;
+        _pulseStart = timestampInMicros;
+
+        return false;
+    }
+
+    // Active again without the release in between: the pulse starts over
+    if (active) {
+        _pulseStart = timestampInMicros;
+        return false;
+    }
+
+    _state = PLV_TIP_IDLE;
+
+    if ((timestampInMicros - _pulseStart) < _minPulseWidth) {
+        _glitches++;
+        return false;
+    }
+
+    _lastTip = _pulseStart;
+    _tipped = true;
+    _tips++;
+
+    return true;
+}
+
+PluviOnTipState PluviOnTipDebouncer::state() {
+    return _state;
+}
+
+uint32_t PluviOnTipDebouncer::lastTipInMicros() {
+    return _lastTip;
+}
+
+unsigned long PluviOnTipDebouncer::lastTipInMillis() {
+
+    // Age of the edge, micros() wraps every ~71 min (edges are popped well before)
+    uint32_t ageInMicros = (uint32_t) micros() - _lastTip;
+
+    return millis() - ageInMicros / 1000;
+}
+
+unsigned long PluviOnTipDebouncer::tips() {
+    return _tips;
+}
+
+unsigned long PluviOnTipDebouncer::glitches() {
+    return _glitches;
+}
+
+unsigned long PluviOnTipDebouncer::bounces() {
+    return _bounces;
+}
@@ -0,0 +1,127 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnTipDebouncer.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnTipDebouncer_h
+#define PluviOnTipDebouncer_h
+
+#include "PluviOn.h"
+
+// |------------------------------------------|
+// |         Tip Debouncer States             |
+// |------------------------------------------|
+// | IDLE  -- active edge -->  PULSE          |
+// |          (ignored within the refractory  |
+// |          period of the last tip: bounce) |
+// | PULSE -- release edge --> IDLE           |
+// |          tip if the pulse lasted the min |
+// |          pulse width, else a glitch      |
+// |------------------------------------------|
+//
+// A tip is the magnet passing the hall sensor: an active edge and its
+// release, both seen. The tip time is the active edge; no tip can follow
+// within the refractory period (1 / max tip rate of the bucket), so the
+// contact bounces and the swing back of the bucket never count twice.
+//
+// Fed with the edges the ISR records (PLV_EDGE: micros() with the pin level
+// after the edge in bit 0), in order, from the loop.
+
+// Edge record: time in micros() (bit 0 dropped) and the pin level after the edge
+#define PLV_EDGE(timestampInMicros, level) (((uint32_t) (timestampInMicros) & ~1UL) | ((level) ? 1 : 0))
+#define PLV_EDGE_TIME(edge)                ((uint32_t) (edge) & ~1UL)
+#define PLV_EDGE_LEVEL(edge)               ((uint8_t) ((edge) & 1))
+
+// Defaults
+#define PLV_TIP_MIN_PULSE_WIDTH 2000   // Shortest magnet pulse (us)
+#define PLV_TIP_REFRACTORY      250000 // Shortest time between two tips (us)
+
+enum PluviOnTipState {
+    PLV_TIP_IDLE = 0,           // Sensor released
+    PLV_TIP_PULSE               // Sensor active, waiting for the release
+};
+
+class PluviOnTipDebouncer
+{
+    public:
+        PluviOnTipDebouncer();
+
+        /**
+         * @param level Pin level while the magnet is over the sensor (LOW with a pull-up)
+         */
+        void            setActiveLevel(uint8_t level);
+
+        /**
+         * @param widthInMicros Shorter active pulses are glitches
+         */
+        void            setMinPulseWidth(unsigned long widthInMicros);
+
+        /**
+         * @param periodInMicros Edges this close to the last tip are bounces
+         */
+        void            setRefractory(unsigned long periodInMicros);
+
+        /**
+         * Refractory period of a bucket that tips at most this often
+         *
+         * @param tipsPerSecond Max tip rate of the bucket
+         */
+        void            setMaxTipRate(float tipsPerSecond);
+
+        /**
+         * Start from the current pin level
+         */
+        void            begin(uint8_t level);
+
+        /**
+         * Process the next edge
+         *
+         * @param timestampInMicros Edge time, micros()
+         * @param level Pin level after the edge
+         * @return true if the edge completes a tip (see lastTipInMicros())
+         */
+        boolean         edge(uint32_t timestampInMicros, uint8_t level);
+
+        PluviOnTipState state();
+
+        /**
+         * @return Active edge time of the last tip
+         */
+        uint32_t        lastTipInMicros();
+
+        /**
+         * Active edge time of the last tip on the millis() clock (for the
+         * rain windows): edges are processed after the ISR stored them, so
+         * millis() at that point is late by the time spent in the ring
+         *
+         * @return millis() at the active edge of the last tip
+         */
+        unsigned long   lastTipInMillis();
+
+        unsigned long   tips();
+        unsigned long   glitches();     // Pulses shorter than the min width
+        unsigned long   bounces();      // Active edges within the refractory period
+
+    private:
+        uint8_t         _activeLevel;
+        unsigned long   _minPulseWidth;
+        unsigned long   _refractory;
+
+        PluviOnTipState _state;
+        uint32_t        _pulseStart;
+        uint32_t        _lastTip;
+        boolean         _tipped;        // A tip was counted (_lastTip is valid)
+
+        unsigned long   _tips;
+        unsigned long   _glitches;
+        unsigned long   _bounces;
+};
+
+#endif
@@ -0,0 +1,306 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnUDPLink.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnUDPLink.h"
+
+PluviOnUDPLink::PluviOnUDPLink(UDP &udp, PluviOnMessageLog &log)
+    : _udp(udp), _log(log), _handler(NULL), _handlerContext(NULL),
+      _host(NULL), _port(0), _state(PLV_UDP_IDLE),
+      _timeout(PLV_UDP_RETRANSMIT_TIMEOUT), _maxAttempts(PLV_UDP_MAX_ATTEMPTS), _lastQueued(0),
+      _sent(0), _retransmits(0), _acks(0), _roundTrip(0) {
+    memset(_flights, 0, sizeof(_flights));
+}
+
+/**
+ * Open the local port the acks arrive at
+ *
+ * @return true if the port is open
+ */
+boolean PluviOnUDPLink::begin(uint16_t localPort) {
+    return _udp.begin(localPort) == 1;
+}
+
+/**
+ * @param timeoutInMillis Wait for an ack before sending again
+ * @param maxAttempts Sends of a message per round
+ */
+void PluviOnUDPLink::setRetransmit(unsigned long timeoutInMillis, uint8_t maxAttempts) {
+    _timeout     = timeoutInMillis;
+    _maxAttempts = max(maxAttempts, (uint8_t) 1);
+}
+
+void PluviOnUDPLink::setAckHandler(PluviOnUDPAckHandler handler, void *context) {
+    _handler        = handler;
+    _handlerContext = context;
+}
+
+/**
+ * Start a round: send every pending message of the log until they are acked
+ *
+ * @return true if started, false if a round is running
+ */
+boolean PluviOnUDPLink::start(const char *host, uint16_t port) {
+
+    if (busy()) {
+        return false;
+    }
+
+    _host       = host;
+    _port       = port;
+    _lastQueued = 0;
+    _state      = PLV_UDP_SENDING;
+
+    memset(_flights, 0, sizeof(_flights));
+
+    return true;
+}
+
+/**
+ * Read the acks, send again the expired messages and fill the window
+ *
+ * @return Round state (DONE and FAILED are returned once)
+ */
+PluviOnUDPState PluviOnUDPLink::step() {
+
+    if (_state == PLV_UDP_DONE || _state == PLV_UDP_FAILED) {
+        _state = PLV_UDP_IDLE;
+    }
+
+    // Acks of a finished round still remove their messages
+    receive();
+
+    if (_state == PLV_UDP_IDLE) {
+        return _state;
+    }
+
+    unsigned long now = millis();
+
+    for (uint8_t i = 0; i < PLV_UDP_WINDOW; i++) {
+
+        PluviOnUDPFlight &flight = _flights[i];
+
+        if (!flight.seq || (now - flight.sentInMillis) < _timeout) {
+            continue;
+        }
+
+        if (flight.attempts >= _maxAttempts) {
+            PLV_DEBUG_(F("UDP: No ack, giving up on seq "));
+            PLV_DEBUG(flight.seq);
+
+            memset(_flights, 0, sizeof(_flights));
+            _state = PLV_UDP_FAILED;
+            return _state;
+        }
+
+        // Gone from the log (acked late or dropped): nothing to resend
+        if (send(flight)) {
+            _retransmits++;
+        } else {
+            flight.seq = 0;
+        }
+    }
+
+    if (!fill() && !inFlight()) {
+        _state = PLV_UDP_DONE;
+    }
+
+    return _state;
+}
+
+boolean PluviOnUDPLink::busy() {
+    return _state == PLV_UDP_SENDING;
+}
+
+unsigned long PluviOnUDPLink::datagramsSent() {
+    return _sent;
+}
+
+unsigned long PluviOnUDPLink::retransmits() {
+    return _retransmits;
+}
+
+unsigned long PluviOnUDPLink::acks() {
+    return _acks;
+}
+
+/**
+ * @return Time from the last acked datagram to its ack
+ */
+unsigned long PluviOnUDPLink::lastRoundTripInMillis() {
+    return _roundTrip;
+}
+
+/**
+ * Read the pending acks ("<seq>|<result>|...", anything else is ignored)
+ */
+void PluviOnUDPLink::receive() {
+
+    for (uint8_t n = 0; n < PLV_UDP_READ_BUDGET; n++) {
+
+        int size = _udp.parsePacket();
+
+        if (size <= 0) {
+            return;
+        }
+
+        int length = _udp.read((uint8_t *) _response, sizeof(_response) - 1);
+        _udp.flush();
+
+        if (length <= 0) {
+            continue;
+        }
+
+        _response[length] = '\0';
+
+        // Line breaks of a hand written ack
+        while (length > 0 && (_response[length - 1] == '\n' || _response[length - 1] == '\r')) {
+            _response[--length] = '\0';
+        }
+
+        char *fields;
+        unsigned long seq = strtoul(_response, &fields, 10);
+
+        if (fields == _response || *fields != '|' || !seq) {
+            PLV_DEBUG_(F("UDP: Invalid ack: "));
+            PLV_DEBUG(_response);
+            continue;
+        }
+
+        fields++;
+
+        if (strncmp(fields, "ok", 2) == 0 && (fields[2] == '|' || fields[2] == '\0')) {
+            acked(seq, fields);
+        } else {
+            // Refused: sent again once its ack times out
+            PLV_DEBUG_(F("UDP: Refused seq "));
+            PLV_DEBUG_(seq);
+            PLV_DEBUG_(F(": "));
+            PLV_DEBUG(fields);
+        }
+    }
+}
+
+/**
+ * Remove an acked message from the window and from the log
+ */
+void PluviOnUDPLink::acked(unsigned long seq, const char *response) {
+
+    for (uint8_t i = 0; i < PLV_UDP_WINDOW; i++) {
+        if (_flights[i].seq == seq) {
+            _roundTrip = millis() - _flights[i].sentInMillis;
+            _flights[i].seq = 0;
+        }
+    }
+
+    // Duplicate acks (of a message sent again) find it acked already
+    if (!_log.ack(seq)) {
+        return;
+    }
+
+    _acks++;
+
+    if (_handler) {
+        _handler(seq, response, _handlerContext);
+    }
+}
+
+/**
+ * Send (or send again) the message of a window slot
+ *
+ * @return false if the message isn't in the log anymore
+ */
+boolean PluviOnUDPLink::send(PluviOnUDPFlight &flight) {
+
+    int prefix = snprintf(_datagram, sizeof(_datagram), "%lu|", flight.seq);
+    int length = _log.read(flight.seq, _datagram + prefix, sizeof(_datagram) - prefix);
+
+    if (length < 0) {
+        return false;
+    }
+
+    flight.sentInMillis = millis();
+    flight.attempts++;
+
+    // A datagram that can't be sent is lost as if the network dropped it
+    if (!_udp.beginPacket(_host, _port) ||
+        _udp.write((const uint8_t *) _datagram, prefix + length) != (size_t) (prefix + length) ||
+        !_udp.endPacket()) {
+        PLV_DEBUG_(F("UDP: Fail sending seq "));
+        PLV_DEBUG(flight.seq);
+        return true;
+    }
+
+    _sent++;
+
+    return true;
+}
+
+/**
+ * Put the next pending messages of the log in the free window slots
+ *
+ * @return false if there is no message left to put in flight
+ */
+boolean PluviOnUDPLink::fill() {
+
+    for (uint8_t i = 0; i < PLV_UDP_WINDOW; i++) {
+
+        if (_flights[i].seq) {
+            continue;
+        }
+
+        while (true) {
+
+            unsigned long seq = _lastQueued ? _log.next(_lastQueued) : _log.first();
+
+            if (!seq) {
+                return false;
+            }
+
+            _lastQueued = seq;
+
+            _flights[i].seq = seq;
+            _flights[i].attempts = 0;
+
+            if (send(_flights[i])) {
+                break;
+            }
+
+            // Unreadable record, do not retry it forever
+            PLV_DEBUG_(F("UDP: Fail reading message, dropping seq "));
+            PLV_DEBUG(seq);
+
+            _log.ack(seq);
+            _flights[i].seq = 0;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @return Messages in flight
+ */
+uint8_t PluviOnUDPLink::inFlight() {
+
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < PLV_UDP_WINDOW; i++) {
+        if (_flights[i].seq) {
+            count++;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,161 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnUDPLink.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnUDPLink_h
+#define PluviOnUDPLink_h
+
+#include "PluviOn.h"
+#include "PluviOnMessageLog.h"
+#include <Udp.h>
+
+// |------------------------------------------|
+// |         UDP Telemetry Datagrams          |
+// |------------------------------------------|
+// | Message: <seq>|<message>                 |
+// | Ack:     <seq>|<result>|<server time>|   |
+// |          <time to reset>|<command>       |
+// |------------------------------------------|
+//
+// <seq> is the message log seq of the message. One datagram per message and
+// one ack per datagram: a reading takes a single round trip, no connection.
+//
+// Up to PLV_UDP_WINDOW messages are in flight; each one is sent again when
+// its ack doesn't arrive within the retransmit timeout. Acks are selective:
+// an "ok" ack removes its own message from the log, whatever the order. Any
+// other result counts as a lost datagram. Tools: firmware/tools/pluvion_udp_server.py
+
+// Messages in flight (sent, not acked yet)
+#ifndef PLV_UDP_WINDOW
+#define PLV_UDP_WINDOW 4
+#endif
+
+// Datagram payload: seq, separator and the message
+#define PLV_UDP_DATAGRAM_SIZE (11 + PLV_LOG_PAYLOAD_SIZE)
+
+// Ack kept (the rest is dropped)
+#ifndef PLV_UDP_RESPONSE_SIZE
+#define PLV_UDP_RESPONSE_SIZE 128
+#endif
+
+// Acks read per step
+#define PLV_UDP_READ_BUDGET 4
+
+// Defaults
+#define PLV_UDP_RETRANSMIT_TIMEOUT 2000 // Without an ack (ms)
+#define PLV_UDP_MAX_ATTEMPTS       4    // Sends of a message per round
+
+enum PluviOnUDPState {
+    PLV_UDP_IDLE = 0,
+    PLV_UDP_SENDING,
+    PLV_UDP_DONE,               // Every pending message acked
+    PLV_UDP_FAILED              // A message ran out of attempts (the unacked ones stay in the log)
+};
+
+/**
+ * Called for every "ok" ack of a pending message, once it's removed from the log
+ *
+ * @param seq Message log seq
+ * @param response Ack fields after the seq ("ok|<server time>|<time to reset>|<command>")
+ * @param context Context given to setAckHandler()
+ */
+typedef void (*PluviOnUDPAckHandler)(unsigned long seq, const char *response, void *context);
+
+struct PluviOnUDPFlight {
+    unsigned long seq;          // 0 = free slot
+    unsigned long sentInMillis;
+    uint8_t       attempts;
+};
+
+/**
+ * Sends the pending messages of a message log as datagrams, stepped from
+ * the loop (never waits on the server).
+ */
+class PluviOnUDPLink
+{
+    public:
+        PluviOnUDPLink(UDP &udp, PluviOnMessageLog &log);
+
+        /**
+         * Open the local port the acks arrive at
+         *
+         * @param localPort Local UDP port
+         * @return true if the port is open
+         */
+        boolean         begin(uint16_t localPort);
+
+        /**
+         * @param timeoutInMillis Wait for an ack before sending again
+         * @param maxAttempts Sends of a message per round
+         */
+        void            setRetransmit(unsigned long timeoutInMillis, uint8_t maxAttempts);
+
+        void            setAckHandler(PluviOnUDPAckHandler handler, void *context = NULL);
+
+        /**
+         * Start a round: send every pending message of the log (including the
+         * ones appended during the round) until they are acked
+         *
+         * @param host Server address
+         * @param port Server UDP port
+         * @return true if started, false if a round is running
+         */
+        boolean         start(const char *host, uint16_t port);
+
+        /**
+         * Read the acks, send again the expired messages and fill the window
+         *
+         * @return Round state (DONE and FAILED are returned once)
+         */
+        PluviOnUDPState step();
+
+        boolean         busy();
+
+        unsigned long   datagramsSent();
+        unsigned long   retransmits();
+        unsigned long   acks();
+
+        /**
+         * @return Time from the last acked datagram to its ack
+         */
+        unsigned long   lastRoundTripInMillis();
+
+    private:
+        UDP                 &_udp;
+        PluviOnMessageLog   &_log;
+        PluviOnUDPAckHandler _handler;
+        void                *_handlerContext;
+
+        const char          *_host;
+        uint16_t             _port;
+        PluviOnUDPState      _state;
+        unsigned long        _timeout;
+        uint8_t              _maxAttempts;
+
+        PluviOnUDPFlight     _flights[PLV_UDP_WINDOW];
+        unsigned long        _lastQueued;     // Last seq put in flight this round
+
+        char                 _datagram[PLV_UDP_DATAGRAM_SIZE];
+        char                 _response[PLV_UDP_RESPONSE_SIZE];
+
+        unsigned long        _sent;
+        unsigned long        _retransmits;
+        unsigned long        _acks;
+        unsigned long        _roundTrip;
+
+        void                 receive();
+        void                 acked(unsigned long seq, const char *response);
+        boolean              send(PluviOnUDPFlight &flight);
+        boolean              fill();
+        uint8_t              inFlight();
+};
+
+#endif
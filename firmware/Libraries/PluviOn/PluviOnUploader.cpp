@@ -0,0 +1,428 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnUploader.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include "PluviOnUploader.h"
+
+PluviOnUploader::PluviOnUploader(Client &client)
+    : _client(client), _host(NULL), _port(0), _protocol(PLV_UPLOAD_HTTP),
+      _state(PLV_UPLOAD_IDLE), _failedState(PLV_UPLOAD_IDLE), _keepAlive(false),
+      _connectTimeout(PLV_UPLOAD_CONNECT_TIMEOUT), _connectRetryDelay(PLV_UPLOAD_CONNECT_RETRY_DELAY),
+      _writeTimeout(PLV_UPLOAD_WRITE_TIMEOUT), _readTimeout(PLV_UPLOAD_READ_TIMEOUT),
+      _stateStartInMillis(0), _retryAtInMillis(0),
+      _head(NULL), _headLength(0), _content(NULL), _contentLength(0), _source(NULL), _context(NULL),
+      _offset(0), _inContent(false), _chunkLength(0), _chunkOffset(0),
+      _connectTime(0), _bytesSent(0), _bytesReceived(0) {
+}
+
+/**
+ * Set the state deadlines
+ *
+ * @param connectInMillis Time for all connection attempts
+ * @param writeInMillis Time to write the whole request
+ * @param readInMillis Time to read the status and to read the body, each
+ */
+void PluviOnUploader::setTimeouts(unsigned long connectInMillis, unsigned long writeInMillis, unsigned long readInMillis) {
+    _connectTimeout = connectInMillis;
+    _writeTimeout   = writeInMillis;
+    _readTimeout    = readInMillis;
+}
+
+/**
+ * Delay between connection attempts (within the connect deadline)
+ */
+void PluviOnUploader::setConnectRetryDelay(unsigned long delayInMillis) {
+    _connectRetryDelay = delayInMillis;
+}
+
+/**
+ * Keep the connection open after an HTTP response that allows it
+ */
+void PluviOnUploader::setKeepAlive(boolean keepAlive) {
+    _keepAlive = keepAlive;
+}
+
+/**
+ * Start an upload from memory
+ *
+ * @return true if started, false if an upload is in progress
+ */
+boolean PluviOnUploader::start(const char *host, uint16_t port, PluviOnUploadProtocol protocol,
+                               const char *head, size_t headLength, const uint8_t *content, size_t length) {
+
+    if (busy()) {
+        return false;
+    }
+
+    _content       = content;
+    _contentLength = length;
+    _source        = NULL;
+    _context       = NULL;
+
+    begin(host, port, protocol, head, headLength);
+
+    return true;
+}
+
+/**
+ * Start an upload with the content from a source
+ *
+ * @return true if started, false if an upload is in progress
+ */
+boolean PluviOnUploader::start(const char *host, uint16_t port, PluviOnUploadProtocol protocol,
+                               const char *head, size_t headLength, PluviOnUploadSource source, void *context) {
+
+    if (busy()) {
+        return false;
+    }
+
+    _content       = NULL;
+    _contentLength = 0;
+    _source        = source;
+    _context       = context;
+
+    begin(host, port, protocol, head, headLength);
+
+    return true;
+}
+
+/**
+ * Run one bounded step
+ *
+ * @return The current state; DONE or FAILED once, when the upload ends
+ */
+PluviOnUploadState PluviOnUploader::step() {
+
+    switch (_state) {
+
+        case PLV_UPLOAD_CONNECT:
+            stepConnect();
+            break;
+
+        case PLV_UPLOAD_WRITE:
+            stepWrite();
+            break;
+
+        case PLV_UPLOAD_READ_STATUS:
+            stepRead();
+            break;
+
+        case PLV_UPLOAD_READ_BODY:
+            stepRead();
+            break;
+
+        case PLV_UPLOAD_CLOSE:
+            stepClose();
+            break;
+
+        case PLV_UPLOAD_DONE:
+        case PLV_UPLOAD_FAILED:
+            // Reported once, by the previous step
+            _state = PLV_UPLOAD_IDLE;
+            break;
+
+        default:
+            break;
+    }
+
+    return _state;
+}
+
+/**
+ * Abort the upload in progress and close the connection
+ */
+void PluviOnUploader::stop() {
+
+    _client.stop();
+    _state = PLV_UPLOAD_IDLE;
+}
+
+/**
+ * @return true while an upload is in progress
+ */
+boolean PluviOnUploader::busy() {
+    return _state != PLV_UPLOAD_IDLE && _state != PLV_UPLOAD_DONE && _state != PLV_UPLOAD_FAILED;
+}
+
+PluviOnUploadState PluviOnUploader::state() {
+    return _state;
+}
+
+/**
+ * @return State in which the last upload failed
+ */
+PluviOnUploadState PluviOnUploader::failedState() {
+    return _failedState;
+}
+
+/**
+ * @return HTTP status code of the last upload (0 for PLV_UPLOAD_LINE or if not received)
+ */
+int PluviOnUploader::status() {
+    return _parser.status();
+}
+
+/**
+ * @return Response body (HTTP) or reply line (LINE) of the last upload, without line breaks
+ */
+const char *PluviOnUploader::response() {
+    return _parser.body();
+}
+
+/**
+ * @return Accept-Encoding header of the last HTTP response ("" if not sent)
+ */
+const char *PluviOnUploader::acceptEncoding() {
+    return _parser.acceptEncoding();
+}
+
+/**
+ * @return Connection time of the last upload (0 if the connection was reused)
+ */
+unsigned long PluviOnUploader::connectTimeInMillis() {
+    return _connectTime;
+}
+
+unsigned long PluviOnUploader::bytesSent() {
+    return _bytesSent;
+}
+
+unsigned long PluviOnUploader::bytesReceived() {
+    return _bytesReceived;
+}
+
+/**
+ * Reset the request and response state and enter CONNECT (or WRITE when
+ * the kept-alive connection is still open)
+ */
+void PluviOnUploader::begin(const char *host, uint16_t port, PluviOnUploadProtocol protocol,
+                            const char *head, size_t headLength) {
+
+    _host       = host;
+    _port       = port;
+    _protocol   = protocol;
+    _head       = (const uint8_t *) head;
+    _headLength = head ? headLength : 0;
+
+    _offset      = 0;
+    _inContent   = false;
+    _chunkLength = 0;
+    _chunkOffset = 0;
+
+    if (_protocol == PLV_UPLOAD_LINE) {
+        _parser.beginLine();
+    } else {
+        _parser.begin();
+    }
+
+    _failedState   = PLV_UPLOAD_IDLE;
+    _connectTime   = 0;
+    _bytesSent     = 0;
+    _bytesReceived = 0;
+
+    if (_keepAlive && _protocol == PLV_UPLOAD_HTTP && _client.connected()) {
+        enter(PLV_UPLOAD_WRITE);
+        return;
+    }
+
+    // Drop what's left of a connection closed by the server
+    _client.stop();
+
+    _retryAtInMillis = millis();
+    enter(PLV_UPLOAD_CONNECT);
+}
+
+void PluviOnUploader::enter(PluviOnUploadState state) {
+    _state = state;
+    _stateStartInMillis = millis();
+}
+
+boolean PluviOnUploader::expired(unsigned long timeout) {
+    return (millis() - _stateStartInMillis) >= timeout;
+}
+
+void PluviOnUploader::fail() {
+
+    PLV_DEBUG_(F("ERROR: Upload failed in state "));
+    PLV_DEBUG(_state);
+
+    _failedState = _state;
+    _client.stop();
+    _state = PLV_UPLOAD_FAILED;
+}
+
+/**
+ * One connection attempt (blocks up to the client timeout, plus the
+ * handshake of a TLS client), retried after the retry delay until the
+ * connect deadline
+ */
+void PluviOnUploader::stepConnect() {
+
+    if ((long) (millis() - _retryAtInMillis) < 0) {
+        return;
+    }
+
+    unsigned long start = millis();
+
+    if (_client.connect(_host, _port)) {
+        _connectTime = millis() - start;
+        enter(PLV_UPLOAD_WRITE);
+        return;
+    }
+
+    if (expired(_connectTimeout)) {
+        fail();
+        return;
+    }
+
+    _retryAtInMillis = millis() + _connectRetryDelay;
+}
+
+/**
+ * Write one chunk of the head or of the content
+ */
+void PluviOnUploader::stepWrite() {
+
+    const uint8_t *data = NULL;
+    size_t length = 0;
+
+    if (!_inContent) {
+
+        // Head
+        data   = _head + _offset;
+        length = min((size_t) PLV_UPLOAD_CHUNK_SIZE, _headLength - _offset);
+
+    } else if (!_source) {
+
+        // Content from memory
+        data   = _content + _offset;
+        length = min((size_t) PLV_UPLOAD_CHUNK_SIZE, _contentLength - _offset);
+
+    } else {
+
+        // Content from the source, one chunk at a time
+        if (_chunkOffset >= _chunkLength) {
+            _chunkLength = _source(_chunk, sizeof(_chunk), _context);
+            _chunkOffset = 0;
+
+            if (_chunkLength == PLV_UPLOAD_SOURCE_ERROR) {
+                _chunkLength = 0;
+                fail();
+                return;
+            }
+        }
+
+        data   = _chunk + _chunkOffset;
+        length = _chunkLength - _chunkOffset;
+    }
+
+    if (length == 0) {
+
+        if (!_inContent) {
+            _inContent = true;
+            _offset = 0;
+            return;
+        }
+
+        // Request written
+        enter(PLV_UPLOAD_READ_STATUS);
+        return;
+    }
+
+    size_t written = _client.write(data, length);
+
+    _bytesSent += written;
+    if (_source && _inContent) {
+        _chunkOffset += written;
+    } else {
+        _offset += written;
+    }
+
+    if (written == 0 && !_client.connected()) {
+        fail();
+        return;
+    }
+
+    if (expired(_writeTimeout)) {
+        fail();
+    }
+}
+
+/**
+ * Read the bytes available (up to PLV_UPLOAD_READ_BUDGET, in one read) and
+ * feed them to the response parser
+ */
+void PluviOnUploader::stepRead() {
+
+    int available = _client.available();
+
+    if (available > 0) {
+
+        // The request is written, its chunk buffer takes the response
+        size_t size = min((size_t) available, min(sizeof(_chunk), (size_t) PLV_UPLOAD_READ_BUDGET));
+        int length = _client.read(_chunk, size);
+
+        if (length > 0) {
+            _bytesReceived += length;
+            _parser.feed(_chunk, length);
+        }
+    }
+
+    if (_parser.done()) {
+        enter(PLV_UPLOAD_CLOSE);
+        return;
+    }
+
+    // Headers read, the body gets its own deadline
+    if (_state == PLV_UPLOAD_READ_STATUS && _parser.state() == PLV_HTTP_BODY && _protocol == PLV_UPLOAD_HTTP) {
+        enter(PLV_UPLOAD_READ_BODY);
+    }
+
+    if (!_client.available() && !_client.connected()) {
+
+        // No Content-Length (or a LINE reply without '\r'): the response ends when the server closes
+        _parser.finish();
+
+        if (_parser.done()) {
+            enter(PLV_UPLOAD_CLOSE);
+            return;
+        }
+
+        fail();
+        return;
+    }
+
+    if (expired(_readTimeout)) {
+        fail();
+    }
+}
+
+/**
+ * Keep the connection for the next upload, or close it
+ */
+void PluviOnUploader::stepClose() {
+
+    // The body must end at its Content-Length, not with the connection
+    boolean reusable =
+        _keepAlive &&
+        _protocol == PLV_UPLOAD_HTTP &&
+        _parser.keepAlive() &&
+        _parser.contentLength() >= 0;
+
+    if (!reusable) {
+        _client.stop();
+    }
+
+    _state = PLV_UPLOAD_DONE;
+}
@@ -0,0 +1,233 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnUploader.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#ifndef PluviOnUploader_h
+#define PluviOnUploader_h
+
+#include "PluviOn.h"
+#include "PluviOnHTTPParser.h"
+#include <Client.h>
+
+// |------------------------------------------|
+// |         Upload state machine             |
+// |------------------------------------------|
+// | IDLE -> CONNECT -> WRITE -> READ_STATUS  |
+// |      -> READ_BODY (HTTP) -> CLOSE -> DONE |
+// |                                          |
+// | Every state has a deadline; missing it   |
+// | closes the connection and ends in FAILED.|
+// | DONE and FAILED are returned by step()   |
+// | once, then the uploader is IDLE again.   |
+// |------------------------------------------|
+//
+// step() doesn't wait for the server, except in CONNECT: Client::connect()
+// blocks, up to the client timeout per attempt (set it short), and a TLS
+// client runs its handshake there too. That takes seconds of CPU on the
+// ESP8266 unless the TLS session is resumed; keep-alive skips CONNECT.
+
+// Bytes written per step (also the content source chunk size)
+#ifndef PLV_UPLOAD_CHUNK_SIZE
+#define PLV_UPLOAD_CHUNK_SIZE    256
+#endif
+
+// Bytes read per step, in one read (the request chunk buffer receives them,
+// so at most PLV_UPLOAD_CHUNK_SIZE)
+#ifndef PLV_UPLOAD_READ_BUDGET
+#define PLV_UPLOAD_READ_BUDGET   256
+#endif
+
+// Default deadlines (ms)
+#define PLV_UPLOAD_CONNECT_TIMEOUT     5000  // All connection attempts
+#define PLV_UPLOAD_CONNECT_RETRY_DELAY 1000  // Between connection attempts
+#define PLV_UPLOAD_WRITE_TIMEOUT       10000
+#define PLV_UPLOAD_READ_TIMEOUT        5000  // Status and body, each
+
+enum PluviOnUploadState {
+    PLV_UPLOAD_IDLE = 0,
+    PLV_UPLOAD_CONNECT,
+    PLV_UPLOAD_WRITE,
+    PLV_UPLOAD_READ_STATUS,     // HTTP status line and headers, or the LINE reply
+    PLV_UPLOAD_READ_BODY,
+    PLV_UPLOAD_CLOSE,
+    PLV_UPLOAD_DONE,
+    PLV_UPLOAD_FAILED
+};
+
+enum PluviOnUploadProtocol {
+    PLV_UPLOAD_HTTP = 0,        // HTTP/1.1 response, body read up to its Content-Length
+    PLV_UPLOAD_LINE             // Raw content, the reply is a single line ended by '\r'
+};
+
+// Content source return value that aborts the upload
+#define PLV_UPLOAD_SOURCE_ERROR ((size_t) -1)
+
+/**
+ * Content source, called while writing until it returns 0
+ *
+ * @param buffer Buffer for the next content bytes
+ * @param size Buffer size in bytes
+ * @param context Caller context given to start()
+ * @return Bytes written in the buffer, 0 at the end of the content, or PLV_UPLOAD_SOURCE_ERROR
+ */
+typedef size_t (*PluviOnUploadSource)(uint8_t *buffer, size_t size, void *context);
+
+class PluviOnUploader
+{
+    public:
+        /**
+         * @param client Connection used for the uploads (connect() blocks up to the client timeout)
+         */
+        PluviOnUploader(Client &client);
+
+        /**
+         * Set the state deadlines
+         *
+         * @param connectInMillis Time for all connection attempts
+         * @param writeInMillis Time to write the whole request
+         * @param readInMillis Time to read the status and to read the body, each
+         */
+        void               setTimeouts(unsigned long connectInMillis, unsigned long writeInMillis, unsigned long readInMillis);
+
+        /**
+         * Delay between connection attempts (within the connect deadline)
+         */
+        void               setConnectRetryDelay(unsigned long delayInMillis);
+
+        /**
+         * Keep the connection open after an HTTP response that allows it
+         * (the next upload to the same server skips CONNECT)
+         */
+        void               setKeepAlive(boolean keepAlive);
+
+        /**
+         * Start an upload from memory
+         *
+         * @param host Server address
+         * @param port Server port
+         * @param protocol Response protocol
+         * @param head Request head (e.g. HTTP headers), written first (may be NULL)
+         * @param headLength Head length in bytes
+         * @param content Request content
+         * @param length Content length in bytes
+         * @return true if started, false if an upload is in progress
+         */
+        boolean            start(const char *host, uint16_t port, PluviOnUploadProtocol protocol,
+                                 const char *head, size_t headLength, const uint8_t *content, size_t length);
+
+        /**
+         * Start an upload with the content from a source
+         *
+         * @param source Content source, called from step()
+         * @param context Passed to the source
+         * @return true if started, false if an upload is in progress
+         */
+        boolean            start(const char *host, uint16_t port, PluviOnUploadProtocol protocol,
+                                 const char *head, size_t headLength, PluviOnUploadSource source, void *context);
+
+        /**
+         * Run one step: one connection attempt (blocks up to the client
+         * timeout, TLS handshake included), one chunk written, or up to
+         * PLV_UPLOAD_READ_BUDGET bytes read
+         *
+         * @return The current state; DONE or FAILED once, when the upload ends
+         */
+        PluviOnUploadState step();
+
+        /**
+         * Abort the upload in progress and close the connection
+         */
+        void               stop();
+
+        /**
+         * @return true while an upload is in progress
+         */
+        boolean            busy();
+
+        PluviOnUploadState state();
+
+        /**
+         * @return State in which the last upload failed
+         */
+        PluviOnUploadState failedState();
+
+        /**
+         * @return HTTP status code of the last upload (0 for PLV_UPLOAD_LINE or if not received)
+         */
+        int                status();
+
+        /**
+         * @return Response body (HTTP) or reply line (LINE) of the last upload, without line breaks
+         */
+        const char        *response();
+
+        /**
+         * @return Accept-Encoding header of the last HTTP response ("" if not sent),
+         *         the content codings the server accepts in requests (RFC 7694)
+         */
+        const char        *acceptEncoding();
+
+        /**
+         * @return Connection time of the last upload (0 if the connection was reused)
+         */
+        unsigned long      connectTimeInMillis();
+
+        unsigned long      bytesSent();
+        unsigned long      bytesReceived();
+
+    private:
+        Client                &_client;
+        const char            *_host;
+        uint16_t               _port;
+        PluviOnUploadProtocol  _protocol;
+        PluviOnUploadState     _state;
+        PluviOnUploadState     _failedState;
+        boolean                _keepAlive;
+
+        unsigned long          _connectTimeout;
+        unsigned long          _connectRetryDelay;
+        unsigned long          _writeTimeout;
+        unsigned long          _readTimeout;
+        unsigned long          _stateStartInMillis;
+        unsigned long          _retryAtInMillis;
+
+        // Request
+        const uint8_t         *_head;
+        size_t                 _headLength;
+        const uint8_t         *_content;
+        size_t                 _contentLength;
+        PluviOnUploadSource    _source;
+        void                  *_context;
+        size_t                 _offset;        // In the head, then in the content
+        boolean                _inContent;
+        uint8_t                _chunk[PLV_UPLOAD_CHUNK_SIZE];
+        size_t                 _chunkLength;
+        size_t                 _chunkOffset;
+
+        // Response (status line, headers and body, or the LINE reply)
+        PluviOnHTTPParser      _parser;
+
+        unsigned long          _connectTime;
+        unsigned long          _bytesSent;
+        unsigned long          _bytesReceived;
+
+        void                   begin(const char *host, uint16_t port, PluviOnUploadProtocol protocol,
+                                     const char *head, size_t headLength);
+        void                   enter(PluviOnUploadState state);
+        boolean                expired(unsigned long timeout);
+        void                   fail();
+        void                   stepConnect();
+        void                   stepWrite();
+        void                   stepRead();
+        void                   stepClose();
+};
+
+#endif
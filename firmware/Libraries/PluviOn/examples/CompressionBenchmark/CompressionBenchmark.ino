@@ -0,0 +1,178 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: CompressionBenchmark.ino
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Batch compression benchmark: compresses the weather messages queued in
+ * the message log (flash a station, let it queue messages offline, then
+ * flash this sketch) in batches, as the offline uploads do.
+ *
+ * Reports the compression ratio, the CPU cycles per input byte and checks
+ * that every batch decompresses to the same bytes. The ratio of a "dump"
+ * capture can also be checked on a computer with firmware/tools/pluvion_lzss.py --bench.
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include <PluviOn.h>
+#include <PluviOnMessageLog.h>
+#include <PluviOnLZSS.h>
+
+#define BENCH_BATCH_SIZE 10 // As SEND_OFFLINE_MESSAGES_BATCH_SIZE
+
+PluviOnMessageLog messageLog;
+PluviOnLZSS compressor;
+
+// Batch being compressed
+unsigned long batchSeqs[BENCH_BATCH_SIZE];
+uint8_t batchCount = 0;
+uint8_t batchNext = 0;
+char batchRecord[PLV_LOG_PAYLOAD_SIZE + 5];
+size_t batchRecordLength = 0;
+size_t batchRecordOffset = 0;
+
+/**
+ * Start reading the batch from its first record
+ */
+void rewindBatch() {
+    batchNext = 0;
+    batchRecordLength = 0;
+    batchRecordOffset = 0;
+}
+
+/**
+ * Content source: the batch records, one per line with the offline suffix
+ */
+size_t readBatch(uint8_t *buffer, size_t size, void *context) {
+
+    // Next record
+    while (batchRecordOffset >= batchRecordLength) {
+
+        if (batchNext >= batchCount) {
+            return 0;
+        }
+
+        int length = messageLog.read(batchSeqs[batchNext++], batchRecord, PLV_LOG_PAYLOAD_SIZE);
+
+        if (length < 0) {
+            return PLV_UPLOAD_SOURCE_ERROR;
+        }
+
+        memcpy(batchRecord + length, "|off\n", 5);
+        batchRecordLength = length + 5;
+        batchRecordOffset = 0;
+    }
+
+    size_t length = min(size, batchRecordLength - batchRecordOffset);
+    memcpy(buffer, batchRecord + batchRecordOffset, length);
+    batchRecordOffset += length;
+
+    return length;
+}
+
+void setup() {
+
+    PLV_DEBUG_SETUP(115200);
+
+    PLV_DEBUG_HEADER(F("PLUVION COMPRESSION BENCHMARK"));
+
+    if (!messageLog.begin()) {
+        PLV_DEBUG(F("ERROR: Message log not available."));
+        return;
+    }
+
+    PLV_DEBUG_(F("Queued messages: "));
+    PLV_DEBUG(messageLog.pending());
+
+    static uint8_t original[BENCH_BATCH_SIZE * (PLV_LOG_PAYLOAD_SIZE + 5)];
+    static uint8_t compressed[sizeof(original) + sizeof(original) / 8 + 1];
+    static uint8_t decompressed[sizeof(original)];
+
+    unsigned long bytesIn = 0;
+    unsigned long bytesOut = 0;
+    uint32_t cycles = 0;
+    int batches = 0;
+    int mismatches = 0;
+
+    unsigned long seq = messageLog.first();
+
+    while (seq) {
+
+        // Next batch
+        batchCount = 0;
+        for (; seq && batchCount < BENCH_BATCH_SIZE; seq = messageLog.next(seq)) {
+            batchSeqs[batchCount++] = seq;
+        }
+
+        // Original content (same source, for the comparison)
+        rewindBatch();
+        size_t originalLength = 0;
+        size_t chunk;
+        while ((chunk = readBatch(original + originalLength, sizeof(original) - originalLength, NULL)) > 0 &&
+               chunk != PLV_UPLOAD_SOURCE_ERROR) {
+            originalLength += chunk;
+        }
+
+        // Compress (flash reads included, as in the upload)
+        rewindBatch();
+        size_t compressedLength = 0;
+        uint32_t start = ESP.getCycleCount();
+        compressor.begin(readBatch, NULL);
+        while ((chunk = compressor.read(compressed + compressedLength, PLV_UPLOAD_CHUNK_SIZE)) > 0 &&
+               chunk != PLV_UPLOAD_SOURCE_ERROR) {
+            compressedLength += chunk;
+        }
+        cycles += ESP.getCycleCount() - start;
+
+        long length = PluviOnLZSS::decompress(compressed, compressedLength, decompressed, sizeof(decompressed));
+
+        if (length != (long) originalLength || memcmp(original, decompressed, originalLength) != 0) {
+            mismatches++;
+        }
+
+        bytesIn += originalLength;
+        bytesOut += compressedLength;
+        batches++;
+
+        yield();
+    }
+
+    if (!batches) {
+        PLV_DEBUG(F("Nothing to compress, queue some messages first."));
+        return;
+    }
+
+    PLV_DEBUG_(F("Batches: "));
+    PLV_DEBUG_(batches);
+    PLV_DEBUG_(F(" of up to "));
+    PLV_DEBUG_(BENCH_BATCH_SIZE);
+    PLV_DEBUG(F(" messages"));
+
+    PLV_DEBUG_(F("Content: "));
+    PLV_DEBUG_(bytesIn);
+    PLV_DEBUG_(F(" -> "));
+    PLV_DEBUG_(bytesOut);
+    PLV_DEBUG_(F(" bytes ("));
+    PLV_DEBUG_(100.0 * bytesOut / bytesIn);
+    PLV_DEBUG(F(" %)"));
+
+    PLV_DEBUG_(F("Encode cycles/byte: "));
+    PLV_DEBUG(cycles / bytesIn);
+
+    PLV_DEBUG_(F("Mismatches: "));
+    PLV_DEBUG_(mismatches);
+    PLV_DEBUG_(F(" of "));
+    PLV_DEBUG(batches);
+
+    PLV_DEBUG(F("\nDone."));
+}
+
+void loop() {
+}
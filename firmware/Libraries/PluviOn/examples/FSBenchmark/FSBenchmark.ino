@@ -0,0 +1,187 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: FSBenchmark.ino
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Storage backend benchmark: openDir/open/remove latency and RAM use with
+ * 10, 100 and 1000 files in a directory.
+ *
+ * Build it once per backend (-DPLV_FS_BACKEND=PLV_FS_SPIFFS or
+ * -DPLV_FS_BACKEND=PLV_FS_LITTLEFS) and compare the reports. The backend is
+ * called directly (not through the PluviOn FS* functions) so the debug
+ * output does not add to the latencies.
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include <PluviOn.h>
+
+#define BENCH_DIR "/bench"
+
+const int BENCH_FILE_COUNTS[] = { 10, 100, 1000 };
+
+/**
+ * Build the path of a benchmark file
+ */
+void benchPath(char *path, int file) {
+    snprintf(path, PLV_FS_PATH_SIZE, "%s/%d", BENCH_DIR, file);
+}
+
+/**
+ * Remove the files left by a previous (interrupted) run
+ */
+void benchCleanup() {
+
+    Dir dir = PLV_FS.openDir(BENCH_DIR);
+    while (dir.next()) {
+
+        char path[PLV_FS_PATH_SIZE];
+        if (PluviOn::FSEntryPath(path, BENCH_DIR, dir)) {
+            PLV_FS.remove(path);
+        }
+
+        yield();
+    }
+}
+
+/**
+ * Print one result line
+ */
+void benchReport(const __FlashStringHelper *operation, unsigned long totalInMicros, int count) {
+
+    PLV_DEBUG_(operation);
+    PLV_DEBUG_(F(" total: "));
+    PLV_DEBUG_(totalInMicros);
+    PLV_DEBUG_(F(" us, avg: "));
+    PLV_DEBUG_(count ? totalInMicros / count : 0);
+    PLV_DEBUG(F(" us"));
+}
+
+/**
+ * Run one round with the given number of files
+ */
+void benchRound(int files) {
+
+    PLV_DEBUG_(F("\n--- "));
+    PLV_DEBUG_(files);
+    PLV_DEBUG(F(" files ---"));
+
+    char path[PLV_FS_PATH_SIZE];
+    unsigned long start;
+    uint32_t minFreeHeap = ESP.getFreeHeap();
+
+    // Create (empty files, like the legacy "value encoded in file name" layout)
+    int created = 0;
+    start = micros();
+    for (int i = 0; i < files; i++) {
+
+        benchPath(path, i);
+        File f = PLV_FS.open(path, "w");
+        if (!f) {
+            break;
+        }
+
+        f.close();
+        created++;
+        yield();
+    }
+    benchReport(F("create     "), micros() - start, created);
+
+    if (created < files) {
+        PLV_DEBUG_(F("ERROR: file system full after "));
+        PLV_DEBUG_(created);
+        PLV_DEBUG(F(" files."));
+    }
+
+    // openDir + first entry (what FSReadInt/FSReadString do)
+    start = micros();
+    {
+        Dir dir = PLV_FS.openDir(BENCH_DIR);
+        dir.next();
+        minFreeHeap = min(minFreeHeap, ESP.getFreeHeap());
+    }
+    benchReport(F("openDir    "), micros() - start, 1);
+
+    // openDir + full scan
+    int entries = 0;
+    start = micros();
+    {
+        Dir dir = PLV_FS.openDir(BENCH_DIR);
+        while (dir.next()) {
+            entries++;
+            yield();
+        }
+    }
+    benchReport(F("scan       "), micros() - start, entries);
+
+    // Open (by path) and close every file
+    start = micros();
+    for (int i = 0; i < created; i++) {
+
+        benchPath(path, i);
+        File f = PLV_FS.open(path, "r");
+        minFreeHeap = min(minFreeHeap, ESP.getFreeHeap());
+        f.close();
+        yield();
+    }
+    benchReport(F("open       "), micros() - start, created);
+
+    // Remove every file
+    start = micros();
+    for (int i = 0; i < created; i++) {
+
+        benchPath(path, i);
+        PLV_FS.remove(path);
+        yield();
+    }
+    benchReport(F("remove     "), micros() - start, created);
+
+    PLV_DEBUG_(F("Min free heap during round: "));
+    PLV_DEBUG_(minFreeHeap);
+    PLV_DEBUG(F(" bytes"));
+}
+
+void setup() {
+
+    PLV_DEBUG_SETUP(115200);
+
+    PLV_DEBUG_HEADER(F("PLUVION STORAGE BENCHMARK"));
+
+    PLV_DEBUG_(F("Backend: "));
+    PLV_DEBUG(F(PLV_FS_NAME));
+
+    // RAM used by the mounted file system
+    uint32_t heapBeforeMount = ESP.getFreeHeap();
+    unsigned long start = micros();
+
+    if (!PluviOn::begin()) {
+        PLV_DEBUG(F("FATAL: Error mounting file system."));
+        return;
+    }
+
+    PLV_DEBUG_(F("Mount time: "));
+    PLV_DEBUG_(micros() - start);
+    PLV_DEBUG(F(" us"));
+
+    PLV_DEBUG_(F("Mount RAM: "));
+    PLV_DEBUG_(heapBeforeMount - ESP.getFreeHeap());
+    PLV_DEBUG(F(" bytes"));
+
+    benchCleanup();
+
+    for (unsigned int i = 0; i < sizeof(BENCH_FILE_COUNTS) / sizeof(BENCH_FILE_COUNTS[0]); i++) {
+        benchRound(BENCH_FILE_COUNTS[i]);
+    }
+
+    PLV_DEBUG(F("\nDone."));
+}
+
+void loop() {
+}
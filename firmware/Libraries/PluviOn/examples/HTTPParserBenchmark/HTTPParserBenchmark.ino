@@ -0,0 +1,194 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: HTTPParserBenchmark.ino
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Response parser check: feeds captured server responses to PluviOnHTTPParser
+ * in chunks of random sizes (as the socket delivers them, from single bytes
+ * to whole responses) and checks the status, body, Content-Length, keep-alive
+ * and Accept-Encoding read from each one.
+ *
+ * Reports the CPU cycles per response and the heap used while parsing
+ * (none: the parser only writes its own buffers).
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include <PluviOn.h>
+#include <PluviOnHTTPParser.h>
+
+#define BENCH_ROUNDS 200
+
+struct CapturedResponse {
+    const char *name;
+    const char *data;
+    boolean     line;           // Line reply (LINE upload format)
+    boolean     closes;         // The server closes after the data
+    boolean     complete;
+    int         status;
+    const char *body;
+    long        contentLength;
+    boolean     keepAlive;
+    const char *acceptEncoding;
+};
+
+const CapturedResponse RESPONSES[] = {
+    {
+        "API ok",
+        "HTTP/1.1 200 OK\r\nServer: nginx\r\nContent-Type: text/plain\r\nContent-Length: 27\r\n"
+        "Connection: keep-alive\r\nAccept-Encoding: x-plv-lzss, identity\r\n\r\nok|1700000000|86400|reset|\r\n",
+        false, false, true, 200, "ok|1700000000|86400|reset|", 27, true, "x-plv-lzss, identity"
+    },
+    {
+        "Batch acks",
+        "HTTP/1.1 200 OK\r\nContent-Length: 33\r\n\r\nbatch|1700000000|86400||0,1,2,4,5",
+        false, false, true, 200, "batch|1700000000|86400||0,1,2,4,5", 33, true, ""
+    },
+    {
+        "HTTP/1.0, no Content-Length",
+        "HTTP/1.0 200 OK\r\n\r\nok|1|2|",
+        false, true, true, 200, "ok|1|2|", -1, false, ""
+    },
+    {
+        "Compressed batch refused",
+        "HTTP/1.1 415 Unsupported Media Type\r\nconnection: Close\r\ncontent-length: 0\r\n\r\n",
+        false, false, true, 415, "", 0, false, ""
+    },
+    {
+        "Long header",
+        "HTTP/1.1 200 OK\r\nSet-Cookie: session=0123456789abcdef0123456789abcdef0123456789abcdef"
+        "0123456789abcdef0123456789abcdef0123456789abcdef\r\nContent-Length: 2\r\n\r\nok",
+        false, false, true, 200, "ok", 2, true, ""
+    },
+    {
+        "Closed mid body",
+        "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nok|1",
+        false, true, false, 200, "ok|1", 10, true, ""
+    },
+    {
+        "Line reply",
+        "ok\r\nextra",
+        true, false, true, 0, "ok", -1, false, ""
+    },
+    {
+        "Line reply, closed",
+        "ok",
+        true, true, true, 0, "ok", -1, false, ""
+    },
+};
+
+#define BENCH_RESPONSES (sizeof(RESPONSES) / sizeof(RESPONSES[0]))
+
+PluviOnHTTPParser parser;
+
+/**
+ * Feed a captured response in random chunks
+ *
+ * @param index Position in RESPONSES
+ * @param maxChunk Largest chunk fed at once
+ * @return true if everything read matches the capture
+ */
+boolean parseResponse(size_t index, size_t maxChunk) {
+
+    const CapturedResponse &response = RESPONSES[index];
+    const uint8_t *data = (const uint8_t *) response.data;
+    size_t length = strlen(response.data);
+    size_t position = 0;
+
+    if (response.line) {
+        parser.beginLine();
+    } else {
+        parser.begin();
+    }
+
+    while (position < length && !parser.done()) {
+
+        size_t chunk = min((size_t) random(1, maxChunk + 1), length - position);
+        size_t used = parser.feed(data + position, chunk);
+
+        if (used > chunk) {
+            return false;
+        }
+
+        position += used;
+
+        // Bytes past the end of the response are left to the caller
+        if (used < chunk) {
+            break;
+        }
+    }
+
+    if (response.closes) {
+        parser.finish();
+    }
+
+    return parser.done() == response.complete &&
+           parser.status() == response.status &&
+           parser.contentLength() == response.contentLength &&
+           (!response.complete || parser.keepAlive() == response.keepAlive) &&
+           strcmp(parser.body(), response.body) == 0 &&
+           strcmp(parser.acceptEncoding(), response.acceptEncoding) == 0;
+}
+
+void setup() {
+
+    PLV_DEBUG_SETUP(115200);
+
+    PLV_DEBUG_HEADER(F("PLUVION HTTP PARSER BENCHMARK"));
+
+    randomSeed(ESP.getCycleCount());
+
+    int mismatches = 0;
+
+    for (size_t r = 0; r < BENCH_RESPONSES; r++) {
+
+        const CapturedResponse &response = RESPONSES[r];
+
+        int failed = 0;
+        uint32_t cycles = 0;
+        uint32_t heap = ESP.getFreeHeap();
+
+        for (int n = 0; n < BENCH_ROUNDS; n++) {
+
+            // Small chunks (bytes trickling in) and large ones (a full socket buffer)
+            size_t maxChunk = n % 3 == 0 ? 4 : 64;
+
+            uint32_t start = ESP.getCycleCount();
+            boolean valid = parseResponse(r, maxChunk);
+            cycles += ESP.getCycleCount() - start;
+
+            if (!valid) {
+                failed++;
+            }
+
+            yield();
+        }
+
+        mismatches += failed;
+
+        PLV_DEBUG_(response.name);
+        PLV_DEBUG_(F(": "));
+        PLV_DEBUG_(cycles / BENCH_ROUNDS);
+        PLV_DEBUG_(F(" cycles, heap "));
+        PLV_DEBUG_((long) heap - (long) ESP.getFreeHeap());
+        PLV_DEBUG_(F(" bytes, mismatches "));
+        PLV_DEBUG(failed);
+    }
+
+    PLV_DEBUG_(F("Mismatches: "));
+    PLV_DEBUG_(mismatches);
+    PLV_DEBUG_(F(" of "));
+    PLV_DEBUG(BENCH_ROUNDS * BENCH_RESPONSES);
+
+    PLV_DEBUG(F("\nDone."));
+}
+
+void loop() {
+}
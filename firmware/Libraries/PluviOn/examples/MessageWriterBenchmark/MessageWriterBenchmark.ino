@@ -0,0 +1,145 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: MessageWriterBenchmark.ino
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Message builder benchmark: String += against PluviOnMessageWriter, on a
+ * message with the same fields as the weather message.
+ *
+ * Reports the CPU cycles per message, the heap held while the message is
+ * alive (0 means no allocation) and checks that both builders produce the
+ * same bytes.
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include <PluviOn.h>
+#include <PluviOnMessageWriter.h>
+
+#define BENCH_ROUNDS 1000
+#define BENCH_MESSAGE_SIZE 512
+
+const String FIELD_SEPARATOR = "|";
+const String STATION_ID = "PluviOn_1A2B3C";
+
+// Fake readings, changed every round so nothing is constant folded
+int messageID = 0;
+float rainVolume = 0;
+float temperature = 23.4;
+uint32_t freeHeap = 0;
+
+/**
+ * Append the benchmark fields (same code for both builders)
+ */
+template <class T>
+void benchFields(T &message) {
+
+    message += messageID;
+    message += FIELD_SEPARATOR;
+    message += 86400;
+    message += FIELD_SEPARATOR;
+    message += rainVolume;
+    message += FIELD_SEPARATOR;
+    message += temperature;
+    message += FIELD_SEPARATOR;
+    message += -temperature;
+    message += FIELD_SEPARATOR;
+    message += STATION_ID;
+    message += FIELD_SEPARATOR;
+    message += "-23.5505";
+    message += FIELD_SEPARATOR;
+    message += 3.22;
+    message += FIELD_SEPARATOR;
+    message += 600000;
+    message += FIELD_SEPARATOR;
+    message += freeHeap;
+    message += FIELD_SEPARATOR;
+    message += (messageID % 2 ? "true" : "false");
+    message += FIELD_SEPARATOR;
+    message += -67;
+    message += FIELD_SEPARATOR;
+    message += NAN;
+}
+
+void setup() {
+
+    PLV_DEBUG_SETUP(115200);
+
+    PLV_DEBUG_HEADER(F("PLUVION MESSAGE WRITER BENCHMARK"));
+
+    static char buffer[BENCH_MESSAGE_SIZE];
+
+    uint32_t stringCycles = 0;
+    uint32_t writerCycles = 0;
+    uint32_t stringHeld = 0;
+    uint32_t writerHeld = 0;
+    int mismatches = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+
+        messageID = round;
+        rainVolume = round * 0.254;
+        temperature = 23.4 + round * 0.01;
+
+        // Read once: the String still holds its buffer while the writer runs
+        freeHeap = ESP.getFreeHeap();
+
+        // String
+        uint32_t heap = ESP.getFreeHeap();
+        uint32_t start = ESP.getCycleCount();
+        String message = "";
+        benchFields(message);
+        stringCycles += ESP.getCycleCount() - start;
+        stringHeld = max(stringHeld, heap - ESP.getFreeHeap());
+
+        // Writer
+        heap = ESP.getFreeHeap();
+        start = ESP.getCycleCount();
+        PluviOnMessageWriter writer(buffer, sizeof(buffer));
+        benchFields(writer);
+        writerCycles += ESP.getCycleCount() - start;
+        writerHeld = max(writerHeld, heap - ESP.getFreeHeap());
+
+        if (message.length() != writer.length() || strcmp(message.c_str(), writer.c_str()) != 0) {
+
+            if (!mismatches) {
+                PLV_DEBUG(F("ERROR: outputs differ:"));
+                PLV_DEBUG(message);
+                PLV_DEBUG(writer.c_str());
+            }
+
+            mismatches++;
+        }
+
+        yield();
+    }
+
+    PLV_DEBUG_(F("String  cycles/msg: "));
+    PLV_DEBUG_(stringCycles / BENCH_ROUNDS);
+    PLV_DEBUG_(F(", heap held: "));
+    PLV_DEBUG_(stringHeld);
+    PLV_DEBUG(F(" bytes"));
+
+    PLV_DEBUG_(F("Writer  cycles/msg: "));
+    PLV_DEBUG_(writerCycles / BENCH_ROUNDS);
+    PLV_DEBUG_(F(", heap held: "));
+    PLV_DEBUG_(writerHeld);
+    PLV_DEBUG(F(" bytes"));
+
+    PLV_DEBUG_(F("Mismatches: "));
+    PLV_DEBUG_(mismatches);
+    PLV_DEBUG_(F(" of "));
+    PLV_DEBUG(BENCH_ROUNDS);
+
+    PLV_DEBUG(F("\nDone."));
+}
+
+void loop() {
+}
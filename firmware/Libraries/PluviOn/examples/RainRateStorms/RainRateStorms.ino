@@ -0,0 +1,203 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: RainRateStorms.ino
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Rain rate check: plays synthetic storms (a drizzle, a cloudburst, two
+ * showers an hour and a half apart and a storm across the millis() wrap)
+ * through PluviOnRainRate on a simulated clock. Every minute the windows
+ * are checked against a count of the tips kept in a list; every 10 minutes
+ * the peak intensities are printed and a new period starts, as the firmware
+ * does on every message.
+ *
+ * Also reports the CPU cycles per tip and per update.
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include <PluviOn.h>
+#include <PluviOnRainRate.h>
+
+#define BENCH_BUCKET_VOLUME 3.22   // ml
+#define BENCH_CONTRIBUTION_AREA 7797.0 // mm2
+#define BENCH_MAX_TIPS 1500        // Tips kept for the reference count
+#define BENCH_STORM_MINUTES 180
+#define BENCH_PERIOD_MINUTES 10    // Reporting period
+
+#define STORM_DRIZZLE 0
+#define STORM_CLOUDBURST 1
+#define STORM_SHOWERS 2
+#define STORM_WRAP 3
+#define STORMS 4
+
+unsigned long tipTimes[BENCH_MAX_TIPS];
+int tipCount = 0;
+
+uint32_t tipCycles = 0;
+unsigned long tipsTimed = 0;
+uint32_t updateCycles = 0;
+unsigned long updates = 0;
+
+/**
+ * @return Storm rain intensity (mm/h) at the given minute
+ */
+float stormIntensity(uint8_t storm, float minute) {
+
+    switch (storm) {
+        case STORM_DRIZZLE:
+            return 2.0;
+
+        // 120 mm/h peak at 90 min, about 20 min wide
+        case STORM_CLOUDBURST:
+            return 120.0 * exp(-pow((minute - 90) / 12.0, 2));
+
+        // 30 mm/h for 20 min, a dry hour and a half, again
+        case STORM_SHOWERS:
+            return (minute < 20 || (minute >= 110 && minute < 130)) ? 30.0 : 0.0;
+
+        default:
+            return 40.0;
+    }
+}
+
+/**
+ * @return Tips of the list in the window ending at the current slot
+ */
+int referenceTips(unsigned long start, unsigned long now, uint8_t minutes) {
+
+    unsigned long slotMillis = PLV_RAIN_SLOT_SECONDS * 1000UL;
+    unsigned long current = (now - start) / slotMillis;
+    long first = (long) current - minutes * 60 / PLV_RAIN_SLOT_SECONDS + 1;
+    int count = 0;
+
+    for (int i = 0; i < tipCount; i++) {
+        long slot = (tipTimes[i] - start) / slotMillis;
+        if (slot >= first && slot <= (long) current) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Play a storm, one simulated second per step
+ *
+ * @return Window mismatches
+ */
+int playStorm(uint8_t storm) {
+
+    PluviOnRainRate rainRate;
+    rainRate.setBucket(BENCH_BUCKET_VOLUME, BENCH_CONTRIBUTION_AREA);
+
+    float mmPerTip = BENCH_BUCKET_VOLUME * 1000 / BENCH_CONTRIBUTION_AREA;
+
+    // The wrap storm starts half an hour before millis() wraps
+    unsigned long start = storm == STORM_WRAP ? 0xFFFFFFFFUL - 1800000UL : 1000;
+    unsigned long now = start;
+    int mismatches = 0;
+
+    tipCount = 0;
+    rainRate.update(now);
+
+    for (unsigned long second = 1; second <= BENCH_STORM_MINUTES * 60UL; second++) {
+
+        now += 1000;
+
+        // Tip chance in this second
+        float tips = stormIntensity(storm, second / 60.0) / 3600.0 / mmPerTip;
+
+        if (random(1000000) < tips * 1000000) {
+
+            uint32_t cycles = ESP.getCycleCount();
+            rainRate.tip(now);
+            tipCycles += ESP.getCycleCount() - cycles;
+            tipsTimed++;
+
+            if (tipCount < BENCH_MAX_TIPS) {
+                tipTimes[tipCount++] = now;
+            }
+        }
+
+        if (second % 60) {
+            continue;
+        }
+
+        uint32_t cycles = ESP.getCycleCount();
+        rainRate.update(now);
+        updateCycles += ESP.getCycleCount() - cycles;
+        updates++;
+
+        for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++) {
+
+            PluviOnRainWindow window = (PluviOnRainWindow) w;
+            float expected = referenceTips(start, now, PluviOnRainRate::windowMinutes(window)) * mmPerTip;
+
+            if (fabs(rainRate.rainInMm(window) - expected) > 0.001) {
+                mismatches++;
+            }
+        }
+
+        if ((second / 60) % BENCH_PERIOD_MINUTES == 0) {
+
+            PLV_DEBUG_(F("  min "));
+            PLV_DEBUG_(second / 60);
+            PLV_DEBUG_(F(" peak mm/h (1/5/15/60 min): "));
+
+            for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++) {
+                PLV_DEBUG_(rainRate.maxIntensity((PluviOnRainWindow) w));
+                PLV_DEBUG_(w + 1 < PLV_RAIN_WINDOWS ? F(" / ") : F(""));
+            }
+            PLV_DEBUG(F(""));
+
+            rainRate.resetPeriod();
+        }
+
+        yield();
+    }
+
+    PLV_DEBUG_(F("  Tips: "));
+    PLV_DEBUG_(rainRate.tips());
+    PLV_DEBUG_(F(", mismatches: "));
+    PLV_DEBUG(mismatches);
+
+    return mismatches;
+}
+
+void setup() {
+
+    PLV_DEBUG_SETUP(115200);
+
+    PLV_DEBUG_HEADER(F("PLUVION RAIN RATE STORMS"));
+
+    randomSeed(ESP.getCycleCount());
+
+    const char *names[STORMS] = { "Drizzle", "Cloudburst", "Showers", "Across the millis() wrap" };
+    int mismatches = 0;
+
+    for (uint8_t storm = 0; storm < STORMS; storm++) {
+        PLV_DEBUG(names[storm]);
+        mismatches += playStorm(storm);
+    }
+
+    PLV_DEBUG_(F("Cycles per tip: "));
+    PLV_DEBUG(tipsTimed ? tipCycles / tipsTimed : 0);
+
+    PLV_DEBUG_(F("Cycles per update (1 min apart): "));
+    PLV_DEBUG(updates ? updateCycles / updates : 0);
+
+    PLV_DEBUG_(F("Mismatches: "));
+    PLV_DEBUG(mismatches);
+
+    PLV_DEBUG(F("\nDone."));
+}
+
+void loop() {
+}
@@ -0,0 +1,156 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: SampleBlockBenchmark.ino
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Sample block round trip: encodes simulated sensor readings (a random walk
+ * around a day of DHT22 samples, with failed readings and a rain counter
+ * reset), decodes every block and checks that each sample comes back within
+ * the 0.1 resolution.
+ *
+ * Reports the bytes per sample and prints the last block as hex, which
+ * decodes on a computer with firmware/tools/pluvion_telemetry.py --hex.
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include <PluviOn.h>
+#include <PluviOnTelemetry.h>
+
+#define BENCH_BLOCKS 200
+#define BENCH_BLOCK_SIZE 10 // As SEND_OFFLINE_MESSAGES_BATCH_SIZE
+#define BENCH_STATION_ID "PluviOn_1A2B3C"
+#define BENCH_BUFFER_SIZE 256
+
+/**
+ * @return true if the decoded reading matches (NaN for a failed reading)
+ */
+boolean sameReading(float expected, float decoded) {
+
+    if (isnan(expected) || isnan(decoded)) {
+        return isnan(expected) && isnan(decoded);
+    }
+
+    return fabs(expected - decoded) <= 0.051;
+}
+
+/**
+ * Next simulated sample (10 minutes later)
+ */
+void nextSample(PluviOnSample &sample) {
+
+    sample.messageID++;
+    sample.stationTime += 600;
+    sample.tipCount += random(0, 3) == 0 ? random(1, 5) : 0;
+
+    // Rain counter reset by the server
+    if (random(0, 500) == 0) {
+        sample.tipCount = 0;
+    }
+
+    // Failed readings are NaN
+    if (random(0, 100) == 0) {
+        sample.temperature = NAN;
+        sample.humidity = NAN;
+        return;
+    }
+
+    if (isnan(sample.temperature)) {
+        sample.temperature = 22.0;
+        sample.humidity = 60.0;
+    }
+
+    sample.temperature = constrain(sample.temperature + random(-3, 4) / 10.0, -40.0, 80.0);
+    sample.humidity = constrain(sample.humidity + random(-5, 6) / 10.0, 0.0, 100.0);
+}
+
+void setup() {
+
+    PLV_DEBUG_SETUP(115200);
+
+    PLV_DEBUG_HEADER(F("PLUVION SAMPLE BLOCK BENCHMARK"));
+
+    randomSeed(ESP.getCycleCount());
+
+    static uint8_t buffer[BENCH_BUFFER_SIZE];
+    PluviOnSample samples[BENCH_BLOCK_SIZE];
+    PluviOnSample decoded[BENCH_BLOCK_SIZE];
+    PluviOnSample sample = { 1000, 86400, 0, 22.0, 60.0 };
+
+    unsigned long bytes = 0;
+    unsigned long count = 0;
+    int mismatches = 0;
+    size_t length = 0;
+
+    for (int n = 0; n < BENCH_BLOCKS; n++) {
+
+        PluviOnSampleBlock block(buffer, sizeof(buffer));
+        block.begin(BENCH_STATION_ID);
+
+        for (uint8_t i = 0; i < BENCH_BLOCK_SIZE; i++) {
+            nextSample(sample);
+            samples[i] = sample;
+            block.add(sample);
+        }
+
+        length = block.length();
+
+        int decodedCount = PluviOnSampleBlock::decode(buffer, length, decoded, BENCH_BLOCK_SIZE);
+        boolean valid = decodedCount == BENCH_BLOCK_SIZE;
+
+        for (uint8_t i = 0; valid && i < BENCH_BLOCK_SIZE; i++) {
+            valid = decoded[i].messageID == samples[i].messageID &&
+                    decoded[i].stationTime == samples[i].stationTime &&
+                    decoded[i].tipCount == samples[i].tipCount &&
+                    sameReading(samples[i].temperature, decoded[i].temperature) &&
+                    sameReading(samples[i].humidity, decoded[i].humidity);
+        }
+
+        // Truncated blocks must be refused
+        if (PluviOnSampleBlock::decode(buffer, length - 1, decoded, BENCH_BLOCK_SIZE) >= 0) {
+            valid = false;
+        }
+
+        if (!valid) {
+            mismatches++;
+        }
+
+        bytes += length;
+        count += BENCH_BLOCK_SIZE;
+
+        yield();
+    }
+
+    PLV_DEBUG_(F("Samples: "));
+    PLV_DEBUG_(count);
+    PLV_DEBUG_(F(" in blocks of "));
+    PLV_DEBUG(BENCH_BLOCK_SIZE);
+
+    PLV_DEBUG_(F("Block bytes/sample: "));
+    PLV_DEBUG(1.0 * bytes / count);
+
+    PLV_DEBUG_(F("Mismatches: "));
+    PLV_DEBUG_(mismatches);
+    PLV_DEBUG_(F(" of "));
+    PLV_DEBUG(BENCH_BLOCKS);
+
+    PLV_DEBUG(F("Last block:"));
+    for (size_t i = 0; i < length; i++) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", buffer[i]);
+        PLV_DEBUG_(hex);
+    }
+    PLV_DEBUG(F(""));
+
+    PLV_DEBUG(F("\nDone."));
+}
+
+void loop() {
+}
@@ -0,0 +1,144 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: TipReplay.ino
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Tip debouncer check: replays edge sequences recorded from the hall sensor
+ * (both edges, as the ISR stores them) through PluviOnTipDebouncer and
+ * checks the tips counted against the tips of the recording.
+ *
+ * Every recording is a pattern of edges (time since the previous edge in us,
+ * pin level after the edge) played a number of times, with the sensor wired
+ * to a pull-up (LOW = magnet over the sensor).
+ */
+#include <FS.h> // FS must be the first
+
+#define PLV_DEBUG_ENABLED true
+#include <PluviOn.h>
+#include <PluviOnTipDebouncer.h>
+
+#define REPLAY_MIN_PULSE_WIDTH 2000 // us
+#define REPLAY_REFRACTORY 250000    // us, 4 tips/s
+
+struct RecordedEdge {
+    uint32_t sincePreviousInMicros;
+    uint8_t  level;
+};
+
+struct Recording {
+    const char         *name;
+    const RecordedEdge *pattern;
+    uint8_t            edges;
+    uint8_t            repeat;
+    uint8_t            startLevel;  // Pin level at begin()
+    uint32_t           startTime;   // micros() at begin()
+    int                tips;        // Expected tips
+};
+
+// One tip a second, clean 20 ms pulses
+const RecordedEdge CLEAN[] = { { 1000000, LOW }, { 20000, HIGH } };
+
+// Contact bounce on both edges and the bucket swinging back 30 ms later
+const RecordedEdge BOUNCY[] = {
+    { 1000000, LOW }, { 300, HIGH }, { 200, LOW }, { 15000, HIGH },
+    { 400, LOW }, { 300, HIGH }, { 30000, LOW }, { 5000, HIGH }
+};
+
+// 50 us spikes from the pump relay, no tip at all
+const RecordedEdge EMI[] = { { 37000, LOW }, { 50, HIGH } };
+
+// A tip every 280 ms (3.5 tips/s, the fastest the bucket empties)
+const RecordedEdge CLOUDBURST[] = { { 270000, LOW }, { 10000, HIGH } };
+
+// Bucket stopped with the magnet over the sensor: the release counts at boot
+const RecordedEdge ACTIVE_AT_BOOT[] = { { 50000, HIGH }, { 1000000, LOW }, { 20000, HIGH } };
+
+// Release lost with the ring full: the pulse starts over on the next active edge
+const RecordedEdge MISSED_RELEASE[] = { { 1000000, LOW }, { 400000, LOW }, { 20000, HIGH } };
+
+#define EDGES(pattern) (sizeof(pattern) / sizeof(pattern[0]))
+
+const Recording RECORDINGS[] = {
+    { "Clean",                    CLEAN,          EDGES(CLEAN),          10, HIGH, 1000, 10 },
+    { "Bouncy",                   BOUNCY,         EDGES(BOUNCY),         10, HIGH, 1000, 10 },
+    { "EMI spikes",               EMI,            EDGES(EMI),            50, HIGH, 1000, 0 },
+    { "Cloudburst (3.5 tips/s)",  CLOUDBURST,     EDGES(CLOUDBURST),     40, HIGH, 1000, 40 },
+    { "Active at boot",           ACTIVE_AT_BOOT, EDGES(ACTIVE_AT_BOOT), 1,  LOW,  1000, 2 },
+    { "Missed release",           MISSED_RELEASE, EDGES(MISSED_RELEASE), 1,  HIGH, 1000, 1 },
+    { "Across the micros() wrap", CLEAN,          EDGES(CLEAN),          10, HIGH, 0xFFFFFFFFUL - 3000000UL, 10 }
+};
+
+#define RECORDINGS_COUNT (sizeof(RECORDINGS) / sizeof(RECORDINGS[0]))
+
+/**
+ * Replay a recording, the edges encoded as the ISR does
+ *
+ * @return true if the tips match the recording
+ */
+boolean replay(uint8_t index) {
+
+    const Recording &recording = RECORDINGS[index];
+
+    PluviOnTipDebouncer debouncer;
+    debouncer.setMinPulseWidth(REPLAY_MIN_PULSE_WIDTH);
+    debouncer.setRefractory(REPLAY_REFRACTORY);
+    debouncer.begin(recording.startLevel);
+
+    uint32_t now = recording.startTime;
+    int tips = 0;
+
+    for (uint8_t r = 0; r < recording.repeat; r++) {
+        for (uint8_t e = 0; e < recording.edges; e++) {
+
+            now += recording.pattern[e].sincePreviousInMicros;
+            uint32_t edge = PLV_EDGE(now, recording.pattern[e].level);
+
+            if (debouncer.edge(PLV_EDGE_TIME(edge), PLV_EDGE_LEVEL(edge))) {
+                tips++;
+            }
+        }
+    }
+
+    PLV_DEBUG_(recording.name);
+    PLV_DEBUG_(F(": tips "));
+    PLV_DEBUG_(tips);
+    PLV_DEBUG_(F(" (expected "));
+    PLV_DEBUG_(recording.tips);
+    PLV_DEBUG_(F("), glitches "));
+    PLV_DEBUG_(debouncer.glitches());
+    PLV_DEBUG_(F(", bounces "));
+    PLV_DEBUG_(debouncer.bounces());
+    PLV_DEBUG(tips == recording.tips ? F(" - OK") : F(" - FAIL"));
+
+    return tips == recording.tips;
+}
+
+void setup() {
+
+    PLV_DEBUG_SETUP(115200);
+
+    PLV_DEBUG_HEADER(F("PLUVION TIP REPLAY"));
+
+    int failures = 0;
+
+    for (uint8_t i = 0; i < RECORDINGS_COUNT; i++) {
+        if (!replay(i)) {
+            failures++;
+        }
+    }
+
+    PLV_DEBUG_(F("Failures: "));
+    PLV_DEBUG(failures);
+
+    PLV_DEBUG(F("\nDone."));
+}
+
+void loop() {
+}
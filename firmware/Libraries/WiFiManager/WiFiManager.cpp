@@ -20,13 +20,6 @@
 //  - GMT: Brasilia
 const String RESET_TIME                 = "7,0";
 
-const String DIR_STATION_BUCKET_VOL     = "/stt/bucketvol";
-const String DIR_STATION_LATITUDE       = "/stt/lat";
-const String DIR_STATION_LONGITUDE      = "/stt/lon";
-const String DIR_STATION_TIME_TO_RESET  = "/stt/ttr";
-const String DIR_STATION_NAME           = "/stt/name";
-const String DIR_FIRMWARE_VERSION       = "/fmwver";
-
 String fmwver = "";
 String stationID = "PluviOn_";
 String macAddr = "";
@@ -380,6 +373,10 @@ void WiFiManager::setBreakAfterConfig(boolean shouldBreak) {
   _shouldBreakAfterConfig = shouldBreak;
 }
 
+void WiFiManager::setConfigStore(PluviOnConfigStore *configStore) {
+  _configStore = configStore;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 // PLUVION CODES - BEGIN
 //////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -453,6 +450,11 @@ void WiFiManager::handleSavePluviOnConfig() {
   // Save station name
   saveStationName();
 
+  // Write all the values above at once (the sketch loop is not running here)
+  if (_configStore && !_configStore->flush()) {
+    DEBUG_WM(F("ERROR! Fail writing Pluvi.On config."));
+  }
+
   String page = FPSTR(HTTP_HEAD);
   page.replace("{t}", "Configurações Salvas | Pluvi.On");
   page += FPSTR(HTTP_SCRIPT);
@@ -479,71 +481,22 @@ void WiFiManager::handleSavePluviOnConfig() {
  * Get Firmware Version
  */
 String WiFiManager::getFirmwareVersion() {
-  
+
   DEBUG_WM(F("\n\nGET FIRMWARE VERSION"));
   DEBUG_WM(F("===========================================\n"));
 
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ngetFirmwareVersion() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  String fmwver = "";
-
-  // Open the firmware version directory
-  Dir dirFmw = SPIFFS.openDir(DIR_FIRMWARE_VERSION);
-
-  DEBUG_WM(F("Getting Firmware Version..."));
-
-  if(dirFmw.next()){
-
-    fmwver = dirFmw.fileName().substring(DIR_FIRMWARE_VERSION.length() + 1);
-    DEBUG_WM(F("Firmware Version: "));
-    DEBUG_WM(fmwver);
-
-  } else {
-
-    DEBUG_WM(F("ERROR during reading Firmware Version!"));
-
-  }
-
-  return fmwver;
+  return getConfigString(PLV_CFG_FIRMWARE_VERSION);
 }
 
 /**
  * Get Latitude
  */
 String WiFiManager::getLatitude() {
-  
+
   DEBUG_WM(F("\n\nGET LATITUDE"));
   DEBUG_WM(F("===========================================\n"));
 
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ngetLatitude() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  String lat = "";
-
-  // Open the latitude directory
-  Dir dirLat = SPIFFS.openDir(DIR_STATION_LATITUDE);
-
-  DEBUG_WM(F("Getting Latitude..."));
-
-  if(dirLat.next()){
-
-    lat = dirLat.fileName().substring(DIR_STATION_LATITUDE.length() + 1);
-    lat.replace(",",".");
-    DEBUG_WM(F("Latitude: "));
-    DEBUG_WM(lat);
-
-  } else {
-
-    DEBUG_WM(F("ERROR during reading latitude!"));
-
-  }
-
-  return lat;
+  return getConfigString(PLV_CFG_LATITUDE);
 }
 
 /**
@@ -554,31 +507,7 @@ String WiFiManager::getLongitude() {
   DEBUG_WM(F("\n\nGET LONGITUDE"));
   DEBUG_WM(F("===========================================\n"));
 
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ngetLongitude() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  String lon = "";
-
-  // Open the longitude directory
-  Dir dirLon = SPIFFS.openDir(DIR_STATION_LONGITUDE);
-
-  DEBUG_WM(F("Getting Longitude..."));
-
-  if(dirLon.next()){
-
-    lon = dirLon.fileName().substring(DIR_STATION_LONGITUDE.length() + 1);
-    lon.replace(",",".");
-    DEBUG_WM(F("Longitude: "));
-    DEBUG_WM(lon);
-
-  } else {
-
-    DEBUG_WM(F("ERROR during reading longitude!"));
-
-  }
-  return lon;
+  return getConfigString(PLV_CFG_LONGITUDE);
 }
 
 /**
@@ -589,135 +518,28 @@ String WiFiManager::getBucketVolume() {
   DEBUG_WM(F("\n\nGET BUCKET VOLUME"));
   DEBUG_WM(F("===========================================\n"));
 
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ngetBucketVolume() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  String vol = "";
-
-  // Open the longitude directory
-  Dir dirVol = SPIFFS.openDir(DIR_STATION_BUCKET_VOL);
-
-  DEBUG_WM(F("Getting Bucket Volume..."));
-
-  if(dirVol.next()){
-
-    vol = dirVol.fileName().substring(DIR_STATION_BUCKET_VOL.length() + 1);
-    vol.replace(",",".");
-    DEBUG_WM(F("Bucket Volume: "));
-    DEBUG_WM(vol);
-
-  } else {
-
+  if (!_configStore || !_configStore->has(PLV_CFG_BUCKET_VOLUME)) {
     DEBUG_WM(F("ERROR during reading Bucket Volume!"));
-
+    return "";
   }
 
-  return vol;  
+  return String(_configStore->getFloat(PLV_CFG_BUCKET_VOLUME));
 }
 
 /**
- * Get Bucket Volume
+ * Get Time to Reset
  */
 String WiFiManager::getTimeToReset() {
 
   DEBUG_WM(F("\n\nGET TIME TO RESET"));
   DEBUG_WM(F("===========================================\n"));
 
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ngetTimeToReset() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  String rt = "";
-
-  // Open the longitude directory
-  Dir dirRT = SPIFFS.openDir(DIR_STATION_TIME_TO_RESET);
-
-  DEBUG_WM(F("Getting Reset Time..."));
-
-  if(dirRT.next()){
-
-    rt = dirRT.fileName().substring(DIR_STATION_TIME_TO_RESET.length() + 1);
-    rt.replace(",",".");
-    DEBUG_WM(F("Reset Time: "));
-    DEBUG_WM(rt);
-
-  } else {
-
+  if (!_configStore || !_configStore->has(PLV_CFG_TIME_TO_RESET)) {
     DEBUG_WM(F("ERROR during reading Reset Time!"));
-
+    return "";
   }
 
-  return rt;  
-}
-
-/**
- * Save Station Name
- */
-void WiFiManager::saveStationName(){
-
-    deleteStationName();
-
-    DEBUG_WM(F("\n\nSAVING STATION NAME"));
-    DEBUG_WM(F("===========================================\n"));
-
-    String stationName = server->arg("name");
-
-    DEBUG_WM(F("Station Name:"));
-    DEBUG_WM(stationName);
-
-    DEBUG_WM(F("Saving Station Name..."));
-
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
-        DEBUG_WM(F("\n\nsaveStationName() - FATAL! Error mounting SPIFFS file system!\n\n"));
-    }
-
-    String stationNameFile = DIR_STATION_NAME;
-      stationNameFile += "/";
-      stationNameFile += stationName;
-
-    File fsn = SPIFFS.open(stationNameFile, "w");
-    if (!fsn) {
-        DEBUG_WM(F("ERROR! Fail saving Station Name file."));
-    } else {
-        DEBUG_WM(F("SUCCESS! Station Name file:"));
-        DEBUG_WM(fsn.name());
-        fsn.close();
-    }
-
-}
-
-/**
- * Remove Station Name
- */
-void WiFiManager::deleteStationName(){
-    DEBUG_WM(F("\n\nDELETING STATION NAME"));
-    DEBUG_WM(F("===========================================\n"));
-
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
-        DEBUG_WM(F("\n\ndeleteStationName() - FATAL! Error mounting SPIFFS file system!\n\n"));
-    }
-
-    // Open the station name directory
-    Dir dir = SPIFFS.openDir(DIR_STATION_NAME);
-
-    DEBUG_WM(F("Deleting Station Name..."));
-    while(dir.next()){
-
-        DEBUG_WM(F("Deleting file: "));
-        DEBUG_WM(dir.fileName());
-
-        // Remove file
-        if (SPIFFS.remove(dir.fileName())) {
-            DEBUG_WM(F("File removed successfully."));
-        } else {
-            DEBUG_WM(F("ERROR during station name file deletion!"));
-        }
-    }
+  return String(_configStore->getInt(PLV_CFG_TIME_TO_RESET));
 }
 
 /**
@@ -725,160 +547,54 @@ void WiFiManager::deleteStationName(){
  */
 String WiFiManager::getStationName(){
 
-    DEBUG_WM(F("\n\nGET STATION NAME"));
-    DEBUG_WM(F("===========================================\n"));
-
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin()) {
-      DEBUG_WM(F("\n\ngetStationName() - FATAL! Error mounting SPIFFS file system!\n\n"));
-    }
-
-    String sn = "";
-
-    // Open the longitude directory
-    Dir dirSN = SPIFFS.openDir(DIR_STATION_NAME);
-
-    DEBUG_WM(F("Getting Station Name ..."));
-
-    if(dirSN.next()){
-
-      sn = dirSN.fileName().substring(DIR_STATION_NAME.length() + 1);
-      DEBUG_WM(F("Station Name: "));
-      DEBUG_WM(sn);
-
-    } else {
-
-      DEBUG_WM(F("ERROR during reading Station Name!"));
-
-    }
-
-    return sn;  
-}
-
-/**
- * Remove the Locations
- */
-void WiFiManager::deleteCoordinates() {
-
-  DEBUG_WM(F("\n\nDELETING COORDINATES"));
+  DEBUG_WM(F("\n\nGET STATION NAME"));
   DEBUG_WM(F("===========================================\n"));
 
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ndeleteCoordinates() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  // Open the latitude and longitude directory
-  Dir dirLat = SPIFFS.openDir(DIR_STATION_LATITUDE);
-  Dir dirLon = SPIFFS.openDir(DIR_STATION_LONGITUDE);
-
-  DEBUG_WM(F("Deleting Latitudes..."));
-  while(dirLat.next()){
-
-    DEBUG_WM(F("Deleting file: "));
-    DEBUG_WM(dirLat.fileName());
-
-    // Remove file
-    if (SPIFFS.remove(dirLat.fileName())) {
-      DEBUG_WM(F("File removed successfully."));
-    } else {
-      DEBUG_WM(F("ERROR during weather file deletion!"));
-    }
-  }
-
-  DEBUG_WM(F("Deleting Longitudes..."));
-  while(dirLon.next()){
-
-    DEBUG_WM(F("Deleting file: "));
-    DEBUG_WM(dirLon.fileName());
-
-    // Remove file
-    if (SPIFFS.remove(dirLon.fileName())) {
-      DEBUG_WM(F("File removed successfully."));
-    } else {
-      DEBUG_WM(F("ERROR during weather file deletion!"));
-    }
-
-  }
+  return getConfigString(PLV_CFG_STATION_NAME);
 }
 
 /**
- * Delete Bucket Volume
+ * Read a String value from the config store
  */
-void WiFiManager::deleteBucketVolume() {
+String WiFiManager::getConfigString(PluviOnConfigKey key) {
 
-
-  DEBUG_WM(F("\n\nDELETING BUCKET VOLUMES"));
-  DEBUG_WM(F("===========================================\n"));
-
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ndeleteBucketVolume() - FATAL! Error mounting SPIFFS file system!\n\n"));
+  if (!_configStore || !_configStore->has(key)) {
+    DEBUG_WM(F("ERROR during reading config value!"));
+    return "";
   }
 
-  // Open the Bucket Volume directory
-  Dir dir = SPIFFS.openDir(DIR_STATION_BUCKET_VOL);
-
-  DEBUG_WM(F("Deleting Bucket Volume..."));
-  while(dir.next()){
-
-    DEBUG_WM(F("Deleting file: "));
-    DEBUG_WM(dir.fileName());
-
-    // Remove file
-    if (SPIFFS.remove(dir.fileName())) {
-      DEBUG_WM(F("File removed successfully."));
-    } else {
-      DEBUG_WM(F("ERROR during weather file deletion!"));
-    }
-  }
+  String value = _configStore->getString(key);
+  DEBUG_WM(value);
 
+  return value;
 }
 
 /**
- * Delete Time to Reset
+ * Save Station Name
  */
-void WiFiManager::deleteTimeToReset() {
-
+void WiFiManager::saveStationName(){
 
-  DEBUG_WM(F("\n\nDELETING TIME TO RESET"));
+  DEBUG_WM(F("\n\nSAVING STATION NAME"));
   DEBUG_WM(F("===========================================\n"));
 
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\ndeleteTimeToReset() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  // Open the Bucket Volume directory
-  Dir dir = SPIFFS.openDir(DIR_STATION_TIME_TO_RESET);
-
-  DEBUG_WM(F("Deleting Timet to Reset..."));
-  while(dir.next()){
+  String stationName = server->arg("name");
 
-    DEBUG_WM(F("Deleting file: "));
-    DEBUG_WM(dir.fileName());
+  DEBUG_WM(F("Station Name:"));
+  DEBUG_WM(stationName);
 
-    // Remove file
-    if (SPIFFS.remove(dir.fileName())) {
-      DEBUG_WM(F("File removed successfully."));
-    } else {
-      DEBUG_WM(F("ERROR during time to reset file deletion!"));
-    }
+  if (!_configStore || !_configStore->setString(PLV_CFG_STATION_NAME, stationName.c_str())) {
+    DEBUG_WM(F("ERROR! Fail saving Station Name."));
   }
-
 }
 
 /**
  * Save coordinates to file system
  */
 void WiFiManager::saveCoordinates() {
-  
-  deleteCoordinates();
 
   DEBUG_WM(F("\n\nSAVING COORDINATES"));
   DEBUG_WM(F("===========================================\n"));
 
-
   String lat = server->arg("lat");
   String lon = server->arg("lon");
 
@@ -891,45 +607,17 @@ void WiFiManager::saveCoordinates() {
   DEBUG_WM(F("Longitude: "));
   DEBUG_WM(lon);
 
-  DEBUG_WM(F("Saving location..."));
-
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\nsaveCoordinates() - FATAL! Error mounting SPIFFS file system!\n\n"));
+  if (!_configStore || !_configStore->setString(PLV_CFG_LATITUDE, lat.c_str())) {
+    DEBUG_WM(F("ERROR! Fail saving Latitude."));
   }
 
-  String latFile = DIR_STATION_LATITUDE;
-    latFile += "/";
-    latFile += lat;
-
-  String lonFile = DIR_STATION_LONGITUDE;
-    lonFile += "/";
-    lonFile += lon;
-
-  File fLat = SPIFFS.open(latFile, "w");
-  if (!fLat) {
-    DEBUG_WM(F("ERROR! Fail saving Latitude file."));
-  } else {
-    DEBUG_WM(F("SUCCESS! Latitude file:"));
-    DEBUG_WM(fLat.name());
-    fLat.close();
-  }
-
-  File fLon = SPIFFS.open(lonFile, "w");
-  if (!fLon) {
-    DEBUG_WM(F("ERROR! Fail saving Longitude file."));
-  } else {
-    DEBUG_WM(F("SUCCESS! Longitude file:"));
-    DEBUG_WM(fLon.name());
-    fLon.close();
+  if (!_configStore || !_configStore->setString(PLV_CFG_LONGITUDE, lon.c_str())) {
+    DEBUG_WM(F("ERROR! Fail saving Longitude."));
   }
-
 }
 
 /** Save calibrated Bucket Volume to File System */
 void WiFiManager::saveBucketVolume() {
-  
-  deleteBucketVolume();
 
   DEBUG_WM(F("\n\nSAVING BUCKET VOLUME"));
   DEBUG_WM(F("===========================================\n"));
@@ -942,31 +630,13 @@ void WiFiManager::saveBucketVolume() {
   DEBUG_WM(F("Bucket Volume:"));
   DEBUG_WM(bucketVolume);
 
-  DEBUG_WM(F("Saving Bucket Volume..."));
-
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\nsaveBucketVolume() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  String bucketVolFile = DIR_STATION_BUCKET_VOL;
-    bucketVolFile += "/";
-    bucketVolFile += bucketVolume;
-
-  File fBV = SPIFFS.open(bucketVolFile, "w");
-  if (!fBV) {
-    DEBUG_WM(F("ERROR! Fail saving Bucket Volume file."));
-  } else {
-    DEBUG_WM(F("SUCCESS! Bucket Volume file:"));
-    DEBUG_WM(fBV.name());
-    fBV.close();
+  if (!_configStore || !_configStore->setFloat(PLV_CFG_BUCKET_VOLUME, bucketVolume.toFloat())) {
+    DEBUG_WM(F("ERROR! Fail saving Bucket Volume."));
   }
 }
 
 /** Save next time to reset to File System */
 void WiFiManager::saveTimeToReset() {
-  
-  deleteTimeToReset();
 
   DEBUG_WM(F("\n\nSAVING TIME TO RESET"));
   DEBUG_WM(F("===========================================\n"));
@@ -976,24 +646,8 @@ void WiFiManager::saveTimeToReset() {
   DEBUG_WM(F("Reset time:"));
   DEBUG_WM(ttr);
 
-  DEBUG_WM(F("Saving Time to Reset..."));
-
-  // Mounts SPIFFS file system
-  if (!SPIFFS.begin()) {
-    DEBUG_WM(F("\n\nsaveTimeToReset() - FATAL! Error mounting SPIFFS file system!\n\n"));
-  }
-
-  String ttrFile = DIR_STATION_TIME_TO_RESET;
-    ttrFile += "/";
-    ttrFile += ttr;
-
-  File ttrF = SPIFFS.open(ttrFile, "w");
-  if (!ttrF) {
-    DEBUG_WM(F("ERROR! Fail saving Reset Time file."));
-  } else {
-    DEBUG_WM(F("SUCCESS! Time to Reset file:"));
-    DEBUG_WM(ttrF.name());
-    ttrF.close();
+  if (!_configStore || !_configStore->setInt(PLV_CFG_TIME_TO_RESET, ttr.toInt())) {
+    DEBUG_WM(F("ERROR! Fail saving Time to Reset."));
   }
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1344,6 +998,12 @@ void WiFiManager::handleReset() {
   server->send(200, "text/html", page);
 
   DEBUG_WM(F("Sent reset page"));
+
+  // Do not lose staged config changes
+  if (_configStore) {
+    _configStore->flush();
+  }
+
   delay(5000);
   ESP.reset();
   delay(2000);
@@ -17,6 +17,7 @@
 #include <ESP8266WebServer.h>
 #include <DNSServer.h>
 #include <memory>
+#include <PluviOnConfigStore.h>
 
 extern "C" {
 #include "user_interface.h"
@@ -104,6 +105,8 @@ public:
   void addParameter(WiFiManagerParameter *p);
   //if this is set, it will exit after config, even if connection is unsucessful.
   void setBreakAfterConfig(boolean shouldBreak);
+  //Pluvi.On station configuration read and saved by the config portal
+  void setConfigStore(PluviOnConfigStore *configStore);
   //if this is set, try WPS setup when starting (this will delay config portal for up to 2 mins)
   //TODO
   //if this is set, customise style
@@ -171,17 +174,15 @@ private:
   void saveTimeToReset();
   void saveStationName();
 
-  void deleteCoordinates();
-  void deleteBucketVolume();
-  void deleteTimeToReset();
-  void deleteStationName();
-
   String getLatitude();
   String getLongitude();
   String getBucketVolume();
   String getTimeToReset();
   String getStationName();
   String getFirmwareVersion();
+  String getConfigString(PluviOnConfigKey key);
+
+  PluviOnConfigStore *_configStore = NULL;
 
   // Pluvi.On Functions - End
 
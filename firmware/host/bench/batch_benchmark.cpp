@@ -0,0 +1,235 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: batch_benchmark.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Offline backlog benchmark (host build): messages/s posted by
+ * PluviOnUploader to firmware/tools/pluvion_api_server.py for each batch
+ * size, as the thingspeak firmware posts them (batch size 1: one message per
+ * request to /weather, otherwise /weather/batch with the ack list), with a
+ * new connection per request and with keep-alive.
+ *
+ * The server delays every new connection by the handshake time, a stand-in
+ * for the TLS handshake of the cloud (most of the time of a request on the
+ * station). Compare the batch sizes with each other, not with the station.
+ *
+ *     ./batch_benchmark [messages] [handshake ms] [batch sizes ...]   (default: 200 100 1 5 10)
+ */
+#include <FS.h> // FS must be the first
+
+#include <PluviOn.h>
+#include <PluviOnMessageWriter.h>
+#include <PluviOnUploader.h>
+#include "HostClient.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#define BENCH_MESSAGES   200
+#define BENCH_HANDSHAKE  100
+#define BENCH_HOST       "127.0.0.1"
+
+struct BenchResult {
+    unsigned long requests;
+    unsigned long handshakes;
+    unsigned long acked;
+    unsigned long elapsedInMicros;
+    boolean       success;
+};
+
+/**
+ * Offline weather message as the firmware posts it
+ */
+static std::string message(int i) {
+
+    char line[96];
+    snprintf(line, sizeof(line), "PLV0001|%d|%lu|23.50|65.00|1013.25|%d|0.25|off",
+        i, 1539871200UL + i * 60, i % 7);
+
+    return line;
+}
+
+/**
+ * Positions in the ack list of a /weather/batch response (ok alone for /weather)
+ */
+static unsigned long countAcks(const char *response, int count) {
+
+    if (count == 1) {
+        return strncmp(response, "ok|", 3) == 0 ? 1 : 0;
+    }
+
+    const char *acks = response;
+    for (int field = 0; field < 4 && acks; field++) {
+        acks = strchr(acks, '|');
+        acks = acks ? acks + 1 : NULL;
+    }
+
+    if (!acks || !*acks) {
+        return 0;
+    }
+
+    unsigned long acked = 1;
+    for (; *acks; acks++) {
+        acked += (*acks == ',');
+    }
+
+    return acked;
+}
+
+static FILE *startServer(int handshake, boolean keepAlive, int requests, uint16_t &port) {
+
+    char command[512];
+    snprintf(command, sizeof(command),
+        "%s %s/pluvion_api_server.py --bind " BENCH_HOST " --port 0 --handshake %d --requests %d%s",
+        PLV_BENCH_PYTHON3, PLV_BENCH_TOOLS_DIR, handshake, requests, keepAlive ? "" : " --close");
+
+    FILE *server = popen(command, "r");
+    if (!server) {
+        return NULL;
+    }
+
+    // "listening on 127.0.0.1:PORT/http"
+    char     line[128];
+    unsigned value = 0;
+    if (!fgets(line, sizeof(line), server) || sscanf(line, "listening on " BENCH_HOST ":%u/http", &value) != 1) {
+        pclose(server);
+        return NULL;
+    }
+
+    port = value;
+
+    return server;
+}
+
+static void run(int messages, int handshake, int batchSize, boolean keepAlive, BenchResult &result) {
+
+    result.requests   = 0;
+    result.handshakes = 0;
+    result.acked      = 0;
+    result.success    = false;
+
+    int      requests = (messages + batchSize - 1) / batchSize;
+    uint16_t port;
+    FILE    *server = startServer(handshake, keepAlive, requests, port);
+    if (!server) {
+        result.elapsedInMicros = 0;
+        return;
+    }
+
+    HostClient      client;
+    PluviOnUploader uploader(client);
+    uploader.setKeepAlive(keepAlive);
+
+    char        header[256];
+    std::string body;
+
+    result.success         = true;
+    result.elapsedInMicros = micros();
+
+    for (int first = 0; first < messages; first += batchSize) {
+
+        int count = messages - first < batchSize ? messages - first : batchSize;
+
+        body.clear();
+        for (int i = first; i < first + count; i++) {
+            body += message(i);
+            if (count > 1) {
+                body += '\n';
+            }
+        }
+
+        PluviOnMessageWriter request(header, sizeof(header));
+        request += "POST ";
+        request += count > 1 ? "/weather/batch" : "/weather";
+        request += " HTTP/1.1\r\nHost: " BENCH_HOST "\r\n";
+        request += "Content-Type: application/vnd.community.pluvion.com.br.v1.text\r\n";
+        request += "Content-Length: ";
+        request += (unsigned long) body.size();
+        request += keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+
+        // Not reused: a new connection, with its handshake
+        if (!client.connected()) {
+            result.handshakes++;
+        }
+
+        if (!uploader.start(BENCH_HOST, port, PLV_UPLOAD_HTTP, header, request.length(),
+                            (const uint8_t *) body.data(), body.size())) {
+            result.success = false;
+            break;
+        }
+
+        PluviOnUploadState state;
+        do {
+            state = uploader.step();
+        } while (state != PLV_UPLOAD_DONE && state != PLV_UPLOAD_FAILED);
+
+        if (state == PLV_UPLOAD_FAILED || uploader.status() != 200) {
+            result.success = false;
+            break;
+        }
+
+        result.requests++;
+        result.acked += countAcks(uploader.response(), count);
+    }
+
+    result.elapsedInMicros = micros() - result.elapsedInMicros;
+    client.stop();
+
+    // The server exits after the last request
+    char line[128];
+    while (fgets(line, sizeof(line), server)) {
+    }
+    pclose(server);
+
+    if (result.acked != (unsigned long) messages) {
+        result.success = false;
+    }
+}
+
+static void printResult(int batchSize, boolean keepAlive, const BenchResult &result) {
+
+    double seconds = result.elapsedInMicros / 1000000.0;
+
+    printf("batch %3d  %-10s  %5lu requests  %5lu handshakes  %8.1f messages/s%s\n",
+        batchSize,
+        keepAlive ? "keep-alive" : "new conn",
+        result.requests,
+        result.handshakes,
+        seconds > 0 ? result.acked / seconds : 0,
+        result.success ? "" : "  (FAILED)");
+}
+
+int main(int argc, char **argv) {
+
+    int messages  = argc > 1 ? atoi(argv[1]) : BENCH_MESSAGES;
+    int handshake = argc > 2 ? atoi(argv[2]) : BENCH_HANDSHAKE;
+
+    int defaults[] = {1, 5, 10};
+    int count      = argc > 3 ? argc - 3 : 3;
+
+    printf("%d offline messages, %d ms handshake\n", messages, handshake);
+
+    for (int i = 0; i < count; i++) {
+
+        int batchSize = argc > 3 ? atoi(argv[3 + i]) : defaults[i];
+        if (batchSize < 1) {
+            continue;
+        }
+
+        for (int keepAlive = 0; keepAlive <= 1; keepAlive++) {
+            BenchResult result;
+            run(messages, handshake, batchSize, keepAlive, result);
+            printResult(batchSize, keepAlive, result);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: fs_benchmark.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * File system benchmark (host build): ops/s and heap allocations per call
+ * of FSCreateFile, FSReadInt and FSDeleteFiles with thousands of files on
+ * the SPIFFS emulation.
+ *
+ * The allocations are the ones of the library (the File and Dir handles of
+ * the emulation are not counted), so they match the station. The ops/s
+ * measure the library code and the scan of the flat namespace on the host,
+ * not the flash: compare them between runs and file counts, not with the
+ * FSBenchmark example run on the station.
+ *
+ *     ./fs_benchmark [files ...]   (default: 100 1000 2000 4000)
+ */
+#include <FS.h> // FS must be the first
+
+#include <PluviOn.h>
+#include "HostHeap.h"
+
+#define BENCH_DIR        "/bench"
+#define BENCH_VALUE_DIR  "/stt/id"
+#define BENCH_READS      200
+#define BENCH_FS_SIZE    (3 * 1024 * 1024) // 3 MB SPIFFS of a 4 MB board
+
+static PluviOn pluvion;
+
+struct BenchResult {
+    unsigned long ops;
+    unsigned long elapsedInMicros;
+    unsigned long allocations;
+    boolean       success;
+};
+
+static void printResult(const char *name, int files, const BenchResult &result) {
+
+    double seconds = result.elapsedInMicros / 1000000.0;
+
+    printf("%-14s %6d files  %9.0f ops/s  %6.2f allocs/op%s\n",
+        name,
+        files,
+        seconds > 0 ? result.ops / seconds : 0,
+        result.ops ? (double) result.allocations / result.ops : 0,
+        result.success ? "" : "  (FAILED)");
+}
+
+static void begin(BenchResult &result) {
+    result.ops     = 0;
+    result.success = true;
+    hostHeapReset();
+    result.elapsedInMicros = micros();
+}
+
+static void end(BenchResult &result) {
+    result.elapsedInMicros = micros() - result.elapsedInMicros;
+    result.allocations     = hostHeapStats().allocations;
+}
+
+static void run(int files) {
+
+    PluviOn::end();
+    PLV_FS.setRoot("fs_benchmark");
+    PLV_FS.setSize(BENCH_FS_SIZE);
+    PLV_FS.format();
+    PluviOn::begin();
+
+    BenchResult result;
+
+    // Create the files
+    begin(result);
+    for (int i = 0; i < files; i++) {
+        result.success = pluvion.FSCreateFile(BENCH_DIR, i) && result.success;
+        result.ops++;
+    }
+    end(result);
+    printResult("FSCreateFile", files, result);
+
+    // Read a value, the flat namespace holding the files
+    pluvion.FSCreateFile(BENCH_VALUE_DIR, 1234);
+    String valueDir(BENCH_VALUE_DIR);
+
+    begin(result);
+    for (int i = 0; i < BENCH_READS; i++) {
+        result.success = pluvion.FSReadInt(valueDir) == 1234 && result.success;
+        result.ops++;
+    }
+    end(result);
+    printResult("FSReadInt", files, result);
+
+    // Delete the files
+    begin(result);
+    result.success = pluvion.FSDeleteFiles(BENCH_DIR);
+    result.ops     = files;
+    end(result);
+    printResult("FSDeleteFiles", files, result);
+}
+
+int main(int argc, char **argv) {
+
+    static const int DEFAULT_FILES[] = { 100, 1000, 2000, 4000 };
+
+    printf("PLUVION FS BENCHMARK (host, %s emulation)\n", PLV_FS_NAME);
+    printf("===========================================\n");
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            run(atoi(argv[i]));
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(DEFAULT_FILES) / sizeof(DEFAULT_FILES[0]); i++) {
+            run(DEFAULT_FILES[i]);
+        }
+    }
+
+    return 0;
+}
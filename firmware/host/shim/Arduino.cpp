@@ -0,0 +1,354 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: Arduino.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <chrono>
+#include <thread>
+
+#include "Arduino.h"
+#include "HostHeap.h"
+
+HardwareSerial Serial;
+EspClass       ESP;
+
+// Pin levels (inputs idle HIGH, as with the pull-ups of the station)
+#define HOST_PINS 17
+static uint8_t pins[HOST_PINS] = {
+    HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH,
+    HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH, HIGH
+};
+
+static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+
+// |------------------------------------------|
+// | Time                                     |
+// |------------------------------------------|
+
+unsigned long millis() {
+    return (unsigned long) (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+unsigned long micros() {
+    return (unsigned long) (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+}
+
+// |------------------------------------------|
+// | Random                                   |
+// |------------------------------------------|
+
+long random(long howbig) {
+    return howbig > 0 ? rand() % howbig : 0;
+}
+
+long random(long howsmall, long howbig) {
+    return howsmall < howbig ? random(howbig - howsmall) + howsmall : howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed) {
+        srand(seed);
+    }
+}
+
+// |------------------------------------------|
+// | Pins and interrupts                      |
+// |------------------------------------------|
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void) pin;
+    (void) mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < HOST_PINS) {
+        pins[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < HOST_PINS ? pins[pin] : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    (void) pin;
+    (void) handler;
+    (void) mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    (void) pin;
+}
+
+// |------------------------------------------|
+// | stdlib_noniso                            |
+// |------------------------------------------|
+
+char *ultoa(unsigned long value, char *result, int base) {
+
+    if (base < 2 || base > 16) {
+        *result = 0;
+        return result;
+    }
+
+    char *out = result;
+    do {
+        *out++ = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value);
+
+    *out = 0;
+
+    // Reverse
+    for (char *begin = result, *end = out - 1; begin < end; begin++, end--) {
+        char swap = *begin;
+        *begin = *end;
+        *end = swap;
+    }
+
+    return result;
+}
+
+char *ltoa(long value, char *result, int base) {
+
+    if (value < 0 && base == 10) {
+        *result = '-';
+        ultoa(-(unsigned long) value, result + 1, base);
+        return result;
+    }
+
+    return ultoa((unsigned long) value, result, base);
+}
+
+char *utoa(unsigned int value, char *result, int base) {
+    return ultoa(value, result, base);
+}
+
+char *itoa(int value, char *result, int base) {
+    return ltoa(value, result, base);
+}
+
+// As in core_esp8266_noniso.cpp (the rounding differs from printf)
+char *dtostrf(double number, signed char width, unsigned char prec, char *s) {
+
+    if (isnan(number)) {
+        strcpy(s, "nan");
+        return s;
+    }
+
+    if (isinf(number)) {
+        strcpy(s, "inf");
+        return s;
+    }
+
+    bool negative = false;
+    char *out = s;
+    int fillme = width;
+
+    if (prec > 0) {
+        fillme -= (prec + 1);
+    }
+
+    if (number < 0.0) {
+        negative = true;
+        fillme--;
+        number = -number;
+    }
+
+    double rounding = 2.0;
+    for (uint8_t i = 0; i < prec; ++i) {
+        rounding *= 10.0;
+    }
+    rounding = 1.0 / rounding;
+    number += rounding;
+
+    double tenpow = 1.0;
+    int digitcount = 1;
+    while (number >= 10.0 * tenpow) {
+        tenpow *= 10.0;
+        digitcount++;
+    }
+
+    number /= tenpow;
+    fillme -= digitcount;
+
+    while (fillme-- > 0) {
+        *out++ = ' ';
+    }
+
+    if (negative) {
+        *out++ = '-';
+    }
+
+    digitcount += prec;
+    int8_t digit = 0;
+    while (digitcount-- > 0) {
+        digit = (int8_t) number;
+        if (digit > 9) {
+            digit = 9;
+        }
+        *out++ = (char) ('0' | digit);
+        if ((digitcount == prec) && (prec > 0)) {
+            *out++ = '.';
+        }
+        number -= digit;
+        number *= 10.0;
+    }
+
+    *out = 0;
+    return s;
+}
+
+// |------------------------------------------|
+// | Stream                                   |
+// |------------------------------------------|
+
+int Stream::timedRead() {
+
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) {
+            return c;
+        }
+        yield();
+    } while (millis() - start < _timeout);
+
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) {
+            break;
+        }
+        *buffer++ = (char) c;
+        count++;
+    }
+
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0 || c == terminator) {
+            break;
+        }
+        *buffer++ = (char) c;
+        count++;
+    }
+
+    return count;
+}
+
+String Stream::readString() {
+
+    String out;
+    for (int c = timedRead(); c >= 0; c = timedRead()) {
+        out += (char) c;
+    }
+
+    return out;
+}
+
+String Stream::readStringUntil(char terminator) {
+
+    String out;
+    for (int c = timedRead(); c >= 0 && c != terminator; c = timedRead()) {
+        out += (char) c;
+    }
+
+    return out;
+}
+
+// |------------------------------------------|
+// | Serial                                   |
+// |------------------------------------------|
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+
+    if (!_begun) {
+        return size;
+    }
+
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+// |------------------------------------------|
+// | ESP                                      |
+// |------------------------------------------|
+
+uint32_t EspClass::getFreeHeap() {
+    unsigned long live = hostHeapStats().liveBytes;
+    return live < PLV_HOST_HEAP_SIZE ? PLV_HOST_HEAP_SIZE - live : 0;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() {
+    return getFreeHeap();
+}
+
+// 80 MHz
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - boot).count() / 1000 * 80;
+}
+
+uint32_t EspClass::random() {
+    return ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+}
+
+void EspClass::restart() {
+    Serial.println(F("\n[host] ESP.restart()"));
+    fflush(stdout);
+    exit(0);
+}
+
+void EspClass::reset() {
+    Serial.println(F("\n[host] ESP.reset()"));
+    fflush(stdout);
+    exit(0);
+}
+
+void EspClass::deepSleep(uint64_t timeInMicros) {
+    Serial.print(F("\n[host] ESP.deepSleep() "));
+    Serial.println((unsigned long) (timeInMicros / 1000));
+    fflush(stdout);
+    exit(0);
+}
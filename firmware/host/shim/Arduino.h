@@ -0,0 +1,148 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: Arduino.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: the part of the ESP8266 Arduino core used by the PluviOn
+ * library, its examples and tests. Time comes from the host monotonic
+ * clock, Serial writes to stdout (after Serial.begin()) and the heap is
+ * the counted one of HostHeap.h.
+ */
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH         0x1
+#define LOW          0x0
+
+#define INPUT        0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT       0x01
+
+#define RISING       0x01
+#define FALLING      0x02
+#define CHANGE       0x03
+
+#define PROGMEM
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define PGM_P              const char *
+#define PSTR(s)            (s)
+#define pgm_read_byte(p)   (*(const uint8_t *) (p))
+#define pgm_read_word(p)   (*(const uint16_t *) (p))
+#define pgm_read_dword(p)  (*(const uint32_t *) (p))
+#define memcpy_P           memcpy
+#define strlen_P           strlen
+#define strcpy_P           strcpy
+#define strncpy_P          strncpy
+#define strcmp_P           strcmp
+#define strncmp_P          strncmp
+#define snprintf_P         snprintf
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+void          yield();
+
+long          random(long howbig);
+long          random(long howsmall, long howbig);
+void          randomSeed(unsigned long seed);
+
+void          noInterrupts();
+void          interrupts();
+
+void          pinMode(uint8_t pin, uint8_t mode);
+void          digitalWrite(uint8_t pin, uint8_t value);
+int           digitalRead(uint8_t pin);
+void          attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void          detachInterrupt(uint8_t pin);
+#define       digitalPinToInterrupt(pin) (pin)
+
+// stdlib_noniso
+char         *itoa(int value, char *result, int base);
+char         *ltoa(long value, char *result, int base);
+char         *utoa(unsigned int value, char *result, int base);
+char         *ultoa(unsigned long value, char *result, int base);
+char         *dtostrf(double number, signed char width, unsigned char prec, char *s);
+
+/**
+ * Serial port: stdout, once begin() was called (as on the station, where
+ * nothing comes out of the UART before it)
+ */
+class HardwareSerial : public Stream
+{
+    public:
+        HardwareSerial() : _begun(false) {}
+
+        void   begin(unsigned long baud) { (void) baud; _begun = true; }
+        void   end() { _begun = false; }
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        int    available() override { return 0; }
+        int    read() override { return -1; }
+        int    peek() override { return -1; }
+        void   flush() override;
+        operator bool() const { return _begun; }
+
+        using Print::write;
+
+    private:
+        bool   _begun;
+};
+
+extern HardwareSerial Serial;
+
+/**
+ * ESP8266 system calls
+ */
+class EspClass
+{
+    public:
+        uint32_t getFreeHeap();
+        uint32_t getMaxFreeBlockSize();
+        uint8_t  getHeapFragmentation() { return 0; }
+        uint32_t getCycleCount();
+        uint32_t getChipId() { return 0x00C0FFEE; }
+        uint32_t getFlashChipSize() { return 4 * 1024 * 1024; }
+        uint32_t getFlashChipRealSize() { return 4 * 1024 * 1024; }
+        uint32_t getFlashChipSpeed() { return 40000000; }
+        uint16_t getVcc() { return 3300; }
+        uint32_t random();
+        String   getResetReason() { return String("External System"); }
+        void     restart();
+        void     reset();
+        void     deepSleep(uint64_t timeInMicros);
+};
+
+extern EspClass ESP;
+
+#endif
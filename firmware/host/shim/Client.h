@@ -0,0 +1,39 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: Client.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: Arduino Client
+ */
+#ifndef Client_h
+#define Client_h
+
+#include "Arduino.h"
+
+class Client : public Stream
+{
+    public:
+        virtual int     connect(IPAddress ip, uint16_t port) = 0;
+        virtual int     connect(const char *host, uint16_t port) = 0;
+        virtual size_t  write(uint8_t c) = 0;
+        virtual size_t  write(const uint8_t *buffer, size_t size) = 0;
+        virtual int     available() = 0;
+        virtual int     read() = 0;
+        virtual int     read(uint8_t *buffer, size_t size) = 0;
+        virtual int     peek() = 0;
+        virtual void    flush() = 0;
+        virtual void    stop() = 0;
+        virtual uint8_t connected() = 0;
+        virtual operator bool() = 0;
+
+        using Print::write;
+};
+
+#endif
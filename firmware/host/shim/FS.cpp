@@ -0,0 +1,753 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: FS.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "FS.h"
+#include "LittleFS.h"
+#include "HostHeap.h"
+
+// Root of the emulated file systems, relative to the working directory
+#ifndef PLV_HOST_SPIFFS_ROOT
+#define PLV_HOST_SPIFFS_ROOT   "spiffs"
+#endif
+
+#ifndef PLV_HOST_LITTLEFS_ROOT
+#define PLV_HOST_LITTLEFS_ROOT "littlefs"
+#endif
+
+fs::FS SPIFFS(PLV_HOST_SPIFFS_ROOT, false);
+fs::FS LittleFS(PLV_HOST_LITTLEFS_ROOT, true);
+
+namespace fs {
+
+/**
+ * Open file: a stdio stream on the host file
+ */
+struct FileImpl {
+    FS     *fs;
+    FILE   *fp;
+    bool    append;
+    size_t  size;
+    char    path[PLV_HOST_PATH_SIZE];
+
+    ~FileImpl() {
+        if (fp) {
+            fclose(fp);
+        }
+    }
+};
+
+/**
+ * Directory listing, taken when the directory is opened
+ */
+struct DirEntry {
+    std::string name;      // As returned by fileName()
+    std::string path;      // Full path
+    size_t      size;
+    bool        directory;
+};
+
+struct DirImpl {
+    FS                    *fs;
+    std::vector<DirEntry>  entries;
+    int                    index;
+};
+
+// |------------------------------------------|
+// | Path mapping                             |
+// |------------------------------------------|
+
+// SPIFFS: the full path is one host file name ('%' and '/' escaped)
+static void escape(std::string &out, const char *path) {
+    for (; *path; path++) {
+        if (*path == '%') {
+            out += "%25";
+        } else if (*path == '/') {
+            out += "%2F";
+        } else {
+            out += *path;
+        }
+    }
+}
+
+static std::string unescape(const char *name) {
+
+    std::string out;
+    for (; *name; name++) {
+        if (name[0] == '%' && name[1] == '2' && (name[2] == '5' || name[2] == 'F')) {
+            out += name[2] == '5' ? '%' : '/';
+            name += 2;
+        } else {
+            out += *name;
+        }
+    }
+
+    return out;
+}
+
+static bool isDirectory(const char *hostpath) {
+    struct stat st;
+    return stat(hostpath, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static bool isFile(const char *hostpath) {
+    struct stat st;
+    return stat(hostpath, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static size_t fileSize(const char *hostpath) {
+    struct stat st;
+    return stat(hostpath, &st) == 0 ? st.st_size : 0;
+}
+
+// mkdir -p
+static bool makeDirectories(const char *hostpath) {
+
+    std::string path(hostpath);
+
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+
+        std::string part = path.substr(0, slash);
+        if (::mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+
+        if (slash == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+// rm -r of the directory content
+static void removeContent(const char *hostdir) {
+
+    DIR *dir = opendir(hostdir);
+    if (!dir) {
+        return;
+    }
+
+    for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        std::string path = std::string(hostdir) + "/" + entry->d_name;
+
+        if (isDirectory(path.c_str())) {
+            removeContent(path.c_str());
+            ::rmdir(path.c_str());
+        } else {
+            unlink(path.c_str());
+        }
+    }
+
+    closedir(dir);
+}
+
+// |------------------------------------------|
+// | FS                                       |
+// |------------------------------------------|
+
+FS::FS(const char *root, bool directories) : _directories(directories), _mounted(false), _size(PLV_HOST_FS_SIZE), _usedBytes(0) {
+    setRoot(root);
+}
+
+void FS::setRoot(const char *root) {
+    end();
+    snprintf(_root, sizeof(_root), "%s", root);
+}
+
+bool FS::begin() {
+
+    if (_mounted) {
+        return true;
+    }
+
+    HostHeapQuiet quiet;
+
+    if (!makeDirectories(_root)) {
+        return false;
+    }
+
+    _usedBytes = 0;
+    scanUsage(_root);
+    _mounted = true;
+
+    return true;
+}
+
+void FS::end() {
+    _mounted = false;
+}
+
+bool FS::format() {
+
+    HostHeapQuiet quiet;
+
+    removeContent(_root);
+    _usedBytes = 0;
+
+    return true;
+}
+
+bool FS::info(FSInfo &info) {
+
+    if (!_mounted) {
+        return false;
+    }
+
+    info.totalBytes    = _size;
+    info.usedBytes     = _usedBytes;
+    info.blockSize     = 4096;
+    info.pageSize      = PLV_HOST_FS_PAGE_SIZE;
+    info.maxOpenFiles  = 5;
+    info.maxPathLength = _directories ? 255 : PLV_HOST_SPIFFS_NAME_LEN;
+
+    return true;
+}
+
+File FS::open(const char *path, const char *mode) {
+
+    char hostpath[PLV_HOST_PATH_SIZE];
+    if (!_mounted || !validPath(path) || !hostPath(hostpath, path)) {
+        return File();
+    }
+
+    bool read     = mode[0] == 'r';
+    bool truncate = mode[0] == 'w';
+    bool append   = mode[0] == 'a';
+    bool update   = mode[1] == '+';
+
+    if (!read && !truncate && !append) {
+        return File();
+    }
+
+    if (!isFile(hostpath)) {
+
+        // "r" and "r+" need the file, LittleFS names a directory too
+        if (read || isDirectory(hostpath)) {
+            return File();
+        }
+
+        // A new file takes its index page
+        if (_usedBytes + PLV_HOST_FS_PAGE_SIZE > _size) {
+            return File();
+        }
+
+        if (_directories) {
+            HostHeapQuiet quiet;
+            std::string parent(hostpath);
+            parent.resize(parent.rfind('/'));
+            if (!makeDirectories(parent.c_str())) {
+                return File();
+            }
+        }
+    }
+
+    size_t size = fileSize(hostpath);
+    bool existed = isFile(hostpath);
+
+    // Read and read/write streams never truncate nor create ("r+" on an existing file)
+    FILE *fp = fopen(hostpath, read ? (update ? "r+b" : "rb") : (truncate ? (update ? "w+b" : "wb") : (update ? "a+b" : "ab")));
+    if (!fp) {
+        return File();
+    }
+
+    if (truncate) {
+        _usedBytes -= existed ? pages(size) * PLV_HOST_FS_PAGE_SIZE : 0;
+        _usedBytes += pages(0) * PLV_HOST_FS_PAGE_SIZE;
+        size = 0;
+    } else if (!existed) {
+        _usedBytes += pages(0) * PLV_HOST_FS_PAGE_SIZE;
+    }
+
+    std::shared_ptr<FileImpl> impl;
+    {
+        HostHeapQuiet quiet;
+        impl = std::make_shared<FileImpl>();
+    }
+
+    impl->fs     = this;
+    impl->fp     = fp;
+    impl->append = append;
+    impl->size   = size;
+    snprintf(impl->path, sizeof(impl->path), "%s", path);
+
+    return File(impl);
+}
+
+bool FS::exists(const char *path) {
+
+    char hostpath[PLV_HOST_PATH_SIZE];
+    if (!_mounted || !validPath(path) || !hostPath(hostpath, path)) {
+        return false;
+    }
+
+    return isFile(hostpath) || (_directories && isDirectory(hostpath));
+}
+
+Dir FS::openDir(const char *path) {
+
+    if (!_mounted) {
+        return Dir();
+    }
+
+    HostHeapQuiet quiet;
+
+    std::shared_ptr<DirImpl> impl = std::make_shared<DirImpl>();
+    impl->fs    = this;
+    impl->index = -1;
+
+    if (_directories) {
+
+        char hostpath[PLV_HOST_PATH_SIZE];
+        if (!validPath(path) || !hostPath(hostpath, path)) {
+            return Dir(impl);
+        }
+
+        DIR *dir = opendir(hostpath);
+        if (dir) {
+            for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                    continue;
+                }
+
+                std::string host = std::string(hostpath) + "/" + entry->d_name;
+                std::string full = strcmp(path, "/") == 0 || !path[0] ? std::string("/") + entry->d_name : std::string(path) + "/" + entry->d_name;
+
+                DirEntry e = { entry->d_name, full, fileSize(host.c_str()), isDirectory(host.c_str()) };
+                impl->entries.push_back(e);
+            }
+            closedir(dir);
+        }
+
+    } else {
+
+        // Flat namespace: every file whose full path starts with the prefix
+        size_t length = strlen(path);
+
+        DIR *dir = opendir(_root);
+        if (dir) {
+            for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+
+                if (entry->d_name[0] == '.') {
+                    continue;
+                }
+
+                std::string full = unescape(entry->d_name);
+                if (strncmp(full.c_str(), path, length) != 0) {
+                    continue;
+                }
+
+                std::string host = std::string(_root) + "/" + entry->d_name;
+
+                DirEntry e = { full, full, fileSize(host.c_str()), false };
+                impl->entries.push_back(e);
+            }
+            closedir(dir);
+        }
+    }
+
+    // Stable order (the host directory order depends on the host file system)
+    std::sort(impl->entries.begin(), impl->entries.end(), [](const DirEntry &a, const DirEntry &b) {
+        return a.path < b.path;
+    });
+
+    return Dir(impl);
+}
+
+bool FS::remove(const char *path) {
+
+    char hostpath[PLV_HOST_PATH_SIZE];
+    if (!_mounted || !validPath(path) || !hostPath(hostpath, path) || !isFile(hostpath)) {
+        return false;
+    }
+
+    size_t size = fileSize(hostpath);
+
+    if (unlink(hostpath) != 0) {
+        return false;
+    }
+
+    _usedBytes -= pages(size) * PLV_HOST_FS_PAGE_SIZE;
+
+    if (_directories) {
+        removeEmptyParents(path);
+    }
+
+    return true;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+
+    char from[PLV_HOST_PATH_SIZE];
+    char to[PLV_HOST_PATH_SIZE];
+
+    if (!_mounted || !validPath(pathFrom) || !validPath(pathTo) || !hostPath(from, pathFrom) || !hostPath(to, pathTo)) {
+        return false;
+    }
+
+    if (!isFile(from) && !(_directories && isDirectory(from))) {
+        return false;
+    }
+
+    // SPIFFS refuses to rename over an existing file, LittleFS replaces it
+    if (isFile(to)) {
+        if (!_directories) {
+            return false;
+        }
+        _usedBytes -= pages(fileSize(to)) * PLV_HOST_FS_PAGE_SIZE;
+    }
+
+    if (_directories) {
+        HostHeapQuiet quiet;
+        std::string parent(to);
+        parent.resize(parent.rfind('/'));
+        makeDirectories(parent.c_str());
+    }
+
+    if (::rename(from, to) != 0) {
+        return false;
+    }
+
+    if (_directories) {
+        removeEmptyParents(pathFrom);
+    }
+
+    return true;
+}
+
+bool FS::mkdir(const char *path) {
+
+    if (!_directories) {
+        return true;
+    }
+
+    char hostpath[PLV_HOST_PATH_SIZE];
+    if (!_mounted || !validPath(path) || !hostPath(hostpath, path)) {
+        return false;
+    }
+
+    HostHeapQuiet quiet;
+    return makeDirectories(hostpath);
+}
+
+bool FS::rmdir(const char *path) {
+
+    if (!_directories) {
+        return true;
+    }
+
+    char hostpath[PLV_HOST_PATH_SIZE];
+    if (!_mounted || !validPath(path) || !hostPath(hostpath, path)) {
+        return false;
+    }
+
+    return ::rmdir(hostpath) == 0;
+}
+
+/**
+ * Host path of a file system path
+ */
+bool FS::hostPath(char *hostpath, const char *path) {
+
+    int length;
+
+    if (_directories) {
+        length = snprintf(hostpath, PLV_HOST_PATH_SIZE, "%s%s%s", _root, path[0] == '/' ? "" : "/", path);
+
+        // Trailing slashes name the same directory
+        while (length > 1 && hostpath[length - 1] == '/') {
+            hostpath[--length] = 0;
+        }
+    } else {
+        HostHeapQuiet quiet;
+        std::string name;
+        escape(name, path);
+        length = snprintf(hostpath, PLV_HOST_PATH_SIZE, "%s/%s", _root, name.c_str());
+    }
+
+    return length > 0 && length < PLV_HOST_PATH_SIZE;
+}
+
+/**
+ * Path accepted by the file system
+ */
+bool FS::validPath(const char *path) {
+
+    if (!path) {
+        return false;
+    }
+
+    if (!_directories) {
+        return path[0] && strlen(path) < PLV_HOST_SPIFFS_NAME_LEN;
+    }
+
+    // Stay inside the root
+    return strstr(path, "..") == NULL;
+}
+
+/**
+ * Sum the pages of every file under a host directory
+ */
+void FS::scanUsage(const char *hostdir) {
+
+    DIR *dir = opendir(hostdir);
+    if (!dir) {
+        return;
+    }
+
+    for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        std::string path = std::string(hostdir) + "/" + entry->d_name;
+
+        if (isDirectory(path.c_str())) {
+            scanUsage(path.c_str());
+        } else {
+            _usedBytes += pages(fileSize(path.c_str())) * PLV_HOST_FS_PAGE_SIZE;
+        }
+    }
+
+    closedir(dir);
+}
+
+/**
+ * LittleFS: remove the directories a remove or rename left empty
+ */
+void FS::removeEmptyParents(const char *path) {
+
+    HostHeapQuiet quiet;
+
+    std::string parent(path);
+
+    for (size_t slash = parent.rfind('/'); slash != std::string::npos && slash > 0; slash = parent.rfind('/')) {
+
+        parent.resize(slash);
+
+        char hostpath[PLV_HOST_PATH_SIZE];
+        if (!hostPath(hostpath, parent.c_str()) || ::rmdir(hostpath) != 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * Pages taken by a file: the object index page and the data pages
+ */
+size_t FS::pages(size_t bytes) {
+    return 1 + (bytes + PLV_HOST_FS_PAGE_SIZE - 1) / PLV_HOST_FS_PAGE_SIZE;
+}
+
+// |------------------------------------------|
+// | File                                     |
+// |------------------------------------------|
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+
+    if (!_p || !_p->fp || !size) {
+        return 0;
+    }
+
+    long position = _p->append ? (long) _p->size : ftell(_p->fp);
+    size_t end = position + size > _p->size ? position + size : _p->size;
+
+    // All or nothing when the file system is full
+    size_t grown = (FS::pages(end) - FS::pages(_p->size)) * PLV_HOST_FS_PAGE_SIZE;
+    if (_p->fs->_usedBytes + grown > _p->fs->_size) {
+        return 0;
+    }
+
+    // Switching from reading to writing needs a seek
+    fseek(_p->fp, position, SEEK_SET);
+
+    size_t written = fwrite(buffer, 1, size, _p->fp);
+    if (written != size) {
+        return 0;
+    }
+
+    _p->fs->_usedBytes += grown;
+    _p->size = end;
+
+    return written;
+}
+
+int File::available() {
+    if (!_p || !_p->fp) {
+        return 0;
+    }
+    return (int) (_p->size - position());
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+
+    if (!_p || !_p->fp) {
+        return -1;
+    }
+
+    long position = ftell(_p->fp);
+    int c = read();
+    fseek(_p->fp, position, SEEK_SET);
+
+    return c;
+}
+
+void File::flush() {
+    if (_p && _p->fp) {
+        fflush(_p->fp);
+    }
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+
+    if (!_p || !_p->fp) {
+        return 0;
+    }
+
+    // Switching from writing to reading needs a seek
+    fseek(_p->fp, 0, SEEK_CUR);
+
+    return fread(buffer, 1, size, _p->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+
+    if (!_p || !_p->fp) {
+        return false;
+    }
+
+    long target = mode == SeekSet ? (long) pos : mode == SeekCur ? ftell(_p->fp) + (long) pos : (long) _p->size + (long) pos;
+
+    // SPIFFS can't seek past the end of the file
+    if (target < 0 || (size_t) target > _p->size) {
+        return false;
+    }
+
+    return fseek(_p->fp, target, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+    return _p && _p->fp ? ftell(_p->fp) : 0;
+}
+
+size_t File::size() const {
+    return _p ? _p->size : 0;
+}
+
+bool File::truncate(uint32_t size) {
+
+    if (!_p || !_p->fp || size > _p->size) {
+        return false;
+    }
+
+    fflush(_p->fp);
+    if (ftruncate(fileno(_p->fp), size) != 0) {
+        return false;
+    }
+
+    _p->fs->_usedBytes -= (FS::pages(_p->size) - FS::pages(size)) * PLV_HOST_FS_PAGE_SIZE;
+    _p->size = size;
+
+    return true;
+}
+
+void File::close() {
+    _p = nullptr;
+}
+
+const char *File::name() const {
+
+    if (!_p) {
+        return "";
+    }
+
+    // LittleFS: the entry name, SPIFFS: the full path
+    if (_p->fs->_directories) {
+        const char *slash = strrchr(_p->path, '/');
+        return slash ? slash + 1 : _p->path;
+    }
+
+    return _p->path;
+}
+
+const char *File::fullName() const {
+    return _p ? _p->path : "";
+}
+
+// |------------------------------------------|
+// | Dir                                      |
+// |------------------------------------------|
+
+bool Dir::next() {
+
+    if (!_p || _p->index + 1 >= (int) _p->entries.size()) {
+        return false;
+    }
+
+    _p->index++;
+
+    return true;
+}
+
+String Dir::fileName() {
+
+    if (!_p || _p->index < 0) {
+        return String();
+    }
+
+    return String(_p->entries[_p->index].name.c_str());
+}
+
+size_t Dir::fileSize() {
+    return _p && _p->index >= 0 ? _p->entries[_p->index].size : 0;
+}
+
+bool Dir::isFile() const {
+    return _p && _p->index >= 0 && !_p->entries[_p->index].directory;
+}
+
+bool Dir::isDirectory() const {
+    return _p && _p->index >= 0 && _p->entries[_p->index].directory;
+}
+
+File Dir::openFile(const char *mode) {
+
+    if (!_p || _p->index < 0) {
+        return File();
+    }
+
+    return _p->fs->open(_p->entries[_p->index].path.c_str(), mode);
+}
+
+} // namespace fs
@@ -0,0 +1,185 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: FS.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: fs::FS backed by a local directory.
+ *
+ * SPIFFS keeps its flat namespace: every file is one host file named after
+ * its full path ('/' escaped as "%2F"), openDir() matches a path prefix and
+ * returns full paths, paths are limited to 31 characters (SPIFFS_OBJ_NAME_LEN).
+ * LittleFS maps to real directories: openDir() lists one level and returns
+ * entry names, open() for writing creates the parent directories and
+ * remove() drops the ones left empty.
+ *
+ * Space is accounted in pages as SPIFFS does (one index page per file plus
+ * its data pages), so a file system fills up near where the station's does.
+ */
+#ifndef FS_h
+#define FS_h
+
+#include <memory>
+
+#include "Arduino.h"
+
+// Host path buffer size
+#define PLV_HOST_PATH_SIZE 512
+
+// SPIFFS_OBJ_NAME_LEN of the core (path length + 1)
+#define PLV_HOST_SPIFFS_NAME_LEN 32
+
+// Default file system size (the 1 MB SPIFFS of a 4 MB board) and page size
+#ifndef PLV_HOST_FS_SIZE
+#define PLV_HOST_FS_SIZE      (1024 * 1024)
+#endif
+
+#ifndef PLV_HOST_FS_PAGE_SIZE
+#define PLV_HOST_FS_PAGE_SIZE 256
+#endif
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+struct FSInfo {
+    size_t totalBytes;
+    size_t usedBytes;
+    size_t blockSize;
+    size_t pageSize;
+    size_t maxOpenFiles;
+    size_t maxPathLength;
+};
+
+class FS;
+struct FileImpl;
+struct DirImpl;
+
+class File : public Stream
+{
+    public:
+        File() {}
+        File(std::shared_ptr<FileImpl> p) : _p(p) {}
+
+        size_t      write(uint8_t c) override;
+        size_t      write(const uint8_t *buffer, size_t size) override;
+        int         available() override;
+        int         read() override;
+        int         peek() override;
+        void        flush() override;
+        size_t      read(uint8_t *buffer, size_t size);
+        size_t      readBytes(char *buffer, size_t length) override { return read((uint8_t *) buffer, length); }
+        bool        seek(uint32_t pos, SeekMode mode);
+        bool        seek(uint32_t pos) { return seek(pos, SeekSet); }
+        size_t      position() const;
+        size_t      size() const;
+        bool        truncate(uint32_t size);
+        void        close();
+        operator    bool() const { return _p != nullptr; }
+        const char *name() const;
+        const char *fullName() const;
+        bool        isFile() const { return _p != nullptr; }
+        bool        isDirectory() const { return false; }
+
+        using Print::write;
+
+    private:
+        std::shared_ptr<FileImpl> _p;
+};
+
+class Dir
+{
+    public:
+        Dir() {}
+        Dir(std::shared_ptr<DirImpl> p) : _p(p) {}
+
+        bool   next();
+        String fileName();
+        size_t fileSize();
+        bool   isFile() const;
+        bool   isDirectory() const;
+        File   openFile(const char *mode);
+
+    private:
+        std::shared_ptr<DirImpl> _p;
+};
+
+class FS
+{
+    public:
+        /**
+         * @param root Host directory holding the files (created by begin())
+         * @param directories false for the flat namespace of SPIFFS, true for LittleFS
+         */
+        FS(const char *root, bool directories);
+
+        /**
+         * Host directory holding the files (unmounts the file system)
+         */
+        void   setRoot(const char *root);
+        const char *root() const { return _root; }
+
+        /**
+         * File system size in bytes (PLV_HOST_FS_SIZE by default)
+         */
+        void   setSize(size_t size) { _size = size; }
+
+        bool   begin();
+        void   end();
+        bool   format();
+        bool   info(FSInfo &info);
+
+        File   open(const char *path, const char *mode);
+        File   open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+        bool   exists(const char *path);
+        bool   exists(const String &path) { return exists(path.c_str()); }
+        Dir    openDir(const char *path);
+        Dir    openDir(const String &path) { return openDir(path.c_str()); }
+        bool   remove(const char *path);
+        bool   remove(const String &path) { return remove(path.c_str()); }
+        bool   rename(const char *pathFrom, const char *pathTo);
+        bool   rename(const String &pathFrom, const String &pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+        bool   mkdir(const char *path);
+        bool   rmdir(const char *path);
+
+    private:
+        char   _root[PLV_HOST_PATH_SIZE];
+        bool   _directories;
+        bool   _mounted;
+        size_t _size;
+        size_t _usedBytes;
+
+        bool   hostPath(char *hostpath, const char *path);
+        bool   validPath(const char *path);
+        void   scanUsage(const char *hostdir);
+        void   removeEmptyParents(const char *path);
+
+        static size_t pages(size_t bytes);
+
+        friend class File;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::Dir;
+using fs::FSInfo;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+extern fs::FS SPIFFS;
+
+#endif
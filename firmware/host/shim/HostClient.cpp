@@ -0,0 +1,179 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: HostClient.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "HostClient.h"
+
+HostClient::HostClient() : _socket(-1), _timeout(5000) {
+}
+
+HostClient::~HostClient() {
+    stop();
+}
+
+int HostClient::connect(IPAddress ip, uint16_t port) {
+
+    stop();
+
+    _socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (_socket < 0) {
+        return 0;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec  = _timeout / 1000;
+    timeout.tv_usec = (_timeout % 1000) * 1000;
+    setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    int one = 1;
+    setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(port);
+    address.sin_addr.s_addr = (uint32_t) ip; // Same byte order as the station (first octet in the low byte)
+
+    if (::connect(_socket, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        stop();
+        return 0;
+    }
+
+    return 1;
+}
+
+int HostClient::connect(const char *host, uint16_t port) {
+
+    IPAddress ip;
+    if (ip.fromString(host)) {
+        return connect(ip, port);
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *result = NULL;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || !result) {
+        return 0;
+    }
+
+    uint32_t address = ((struct sockaddr_in *) result->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(result);
+
+    return connect(IPAddress(address), port);
+}
+
+size_t HostClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HostClient::write(const uint8_t *buffer, size_t size) {
+
+    if (_socket < 0) {
+        return 0;
+    }
+
+    ssize_t written = send(_socket, buffer, size, MSG_NOSIGNAL);
+
+    return written > 0 ? written : 0;
+}
+
+int HostClient::available() {
+
+    if (_socket < 0) {
+        return 0;
+    }
+
+    int count = 0;
+    if (ioctl(_socket, FIONREAD, &count) != 0) {
+        return 0;
+    }
+
+    return count;
+}
+
+int HostClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int HostClient::read(uint8_t *buffer, size_t size) {
+
+    if (_socket < 0 || !available()) {
+        return -1;
+    }
+
+    ssize_t length = recv(_socket, buffer, size, 0);
+
+    return length > 0 ? length : -1;
+}
+
+int HostClient::peek() {
+
+    uint8_t c;
+
+    if (_socket < 0 || !available()) {
+        return -1;
+    }
+
+    return recv(_socket, &c, 1, MSG_PEEK) == 1 ? c : -1;
+}
+
+void HostClient::flush() {
+}
+
+void HostClient::stop() {
+
+    if (_socket >= 0) {
+        close(_socket);
+        _socket = -1;
+    }
+}
+
+/**
+ * Open, or closed by the server with bytes left to read (as on the station)
+ */
+uint8_t HostClient::connected() {
+
+    if (_socket < 0) {
+        return 0;
+    }
+
+    uint8_t c;
+    ssize_t length = recv(_socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+    if (length > 0) {
+        return 1;
+    }
+
+    return length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+HostClient::operator bool() {
+    return connected();
+}
+
+void HostClient::setTimeout(unsigned long timeoutInMillis) {
+    _timeout = timeoutInMillis;
+}
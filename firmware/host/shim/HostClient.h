@@ -0,0 +1,52 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: HostClient.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: Client over a POSIX TCP socket (stands in for WiFiClient, to
+ * run the uploads against the local servers of firmware/tools)
+ */
+#ifndef HostClient_h
+#define HostClient_h
+
+#include "Client.h"
+
+class HostClient : public Client
+{
+    public:
+        HostClient();
+        ~HostClient();
+
+        int     connect(IPAddress ip, uint16_t port) override;
+        int     connect(const char *host, uint16_t port) override;
+        size_t  write(uint8_t c) override;
+        size_t  write(const uint8_t *buffer, size_t size) override;
+        int     available() override;
+        int     read() override;
+        int     read(uint8_t *buffer, size_t size) override;
+        int     peek() override;
+        void    flush() override;
+        void    stop() override;
+        uint8_t connected() override;
+        operator bool() override;
+
+        /**
+         * Bound connect, reads and writes (as WiFiClient::setTimeout)
+         */
+        void    setTimeout(unsigned long timeoutInMillis);
+
+        using Print::write;
+
+    private:
+        int           _socket;
+        unsigned long _timeout;
+};
+
+#endif
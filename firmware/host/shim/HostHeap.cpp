@@ -0,0 +1,135 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: HostHeap.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <new>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostHeap.h"
+
+// Block header, padded to keep the block aligned
+union HostBlock {
+    struct {
+        size_t size;     // Bytes requested
+        bool   counted;  // false if allocated while quiet
+    } info;
+    max_align_t align;
+};
+
+static HostHeapStats stats;
+static int           quiet = 0;
+
+void *hostMalloc(size_t size) {
+
+    HostBlock *block = (HostBlock *) malloc(sizeof(HostBlock) + size);
+    if (!block) {
+        return NULL;
+    }
+
+    block->info.size    = size;
+    block->info.counted = !quiet;
+
+    if (block->info.counted) {
+        stats.allocations++;
+        stats.liveBytes += size;
+        if (stats.liveBytes > stats.peakBytes) {
+            stats.peakBytes = stats.liveBytes;
+        }
+    }
+
+    return block + 1;
+}
+
+void *hostRealloc(void *block, size_t size) {
+
+    if (!block) {
+        return hostMalloc(size);
+    }
+
+    // A new block and a copy, as umm_realloc does when the block can't grow in place
+    void *grown = hostMalloc(size);
+    if (!grown) {
+        return NULL;
+    }
+
+    HostBlock *old = (HostBlock *) block - 1;
+    memcpy(grown, block, old->info.size < size ? old->info.size : size);
+    hostFree(block);
+
+    return grown;
+}
+
+void hostFree(void *block) {
+
+    if (!block) {
+        return;
+    }
+
+    HostBlock *header = (HostBlock *) block - 1;
+
+    if (header->info.counted) {
+        stats.frees++;
+        stats.liveBytes -= header->info.size;
+    }
+
+    free(header);
+}
+
+const HostHeapStats &hostHeapStats() {
+    return stats;
+}
+
+void hostHeapReset() {
+    stats.allocations = 0;
+    stats.frees       = 0;
+    stats.peakBytes   = stats.liveBytes;
+}
+
+HostHeapQuiet::HostHeapQuiet() {
+    quiet++;
+}
+
+HostHeapQuiet::~HostHeapQuiet() {
+    quiet--;
+}
+
+// Every new/delete of the program goes through the counted heap
+void *operator new(size_t size) {
+
+    void *block = hostMalloc(size ? size : 1);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+
+    return block;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *block) noexcept {
+    hostFree(block);
+}
+
+void operator delete[](void *block) noexcept {
+    hostFree(block);
+}
+
+void operator delete(void *block, size_t) noexcept {
+    hostFree(block);
+}
+
+void operator delete[](void *block, size_t) noexcept {
+    hostFree(block);
+}
@@ -0,0 +1,63 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: HostHeap.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: heap accounting. Every operator new and every String buffer
+ * goes through hostMalloc(), so the tests and benchmarks can count the
+ * allocations of a call and ESP.getFreeHeap() behaves as on the station.
+ */
+#ifndef HostHeap_h
+#define HostHeap_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Heap of the emulated station (ESP.getFreeHeap() = size - live bytes)
+#ifndef PLV_HOST_HEAP_SIZE
+#define PLV_HOST_HEAP_SIZE 45000
+#endif
+
+/**
+ * Heap counters
+ */
+struct HostHeapStats {
+    unsigned long allocations;  // Blocks allocated
+    unsigned long frees;        // Blocks freed
+    unsigned long liveBytes;    // Bytes currently allocated
+    unsigned long peakBytes;    // Highest liveBytes since the last reset
+};
+
+void                *hostMalloc(size_t size);
+void                *hostRealloc(void *block, size_t size);
+void                 hostFree(void *block);
+
+/**
+ * @return the heap counters
+ */
+const HostHeapStats &hostHeapStats();
+
+/**
+ * Reset the allocation counters and the peak (the live bytes stay)
+ */
+void                 hostHeapReset();
+
+/**
+ * Allocations made while an instance is alive are not counted (for the
+ * bookkeeping of the shim itself, which the station doesn't have)
+ */
+class HostHeapQuiet
+{
+    public:
+        HostHeapQuiet();
+        ~HostHeapQuiet();
+};
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: HostUDP.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "HostUDP.h"
+
+HostUDP::HostUDP()
+    : _socket(-1), _destinationPort(0), _outLength(0), _outOverflow(false),
+      _remotePort(0), _inLength(0), _inPos(0) {
+}
+
+HostUDP::~HostUDP() {
+    stop();
+}
+
+/**
+ * @param port Local port (0: any free port)
+ * @return 1 if the socket is open
+ */
+uint8_t HostUDP::begin(uint16_t port) {
+
+    stop();
+
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_socket < 0) {
+        return 0;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(_socket, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL) | O_NONBLOCK) != 0) {
+        stop();
+        return 0;
+    }
+
+    return 1;
+}
+
+void HostUDP::stop() {
+
+    if (_socket >= 0) {
+        close(_socket);
+        _socket = -1;
+    }
+
+    _inLength = _inPos = 0;
+}
+
+int HostUDP::beginPacket(IPAddress ip, uint16_t port) {
+
+    _destination     = ip;
+    _destinationPort = port;
+    _outLength       = 0;
+    _outOverflow     = false;
+
+    return _socket >= 0;
+}
+
+int HostUDP::beginPacket(const char *host, uint16_t port) {
+
+    IPAddress ip;
+    if (ip.fromString(host)) {
+        return beginPacket(ip, port);
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo *result = NULL;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || !result) {
+        return 0;
+    }
+
+    uint32_t address = ((struct sockaddr_in *) result->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(result);
+
+    return beginPacket(IPAddress(address), port);
+}
+
+/**
+ * Send the datagram written since beginPacket()
+ *
+ * @return 1 if sent
+ */
+int HostUDP::endPacket() {
+
+    if (_socket < 0 || _outOverflow) {
+        return 0;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(_destinationPort);
+    address.sin_addr.s_addr = (uint32_t) _destination; // Same byte order as the station (first octet in the low byte)
+
+    ssize_t sent = sendto(_socket, _out, _outLength, 0, (struct sockaddr *) &address, sizeof(address));
+    _outLength = 0;
+
+    return sent >= 0;
+}
+
+size_t HostUDP::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HostUDP::write(const uint8_t *buffer, size_t size) {
+
+    if (_outLength + size > sizeof(_out)) {
+        _outOverflow = true;
+        return 0;
+    }
+
+    memcpy(_out + _outLength, buffer, size);
+    _outLength += size;
+
+    return size;
+}
+
+/**
+ * Receive the next datagram (never waits)
+ *
+ * @return Datagram size, 0 if none arrived
+ */
+int HostUDP::parsePacket() {
+
+    _inLength = _inPos = 0;
+
+    if (_socket < 0) {
+        return 0;
+    }
+
+    struct sockaddr_in address;
+    socklen_t          size = sizeof(address);
+
+    ssize_t length = recvfrom(_socket, _in, sizeof(_in), 0, (struct sockaddr *) &address, &size);
+    if (length <= 0) {
+        return 0;
+    }
+
+    _remote     = IPAddress((uint32_t) address.sin_addr.s_addr);
+    _remotePort = ntohs(address.sin_port);
+    _inLength   = length;
+
+    return length;
+}
+
+int HostUDP::available() {
+    return _inLength - _inPos;
+}
+
+int HostUDP::read() {
+    return _inPos < _inLength ? _in[_inPos++] : -1;
+}
+
+int HostUDP::read(unsigned char *buffer, size_t len) {
+
+    size_t length = min(len, _inLength - _inPos);
+
+    memcpy(buffer, _in + _inPos, length);
+    _inPos += length;
+
+    return length;
+}
+
+int HostUDP::read(char *buffer, size_t len) {
+    return read((unsigned char *) buffer, len);
+}
+
+int HostUDP::peek() {
+    return _inPos < _inLength ? _in[_inPos] : -1;
+}
+
+/**
+ * Drop the rest of the received datagram
+ */
+void HostUDP::flush() {
+    _inPos = _inLength;
+}
+
+IPAddress HostUDP::remoteIP() {
+    return _remote;
+}
+
+uint16_t HostUDP::remotePort() {
+    return _remotePort;
+}
@@ -0,0 +1,65 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: HostUDP.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: UDP over a non blocking POSIX socket (stands in for WiFiUDP,
+ * to run PluviOnUDPLink against the local servers of firmware/tools)
+ */
+#ifndef HostUDP_h
+#define HostUDP_h
+
+#include "Udp.h"
+
+// Largest datagram sent or received
+#define HOST_UDP_PACKET_SIZE 1472
+
+class HostUDP : public UDP
+{
+    public:
+        HostUDP();
+        ~HostUDP();
+
+        uint8_t begin(uint16_t port) override;
+        void    stop() override;
+        int     beginPacket(IPAddress ip, uint16_t port) override;
+        int     beginPacket(const char *host, uint16_t port) override;
+        int     endPacket() override;
+        size_t  write(uint8_t c) override;
+        size_t  write(const uint8_t *buffer, size_t size) override;
+        int     parsePacket() override;
+        int     available() override;
+        int     read() override;
+        int     read(unsigned char *buffer, size_t len) override;
+        int     read(char *buffer, size_t len) override;
+        int     peek() override;
+        void    flush() override;
+        IPAddress remoteIP() override;
+        uint16_t  remotePort() override;
+
+        using Print::write;
+
+    private:
+        int       _socket;
+
+        IPAddress _destination;
+        uint16_t  _destinationPort;
+        uint8_t   _out[HOST_UDP_PACKET_SIZE];
+        size_t    _outLength;
+        boolean   _outOverflow;
+
+        IPAddress _remote;
+        uint16_t  _remotePort;
+        uint8_t   _in[HOST_UDP_PACKET_SIZE];
+        size_t    _inLength;
+        size_t    _inPos;
+};
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: IPAddress.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: Arduino IPAddress
+ */
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "WString.h"
+
+class IPAddress
+{
+    public:
+        IPAddress() : _address(0) {}
+        IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address(a | (b << 8) | (c << 16) | ((uint32_t) d << 24)) {}
+        IPAddress(uint32_t address) : _address(address) {}
+
+        operator uint32_t() const { return _address; }
+        uint8_t operator[](int index) const { return (_address >> (8 * index)) & 0xFF; }
+
+        bool fromString(const char *address) {
+            unsigned int a, b, c, d;
+            char end;
+            if (sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+                return false;
+            }
+            *this = IPAddress(a, b, c, d);
+            return true;
+        }
+
+        String toString() const {
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+            return String(buf);
+        }
+
+    private:
+        uint32_t _address;
+};
+
+#endif
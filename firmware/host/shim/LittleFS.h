@@ -0,0 +1,22 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: LittleFS.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: LittleFS (see FS.h)
+ */
+#ifndef LittleFS_h
+#define LittleFS_h
+
+#include "FS.h"
+
+extern fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: Print.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "Arduino.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+
+    return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+
+    char line[256];
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return 0;
+    }
+
+    return write((const uint8_t *) line, (size_t) length < sizeof(line) ? length : sizeof(line) - 1);
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+    return write((const char *) str);
+}
+
+size_t Print::print(const String &str) {
+    return write((const uint8_t *) str.c_str(), str.length());
+}
+
+size_t Print::print(const char *str) {
+    return write(str);
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t) c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+    return print((unsigned long) value, base);
+}
+
+size_t Print::print(int value, int base) {
+    return print((long) value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return print((unsigned long) value, base);
+}
+
+size_t Print::print(long value, int base) {
+
+    if (base == 0) {
+        return write((uint8_t) value);
+    }
+
+    if (base == 10 && value < 0) {
+        return print('-') + printNumber(-(unsigned long) value, 10);
+    }
+
+    return printNumber(value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+
+    if (base == 0) {
+        return write((uint8_t) value);
+    }
+
+    return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+    return printFloat(value, digits);
+}
+
+size_t Print::println(const __FlashStringHelper *str) {
+    return print(str) + println();
+}
+
+size_t Print::println(const String &str) {
+    return print(str) + println();
+}
+
+size_t Print::println(const char *str) {
+    return print(str) + println();
+}
+
+size_t Print::println(char c) {
+    return print(c) + println();
+}
+
+size_t Print::println(unsigned char value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(int value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(unsigned int value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(double value, int digits) {
+    return print(value, digits) + println();
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::printNumber(unsigned long value, uint8_t base) {
+
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+
+    *str = '\0';
+
+    if (base < 2) {
+        base = 10;
+    }
+
+    do {
+        char c = value % base;
+        value /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (value);
+
+    return write(str);
+}
+
+size_t Print::printFloat(double value, uint8_t digits) {
+
+    if (isnan(value)) {
+        return print("nan");
+    }
+
+    if (isinf(value)) {
+        return print("inf");
+    }
+
+    if (value > 4294967040.0 || value < -4294967040.0) {
+        return print("ovf");
+    }
+
+    size_t n = 0;
+
+    if (value < 0.0) {
+        n += print('-');
+        value = -value;
+    }
+
+    // Round correctly so that print(1.999, 2) prints as "2.00"
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i) {
+        rounding /= 10.0;
+    }
+
+    value += rounding;
+
+    unsigned long integer = (unsigned long) value;
+    double remainder = value - (double) integer;
+    n += print(integer);
+
+    if (digits > 0) {
+        n += print('.');
+    }
+
+    while (digits-- > 0) {
+        remainder *= 10.0;
+        int digit = (int) remainder;
+        n += print(digit);
+        remainder -= digit;
+    }
+
+    return n;
+}
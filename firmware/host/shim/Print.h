@@ -0,0 +1,70 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: Print.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: Arduino Print
+ */
+#ifndef Print_h
+#define Print_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print
+{
+    public:
+        virtual ~Print() {}
+
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        size_t         write(const char *str) { return str ? write((const uint8_t *) str, strlen(str)) : 0; }
+        size_t         write(const char *buffer, size_t size) { return write((const uint8_t *) buffer, size); }
+        virtual void   flush() {}
+
+        size_t         printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+
+        size_t         print(const __FlashStringHelper *str);
+        size_t         print(const String &str);
+        size_t         print(const char *str);
+        size_t         print(char c);
+        size_t         print(unsigned char value, int base = DEC);
+        size_t         print(int value, int base = DEC);
+        size_t         print(unsigned int value, int base = DEC);
+        size_t         print(long value, int base = DEC);
+        size_t         print(unsigned long value, int base = DEC);
+        size_t         print(double value, int digits = 2);
+
+        size_t         println(const __FlashStringHelper *str);
+        size_t         println(const String &str);
+        size_t         println(const char *str);
+        size_t         println(char c);
+        size_t         println(unsigned char value, int base = DEC);
+        size_t         println(int value, int base = DEC);
+        size_t         println(unsigned int value, int base = DEC);
+        size_t         println(long value, int base = DEC);
+        size_t         println(unsigned long value, int base = DEC);
+        size_t         println(double value, int digits = 2);
+        size_t         println();
+
+    private:
+        size_t         printNumber(unsigned long value, uint8_t base);
+        size_t         printFloat(double value, uint8_t digits);
+};
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: Stream.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: Arduino Stream
+ */
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+class Stream : public Print
+{
+    public:
+        Stream() : _timeout(1000) {}
+
+        virtual int    available() = 0;
+        virtual int    read() = 0;
+        virtual int    peek() = 0;
+
+        void           setTimeout(unsigned long timeout) { _timeout = timeout; }
+        unsigned long  getTimeout() const { return _timeout; }
+
+        virtual size_t readBytes(char *buffer, size_t length);
+        size_t         readBytes(uint8_t *buffer, size_t length) { return readBytes((char *) buffer, length); }
+        size_t         readBytesUntil(char terminator, char *buffer, size_t length);
+        String         readString();
+        String         readStringUntil(char terminator);
+
+    protected:
+        unsigned long  _timeout;
+
+        int            timedRead();
+};
+
+#endif
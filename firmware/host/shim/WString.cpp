@@ -0,0 +1,519 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: WString.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "HostHeap.h"
+
+String::String(const char *cstr) : _buffer(NULL), _capacity(0), _length(0) {
+    if (cstr) {
+        copy(cstr, strlen(cstr));
+    }
+}
+
+String::String(const String &str) : _buffer(NULL), _capacity(0), _length(0) {
+    *this = str;
+}
+
+String::String(String &&str) : _buffer(NULL), _capacity(0), _length(0) {
+    move(str);
+}
+
+String::String(const __FlashStringHelper *str) : _buffer(NULL), _capacity(0), _length(0) {
+    *this = str;
+}
+
+String::String(char c) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[2] = { c, 0 };
+    *this = buf;
+}
+
+String::String(unsigned char value, unsigned char base) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[1 + 8 * sizeof(unsigned char)];
+    *this = utoa(value, buf, base);
+}
+
+String::String(int value, unsigned char base) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[2 + 8 * sizeof(int)];
+    *this = base == 10 ? itoa(value, buf, base) : utoa((unsigned int) value, buf, base);
+}
+
+String::String(unsigned int value, unsigned char base) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[1 + 8 * sizeof(unsigned int)];
+    *this = utoa(value, buf, base);
+}
+
+String::String(long value, unsigned char base) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[2 + 8 * sizeof(long)];
+    *this = base == 10 ? ltoa(value, buf, base) : ultoa((unsigned long) value, buf, base);
+}
+
+String::String(unsigned long value, unsigned char base) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[1 + 8 * sizeof(unsigned long)];
+    *this = ultoa(value, buf, base);
+}
+
+String::String(float value, unsigned char decimalPlaces) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[33];
+    *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+}
+
+String::String(double value, unsigned char decimalPlaces) : _buffer(NULL), _capacity(0), _length(0) {
+    char buf[33];
+    *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
+}
+
+String::~String() {
+    hostFree(_buffer);
+}
+
+void String::invalidate() {
+    hostFree(_buffer);
+    _buffer   = NULL;
+    _capacity = 0;
+    _length   = 0;
+}
+
+bool String::reserve(unsigned int size) {
+
+    if (_buffer && _capacity >= size) {
+        return true;
+    }
+
+    if (changeBuffer(size)) {
+        if (_length == 0) {
+            _buffer[0] = 0;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool String::changeBuffer(unsigned int size) {
+
+    char *buffer = (char *) hostRealloc(_buffer, size + 1);
+    if (!buffer) {
+        return false;
+    }
+
+    _buffer   = buffer;
+    _capacity = size;
+
+    return true;
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+
+    if (!reserve(length)) {
+        invalidate();
+        return *this;
+    }
+
+    _length = length;
+    memmove(_buffer, cstr, length);
+    _buffer[length] = 0;
+
+    return *this;
+}
+
+void String::move(String &rhs) {
+
+    if (this == &rhs) {
+        return;
+    }
+
+    hostFree(_buffer);
+
+    _buffer   = rhs._buffer;
+    _capacity = rhs._capacity;
+    _length   = rhs._length;
+
+    rhs._buffer   = NULL;
+    rhs._capacity = 0;
+    rhs._length   = 0;
+}
+
+String &String::operator=(const String &rhs) {
+
+    if (this == &rhs) {
+        return *this;
+    }
+
+    if (rhs._buffer) {
+        copy(rhs._buffer, rhs._length);
+    } else {
+        invalidate();
+    }
+
+    return *this;
+}
+
+String &String::operator=(String &&rhs) {
+    move(rhs);
+    return *this;
+}
+
+String &String::operator=(const char *cstr) {
+
+    if (cstr) {
+        copy(cstr, strlen(cstr));
+    } else {
+        invalidate();
+    }
+
+    return *this;
+}
+
+String &String::operator=(const __FlashStringHelper *str) {
+    return *this = (const char *) str;
+}
+
+bool String::concat(const char *cstr, unsigned int length) {
+
+    if (!cstr) {
+        return false;
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    unsigned int newLength = _length + length;
+
+    // Grow as the core does: to the exact size needed
+    if (!reserve(newLength)) {
+        return false;
+    }
+
+    memmove(_buffer + _length, cstr, length);
+    _length = newLength;
+    _buffer[_length] = 0;
+
+    return true;
+}
+
+bool String::concat(const String &str) {
+    // Concatenating a string to itself: copy first
+    if (&str == this) {
+        String copy(str);
+        return concat(copy._buffer, copy._length);
+    }
+    return concat(str.c_str(), str._length);
+}
+
+bool String::concat(const char *cstr) {
+    return cstr ? concat(cstr, strlen(cstr)) : false;
+}
+
+bool String::concat(const __FlashStringHelper *str) {
+    return concat((const char *) str);
+}
+
+bool String::concat(char c) {
+    return concat(&c, 1);
+}
+
+bool String::concat(unsigned char value) {
+    char buf[1 + 3 * sizeof(unsigned char)];
+    return concat(utoa(value, buf, 10));
+}
+
+bool String::concat(int value) {
+    char buf[2 + 3 * sizeof(int)];
+    return concat(itoa(value, buf, 10));
+}
+
+bool String::concat(unsigned int value) {
+    char buf[1 + 3 * sizeof(unsigned int)];
+    return concat(utoa(value, buf, 10));
+}
+
+bool String::concat(long value) {
+    char buf[2 + 3 * sizeof(long)];
+    return concat(ltoa(value, buf, 10));
+}
+
+bool String::concat(unsigned long value) {
+    char buf[1 + 3 * sizeof(unsigned long)];
+    return concat(ultoa(value, buf, 10));
+}
+
+bool String::concat(float value) {
+    char buf[20];
+    return concat(dtostrf(value, 4, 2, buf));
+}
+
+bool String::concat(double value) {
+    char buf[20];
+    return concat(dtostrf(value, 4, 2, buf));
+}
+
+int String::compareTo(const String &s) const {
+    return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const String &s) const {
+    return _length == s._length && compareTo(s) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+    return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+    return _length == s._length && strcasecmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+    if (offset > _length || prefix._length > _length - offset) {
+        return false;
+    }
+    return strncmp(c_str() + offset, prefix.c_str(), prefix._length) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    if (suffix._length > _length) {
+        return false;
+    }
+    return strcmp(c_str() + _length - suffix._length, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+    return operator[](index);
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < _length) {
+        _buffer[index] = c;
+    }
+}
+
+char String::operator[](unsigned int index) const {
+    return index < _length ? _buffer[index] : 0;
+}
+
+char &String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _length) {
+        dummy = 0;
+        return dummy;
+    }
+    return _buffer[index];
+}
+
+void String::toCharArray(char *buf, unsigned int bufsize, unsigned int index) const {
+
+    if (!bufsize || !buf) {
+        return;
+    }
+
+    if (index >= _length) {
+        buf[0] = 0;
+        return;
+    }
+
+    unsigned int n = bufsize - 1;
+    if (n > _length - index) {
+        n = _length - index;
+    }
+
+    strncpy(buf, c_str() + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+
+    if (fromIndex >= _length) {
+        return -1;
+    }
+
+    const char *found = strchr(c_str() + fromIndex, ch);
+    return found ? found - c_str() : -1;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+
+    if (fromIndex >= _length) {
+        return -1;
+    }
+
+    const char *found = strstr(c_str() + fromIndex, str.c_str());
+    return found ? found - c_str() : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+    const char *found = strrchr(c_str(), ch);
+    return found ? found - c_str() : -1;
+}
+
+int String::lastIndexOf(const String &str) const {
+
+    int found = -1;
+    for (int i = indexOf(str); i >= 0; i = indexOf(str, i + 1)) {
+        found = i;
+    }
+
+    return found;
+}
+
+String String::substring(unsigned int beginIndex) const {
+    return substring(beginIndex, _length);
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+
+    if (beginIndex > endIndex) {
+        unsigned int swap = endIndex;
+        endIndex   = beginIndex;
+        beginIndex = swap;
+    }
+
+    String out;
+
+    if (beginIndex >= _length) {
+        return out;
+    }
+
+    if (endIndex > _length) {
+        endIndex = _length;
+    }
+
+    out.copy(c_str() + beginIndex, endIndex - beginIndex);
+
+    return out;
+}
+
+void String::replace(char find, char replace) {
+    for (unsigned int i = 0; i < _length; i++) {
+        if (_buffer[i] == find) {
+            _buffer[i] = replace;
+        }
+    }
+}
+
+void String::replace(const String &find, const String &replace) {
+
+    if (!_length || !find._length) {
+        return;
+    }
+
+    String out;
+    unsigned int from = 0;
+
+    for (int i = indexOf(find); i >= 0; i = indexOf(find, from)) {
+        out.concat(c_str() + from, i - from);
+        out.concat(replace);
+        from = i + find._length;
+    }
+
+    out.concat(c_str() + from, _length - from);
+    move(out);
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int) -1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+
+    if (index >= _length) {
+        return;
+    }
+
+    if (count > _length - index) {
+        count = _length - index;
+    }
+
+    memmove(_buffer + index, _buffer + index + count, _length - index - count);
+    _length -= count;
+    _buffer[_length] = 0;
+}
+
+void String::toLowerCase() {
+    for (unsigned int i = 0; i < _length; i++) {
+        _buffer[i] = tolower((unsigned char) _buffer[i]);
+    }
+}
+
+void String::toUpperCase() {
+    for (unsigned int i = 0; i < _length; i++) {
+        _buffer[i] = toupper((unsigned char) _buffer[i]);
+    }
+}
+
+void String::trim() {
+
+    if (!_length) {
+        return;
+    }
+
+    unsigned int first = 0;
+    while (first < _length && isspace((unsigned char) _buffer[first])) {
+        first++;
+    }
+
+    unsigned int last = _length;
+    while (last > first && isspace((unsigned char) _buffer[last - 1])) {
+        last--;
+    }
+
+    _length = last - first;
+    if (first) {
+        memmove(_buffer, _buffer + first, _length);
+    }
+    _buffer[_length] = 0;
+}
+
+long String::toInt() const {
+    return atol(c_str());
+}
+
+float String::toFloat() const {
+    return atof(c_str());
+}
+
+double String::toDouble() const {
+    return atof(c_str());
+}
+
+String operator+(const String &lhs, const String &rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
+
+String operator+(const String &lhs, char rhs) {
+    String out(lhs);
+    out.concat(rhs);
+    return out;
+}
@@ -0,0 +1,127 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: WString.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: Arduino String. The buffer lives on the counted heap (see
+ * HostHeap.h) and grows as in the core, without the small string
+ * optimization, so the host counts at least the allocations of the station.
+ */
+#ifndef WString_h
+#define WString_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+
+class String
+{
+    public:
+        String(const char *cstr = "");
+        String(const String &str);
+        String(String &&str);
+        String(const __FlashStringHelper *str);
+        explicit String(char c);
+        explicit String(unsigned char value, unsigned char base = 10);
+        explicit String(int value, unsigned char base = 10);
+        explicit String(unsigned int value, unsigned char base = 10);
+        explicit String(long value, unsigned char base = 10);
+        explicit String(unsigned long value, unsigned char base = 10);
+        explicit String(float value, unsigned char decimalPlaces = 2);
+        explicit String(double value, unsigned char decimalPlaces = 2);
+        ~String();
+
+        bool           reserve(unsigned int size);
+        unsigned int   length() const { return _length; }
+        bool           isEmpty() const { return _length == 0; }
+        const char    *c_str() const { return _buffer ? _buffer : ""; }
+        char          *begin() { return _buffer; }
+        char          *end() { return _buffer + _length; }
+
+        String        &operator=(const String &rhs);
+        String        &operator=(String &&rhs);
+        String        &operator=(const char *cstr);
+        String        &operator=(const __FlashStringHelper *str);
+
+        bool           concat(const String &str);
+        bool           concat(const char *cstr);
+        bool           concat(const char *cstr, unsigned int length);
+        bool           concat(const __FlashStringHelper *str);
+        bool           concat(char c);
+        bool           concat(unsigned char value);
+        bool           concat(int value);
+        bool           concat(unsigned int value);
+        bool           concat(long value);
+        bool           concat(unsigned long value);
+        bool           concat(float value);
+        bool           concat(double value);
+
+        template <typename T>
+        String        &operator+=(const T &rhs) { concat(rhs); return *this; }
+
+        int            compareTo(const String &s) const;
+        bool           equals(const String &s) const;
+        bool           equals(const char *cstr) const;
+        bool           equalsIgnoreCase(const String &s) const;
+        bool           operator==(const String &rhs) const { return equals(rhs); }
+        bool           operator==(const char *cstr) const { return equals(cstr); }
+        bool           operator!=(const String &rhs) const { return !equals(rhs); }
+        bool           operator!=(const char *cstr) const { return !equals(cstr); }
+        bool           operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+        bool           operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+        bool           startsWith(const String &prefix) const;
+        bool           startsWith(const String &prefix, unsigned int offset) const;
+        bool           endsWith(const String &suffix) const;
+
+        char           charAt(unsigned int index) const;
+        void           setCharAt(unsigned int index, char c);
+        char           operator[](unsigned int index) const;
+        char          &operator[](unsigned int index);
+        void           toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const;
+
+        int            indexOf(char ch, unsigned int fromIndex = 0) const;
+        int            indexOf(const String &str, unsigned int fromIndex = 0) const;
+        int            lastIndexOf(char ch) const;
+        int            lastIndexOf(const String &str) const;
+        String         substring(unsigned int beginIndex) const;
+        String         substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+        void           replace(char find, char replace);
+        void           replace(const String &find, const String &replace);
+        void           remove(unsigned int index);
+        void           remove(unsigned int index, unsigned int count);
+        void           toLowerCase();
+        void           toUpperCase();
+        void           trim();
+
+        long           toInt() const;
+        float          toFloat() const;
+        double         toDouble() const;
+
+    private:
+        char          *_buffer;
+        unsigned int   _capacity;
+        unsigned int   _length;
+
+        void           invalidate();
+        bool           changeBuffer(unsigned int size);
+        String        &copy(const char *cstr, unsigned int length);
+        void           move(String &rhs);
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: main.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: runs a sketch (setup() once, then loop() PLV_HOST_LOOPS times,
+ * 1 by default, as the examples do their work in setup())
+ */
+#include "Arduino.h"
+
+void setup();
+void loop();
+
+int main() {
+
+    const char *loops = getenv("PLV_HOST_LOOPS");
+    long count = loops ? atol(loops) : 1;
+
+    setup();
+
+    for (long i = 0; i < count; i++) {
+        loop();
+    }
+
+    Serial.flush();
+
+    return 0;
+}
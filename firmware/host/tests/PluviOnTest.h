@@ -0,0 +1,139 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: PluviOnTest.h
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Host build: minimal test runner. Every PLV_TEST runs on an empty file
+ * system (a directory named after the test), a failed PLV_CHECK stops the
+ * test and the runner exits with the number of failed tests.
+ *
+ *     PLV_TEST(appendAndRead) {
+ *         PLV_CHECK(log.begin());
+ *         PLV_CHECK_EQUAL(1UL, log.append("a", 1));
+ *     }
+ *
+ *     PLV_TEST_MAIN()
+ */
+#ifndef PluviOnTest_h
+#define PluviOnTest_h
+
+#include <FS.h> // FS must be the first
+
+#include <PluviOn.h>
+#include "HostHeap.h"
+
+typedef void (*PluviOnTestFunction)();
+
+struct PluviOnTestCase {
+    const char          *name;
+    PluviOnTestFunction  function;
+    PluviOnTestCase     *next;
+};
+
+class PluviOnTest
+{
+    public:
+        static PluviOnTestCase *&cases() {
+            static PluviOnTestCase *head = NULL;
+            return head;
+        }
+
+        static boolean &failed() {
+            static boolean value = false;
+            return value;
+        }
+
+        static PluviOnTestCase *add(PluviOnTestCase *test) {
+            PluviOnTestCase **tail = &cases();
+            while (*tail) {
+                tail = &(*tail)->next;
+            }
+            *tail = test;
+            return test;
+        }
+
+        /**
+         * Empty file system, freshly formatted and mounted
+         */
+        static void freshFS(const char *name) {
+            PluviOn::end();
+            PLV_FS.setRoot(name);
+            PLV_FS.setSize(PLV_HOST_FS_SIZE);
+            PLV_FS.format();
+            PluviOn::begin();
+        }
+
+        /**
+         * Reset: unmount, so the next PluviOn::begin() reloads the storage epoch
+         */
+        static void reboot() {
+            PluviOn::end();
+        }
+
+        static int run(const char *filter) {
+
+            int failures = 0;
+            int count    = 0;
+
+            for (PluviOnTestCase *test = cases(); test; test = test->next) {
+
+                if (filter && !strstr(test->name, filter)) {
+                    continue;
+                }
+
+                freshFS(test->name);
+                failed() = false;
+                count++;
+
+                test->function();
+
+                printf("%s %s\n", failed() ? "FAIL" : "ok  ", test->name);
+                if (failed()) {
+                    failures++;
+                }
+            }
+
+            printf("%d tests, %d failures\n", count, failures);
+
+            return failures;
+        }
+};
+
+#define PLV_TEST(name) \
+    static void name(); \
+    static PluviOnTestCase name##Case = { #name, name, NULL }; \
+    static PluviOnTestCase *name##Added __attribute__((unused)) = PluviOnTest::add(&name##Case); \
+    static void name()
+
+#define PLV_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: PLV_CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            PluviOnTest::failed() = true; \
+            return; \
+        } \
+    } while (0)
+
+#define PLV_CHECK_EQUAL(expected, actual) \
+    do { \
+        if (!((expected) == (actual))) { \
+            printf("%s:%d: PLV_CHECK_EQUAL(%s, %s) failed\n", __FILE__, __LINE__, #expected, #actual); \
+            PluviOnTest::failed() = true; \
+            return; \
+        } \
+    } while (0)
+
+// Runs every test, or the ones whose name contains the first argument
+#define PLV_TEST_MAIN() \
+    int main(int argc, char **argv) { \
+        return PluviOnTest::run(argc > 1 ? argv[1] : NULL) ? 1 : 0; \
+    }
+
+#endif
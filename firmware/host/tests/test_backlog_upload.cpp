@@ -0,0 +1,246 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_backlog_upload.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * Backlog upload of the WiFi firmware: PluviOnDirSource streamed by
+ * PluviOnUploader (PLV_UPLOAD_LINE) to firmware/tools/pluvion_tcp_server.py,
+ * over a real TCP connection. Needs python3 (PLV_TEST_PYTHON3, PLV_TEST_TOOLS_DIR).
+ */
+#include "PluviOnTest.h"
+#include <PluviOnDirSource.h>
+#include <PluviOnUploader.h>
+#include "HostClient.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#define TEST_DATA_DIR         "/data"
+#define TEST_RECORDS_PER_FILE 100
+#define TEST_SAVED_UPLOAD     "upload.txt"
+
+/**
+ * Backlog as the WiFi firmware leaves it: files of TEST_RECORDS_PER_FILE
+ * messages, the last one of every file without its '\n'
+ *
+ * @return Bytes the server must receive
+ */
+static std::string writeBacklog(unsigned long records) {
+
+    std::string expected;
+    char        filepath[PLV_FS_PATH_SIZE];
+    char        line[64];
+
+    for (unsigned long first = 0; first < records; first += TEST_RECORDS_PER_FILE) {
+
+        snprintf(filepath, sizeof(filepath), TEST_DATA_DIR "/%05lu", first / TEST_RECORDS_PER_FILE);
+        File f = PluviOn::FSOpen(filepath, "w");
+
+        for (unsigned long i = first; i < records && i < first + TEST_RECORDS_PER_FILE; i++) {
+
+            int length = snprintf(line, sizeof(line), "%lu,%lu,23.50,65.00,1013.25,%lu",
+                                  1539871200UL + i * 60, i, i % 7);
+            boolean last = (i + 1 == records || i + 1 == first + TEST_RECORDS_PER_FILE);
+
+            f.write((const uint8_t *) line, length);
+            if (!last) {
+                f.write('\n');
+            }
+
+            expected.append(line, length);
+            expected += '\n';
+        }
+
+        f.close();
+    }
+
+    return expected;
+}
+
+/**
+ * Start the server on a free port (--once: it exits after the upload)
+ *
+ * @return The server pipe, NULL if it didn't start
+ */
+static FILE *startServer(uint16_t &port) {
+
+    char command[512];
+    snprintf(command, sizeof(command),
+             "%s %s/pluvion_tcp_server.py --bind 127.0.0.1 --port 0 --once --idle 0.5 --reply ok --save %s",
+             PLV_TEST_PYTHON3, PLV_TEST_TOOLS_DIR, TEST_SAVED_UPLOAD);
+
+    FILE *server = popen(command, "r");
+    if (!server) {
+        return NULL;
+    }
+
+    // "listening on 127.0.0.1:PORT/tcp"
+    char     line[128];
+    unsigned value = 0;
+    if (!fgets(line, sizeof(line), server) || sscanf(line, "listening on 127.0.0.1:%u/tcp", &value) != 1) {
+        pclose(server);
+        return NULL;
+    }
+
+    port = value;
+
+    return server;
+}
+
+static std::string readSavedUpload() {
+
+    std::string content;
+
+    FILE *f = fopen(TEST_SAVED_UPLOAD, "rb");
+    if (!f) {
+        return content;
+    }
+
+    char   buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        content.append(buffer, length);
+    }
+
+    fclose(f);
+
+    return content;
+}
+
+struct BacklogUpload {
+    PluviOnUploadState state;
+    std::string        response;
+    unsigned long      bytesSent;
+    unsigned long      files;
+    unsigned long      heapUsed;    // Peak bytes above the heap in use before the upload
+    std::string        received;
+};
+
+/**
+ * Drain the backlog to the server, one step per loop() as the firmware does
+ */
+static boolean uploadBacklog(BacklogUpload &result) {
+
+    uint16_t port;
+    FILE *server = startServer(port);
+    if (!server) {
+        return false;
+    }
+
+    HostClient       client;
+    PluviOnUploader  uploader(client);
+    PluviOnDirSource source;
+
+    hostHeapReset();
+    unsigned long heapBefore = hostHeapStats().liveBytes;
+
+    source.begin(TEST_DATA_DIR);
+    if (!uploader.start("127.0.0.1", port, PLV_UPLOAD_LINE, NULL, 0, PluviOnDirSource::source, &source)) {
+        pclose(server);
+        return false;
+    }
+
+    PluviOnUploadState state;
+    do {
+        state = uploader.step();
+    } while (state != PLV_UPLOAD_DONE && state != PLV_UPLOAD_FAILED);
+
+    source.end();
+
+    result.state     = state;
+    result.response  = uploader.response();
+    result.bytesSent = uploader.bytesSent();
+    result.files     = source.files();
+    result.heapUsed  = hostHeapStats().peakBytes - heapBefore;
+
+    // The server prints its summary and exits
+    char line[128];
+    while (fgets(line, sizeof(line), server)) {
+        printf("  server: %s", line);
+    }
+    pclose(server);
+
+    result.received = readSavedUpload();
+
+    return true;
+}
+
+PLV_TEST(drainsTenThousandRecords) {
+
+    PLV_FS.setSize(3 * 1024 * 1024);
+    PLV_FS.format();
+    PluviOn::begin();
+
+    std::string expected = writeBacklog(10000);
+    PLV_CHECK_EQUAL(expected.size(), PluviOnDirSource::length(TEST_DATA_DIR));
+
+    BacklogUpload upload;
+    PLV_CHECK(uploadBacklog(upload));
+
+    PLV_CHECK_EQUAL(PLV_UPLOAD_DONE, upload.state);
+    PLV_CHECK(upload.response == "ok");
+    PLV_CHECK_EQUAL(10000UL / TEST_RECORDS_PER_FILE, upload.files);
+    PLV_CHECK_EQUAL(expected.size(), upload.bytesSent);
+    PLV_CHECK(upload.received == expected);
+}
+
+PLV_TEST(heapDoesntGrowWithTheBacklog) {
+
+    PLV_FS.setSize(3 * 1024 * 1024);
+    PLV_FS.format();
+    PluviOn::begin();
+
+    writeBacklog(100);
+
+    BacklogUpload small;
+    PLV_CHECK(uploadBacklog(small));
+    PLV_CHECK_EQUAL(PLV_UPLOAD_DONE, small.state);
+
+    PluviOn utils;
+    PLV_CHECK(utils.FSDeleteFiles(TEST_DATA_DIR));
+    writeBacklog(10000);
+
+    BacklogUpload large;
+    PLV_CHECK(uploadBacklog(large));
+    PLV_CHECK_EQUAL(PLV_UPLOAD_DONE, large.state);
+
+    printf("  heap: %lu bytes for 100 records, %lu bytes for 10000 records\n", small.heapUsed, large.heapUsed);
+    PLV_CHECK_EQUAL(small.heapUsed, large.heapUsed);
+}
+
+PLV_TEST(serverRefusal) {
+
+    writeBacklog(10);
+
+    // Nothing listens: the uploader fails in CONNECT, the files stay
+    HostClient       client;
+    PluviOnUploader  uploader(client);
+    PluviOnDirSource source;
+
+    uploader.setTimeouts(300, 1000, 1000);
+    uploader.setConnectRetryDelay(100);
+
+    source.begin(TEST_DATA_DIR);
+    PLV_CHECK(uploader.start("127.0.0.1", 1, PLV_UPLOAD_LINE, NULL, 0, PluviOnDirSource::source, &source));
+
+    PluviOnUploadState state;
+    do {
+        state = uploader.step();
+    } while (state != PLV_UPLOAD_DONE && state != PLV_UPLOAD_FAILED);
+
+    source.end();
+
+    PLV_CHECK_EQUAL(PLV_UPLOAD_FAILED, state);
+    PLV_CHECK_EQUAL(PLV_UPLOAD_CONNECT, uploader.failedState());
+    PLV_CHECK(PluviOnDirSource::length(TEST_DATA_DIR) > 0);
+}
+
+PLV_TEST_MAIN()
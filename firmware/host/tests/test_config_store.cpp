@@ -0,0 +1,198 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_config_store.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnConfigStore: migration of the legacy "value encoded in filename"
+ * directories, the invalid config files (CRC, version, older storage epoch)
+ * and the writes, only on change and batched by commit() and flush().
+ */
+#include "PluviOnTest.h"
+#include <PluviOnConfigStore.h>
+#include <stddef.h>
+
+// The longest name the legacy layout kept: "/stt/name/" + 21 chars
+#define TEST_LEGACY_NAME "Estacao Jd. Paulista1"
+
+/**
+ * Overwrite bytes of the config file (as a reset or a flash error would)
+ */
+static boolean patchConfig(size_t offset, const void *data, size_t size) {
+
+    File f = PLV_FS.open(PLV_CONFIG_FILE, "r+");
+    boolean success = f && f.seek(offset) && f.write((const uint8_t *) data, size) == size;
+    f.close();
+
+    return success;
+}
+
+PLV_TEST(migratesTheLegacyLayout) {
+
+    PluviOn pluvion;
+    PLV_CHECK(pluvion.FSCreateFile("/msgcnt", 42));
+    PLV_CHECK(pluvion.FSCreateFile("/stt/time", 1539871200UL));
+    PLV_CHECK(pluvion.FSCreateFile("/stt/bucketvol", "3.25"));
+    PLV_CHECK(pluvion.FSCreateFile("/stt/lat", "-23.5505"));
+    PLV_CHECK(pluvion.FSCreateFile("/stt/name", TEST_LEGACY_NAME));
+    PLV_CHECK(pluvion.FSCreateFile("/fmwver", "1.0.0"));
+
+    PluviOnConfigStore config(pluvion);
+    PLV_CHECK(config.begin());
+    PLV_CHECK_EQUAL(1UL, config.writeCount());
+
+    PLV_CHECK_EQUAL(42L, config.getInt(PLV_CFG_MESSAGE_ID));
+    PLV_CHECK_EQUAL(1539871200L, config.getInt(PLV_CFG_STATION_TIME));
+    PLV_CHECK(!config.has(PLV_CFG_TIME_TO_RESET));
+    PLV_CHECK_EQUAL(3.25f, config.getFloat(PLV_CFG_BUCKET_VOLUME));
+    PLV_CHECK(strcmp(config.getString(PLV_CFG_LATITUDE), "-23.5505") == 0);
+    PLV_CHECK(strcmp(config.getString(PLV_CFG_STATION_NAME), TEST_LEGACY_NAME) == 0);
+    PLV_CHECK(strcmp(config.getString(PLV_CFG_FIRMWARE_VERSION), "1.0.0") == 0);
+    PLV_CHECK(strcmp(config.getString(PLV_CFG_STATION_ID), "") == 0);
+
+    // The legacy directories are gone once the config file is written
+    PLV_CHECK(pluvion.FSReadString("/msgcnt") == "");
+    PLV_CHECK(pluvion.FSReadString("/stt/name") == "");
+
+    PluviOnTest::reboot();
+
+    PluviOnConfigStore loaded(pluvion);
+    PLV_CHECK(loaded.begin());
+    PLV_CHECK_EQUAL(0UL, loaded.writeCount());
+    PLV_CHECK_EQUAL(42L, loaded.getInt(PLV_CFG_MESSAGE_ID));
+    PLV_CHECK(strcmp(loaded.getString(PLV_CFG_STATION_NAME), TEST_LEGACY_NAME) == 0);
+}
+
+PLV_TEST(invalidFileFallsBackToDefaults) {
+
+    PluviOn pluvion;
+
+    // A byte of a value, then the layout version
+    const size_t offsets[] = {
+        offsetof(PluviOnConfigData, messageID),
+        offsetof(PluviOnConfigData, version)
+    };
+
+    for (int i = 0; i < 2; i++) {
+
+        PluviOnConfigStore config(pluvion);
+        PLV_CHECK(config.begin());
+        PLV_CHECK(config.setInt(PLV_CFG_MESSAGE_ID, 42));
+        PLV_CHECK(config.flush());
+
+        uint8_t patch = 0x7F;
+        PLV_CHECK(patchConfig(offsets[i], &patch, 1));
+
+        PluviOnTest::reboot();
+
+        PluviOnConfigStore loaded(pluvion);
+        PLV_CHECK(loaded.begin());
+        PLV_CHECK(!loaded.has(PLV_CFG_MESSAGE_ID));
+        PLV_CHECK_EQUAL(0L, loaded.getInt(PLV_CFG_MESSAGE_ID));
+        PLV_CHECK(strcmp(loaded.getString(PLV_CFG_STATION_NAME), "") == 0);
+    }
+}
+
+PLV_TEST(wipedFileIsIgnored) {
+
+    PluviOn pluvion;
+
+    PluviOnConfigStore config(pluvion);
+    PLV_CHECK(config.begin());
+    PLV_CHECK(config.setString(PLV_CFG_STATION_ID, "PLV0001"));
+    PLV_CHECK(config.flush());
+
+    // The legacy directories of the wiped storage aren't migrated either
+    PLV_CHECK(pluvion.FSCreateFile("/msgcnt", 42));
+
+    PLV_CHECK(PluviOn::FSWipe());
+    PluviOnTest::reboot();
+
+    PluviOnConfigStore wiped(pluvion);
+    PLV_CHECK(wiped.begin());
+    PLV_CHECK(!wiped.has(PLV_CFG_STATION_ID));
+    PLV_CHECK(!wiped.has(PLV_CFG_MESSAGE_ID));
+
+    // The old file doesn't come back once the reclaim is over
+    PLV_CHECK(wiped.setInt(PLV_CFG_MESSAGE_ID, 7));
+    PLV_CHECK(wiped.flush());
+    while (PluviOn::FSReclaimStep()) {
+    }
+    PluviOnTest::reboot();
+
+    PluviOnConfigStore reclaimed(pluvion);
+    PLV_CHECK(reclaimed.begin());
+    PLV_CHECK_EQUAL(7L, reclaimed.getInt(PLV_CFG_MESSAGE_ID));
+    PLV_CHECK(!reclaimed.has(PLV_CFG_STATION_ID));
+}
+
+PLV_TEST(writesOnlyOnChange) {
+
+    PluviOn pluvion;
+
+    PluviOnConfigStore config(pluvion);
+    PLV_CHECK(config.begin());
+    unsigned long writes = config.writeCount();
+
+    PLV_CHECK(config.setInt(PLV_CFG_MESSAGE_ID, 1));
+    PLV_CHECK(config.isDirty());
+    PLV_CHECK(config.commit());
+    PLV_CHECK_EQUAL(writes + 1, config.writeCount());
+
+    // The same values: nothing staged, nothing written
+    PLV_CHECK(config.setInt(PLV_CFG_MESSAGE_ID, 1));
+    PLV_CHECK(!config.isDirty());
+    PLV_CHECK(config.commit());
+    PLV_CHECK(config.flush());
+    PLV_CHECK_EQUAL(writes + 1, config.writeCount());
+
+    // Changes within the commit delay go in a single write
+    config.setCommitDelay(100);
+    for (long id = 2; id <= 10; id++) {
+        PLV_CHECK(config.setInt(PLV_CFG_MESSAGE_ID, id));
+        PLV_CHECK(config.setFloat(PLV_CFG_BUCKET_VOLUME, id * 0.25f));
+        PLV_CHECK(!config.commit());
+    }
+    PLV_CHECK_EQUAL(writes + 1, config.writeCount());
+
+    delay(110);
+    PLV_CHECK(config.commit());
+    PLV_CHECK_EQUAL(writes + 2, config.writeCount());
+
+    // flush() doesn't wait for the delay
+    PLV_CHECK(config.setString(PLV_CFG_LATITUDE, "-23.5505"));
+    PLV_CHECK(!config.commit());
+    PLV_CHECK(config.flush());
+    PLV_CHECK_EQUAL(writes + 3, config.writeCount());
+
+    PluviOnTest::reboot();
+
+    PluviOnConfigStore loaded(pluvion);
+    PLV_CHECK(loaded.begin());
+    PLV_CHECK_EQUAL(10L, loaded.getInt(PLV_CFG_MESSAGE_ID));
+    PLV_CHECK_EQUAL(2.5f, loaded.getFloat(PLV_CFG_BUCKET_VOLUME));
+    PLV_CHECK(strcmp(loaded.getString(PLV_CFG_LATITUDE), "-23.5505") == 0);
+}
+
+PLV_TEST(stationNameKeepsTheLegacyLimit) {
+
+    PluviOn pluvion;
+
+    PluviOnConfigStore config(pluvion);
+    PLV_CHECK(config.begin());
+
+    PLV_CHECK(config.setString(PLV_CFG_STATION_NAME, TEST_LEGACY_NAME));
+    PLV_CHECK(strcmp(config.getString(PLV_CFG_STATION_NAME), TEST_LEGACY_NAME) == 0);
+
+    // Longer than the slot: truncated (and logged)
+    PLV_CHECK(config.setString(PLV_CFG_STATION_NAME, TEST_LEGACY_NAME "234"));
+    PLV_CHECK(strcmp(config.getString(PLV_CFG_STATION_NAME), TEST_LEGACY_NAME) == 0);
+}
+
+PLV_TEST_MAIN()
@@ -0,0 +1,116 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_event_ring.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnEventRing: FIFO order while the uint8_t head and tail wrap, the
+ * full condition and the events dropped with the ring full.
+ */
+#include "PluviOnTest.h"
+#include <PluviOnEventRing.h>
+
+/**
+ * Push and pop n events, so head and tail start the test at n
+ */
+static void advance(PluviOnEventRing &ring, int n) {
+
+    uint32_t timestamp;
+
+    for (int i = 0; i < n; i++) {
+        ring.push(i);
+        PLV_CHECK(ring.pop(timestamp));
+    }
+}
+
+PLV_TEST(fifoAcrossTheIndexWrap) {
+
+    PluviOnEventRing ring;
+    uint32_t         pushed = 0;
+    uint32_t         popped = 0;
+    uint32_t         timestamp;
+
+    // Bursts of 1 to PLV_EVENT_RING_SIZE events: head and tail wrap several times
+    for (int burst = 0; pushed < 1000; burst++) {
+
+        int size = 1 + (burst * 7) % PLV_EVENT_RING_SIZE;
+
+        for (int i = 0; i < size; i++) {
+            ring.push(1000000 + pushed++);
+        }
+        PLV_CHECK_EQUAL((uint8_t) size, ring.available());
+
+        while (ring.pop(timestamp)) {
+            PLV_CHECK_EQUAL(1000000 + popped++, timestamp);
+        }
+    }
+
+    PLV_CHECK_EQUAL(pushed, popped);
+    PLV_CHECK_EQUAL(0, ring.available());
+    PLV_CHECK_EQUAL(0UL, ring.overflows());
+}
+
+PLV_TEST(fullAtTheRingSize) {
+
+    // From a fresh ring, and filled across the wrap of the indexes
+    for (int start = 0; start < 256; start += 256 - PLV_EVENT_RING_SIZE / 2) {
+
+        PluviOnEventRing ring;
+        advance(ring, start);
+
+        for (int i = 0; i < PLV_EVENT_RING_SIZE; i++) {
+            ring.push(i);
+        }
+        PLV_CHECK_EQUAL((uint8_t) PLV_EVENT_RING_SIZE, ring.available());
+        PLV_CHECK_EQUAL(0UL, ring.overflows());
+
+        ring.push(PLV_EVENT_RING_SIZE);
+        PLV_CHECK_EQUAL((uint8_t) PLV_EVENT_RING_SIZE, ring.available());
+        PLV_CHECK_EQUAL(1UL, ring.overflows());
+
+        // One slot back, one event in
+        uint32_t timestamp;
+        PLV_CHECK(ring.pop(timestamp));
+        PLV_CHECK_EQUAL(0U, timestamp);
+        ring.push(PLV_EVENT_RING_SIZE + 1);
+        PLV_CHECK_EQUAL((uint8_t) PLV_EVENT_RING_SIZE, ring.available());
+        PLV_CHECK_EQUAL(1UL, ring.overflows());
+    }
+}
+
+PLV_TEST(rejectedPushKeepsTheUnreadEvents) {
+
+    PluviOnEventRing ring;
+    advance(ring, 250);
+
+    for (int i = 0; i < PLV_EVENT_RING_SIZE; i++) {
+        ring.push(i);
+    }
+
+    // The loop falls behind: every new event is counted and dropped
+    for (int i = 0; i < 300; i++) {
+        ring.push(0xDEAD0000 + i);
+    }
+    PLV_CHECK_EQUAL(300UL, ring.overflows());
+
+    uint32_t timestamp;
+    for (int i = 0; i < PLV_EVENT_RING_SIZE; i++) {
+        PLV_CHECK(ring.pop(timestamp));
+        PLV_CHECK_EQUAL((uint32_t) i, timestamp);
+    }
+    PLV_CHECK(!ring.pop(timestamp));
+
+    // Pushes work again once there is room, the count stays
+    ring.push(42);
+    PLV_CHECK(ring.pop(timestamp));
+    PLV_CHECK_EQUAL(42U, timestamp);
+    PLV_CHECK_EQUAL(300UL, ring.overflows());
+}
+
+PLV_TEST_MAIN()
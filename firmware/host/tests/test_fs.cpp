@@ -0,0 +1,293 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_fs.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOn file system calls: values stored as file names, atomic writes,
+ * wipe and reclaim, on the SPIFFS emulation of the host build.
+ */
+#include "PluviOnTest.h"
+
+static PluviOn pluvion;
+
+static boolean writeFile(const char *path, const char *content) {
+    File f = PLV_FS.open(path, "w");
+    return f && f.write((const uint8_t *) content, strlen(content)) == strlen(content);
+}
+
+static String readFile(const char *path) {
+
+    File f = PLV_FS.open(path, "r");
+    String content;
+
+    while (f && f.available()) {
+        content += (char) f.read();
+    }
+
+    return content;
+}
+
+PLV_TEST(valuesStoredAsFileNames) {
+
+    PLV_CHECK(pluvion.FSCreateFile("/stt/lat", "-23.5505"));
+    PLV_CHECK(pluvion.FSCreateFile("/stt/id", 1234));
+    PLV_CHECK(pluvion.FSCreateFile("/stt/ttr", 4000000000UL));
+    PLV_CHECK(pluvion.FSCreateFile(F("/stt/name"), "pluvi"));
+
+    PLV_CHECK(fabs(pluvion.FSReadFloat("/stt/lat") + 23.5505) < 0.0001);
+    PLV_CHECK_EQUAL(1234U, pluvion.FSReadInt("/stt/id"));
+    PLV_CHECK_EQUAL(4000000000UL, pluvion.FSReadULong("/stt/ttr"));
+    PLV_CHECK(pluvion.FSReadString("/stt/name") == "pluvi");
+
+    // Missing values read as 0 / ""
+    PLV_CHECK_EQUAL(0U, pluvion.FSReadInt("/stt/none"));
+    PLV_CHECK(pluvion.FSReadString("/stt/none") == "");
+}
+
+PLV_TEST(pathsTooLongAreRefused) {
+
+    // PLV_FS_PATH_SIZE includes the NUL, as SPIFFS_OBJ_NAME_LEN
+    PLV_CHECK(!pluvion.FSCreateFile("/directory-name", "a-file-name-too-long"));
+    PLV_CHECK(pluvion.FSCreateFile("/directory-name", "a-name-fits"));
+#if PLV_FS_BACKEND == PLV_FS_SPIFFS
+    PLV_CHECK(!PLV_FS.open("/directory-name/a-file-name-too-long", "w"));
+#endif
+}
+
+PLV_TEST(deleteFilesKeepsOtherDirectories) {
+
+    for (int i = 0; i < 20; i++) {
+        PLV_CHECK(pluvion.FSCreateFile("/data", i));
+    }
+    PLV_CHECK(pluvion.FSCreateFile("/other", 1));
+
+    PLV_CHECK(pluvion.FSDeleteFiles("/data"));
+
+    Dir dir = PLV_FS.openDir("/data");
+    PLV_CHECK(!dir.next());
+    PLV_CHECK(PLV_FS.exists("/other/1"));
+
+    PLV_CHECK(pluvion.FSDeleteFile("/other", 1));
+    PLV_CHECK(!PLV_FS.exists("/other/1"));
+    PLV_CHECK(!pluvion.FSDeleteFile("/other", 1));
+}
+
+#if PLV_FS_BACKEND == PLV_FS_SPIFFS
+PLV_TEST(flatNamespace) {
+
+    PLV_CHECK(writeFile("/log/0", "a"));
+    PLV_CHECK(writeFile("/log/1", "bc"));
+    PLV_CHECK(writeFile("/logs", "d"));
+    PLV_CHECK(writeFile("/data/1", "e"));
+
+    // A directory is a path prefix, entries are full paths
+    Dir dir = PLV_FS.openDir("/log/");
+    PLV_CHECK(dir.next());
+    PLV_CHECK(dir.fileName() == "/log/0");
+    PLV_CHECK(dir.next());
+    PLV_CHECK(dir.fileName() == "/log/1");
+    PLV_CHECK_EQUAL(2U, dir.fileSize());
+    PLV_CHECK(!dir.next());
+
+    char path[PLV_FS_PATH_SIZE];
+    dir = PLV_FS.openDir("/data");
+    PLV_CHECK(dir.next());
+    PLV_CHECK(PluviOn::FSEntryPath(path, "/data", dir));
+    PLV_CHECK(strcmp(path, "/data/1") == 0);
+    PLV_CHECK(PluviOn::FSEntryName("/data", dir) == "1");
+
+    // SPIFFS doesn't rename over an existing file
+    PLV_CHECK(!PLV_FS.rename("/log/0", "/log/1"));
+    PLV_CHECK(PLV_FS.rename("/log/0", "/log/2"));
+    PLV_CHECK(readFile("/log/2") == "a");
+}
+#else
+PLV_TEST(directories) {
+
+    PLV_CHECK(writeFile("/log/0", "a"));
+    PLV_CHECK(writeFile("/data/1", "e"));
+
+    // Entries are names, FSEntryPath rebuilds the full path
+    char path[PLV_FS_PATH_SIZE];
+    Dir dir = PLV_FS.openDir("/data");
+    PLV_CHECK(dir.next());
+    PLV_CHECK(dir.fileName() == "1");
+    PLV_CHECK(PluviOn::FSEntryPath(path, "/data", dir));
+    PLV_CHECK(strcmp(path, "/data/1") == 0);
+    PLV_CHECK(PluviOn::FSEntryName("/data", dir) == "1");
+
+    dir = PLV_FS.openDir("/");
+    PLV_CHECK(dir.next());
+    PLV_CHECK(dir.isDirectory());
+
+    // Removing the last file removes its directory
+    PLV_CHECK(PLV_FS.remove("/data/1"));
+    PLV_CHECK(!PLV_FS.exists("/data"));
+}
+#endif
+
+PLV_TEST(fullFileSystemRefusesWrites) {
+
+    PLV_FS.setSize(4 * PLV_HOST_FS_PAGE_SIZE);
+
+    // Index page + one data page
+    PLV_CHECK(writeFile("/a", "1"));
+    PLV_CHECK(writeFile("/b", "2"));
+
+    File f = PLV_FS.open("/c", "w");
+    PLV_CHECK(!f);
+
+    // Removing a file gives its pages back
+    PLV_CHECK(PLV_FS.remove("/a"));
+    PLV_CHECK(writeFile("/c", "3"));
+
+    FSInfo info;
+    PLV_CHECK(PLV_FS.info(info));
+    PLV_CHECK_EQUAL(info.totalBytes, info.usedBytes);
+}
+
+PLV_TEST(writeAtomicReplacesContent) {
+
+    PLV_CHECK(PluviOn::FSWriteAtomic("/cfg", (const uint8_t *) "old", 3));
+    PLV_CHECK(PluviOn::FSWriteAtomic("/cfg", (const uint8_t *) "new", 3));
+
+    PLV_CHECK(readFile("/cfg") == "new");
+    PLV_CHECK(!PLV_FS.exists("/cfg.tmp"));
+}
+
+PLV_TEST(recoverAtomicFinishesOrDiscards) {
+
+    // Reset while writing the temporary file: the old content stays
+    PLV_CHECK(writeFile("/cfg", "old"));
+    PLV_CHECK(writeFile("/cfg.tmp", "ne"));
+    PLV_CHECK(PluviOn::FSRecoverAtomic("/cfg"));
+    PLV_CHECK(readFile("/cfg") == "old");
+    PLV_CHECK(!PLV_FS.exists("/cfg.tmp"));
+
+    // Reset between remove and rename: the move is finished
+    PLV_CHECK(PLV_FS.remove("/cfg"));
+    PLV_CHECK(writeFile("/cfg.tmp", "new"));
+    PLV_CHECK(PluviOn::FSRecoverAtomic("/cfg"));
+    PLV_CHECK(readFile("/cfg") == "new");
+    PLV_CHECK(!PLV_FS.exists("/cfg.tmp"));
+}
+
+PLV_TEST(wipeReclaimsOlderEpochs) {
+
+    PluviOn::FSKeep("/keep");
+
+    for (int i = 0; i < 10; i++) {
+        PLV_CHECK(pluvion.FSCreateFile("/data", i));
+    }
+    PLV_CHECK(pluvion.FSCreateFile("/keep", 1));
+
+    uint32_t epoch = PluviOn::FSEpoch();
+    PLV_CHECK(PluviOn::FSWipe());
+    PLV_CHECK_EQUAL(epoch + 1, PluviOn::FSEpoch());
+    PLV_CHECK(PluviOn::FSReclaimPending());
+
+    // A reset in the middle of the reclaim resumes it
+    PLV_CHECK(PluviOn::FSReclaimStep());
+    PluviOnTest::reboot();
+    PLV_CHECK(PluviOn::begin());
+    PLV_CHECK(PluviOn::FSReclaimPending());
+
+    int steps = 0;
+    while (PluviOn::FSReclaimStep()) {
+        steps++;
+    }
+
+    PLV_CHECK_EQUAL(9, steps);
+    PLV_CHECK(!PluviOn::FSReclaimPending());
+
+    Dir dir = PLV_FS.openDir("/data");
+    PLV_CHECK(!dir.next());
+    PLV_CHECK(PLV_FS.exists("/keep/1"));
+
+    // The epoch survives a reset
+    PluviOnTest::reboot();
+    PLV_CHECK(PluviOn::begin());
+    PLV_CHECK_EQUAL(epoch + 1, PluviOn::FSEpoch());
+    PLV_CHECK(!PluviOn::FSReclaimPending());
+}
+
+PLV_TEST(filesWrittenDuringTheReclaimStay) {
+
+    // Not kept: a writer that didn't call FSKeep
+    for (int i = 0; i < 5; i++) {
+        PLV_CHECK(pluvion.FSCreateFile("/data", i));
+    }
+
+    PLV_CHECK(PluviOn::FSWipe());
+
+    // The older files are gone for the readers right away
+    PLV_CHECK(!PluviOn::FSExists("/data/0"));
+    PLV_CHECK(!PluviOn::FSOpen("/data/0", "r"));
+
+    // New files, and older ones written again, belong to the new epoch
+    PLV_CHECK(pluvion.FSCreateFile("/data", 10));
+    PLV_CHECK(pluvion.FSCreateFile("/data", 3));
+    PLV_CHECK(PluviOn::FSWriteAtomic("/data/4", (const uint8_t *) "new", 3));
+    PLV_CHECK(PluviOn::FSExists("/data/10"));
+
+    // An append doesn't bring the older content back
+    File f = PluviOn::FSOpen("/data/2", "a");
+    PLV_CHECK(f);
+    PLV_CHECK_EQUAL(1U, f.write('x'));
+    f.close();
+
+    PLV_CHECK(PluviOn::FSReclaimStep());
+    PluviOnTest::reboot();
+    PLV_CHECK(PluviOn::begin());
+    PLV_CHECK(pluvion.FSCreateFile("/data", 11));
+
+    int steps = 0;
+    while (PluviOn::FSReclaimStep()) {
+        steps++;
+    }
+
+    PLV_CHECK_EQUAL(1, steps);
+    PLV_CHECK(!PluviOn::FSReclaimPending());
+
+    PLV_CHECK(!PLV_FS.exists("/data/0"));
+    PLV_CHECK(!PLV_FS.exists("/data/1"));
+    PLV_CHECK(readFile("/data/2") == "x");
+    PLV_CHECK(PLV_FS.exists("/data/3"));
+    PLV_CHECK(readFile("/data/4") == "new");
+    PLV_CHECK(PLV_FS.exists("/data/10"));
+    PLV_CHECK(PLV_FS.exists("/data/11"));
+    PLV_CHECK(!PLV_FS.exists(PLV_FS_FRESH_FILE));
+}
+
+PLV_TEST(operationsAreCounted) {
+
+    PluviOn::FSResetStats();
+
+    PLV_CHECK(pluvion.FSCreateFile("/data", 1));
+    PLV_CHECK(PluviOn::FSWriteAtomic("/cfg", (const uint8_t *) "12345", 5));
+
+    PLV_CHECK_EQUAL(2UL, PluviOn::FSOpStats(PLV_FS_OP_OPEN).count);
+    PLV_CHECK_EQUAL(1UL, PluviOn::FSOpStats(PLV_FS_OP_RENAME).count);
+    PLV_CHECK_EQUAL(5UL, PluviOn::FSBytesWritten());
+}
+
+PLV_TEST(createFileWithoutHeap) {
+
+    PLV_CHECK(PluviOn::begin());
+
+    hostHeapReset();
+    PLV_CHECK(pluvion.FSCreateFile("/data", 1));
+    PLV_CHECK(pluvion.FSDeleteFile("/data", 1));
+
+    // The char * overloads build the path on the stack
+    PLV_CHECK_EQUAL(0UL, hostHeapStats().allocations);
+}
+
+PLV_TEST_MAIN()
@@ -0,0 +1,125 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_http_parser.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnHTTPParser: response boundaries, bodies longer than the buffer,
+ * incomplete responses and no heap. The captured responses are checked by
+ * the HTTPParserBenchmark example (example_HTTPParserBenchmark test).
+ */
+#include "PluviOnTest.h"
+#include <PluviOnHTTPParser.h>
+
+static size_t feedString(PluviOnHTTPParser &parser, const char *data) {
+    return parser.feed((const uint8_t *) data, strlen(data));
+}
+
+PLV_TEST(stopsAtTheEndOfTheResponse) {
+
+    // Two responses on a kept connection, received at once
+    const char *data =
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nok|1|"
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nok|2|";
+    size_t first = strlen(data) / 2;
+
+    PluviOnHTTPParser parser;
+    parser.begin();
+
+    PLV_CHECK_EQUAL(first, feedString(parser, data));
+    PLV_CHECK(parser.done());
+    PLV_CHECK(parser.keepAlive());
+    PLV_CHECK(strcmp(parser.body(), "ok|1|") == 0);
+
+    // Nothing more is used once done
+    PLV_CHECK_EQUAL((size_t) 0, feedString(parser, data + first));
+
+    parser.begin();
+    PLV_CHECK_EQUAL(first, feedString(parser, data + first));
+    PLV_CHECK(parser.done());
+    PLV_CHECK(strcmp(parser.body(), "ok|2|") == 0);
+}
+
+PLV_TEST(longBodyIsCut) {
+
+    char data[64 + 3 * PLV_HTTP_BODY_SIZE];
+    size_t header = snprintf(data, sizeof(data), "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n", 2 * PLV_HTTP_BODY_SIZE);
+
+    memset(data + header, 'x', 2 * PLV_HTTP_BODY_SIZE);
+    strcpy(data + header + 2 * PLV_HTTP_BODY_SIZE, "HTTP/1.1");
+
+    PluviOnHTTPParser parser;
+    parser.begin();
+
+    // The whole body is read (the connection stays usable), only the start is kept
+    PLV_CHECK_EQUAL(header + 2 * PLV_HTTP_BODY_SIZE, feedString(parser, data));
+    PLV_CHECK(parser.done());
+    PLV_CHECK_EQUAL((size_t) PLV_HTTP_BODY_SIZE - 1, strlen(parser.body()));
+    PLV_CHECK_EQUAL(2L * PLV_HTTP_BODY_SIZE, parser.contentLength());
+}
+
+PLV_TEST(incompleteResponses) {
+
+    PluviOnHTTPParser parser;
+
+    // Closed in the headers
+    parser.begin();
+    feedString(parser, "HTTP/1.1 200 OK\r\nContent-Le");
+    PLV_CHECK_EQUAL(PLV_HTTP_HEADERS, parser.state());
+    parser.finish();
+    PLV_CHECK_EQUAL(PLV_HTTP_ERROR, parser.state());
+    PLV_CHECK(!parser.done());
+
+    // Closed before the status line
+    parser.begin();
+    parser.finish();
+    PLV_CHECK_EQUAL(PLV_HTTP_ERROR, parser.state());
+
+    // Empty line reply
+    parser.beginLine();
+    parser.finish();
+    PLV_CHECK_EQUAL(PLV_HTTP_ERROR, parser.state());
+
+    // Nothing is used after an error
+    PLV_CHECK_EQUAL((size_t) 0, feedString(parser, "ok\r"));
+}
+
+PLV_TEST(connectionHeader) {
+
+    PluviOnHTTPParser parser;
+
+    parser.begin();
+    feedString(parser, "HTTP/1.0 200 OK\r\nConnection: keep-alive\r\nContent-Length: 0\r\n\r\n");
+    PLV_CHECK(parser.done());
+    PLV_CHECK(parser.keepAlive());
+
+    parser.begin();
+    feedString(parser, "HTTP/1.1 503 Service Unavailable\r\nCONNECTION:close\r\nContent-Length: 0\r\n\r\n");
+    PLV_CHECK(parser.done());
+    PLV_CHECK(!parser.keepAlive());
+    PLV_CHECK_EQUAL(503, parser.status());
+}
+
+PLV_TEST(noHeap) {
+
+    PluviOnHTTPParser parser;
+
+    hostHeapReset();
+
+    for (int i = 0; i < 100; i++) {
+        parser.begin();
+        feedString(parser, "HTTP/1.1 200 OK\r\nAccept-Encoding: x-plv-lzss\r\nContent-Length: 12\r\n\r\nok|1|86400||");
+    }
+
+    PLV_CHECK_EQUAL(0UL, hostHeapStats().allocations);
+    PLV_CHECK(parser.done());
+    PLV_CHECK(strcmp(parser.acceptEncoding(), "x-plv-lzss") == 0);
+}
+
+PLV_TEST_MAIN()
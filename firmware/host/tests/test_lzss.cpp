@@ -0,0 +1,227 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_lzss.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnLZSS: round trips in chunks of any size, no heap, invalid streams.
+ *
+ * Also writes lzss_batch.txt and lzss_batch.lz in the working directory,
+ * decoded by firmware/tools/pluvion_lzss.py in the lzss_python test.
+ */
+#include "PluviOnTest.h"
+#include <PluviOnLZSS.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_CONTENT_SIZE (24 * 1024) // Much larger than PLV_LZSS_BUFFER_SIZE: the buffer slides
+
+struct TestContent {
+    const uint8_t *data;
+    size_t         length;
+    size_t         offset;
+    size_t         chunk;   // Largest chunk returned by the source
+};
+
+static size_t readContent(uint8_t *buffer, size_t size, void *context) {
+
+    TestContent *content = (TestContent *) context;
+
+    size_t length = content->length - content->offset;
+    if (length > size) {
+        length = size;
+    }
+    if (length > content->chunk) {
+        length = content->chunk;
+    }
+
+    memcpy(buffer, content->data + content->offset, length);
+    content->offset += length;
+
+    return length;
+}
+
+static size_t failingContent(uint8_t *buffer, size_t size, void *context) {
+    return PLV_UPLOAD_SOURCE_ERROR;
+}
+
+/**
+ * Offline batch as uploaded: one weather message per line with the offline suffix
+ */
+static size_t weatherBatch(uint8_t *buffer, size_t size) {
+
+    size_t length = 0;
+
+    for (int i = 0; ; i++) {
+
+        char line[128];
+        int n = snprintf(line, sizeof(line), "%lu|PluviOn_1A2B3C|%d.%02d|%d.00|1013.%02d|%d|%d|-%d|off\n",
+                         1700000000UL + i * 300UL, 20 + i % 7, i % 100, 60 + i % 30, i % 50, i / 12, i % 3, 60 + i % 9);
+
+        if (length + n > size) {
+            return length;
+        }
+
+        memcpy(buffer + length, line, n);
+        length += n;
+    }
+}
+
+/**
+ * Compress with reads of at most readSize bytes, from a source returning at most sourceChunk bytes
+ */
+static long compress(const uint8_t *data, size_t length, uint8_t *out, size_t outSize,
+                     size_t readSize, size_t sourceChunk) {
+
+    static PluviOnLZSS compressor;
+    TestContent content = { data, length, 0, sourceChunk };
+
+    compressor.begin(readContent, &content);
+
+    size_t outLength = 0;
+    size_t chunk;
+
+    while (outLength < outSize) {
+
+        size_t size = outSize - outLength < readSize ? outSize - outLength : readSize;
+        chunk = compressor.read(out + outLength, size);
+
+        if (chunk == PLV_UPLOAD_SOURCE_ERROR) {
+            return -1;
+        }
+        if (chunk == 0) {
+            break;
+        }
+
+        outLength += chunk;
+    }
+
+    if (compressor.bytesIn() != length || compressor.bytesOut() != outLength) {
+        return -1;
+    }
+
+    return outLength;
+}
+
+static uint8_t original[TEST_CONTENT_SIZE];
+static uint8_t compressed[TEST_CONTENT_SIZE + TEST_CONTENT_SIZE / 8 + 1];
+static uint8_t decompressed[TEST_CONTENT_SIZE];
+
+PLV_TEST(weatherBatchRoundTrip) {
+
+    size_t length = weatherBatch(original, sizeof(original));
+    long compressedLength = compress(original, length, compressed, sizeof(compressed), PLV_UPLOAD_CHUNK_SIZE, length);
+
+    PLV_CHECK(compressedLength > 0);
+    // The messages repeat most of their fields: well under half the size
+    PLV_CHECK((size_t) compressedLength < length / 2);
+
+    PLV_CHECK_EQUAL((long) length, PluviOnLZSS::decompress(compressed, compressedLength, decompressed, sizeof(decompressed)));
+    PLV_CHECK(memcmp(original, decompressed, length) == 0);
+
+    // For the lzss_python test
+    FILE *text = fopen("lzss_batch.txt", "wb");
+    FILE *lz = fopen("lzss_batch.lz", "wb");
+    PLV_CHECK(text && lz);
+    fwrite(original, 1, length, text);
+    fwrite(compressed, 1, compressedLength, lz);
+    fclose(text);
+    fclose(lz);
+}
+
+PLV_TEST(anyChunkSizes) {
+
+    size_t length = weatherBatch(original, 4096);
+
+    // Same stream whatever the read and source chunk sizes
+    long reference = compress(original, length, compressed, sizeof(compressed), PLV_UPLOAD_CHUNK_SIZE, length);
+    PLV_CHECK(reference > 0);
+
+    static uint8_t expected[sizeof(compressed)];
+    memcpy(expected, compressed, reference);
+
+    static const size_t SIZES[] = { 1, 2, 3, 7, 17, 64, 333, 1024 };
+
+    for (size_t r = 0; r < sizeof(SIZES) / sizeof(SIZES[0]); r++) {
+        for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++) {
+            long compressedLength = compress(original, length, compressed, sizeof(compressed), SIZES[r], SIZES[s]);
+            PLV_CHECK_EQUAL(reference, compressedLength);
+            PLV_CHECK(memcmp(expected, compressed, reference) == 0);
+        }
+    }
+}
+
+PLV_TEST(edgeContents) {
+
+    // Empty
+    PLV_CHECK_EQUAL(0L, compress(original, 0, compressed, sizeof(compressed), 64, 64));
+    PLV_CHECK_EQUAL(0L, PluviOnLZSS::decompress(compressed, 0, decompressed, sizeof(decompressed)));
+
+    // Random bytes: at most one flag byte per 8 literals more
+    srand(1);
+    for (size_t i = 0; i < sizeof(original); i++) {
+        original[i] = rand();
+    }
+
+    long compressedLength = compress(original, sizeof(original), compressed, sizeof(compressed), 256, 100);
+    PLV_CHECK(compressedLength > 0);
+    PLV_CHECK((size_t) compressedLength <= sizeof(original) + (sizeof(original) + 7) / 8);
+    PLV_CHECK_EQUAL((long) sizeof(original), PluviOnLZSS::decompress(compressed, compressedLength, decompressed, sizeof(decompressed)));
+    PLV_CHECK(memcmp(original, decompressed, sizeof(original)) == 0);
+
+    // One byte repeated: matches overlapping their own output, longest matches
+    memset(original, 'a', sizeof(original));
+
+    compressedLength = compress(original, sizeof(original), compressed, sizeof(compressed), 256, 256);
+    PLV_CHECK(compressedLength > 0);
+    PLV_CHECK((size_t) compressedLength < sizeof(original) / 50);
+    PLV_CHECK_EQUAL((long) sizeof(original), PluviOnLZSS::decompress(compressed, compressedLength, decompressed, sizeof(decompressed)));
+    PLV_CHECK(memcmp(original, decompressed, sizeof(original)) == 0);
+}
+
+PLV_TEST(noHeap) {
+
+    size_t length = weatherBatch(original, 8192);
+
+    hostHeapReset();
+
+    long compressedLength = compress(original, length, compressed, sizeof(compressed), PLV_UPLOAD_CHUNK_SIZE, 300);
+    long decompressedLength = PluviOnLZSS::decompress(compressed, compressedLength, decompressed, sizeof(decompressed));
+
+    PLV_CHECK_EQUAL(0UL, hostHeapStats().allocations);
+    PLV_CHECK_EQUAL((long) length, decompressedLength);
+}
+
+PLV_TEST(sourceErrors) {
+
+    PluviOnLZSS compressor;
+    uint8_t buffer[64];
+
+    compressor.begin(failingContent, NULL);
+    PLV_CHECK(compressor.read(buffer, sizeof(buffer)) == PLV_UPLOAD_SOURCE_ERROR);
+}
+
+PLV_TEST(invalidStreams) {
+
+    // Match before the start of the output
+    static const uint8_t BEFORE_START[] = { 0x02, 'a', 0x05, 0x00 };
+    PLV_CHECK_EQUAL(-1L, PluviOnLZSS::decompress(BEFORE_START, sizeof(BEFORE_START), decompressed, sizeof(decompressed)));
+
+    // Truncated match
+    static const uint8_t TRUNCATED[] = { 0x02, 'a', 0x00 };
+    PLV_CHECK_EQUAL(-1L, PluviOnLZSS::decompress(TRUNCATED, sizeof(TRUNCATED), decompressed, sizeof(decompressed)));
+
+    // Doesn't fit in the buffer
+    static const uint8_t LONG[] = { 0x02, 'a', 0x00, 0xFE };    // 'a' then 130 more
+    PLV_CHECK_EQUAL(131L, PluviOnLZSS::decompress(LONG, sizeof(LONG), decompressed, sizeof(decompressed)));
+    PLV_CHECK_EQUAL(-1L, PluviOnLZSS::decompress(LONG, sizeof(LONG), decompressed, 100));
+}
+
+PLV_TEST_MAIN()
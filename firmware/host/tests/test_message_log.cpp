@@ -0,0 +1,241 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_message_log.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnMessageLog: append, read and ack, recovery after a reset, the
+ * drop-oldest policy, the size taken from the file system, torn updates and
+ * the records of older storage epochs.
+ */
+#include "PluviOnTest.h"
+#include <PluviOnMessageLog.h>
+
+static unsigned long appendText(PluviOnMessageLog &log, const char *text) {
+    return log.append(text, strlen(text));
+}
+
+static boolean readText(PluviOnMessageLog &log, unsigned long seq, const char *expected) {
+    char payload[PLV_LOG_PAYLOAD_SIZE + 1];
+    int length = log.read(seq, payload, sizeof(payload) - 1);
+    if (length < 0) {
+        return false;
+    }
+    payload[length] = 0;
+    return strcmp(payload, expected) == 0;
+}
+
+PLV_TEST(appendReadAck) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    PLV_CHECK_EQUAL(0UL, log.first());
+
+    PLV_CHECK_EQUAL(1UL, appendText(log, "one"));
+    PLV_CHECK_EQUAL(2UL, appendText(log, "two"));
+    PLV_CHECK_EQUAL(3UL, appendText(log, "three"));
+
+    PLV_CHECK_EQUAL(1UL, log.first());
+    PLV_CHECK(readText(log, 2, "two"));
+
+    // Out of order acks keep the tail until the oldest is acked
+    PLV_CHECK(log.ack(2));
+    PLV_CHECK(!log.ack(2));
+    PLV_CHECK_EQUAL(1UL, log.first());
+    PLV_CHECK_EQUAL(3UL, log.next(1));
+    PLV_CHECK_EQUAL(2UL, log.pending());
+    PLV_CHECK(log.read(2, NULL, 0) < 0);
+
+    PLV_CHECK(log.ack(1));
+    PLV_CHECK_EQUAL(3UL, log.first());
+    PLV_CHECK_EQUAL(1UL, log.pending());
+}
+
+PLV_TEST(recoveredAfterReset) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+
+    for (int i = 0; i < 40; i++) {
+        char text[16];
+        snprintf(text, sizeof(text), "message %d", i + 1);
+        PLV_CHECK(appendText(log, text));
+    }
+
+    PLV_CHECK(log.ack(1));
+    PLV_CHECK(log.ack(2));
+    PLV_CHECK(log.ack(35));
+
+    PluviOnTest::reboot();
+
+    PluviOnMessageLog recovered;
+    PLV_CHECK(recovered.begin());
+    PLV_CHECK_EQUAL(3UL, recovered.first());
+    PLV_CHECK_EQUAL(37UL, recovered.pending());
+    PLV_CHECK(readText(recovered, 40, "message 40"));
+    PLV_CHECK(recovered.read(35, NULL, 0) < 0);
+
+    // Appends go on after the last record
+    PLV_CHECK_EQUAL(41UL, appendText(recovered, "message 41"));
+}
+
+PLV_TEST(fullLogDropsOldestSegment) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+
+    for (unsigned long i = 0; i < log.capacity() + PLV_LOG_SEGMENT_RECORDS; i++) {
+        PLV_CHECK(appendText(log, "x"));
+    }
+
+    PLV_CHECK_EQUAL((unsigned long) PLV_LOG_SEGMENT_RECORDS, log.dropped());
+    PLV_CHECK_EQUAL((unsigned long) PLV_LOG_SEGMENT_RECORDS + 1, log.first());
+    PLV_CHECK_EQUAL(log.capacity(), log.pending());
+
+    PluviOnTest::reboot();
+
+    PluviOnMessageLog recovered;
+    PLV_CHECK(recovered.begin());
+    PLV_CHECK_EQUAL((unsigned long) PLV_LOG_SEGMENT_RECORDS + 1, recovered.first());
+    PLV_CHECK_EQUAL(log.capacity(), recovered.pending());
+}
+
+PLV_TEST(sizedFromTheFileSystem) {
+
+    // PLV_LOG_FS_SHARE of 1 MB
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    PLV_CHECK_EQUAL(31UL * PLV_LOG_SEGMENT_RECORDS, log.capacity());
+
+    // A smaller file system, a smaller log
+    PluviOnTest::reboot();
+    PLV_FS.setSize(128 * 1024);
+    PLV_FS.format();
+
+    PluviOnMessageLog small;
+    PLV_CHECK(small.begin());
+    PLV_CHECK_EQUAL(3UL * PLV_LOG_SEGMENT_RECORDS, small.capacity());
+    PLV_CHECK_EQUAL(1UL, appendText(small, "kept"));
+
+    // More room: the log only grows once it's empty
+    PluviOnTest::reboot();
+    PLV_FS.setSize(1024 * 1024);
+
+    PluviOnMessageLog grown;
+    PLV_CHECK(grown.begin());
+    PLV_CHECK_EQUAL(3UL * PLV_LOG_SEGMENT_RECORDS, grown.capacity());
+    PLV_CHECK(readText(grown, 1, "kept"));
+    PLV_CHECK(grown.ack(1));
+
+    PluviOnTest::reboot();
+    PLV_CHECK(grown.begin());
+    PLV_CHECK_EQUAL(31UL * PLV_LOG_SEGMENT_RECORDS, grown.capacity());
+    PLV_CHECK_EQUAL(1UL, appendText(grown, "new"));
+}
+
+PLV_TEST(tornRecordIsDropped) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    PLV_CHECK(appendText(log, "complete"));
+    PLV_CHECK(appendText(log, "torn"));
+
+    // Corrupt the payload of the second record (reset while writing it)
+    File f = PLV_FS.open(PLV_LOG_DIR "/0", "r+");
+    PLV_CHECK(f);
+    PLV_CHECK(f.seek(sizeof(PluviOnLogSegmentHeader) + PLV_LOG_RECORD_SIZE + sizeof(PluviOnLogRecordHeader)));
+    PLV_CHECK_EQUAL(1U, f.write('X'));
+    f.close();
+
+    PluviOnTest::reboot();
+
+    PluviOnMessageLog recovered;
+    PLV_CHECK(recovered.begin());
+    PLV_CHECK_EQUAL(1UL, recovered.pending());
+    PLV_CHECK_EQUAL(2UL, appendText(recovered, "again"));
+}
+
+/**
+ * Overwrite a byte of the record payload in a file (reset while writing it)
+ */
+static boolean tearRecord(const char *path, size_t offset) {
+
+    File f = PLV_FS.open(path, "r+");
+    boolean success = f && f.seek(offset + sizeof(PluviOnLogRecordHeader) + 2) && f.write('X') == 1;
+    f.close();
+
+    return success;
+}
+
+PLV_TEST(tornUpdateKeepsTheSamples) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    PLV_CHECK_EQUAL(1UL, appendText(log, "1,2"));
+    PLV_CHECK(log.update(1, "1,2,3", 5));
+
+    // Reset while writing the spare copy: the record holds the earlier samples
+    PLV_CHECK(tearRecord(PLV_LOG_SPARE_FILE, 0));
+
+    PluviOnTest::reboot();
+
+    PluviOnMessageLog recovered;
+    PLV_CHECK(recovered.begin());
+    PLV_CHECK_EQUAL(1UL, recovered.pending());
+    PLV_CHECK(readText(recovered, 1, "1,2,3"));
+
+    // Reset while rewriting the record in place: the spare copy is put back
+    PLV_CHECK(recovered.update(1, "1,2,3,4", 7));
+    PLV_CHECK(tearRecord(PLV_LOG_DIR "/0", sizeof(PluviOnLogSegmentHeader)));
+    PLV_CHECK(recovered.read(1, NULL, 0) < 0);
+
+    PluviOnTest::reboot();
+
+    PluviOnMessageLog again;
+    PLV_CHECK(again.begin());
+    PLV_CHECK_EQUAL(1UL, again.pending());
+    PLV_CHECK(readText(again, 1, "1,2,3,4"));
+    PLV_CHECK_EQUAL(2UL, appendText(again, "5"));
+
+    // Not a copy of a cleared record
+    PLV_CHECK(again.clear());
+    PLV_CHECK_EQUAL(1UL, appendText(again, "new"));
+    PLV_CHECK(tearRecord(PLV_LOG_DIR "/0", sizeof(PluviOnLogSegmentHeader)));
+    PluviOnTest::reboot();
+    PLV_CHECK(again.begin());
+    PLV_CHECK_EQUAL(0UL, again.pending());
+}
+
+PLV_TEST(wipeInvalidatesRecords) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    PLV_CHECK(appendText(log, "old epoch"));
+
+    PLV_CHECK(PluviOn::FSWipe());
+    PLV_CHECK(log.begin());
+
+    PLV_CHECK_EQUAL(0UL, log.pending());
+    PLV_CHECK_EQUAL(1UL, appendText(log, "new epoch"));
+    PLV_CHECK(readText(log, 1, "new epoch"));
+}
+
+PLV_TEST(clearDropsEverything) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    PLV_CHECK(appendText(log, "a"));
+    PLV_CHECK(appendText(log, "b"));
+
+    PLV_CHECK(log.clear());
+    PLV_CHECK_EQUAL(0UL, log.pending());
+    PLV_CHECK_EQUAL(1UL, appendText(log, "c"));
+}
+
+PLV_TEST_MAIN()
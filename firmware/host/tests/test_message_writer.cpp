@@ -0,0 +1,98 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_message_writer.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnMessageWriter: same bytes as String +=, no heap, overflow.
+ */
+#include "PluviOnTest.h"
+#include <PluviOnMessageWriter.h>
+
+PLV_TEST(sameBytesAsString) {
+
+    static const long INTEGERS[] = { 0, 1, -1, 9, 10, 99999, -32768, 2147483647L, -2147483647L - 1 };
+    static const double FLOATS[] = { 0, 0.005, -0.005, 1.125, -16777.125, 23.4, 1e6, -1e-3, NAN };
+
+    char buffer[64];
+
+    for (size_t i = 0; i < sizeof(INTEGERS) / sizeof(INTEGERS[0]); i++) {
+
+        PluviOnMessageWriter writer(buffer, sizeof(buffer));
+        String message;
+
+        writer += INTEGERS[i];
+        writer += (int) INTEGERS[i];
+        writer += (unsigned long) INTEGERS[i];
+        message += INTEGERS[i];
+        message += (int) INTEGERS[i];
+        message += (unsigned long) INTEGERS[i];
+
+        PLV_CHECK(strcmp(message.c_str(), writer.c_str()) == 0);
+    }
+
+    for (size_t i = 0; i < sizeof(FLOATS) / sizeof(FLOATS[0]); i++) {
+
+        PluviOnMessageWriter writer(buffer, sizeof(buffer));
+        String message;
+
+        writer += (float) FLOATS[i];
+        writer += '|';
+        writer.append(FLOATS[i], 6);
+        message += (float) FLOATS[i];
+        message += '|';
+        message += String(FLOATS[i], 6);
+
+        PLV_CHECK(strcmp(message.c_str(), writer.c_str()) == 0);
+    }
+}
+
+PLV_TEST(noHeap) {
+
+    char buffer[128];
+    String station("PluviOn_1A2B3C");
+
+    hostHeapReset();
+
+    PluviOnMessageWriter writer(buffer, sizeof(buffer));
+    writer += 1234;
+    writer += F("|");
+    writer += station;
+    writer += "|";
+    writer += 23.4f;
+    writer += '|';
+    writer += 4000000000UL;
+
+    PLV_CHECK_EQUAL(0UL, hostHeapStats().allocations);
+    PLV_CHECK(strcmp(writer.c_str(), "1234|PluviOn_1A2B3C|23.40|4000000000") == 0);
+}
+
+PLV_TEST(overflowDropsTheAppend) {
+
+    char buffer[8];
+    PluviOnMessageWriter writer(buffer, sizeof(buffer));
+
+    writer += "1234";
+    PLV_CHECK(!writer.overflow());
+
+    // Doesn't fit with the NUL: dropped whole, the message stays terminated
+    writer += "5678";
+    PLV_CHECK(writer.overflow());
+    PLV_CHECK_EQUAL((size_t) 4, writer.length());
+    PLV_CHECK(strcmp(writer.c_str(), "1234") == 0);
+
+    writer += "567";
+    PLV_CHECK(strcmp(writer.c_str(), "1234567") == 0);
+
+    writer.clear();
+    PLV_CHECK(!writer.overflow());
+    PLV_CHECK_EQUAL((size_t) 0, writer.length());
+}
+
+PLV_TEST_MAIN()
@@ -0,0 +1,255 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_sample_block.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnSampleBlock in the message log (PLV_MESSAGE_SAMPLE_BLOCK): the
+ * samples go in the newest record while no sink delivered it, round trips
+ * through the log, resume() and PluviOnMessageLog::update().
+ *
+ * Also writes sample_records.bin (the records as an offline batch) and
+ * sample_records.txt (its expected decoding), compared with the output of
+ * firmware/tools/pluvion_telemetry.py in the sample_block_python test.
+ */
+#include "PluviOnTest.h"
+#include <PluviOnMessageLog.h>
+#include <PluviOnTelemetry.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#define TEST_STATION_ID         "PLV0001"
+#define TEST_SAMPLES_PER_RECORD 32  // PLV_SAMPLES_PER_RECORD of the thingspeak firmware
+#define TEST_SAMPLES            70
+
+static PluviOnSample testSample(uint32_t i) {
+
+    PluviOnSample sample;
+    sample.messageID   = i;
+    sample.stationTime = 1539871200 + i * 300;
+    sample.tipCount    = i / 3;
+    sample.temperature = (235 + (int) (i % 9) - 4) / 10.0f;
+    sample.humidity    = i == 5 ? NAN : (650 - (int) (i % 5) * 7) / 10.0f;
+
+    return sample;
+}
+
+/**
+ * Save a sample as the thingspeak firmware does (saveSample()): in the
+ * newest block while it's unmarked and not full, otherwise in a new one
+ */
+static unsigned long saveSample(PluviOnMessageLog &log, unsigned long &sampleSeq, const PluviOnSample &sample) {
+
+    uint8_t buffer[PLV_LOG_PAYLOAD_SIZE];
+    PluviOnSampleBlock block(buffer, sizeof(buffer));
+
+    if (sampleSeq && !log.marks(sampleSeq)) {
+
+        int length = log.read(sampleSeq, buffer, sizeof(buffer));
+
+        if (length > 0 && block.resume(length) && block.count() < TEST_SAMPLES_PER_RECORD &&
+            block.add(sample) && log.update(sampleSeq, buffer, block.length())) {
+            return sampleSeq;
+        }
+    }
+
+    if (!block.begin(TEST_STATION_ID) || !block.add(sample)) {
+        return 0;
+    }
+
+    sampleSeq = log.append(buffer, block.length());
+
+    return sampleSeq;
+}
+
+static boolean sameSample(const PluviOnSample &expected, const PluviOnSample &actual) {
+
+    return expected.messageID == actual.messageID &&
+           expected.stationTime == actual.stationTime &&
+           expected.tipCount == actual.tipCount &&
+           fabs(expected.temperature - actual.temperature) < 0.01 &&
+           (isnan(expected.humidity) ? isnan(actual.humidity) : fabs(expected.humidity - actual.humidity) < 0.01);
+}
+
+/**
+ * x10 reading as pluvion_telemetry.py prints it (Python float repr)
+ */
+static void printFixed(FILE *f, float value) {
+
+    if (isnan(value)) {
+        fprintf(f, "nan");
+        return;
+    }
+
+    int fixed = (int) lroundf(value * 10);
+    fprintf(f, "%s%d.%d", fixed < 0 ? "-" : "", abs(fixed) / 10, abs(fixed) % 10);
+}
+
+PLV_TEST(samplesShareTheNewestRecord) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+
+    unsigned long sampleSeq = 0;
+
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++) {
+        PLV_CHECK(saveSample(log, sampleSeq, testSample(i)) != 0);
+    }
+
+    // 32 + 32 + 6 samples, not one record each
+    PLV_CHECK_EQUAL(3UL, log.pending());
+
+    uint8_t       payload[PLV_LOG_PAYLOAD_SIZE];
+    PluviOnSample samples[TEST_SAMPLES_PER_RECORD];
+    uint32_t      next = 0;
+    size_t        bytes = 0;
+
+    for (unsigned long seq = log.first(); seq; seq = log.next(seq)) {
+
+        int length = log.read(seq, payload, sizeof(payload));
+        PLV_CHECK(length > 0);
+        bytes += length;
+
+        int count = PluviOnSampleBlock::decode(payload, length, samples, TEST_SAMPLES_PER_RECORD);
+        PLV_CHECK(count > 0);
+
+        for (int n = 0; n < count; n++) {
+            PLV_CHECK(sameSample(testSample(next++), samples[n]));
+        }
+    }
+
+    PLV_CHECK_EQUAL((uint32_t) TEST_SAMPLES, next);
+
+    // Deltas: well under a one sample block (~20 bytes) per sample
+    printf("  %d samples: %lu records, %lu bytes of payload\n", TEST_SAMPLES, log.pending(), (unsigned long) bytes);
+    PLV_CHECK(bytes < TEST_SAMPLES * 10);
+
+    // Kept across a reset, the newest block gets the next samples
+    PluviOnTest::reboot();
+    PluviOnMessageLog recovered;
+    PLV_CHECK(recovered.begin());
+    PLV_CHECK_EQUAL(sampleSeq, saveSample(recovered, sampleSeq, testSample(next)));
+    PLV_CHECK_EQUAL(3UL, recovered.pending());
+}
+
+PLV_TEST(deliveredRecordsAreNotRewritten) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+
+    unsigned long sampleSeq = 0;
+    PLV_CHECK_EQUAL(1UL, saveSample(log, sampleSeq, testSample(0)));
+    PLV_CHECK_EQUAL(1UL, saveSample(log, sampleSeq, testSample(1)));
+
+    // Delivered by a sink: the next sample starts a new record
+    PLV_CHECK(log.mark(1, 0x01));
+    uint8_t payload[PLV_LOG_PAYLOAD_SIZE];
+    int length = log.read(1, payload, sizeof(payload));
+    PLV_CHECK(!log.update(1, payload, length));
+    PLV_CHECK_EQUAL(2UL, saveSample(log, sampleSeq, testSample(2)));
+
+    // Only the newest pending record
+    PLV_CHECK(!log.update(1, payload, length));
+    PLV_CHECK(log.ack(2));
+    PLV_CHECK(!log.update(2, payload, length));
+    PLV_CHECK_EQUAL(3UL, saveSample(log, sampleSeq, testSample(3)));
+    PLV_CHECK(!log.update(3, payload, PLV_LOG_PAYLOAD_SIZE + 1));
+
+    // The delivered record is unchanged
+    PluviOnSample samples[4];
+    length = log.read(1, payload, sizeof(payload));
+    PLV_CHECK_EQUAL(2, PluviOnSampleBlock::decode(payload, length, samples, 4));
+}
+
+PLV_TEST(resumeChecksTheBlock) {
+
+    uint8_t buffer[64];
+    PluviOnSampleBlock block(buffer, sizeof(buffer));
+
+    PLV_CHECK(block.begin(TEST_STATION_ID));
+    PLV_CHECK(block.resume(block.length()));
+    PLV_CHECK_EQUAL(0, block.count());
+
+    PLV_CHECK(block.add(testSample(0)));
+    PLV_CHECK(block.add(testSample(1)));
+    size_t length = block.length();
+
+    // Truncated, trailing bytes, longer than the buffer, not a block
+    PluviOnSampleBlock other(buffer, sizeof(buffer));
+    PLV_CHECK(!other.resume(length - 1));
+    PLV_CHECK(!other.resume(length + 1));
+    PLV_CHECK(!other.resume(sizeof(buffer) + 1));
+    buffer[0] = PLV_TLM_MAGIC;
+    PLV_CHECK(!other.resume(length));
+    PLV_CHECK_EQUAL((size_t) 0, other.length());
+    buffer[0] = PLV_BLK_MAGIC;
+
+    // Resumed: the deltas go on from the last sample
+    PLV_CHECK(other.resume(length));
+    PLV_CHECK(other.add(testSample(2)));
+
+    PluviOnSample samples[3];
+    PLV_CHECK_EQUAL(3, PluviOnSampleBlock::decode(buffer, other.length(), samples, 3));
+    for (uint32_t i = 0; i < 3; i++) {
+        PLV_CHECK(sameSample(testSample(i), samples[i]));
+    }
+}
+
+/**
+ * The records as an offline batch (blocks concatenated, offline flag) and
+ * the decoding pluvion_telemetry.py must print
+ */
+PLV_TEST(writeTheDecoderFiles) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+
+    unsigned long sampleSeq = 0;
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++) {
+        PLV_CHECK(saveSample(log, sampleSeq, testSample(i)) != 0);
+    }
+
+    FILE *bin = fopen("sample_records.bin", "wb");
+    FILE *txt = fopen("sample_records.txt", "w");
+    PLV_CHECK(bin && txt);
+
+    uint8_t  payload[PLV_LOG_PAYLOAD_SIZE];
+    uint32_t next = 0;
+
+    for (unsigned long seq = log.first(); seq; seq = log.next(seq)) {
+
+        int length = log.read(seq, payload, sizeof(payload));
+        PLV_CHECK(length > 0);
+
+        PluviOnSampleBlock::markOffline(payload, length);
+        fwrite(payload, 1, length, bin);
+
+        fprintf(txt, "---\nversion: 1\nblock: True\noffline: True\nstationID: " TEST_STATION_ID "\n");
+
+        for (uint8_t n = 0; n < payload[3]; n++) {
+
+            PluviOnSample sample = testSample(next++);
+
+            fprintf(txt, "  messageID=%u stationTime=%d tipCount=%u temperature=",
+                sample.messageID, sample.stationTime, sample.tipCount);
+            printFixed(txt, sample.temperature);
+            fprintf(txt, " humidity=");
+            printFixed(txt, sample.humidity);
+            fprintf(txt, "\n");
+        }
+    }
+
+    fclose(bin);
+    fclose(txt);
+
+    PLV_CHECK_EQUAL((uint32_t) TEST_SAMPLES, next);
+}
+
+PLV_TEST_MAIN()
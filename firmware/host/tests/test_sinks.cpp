@@ -0,0 +1,328 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_sinks.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnSinks: delivery marks kept in the log (across resets and clears),
+ * out of order deliveries, acknowledgement once every sink delivered, and
+ * what the link health of a sink is told.
+ */
+#include "PluviOnTest.h"
+#include <PluviOnSink.h>
+
+/**
+ * Test sink: delivers the seqs of its accept list (all of them if empty)
+ * from the ones it's started with, in one step
+ */
+struct TestSink {
+    unsigned long started;
+    unsigned long accept[8];
+    uint8_t       acceptCount;
+    uint8_t       batchSize;
+    unsigned long batch[8];
+    uint8_t       batchCount;
+    boolean       finish;       // Step returns DONE (otherwise BUSY)
+    boolean       fail;         // Step returns FAILED
+    boolean       refuse;       // Start returns false
+};
+
+static boolean startTestSink(PluviOnSink &sink, unsigned long seq, void *context) {
+
+    TestSink *test = (TestSink *) context;
+
+    if (test->refuse) {
+        return false;
+    }
+
+    test->started = seq;
+    test->batchCount = 0;
+
+    for (; seq && test->batchCount < test->batchSize; seq = sink.next(seq)) {
+        test->batch[test->batchCount++] = seq;
+    }
+
+    return true;
+}
+
+static PluviOnSinkStatus stepTestSink(PluviOnSink &sink, void *context) {
+
+    TestSink *test = (TestSink *) context;
+
+    if (test->fail) {
+        return PLV_SINK_FAILED;
+    }
+
+    if (!test->finish) {
+        return PLV_SINK_BUSY;
+    }
+
+    for (uint8_t i = 0; i < test->batchCount; i++) {
+
+        boolean accepted = test->acceptCount == 0;
+
+        for (uint8_t a = 0; a < test->acceptCount; a++) {
+            accepted = accepted || test->accept[a] == test->batch[i];
+        }
+
+        if (accepted) {
+            sink.deliver(test->batch[i]);
+        }
+    }
+
+    return PLV_SINK_DONE;
+}
+
+static void appendMessages(PluviOnMessageLog &log, int count) {
+    for (int i = 0; i < count; i++) {
+        log.append("message", 7);
+    }
+}
+
+PLV_TEST(ackedOnceEverySinkDelivered) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 3);
+
+    TestSink a = { 0, {}, 0, 8, {}, 0, true };
+    TestSink b = { 0, {}, 0, 8, {}, 0, false };
+    PluviOnSinks sinks(log);
+    PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+    PluviOnSink sinkB("b", startTestSink, stepTestSink, &b);
+    sinks.add(sinkA);
+    sinks.add(sinkB);
+
+    sinks.step();   // Both start
+    sinks.step();   // a delivers, b is busy
+
+    PLV_CHECK_EQUAL(0UL, sinkA.pending());
+    PLV_CHECK_EQUAL(3UL, sinkB.pending());
+    PLV_CHECK_EQUAL(3UL, log.pending());
+
+    b.finish = true;
+    sinks.step();
+
+    PLV_CHECK_EQUAL(0UL, log.pending());
+}
+
+PLV_TEST(outOfOrderAcksAreNotPostedAgain) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 5);
+
+    // The server acks 2 and 4 of 1..5
+    TestSink a = { 0, { 2, 4 }, 2, 5, {}, 0, true };
+    PluviOnSinks sinks(log);
+    PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+    sinks.add(sinkA);
+
+    sinks.step();
+    sinks.step();
+
+    PLV_CHECK_EQUAL(3UL, log.pending());
+    PLV_CHECK_EQUAL(3UL, sinkA.pending());
+
+    // Next batch: only the refused ones
+    a.acceptCount = 0;
+    sinkA.setBackoff(0, 0);
+    sinks.step();
+
+    PLV_CHECK_EQUAL(1UL, a.started);
+    PLV_CHECK_EQUAL((uint8_t) 3, a.batchCount);
+    PLV_CHECK_EQUAL(1UL, a.batch[0]);
+    PLV_CHECK_EQUAL(3UL, a.batch[1]);
+    PLV_CHECK_EQUAL(5UL, a.batch[2]);
+}
+
+PLV_TEST(marksKeptAcrossResets) {
+
+    {
+        PluviOnMessageLog log;
+        PLV_CHECK(log.begin());
+        appendMessages(log, 4);
+
+        // a delivers everything, b only 1 and 3 (b holds 2 and 4)
+        TestSink a = { 0, {}, 0, 8, {}, 0, true };
+        TestSink b = { 0, { 1, 3 }, 2, 8, {}, 0, true };
+        PluviOnSinks sinks(log);
+        PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+        PluviOnSink sinkB("b", startTestSink, stepTestSink, &b);
+        sinks.add(sinkA);
+        sinks.add(sinkB);
+
+        sinks.step();
+        sinks.step();
+
+        PLV_CHECK_EQUAL(2UL, log.pending());
+    }
+
+    PluviOnTest::reboot();
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+
+    TestSink a = { 0, {}, 0, 8, {}, 0, true };
+    TestSink b = { 0, {}, 0, 8, {}, 0, true };
+    PluviOnSinks sinks(log);
+    PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+    PluviOnSink sinkB("b", startTestSink, stepTestSink, &b);
+    sinks.add(sinkA);
+    sinks.add(sinkB);
+
+    // a has nothing to deliver again, b gets only what it didn't deliver
+    PLV_CHECK_EQUAL(2UL, log.pending());
+    PLV_CHECK_EQUAL(0UL, sinkA.pending());
+    PLV_CHECK_EQUAL(2UL, sinkB.pending());
+
+    sinks.step();
+
+    PLV_CHECK_EQUAL(0UL, a.started);
+    PLV_CHECK_EQUAL(2UL, b.started);
+    PLV_CHECK_EQUAL((uint8_t) 2, b.batchCount);
+    PLV_CHECK_EQUAL(4UL, b.batch[1]);
+}
+
+PLV_TEST(clearDuringADelivery) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 3);
+
+    TestSink a = { 0, {}, 0, 8, {}, 0, false };
+    PluviOnSinks sinks(log);
+    PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+    sinks.add(sinkA);
+
+    sinks.step();
+    PLV_CHECK(sinkA.busy());
+
+    // New messages with the same seqs as the ones being delivered
+    PLV_CHECK(log.clear());
+    sinks.reset();
+    appendMessages(log, 3);
+
+    a.finish = true;
+    sinks.step();
+
+    // Not taken for the old ones
+    PLV_CHECK(!sinkA.busy());
+    PLV_CHECK_EQUAL(3UL, log.pending());
+    PLV_CHECK_EQUAL(3UL, sinkA.pending());
+
+    sinkA.setBackoff(0, 0);
+    sinks.step();
+    sinks.step();
+
+    PLV_CHECK_EQUAL(0UL, log.pending());
+}
+
+PLV_TEST(latestOnlySinkDoesntHold) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 3);
+
+    TestSink a = { 0, {}, 0, 8, {}, 0, false };
+    TestSink latest = { 0, {}, 0, 8, {}, 0, true };
+    PluviOnSinks sinks(log);
+    PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+    PluviOnSink sinkLatest("latest", startTestSink, stepTestSink, &latest);
+    sinkLatest.setLatestOnly(true);
+    sinks.add(sinkA);
+    sinks.add(sinkLatest);
+
+    sinks.step();
+    sinks.step();
+
+    PLV_CHECK_EQUAL(3UL, latest.started);
+    PLV_CHECK_EQUAL(3UL, log.pending());
+
+    // Once delivered, not again until a newer message
+    sinks.step();
+    PLV_CHECK_EQUAL(1UL, sinkLatest.deliveries());
+
+    // a delivers: acknowledged, the latest only sink doesn't hold them
+    a.finish = true;
+    sinks.step();
+    PLV_CHECK_EQUAL(0UL, log.pending());
+}
+
+PLV_TEST(linkOnlyCountsTransportFailures) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 1);
+
+    // The server answers but accepts nothing
+    TestSink a = { 0, { 99 }, 1, 8, {}, 0, true };
+    PluviOnLinkHealth link;
+    PluviOnSinks sinks(log);
+    PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+    sinkA.setLinkHealth(&link);
+    link.setThreshold(2);
+    sinks.add(sinkA);
+
+    for (int i = 0; i < 6; i++) {
+        sinks.step();
+    }
+
+    // The sink backs off, the link is fine
+    PLV_CHECK_EQUAL(3UL, sinkA.failures());
+    PLV_CHECK_EQUAL(3UL, link.successes());
+    PLV_CHECK_EQUAL(0UL, link.failures());
+    PLV_CHECK_EQUAL(PLV_LINK_CLOSED, link.state());
+
+    // Connection failures open it
+    a.fail = true;
+    for (int i = 0; i < 4; i++) {
+        sinks.step();
+    }
+
+    PLV_CHECK_EQUAL(2UL, link.failures());
+    PLV_CHECK_EQUAL(PLV_LINK_OPEN, link.state());
+}
+
+PLV_TEST(probeGivenBackWhenNotStarted) {
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 1);
+
+    TestSink a = { 0, {}, 0, 8, {}, 0, true };
+    a.fail = true;
+    PluviOnLinkHealth link;
+    PluviOnSinks sinks(log);
+    PluviOnSink sinkA("a", startTestSink, stepTestSink, &a);
+    sinkA.setLinkHealth(&link);
+    link.setThreshold(1);
+    link.setBackoff(0, 0);
+    sinks.add(sinkA);
+
+    sinks.step();
+    sinks.step();
+    PLV_CHECK_EQUAL(PLV_LINK_OPEN, link.state());
+
+    // The probe doesn't start: the next start probes again
+    a.refuse = true;
+    sinks.step();
+    PLV_CHECK_EQUAL(PLV_LINK_OPEN, link.state());
+    PLV_CHECK_EQUAL(0UL, link.probes());
+
+    a.refuse = false;
+    a.fail = false;
+    sinks.step();
+    sinks.step();
+    PLV_CHECK_EQUAL(1UL, link.probes());
+    PLV_CHECK_EQUAL(PLV_LINK_CLOSED, link.state());
+    PLV_CHECK_EQUAL(0UL, log.pending());
+}
+
+PLV_TEST_MAIN()
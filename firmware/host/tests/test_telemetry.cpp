@@ -0,0 +1,382 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_telemetry.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnTelemetry frames (PLV_MESSAGE_BINARY): when a frame is a keyframe,
+ * and the varint / zigzag / x100 fields read back as they were encoded.
+ *
+ * Also writes telemetry_frames.bin (frames as an offline batch) and
+ * telemetry_frames.txt (its expected decoding), compared with the output of
+ * firmware/tools/pluvion_telemetry.py in the telemetry_python test.
+ */
+#include "PluviOnTest.h"
+#include <PluviOnTelemetry.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+#define TEST_STATION_ID "PLV0001"
+#define TEST_FRAME_SIZE 256
+
+// x100 value of a float the frame can't hold (PLV_TLM_INVALID_FIXED)
+#define TEST_INVALID_FIXED ((int32_t) 0x80000000)
+
+static PluviOnTelemetrySample testSample(uint32_t i) {
+
+    PluviOnTelemetrySample sample;
+    sample.messageID       = i;
+    sample.stationTime     = 1539871200 + i * 600;
+    sample.rainVolume      = i * 0.25f;
+    sample.tipCount        = i;
+    sample.temperature     = 23.5f - i;
+    sample.humidity        = 65.0f;
+    sample.heatIndex       = 24.25f;
+    sample.freeHeap        = 21000;
+    sample.freeDiskBytes   = 900000;
+    sample.freeDiskPercent = 85.5f;
+    sample.rssi            = -70;
+    sample.vcc             = 3300;
+    sample.timeToReset     = 86400 - i * 600;
+    sample.reset           = i == 0;
+
+    return sample;
+}
+
+static PluviOnTelemetryConfig testConfig(const char *firmwareVersion) {
+
+    PluviOnTelemetryConfig config;
+    config.stationName       = "Pluvi.On";
+    config.latitude          = "-23.5505";
+    config.longitude         = "-46.6333";
+    config.bucketVolume      = 3.25f;
+    config.dhtReadingDelay   = 600000;
+    config.hallDebounceDelay = 250;
+    config.firmwareVersion   = firmwareVersion;
+    config.resetReason       = "Power on";
+    config.ssid              = "pluvion";
+    config.localIp           = "192.168.0.10";
+    config.hostname          = "PLV0001";
+    config.macAddr           = "5C:CF:7F:00:00:01";
+
+    return config;
+}
+
+/**
+ * A frame read back field by field (as pluvion_telemetry.py does)
+ */
+struct TestFrame {
+    uint8_t     flags;
+    std::string stationID;
+    uint32_t    messageID;
+    int32_t     stationTime;
+    int32_t     rainVolume;      // x100
+    uint32_t    tipCount;
+    int32_t     temperature;     // x100
+    int32_t     humidity;        // x100
+    int32_t     heatIndex;       // x100
+    uint32_t    freeHeap;
+    uint32_t    freeDiskBytes;
+    int32_t     freeDiskPercent; // x100
+    int32_t     rssi;
+    uint32_t    vcc;
+    int32_t     timeToReset;
+    std::string strings[9];      // Config strings, in PluviOnTelemetryConfig order
+    int32_t     bucketVolume;    // x100
+    uint32_t    dhtReadingDelay;
+    uint32_t    hallDebounceDelay;
+};
+
+struct TestReader {
+    const uint8_t *data;
+    size_t         length;
+    size_t         pos;
+    boolean        invalid;
+
+    uint8_t byte() {
+        if (pos >= length) {
+            invalid = true;
+            return 0;
+        }
+        return data[pos++];
+    }
+
+    uint32_t uvarint() {
+        uint32_t value = 0;
+        for (uint8_t shift = 0; shift < 35; shift += 7) {
+            uint8_t b = byte();
+            value |= (uint32_t) (b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                return value;
+            }
+        }
+        invalid = true;
+        return 0;
+    }
+
+    int32_t svarint() {
+        uint32_t value = uvarint();
+        return (int32_t) ((value >> 1) ^ (0 - (value & 1)));
+    }
+
+    std::string str() {
+        uint32_t size = uvarint();
+        if (pos + size > length) {
+            invalid = true;
+            return "";
+        }
+        std::string value((const char *) data + pos, size);
+        pos += size;
+        return value;
+    }
+};
+
+/**
+ * @return true if the buffer holds exactly one valid frame
+ */
+static boolean readFrame(const uint8_t *data, size_t length, TestFrame &frame) {
+
+    TestReader r = { data, length, 0, false };
+
+    if (r.byte() != PLV_TLM_MAGIC || r.byte() != PLV_TLM_SCHEMA_VERSION) {
+        return false;
+    }
+
+    frame.flags           = r.byte();
+    frame.stationID       = r.str();
+    frame.messageID       = r.uvarint();
+    frame.stationTime     = r.svarint();
+    frame.rainVolume      = r.svarint();
+    frame.tipCount        = r.uvarint();
+    frame.temperature     = r.svarint();
+    frame.humidity        = r.svarint();
+    frame.heatIndex       = r.svarint();
+    frame.freeHeap        = r.uvarint();
+    frame.freeDiskBytes   = r.uvarint();
+    frame.freeDiskPercent = r.svarint();
+    frame.rssi            = r.svarint();
+    frame.vcc             = r.uvarint();
+    frame.timeToReset     = r.svarint();
+
+    if (frame.flags & PLV_TLM_FLAG_KEYFRAME) {
+        frame.strings[0]        = r.str();
+        frame.strings[1]        = r.str();
+        frame.strings[2]        = r.str();
+        frame.bucketVolume      = r.svarint();
+        frame.dhtReadingDelay   = r.uvarint();
+        frame.hallDebounceDelay = r.uvarint();
+        for (int i = 3; i < 9; i++) {
+            frame.strings[i] = r.str();
+        }
+    }
+
+    return !r.invalid && r.pos == length;
+}
+
+static boolean isKeyframe(PluviOnTelemetry &telemetry, const PluviOnTelemetrySample &sample,
+                          const PluviOnTelemetryConfig &config) {
+
+    uint8_t frame[TEST_FRAME_SIZE];
+    size_t  length = telemetry.encode(TEST_STATION_ID, sample, config, frame, sizeof(frame));
+
+    return length > 0 && (frame[2] & PLV_TLM_FLAG_KEYFRAME);
+}
+
+PLV_TEST(keyframes) {
+
+    PluviOnTelemetry       telemetry;
+    PluviOnTelemetryConfig config = testConfig("1.0.0");
+
+    // The first frame, then every PLV_TLM_KEYFRAME_INTERVAL frames
+    PLV_CHECK(isKeyframe(telemetry, testSample(0), config));
+    for (int i = 1; i < PLV_TLM_KEYFRAME_INTERVAL; i++) {
+        PLV_CHECK(!isKeyframe(telemetry, testSample(i), config));
+    }
+    PLV_CHECK(isKeyframe(telemetry, testSample(PLV_TLM_KEYFRAME_INTERVAL), config));
+    PLV_CHECK(!isKeyframe(telemetry, testSample(1), config));
+
+    // A config change (its checksum), once
+    PluviOnTelemetryConfig updated = testConfig("1.0.1");
+    PLV_CHECK(isKeyframe(telemetry, testSample(2), updated));
+    PLV_CHECK(!isKeyframe(telemetry, testSample(3), updated));
+
+    updated.hallDebounceDelay = 300;
+    PLV_CHECK(isKeyframe(telemetry, testSample(4), updated));
+
+    // Requested, and still due after a frame that didn't fit
+    telemetry.forceKeyframe();
+    uint8_t small[16];
+    PLV_CHECK_EQUAL((size_t) 0, telemetry.encode(TEST_STATION_ID, testSample(5), updated, small, sizeof(small)));
+    PLV_CHECK(isKeyframe(telemetry, testSample(5), updated));
+    PLV_CHECK(!isKeyframe(telemetry, testSample(6), updated));
+}
+
+PLV_TEST(fieldsRoundTrip) {
+
+    PluviOnTelemetry       telemetry;
+    PluviOnTelemetryConfig config = testConfig("1.0.0");
+
+    PluviOnTelemetrySample sample = testSample(0);
+    sample.messageID       = 0xFFFFFFFF;
+    sample.stationTime     = -2147483647 - 1;
+    sample.rainVolume      = 0.0f;
+    sample.temperature     = -5.25f;
+    sample.humidity        = NAN;
+    sample.heatIndex       = INFINITY;
+    sample.freeDiskPercent = 99.99f;
+    sample.rssi            = -1;
+    sample.timeToReset     = -3600;
+
+    uint8_t   buffer[TEST_FRAME_SIZE];
+    size_t    length = telemetry.encode(TEST_STATION_ID, sample, config, buffer, sizeof(buffer));
+    TestFrame frame;
+
+    PLV_CHECK(length > 0);
+    PLV_CHECK(readFrame(buffer, length, frame));
+
+    PLV_CHECK_EQUAL((uint8_t) (PLV_TLM_FLAG_KEYFRAME | PLV_TLM_FLAG_RESET), frame.flags);
+    PLV_CHECK(frame.stationID == TEST_STATION_ID);
+    PLV_CHECK_EQUAL(0xFFFFFFFFU, frame.messageID);
+    PLV_CHECK_EQUAL(-2147483647 - 1, frame.stationTime);
+    PLV_CHECK_EQUAL(0, frame.rainVolume);
+    PLV_CHECK_EQUAL(-525, frame.temperature);
+    PLV_CHECK_EQUAL(TEST_INVALID_FIXED, frame.humidity);
+    PLV_CHECK_EQUAL(TEST_INVALID_FIXED, frame.heatIndex);
+    PLV_CHECK_EQUAL(21000U, frame.freeHeap);
+    PLV_CHECK_EQUAL(9999, frame.freeDiskPercent);
+    PLV_CHECK_EQUAL(-1, frame.rssi);
+    PLV_CHECK_EQUAL(3300U, frame.vcc);
+    PLV_CHECK_EQUAL(-3600, frame.timeToReset);
+    PLV_CHECK(frame.strings[0] == "Pluvi.On");
+    PLV_CHECK(frame.strings[8] == "5C:CF:7F:00:00:01");
+    PLV_CHECK_EQUAL(325, frame.bucketVolume);
+    PLV_CHECK_EQUAL(600000U, frame.dhtReadingDelay);
+    PLV_CHECK_EQUAL(250U, frame.hallDebounceDelay);
+
+    // Varint sizes: 7 bits per byte, zigzag keeps small negative values small
+    PluviOnTelemetry sizes;
+    sizes.encode(TEST_STATION_ID, sample, config, buffer, sizeof(buffer));
+
+    sample.messageID = 127;
+    size_t oneByte = sizes.encode(TEST_STATION_ID, sample, config, buffer, sizeof(buffer));
+    sample.messageID = 128;
+    PLV_CHECK_EQUAL(oneByte + 1, sizes.encode(TEST_STATION_ID, sample, config, buffer, sizeof(buffer)));
+
+    sample.rssi = -64;
+    size_t rssi = sizes.encode(TEST_STATION_ID, sample, config, buffer, sizeof(buffer));
+    sample.rssi = -65;
+    PLV_CHECK_EQUAL(rssi + 1, sizes.encode(TEST_STATION_ID, sample, config, buffer, sizeof(buffer)));
+    PLV_CHECK(readFrame(buffer, rssi + 1, frame));
+    PLV_CHECK_EQUAL(-65, frame.rssi);
+}
+
+/**
+ * x100 value as pluvion_telemetry.py prints it (Python float repr)
+ */
+static void printFixed(FILE *f, int32_t fixed) {
+
+    if (fixed == TEST_INVALID_FIXED) {
+        fprintf(f, "nan");
+        return;
+    }
+
+    int32_t magnitude = fixed < 0 ? -fixed : fixed;
+    int32_t decimals  = magnitude % 100;
+
+    fprintf(f, "%s%d.", fixed < 0 ? "-" : "", magnitude / 100);
+
+    if (decimals % 10 == 0) {
+        fprintf(f, "%d", decimals / 10);
+    } else {
+        fprintf(f, "%02d", decimals);
+    }
+}
+
+static void printFrame(FILE *f, const TestFrame &frame) {
+
+    static const char *strings[] = {
+        "stationName", "latitude", "longitude", "firmwareVersion", "resetReason",
+        "ssid", "localIp", "hostname", "macAddr"
+    };
+
+    const char *flag[] = { "False", "True" };
+
+    fprintf(f, "---\nversion: 1\nkeyframe: %s\nreset: %s\noffline: %s\nstationID: %s\n",
+        flag[(frame.flags & PLV_TLM_FLAG_KEYFRAME) != 0],
+        flag[(frame.flags & PLV_TLM_FLAG_RESET) != 0],
+        flag[(frame.flags & PLV_TLM_FLAG_OFFLINE) != 0],
+        frame.stationID.c_str());
+
+    fprintf(f, "messageID: %u\nstationTime: %d\nrainVolume: ", frame.messageID, frame.stationTime);
+    printFixed(f, frame.rainVolume);
+    fprintf(f, "\ntipCount: %u\ntemperature: ", frame.tipCount);
+    printFixed(f, frame.temperature);
+    fprintf(f, "\nhumidity: ");
+    printFixed(f, frame.humidity);
+    fprintf(f, "\nheatIndex: ");
+    printFixed(f, frame.heatIndex);
+    fprintf(f, "\nfreeHeap: %u\nfreeDiskBytes: %u\nfreeDiskPercent: ", frame.freeHeap, frame.freeDiskBytes);
+    printFixed(f, frame.freeDiskPercent);
+    fprintf(f, "\nrssi: %d\nvcc: %u\ntimeToReset: %d\n", frame.rssi, frame.vcc, frame.timeToReset);
+
+    if (!(frame.flags & PLV_TLM_FLAG_KEYFRAME)) {
+        return;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        fprintf(f, "%s: %s\n", strings[i], frame.strings[i].c_str());
+    }
+    fprintf(f, "bucketVolume: ");
+    printFixed(f, frame.bucketVolume);
+    fprintf(f, "\ndhtReadingDelay: %u\nhallDebounceDelay: %u\n", frame.dhtReadingDelay, frame.hallDebounceDelay);
+    for (int i = 3; i < 9; i++) {
+        fprintf(f, "%s: %s\n", strings[i], frame.strings[i].c_str());
+    }
+}
+
+/**
+ * Frames as an offline batch (keyframes, deltas, a config change, NaN and
+ * negative values) and the decoding pluvion_telemetry.py must print
+ */
+PLV_TEST(writeTheDecoderFiles) {
+
+    PluviOnTelemetry       telemetry;
+    PluviOnTelemetryConfig config = testConfig("1.0.0");
+
+    FILE *bin = fopen("telemetry_frames.bin", "wb");
+    FILE *txt = fopen("telemetry_frames.txt", "w");
+    PLV_CHECK(bin && txt);
+
+    for (uint32_t i = 0; i < 6; i++) {
+
+        PluviOnTelemetrySample sample = testSample(i);
+        if (i == 3) {
+            sample.humidity = NAN;
+            config = testConfig("1.0.1");
+        }
+
+        uint8_t   buffer[TEST_FRAME_SIZE];
+        size_t    length = telemetry.encode(TEST_STATION_ID, sample, config, buffer, sizeof(buffer));
+        TestFrame frame;
+
+        PLV_CHECK(length > 0);
+        PluviOnTelemetry::markOffline(buffer, length);
+        PLV_CHECK(readFrame(buffer, length, frame));
+
+        fwrite(buffer, 1, length, bin);
+        printFrame(txt, frame);
+    }
+
+    fclose(bin);
+    fclose(txt);
+}
+
+PLV_TEST_MAIN()
@@ -0,0 +1,206 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_tip_debouncer.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnTipDebouncer: glitches, bounces, lost edges and the start from an
+ * active sensor, and the tip time handed to the rain windows is the edge
+ * time, however late the edges are processed (the recordings of real
+ * pulses are replayed by the TipReplay example).
+ */
+#include "PluviOnTest.h"
+#include <PluviOnTipDebouncer.h>
+
+#define TEST_MIN_PULSE_WIDTH 2000   // us
+#define TEST_PULSE_WIDTH     10000  // us
+#define TEST_START           1000000UL
+
+/**
+ * Feed a tip (active edge and release) whose active edge was ageInMicros ago
+ */
+static boolean pastTip(PluviOnTipDebouncer &debouncer, uint32_t ageInMicros) {
+
+    uint32_t edge = (uint32_t) micros() - ageInMicros;
+
+    debouncer.edge(edge, LOW);
+    return debouncer.edge(edge + TEST_PULSE_WIDTH, HIGH);
+}
+
+static boolean near(unsigned long expected, unsigned long actual) {
+    long difference = (long) (actual - expected);
+    return difference >= -2 && difference <= 2;
+}
+
+/**
+ * Feed a tip whose active edge is at timestampInMicros
+ */
+static boolean tipAt(PluviOnTipDebouncer &debouncer, uint32_t timestampInMicros) {
+    debouncer.edge(timestampInMicros, LOW);
+    return debouncer.edge(timestampInMicros + TEST_PULSE_WIDTH, HIGH);
+}
+
+static void startIdle(PluviOnTipDebouncer &debouncer) {
+    debouncer.setMinPulseWidth(TEST_MIN_PULSE_WIDTH);
+    debouncer.begin(HIGH);
+}
+
+PLV_TEST(glitchShorterThanTheMinPulseWidth) {
+
+    PluviOnTipDebouncer debouncer;
+    startIdle(debouncer);
+
+    PLV_CHECK(!debouncer.edge(TEST_START, LOW));
+    PLV_CHECK_EQUAL(PLV_TIP_PULSE, debouncer.state());
+    PLV_CHECK(!debouncer.edge(TEST_START + TEST_MIN_PULSE_WIDTH - 1, HIGH));
+    PLV_CHECK_EQUAL(PLV_TIP_IDLE, debouncer.state());
+    PLV_CHECK_EQUAL(1UL, debouncer.glitches());
+    PLV_CHECK_EQUAL(0UL, debouncer.tips());
+
+    // A glitch doesn't start the refractory period; the min width is a tip
+    PLV_CHECK(!debouncer.edge(TEST_START + 10000, LOW));
+    PLV_CHECK(debouncer.edge(TEST_START + 10000 + TEST_MIN_PULSE_WIDTH, HIGH));
+    PLV_CHECK_EQUAL(1UL, debouncer.tips());
+    PLV_CHECK_EQUAL(TEST_START + 10000, debouncer.lastTipInMicros());
+}
+
+PLV_TEST(bounceWithinTheRefractoryPeriod) {
+
+    PluviOnTipDebouncer debouncer;
+    startIdle(debouncer);
+
+    PLV_CHECK(tipAt(debouncer, TEST_START));
+
+    // The swing back of the bucket: active edge and release, ignored
+    PLV_CHECK(!tipAt(debouncer, TEST_START + 100000));
+    PLV_CHECK(!tipAt(debouncer, TEST_START + PLV_TIP_REFRACTORY - 1));
+
+    PLV_CHECK_EQUAL(1UL, debouncer.tips());
+    PLV_CHECK_EQUAL(2UL, debouncer.bounces());
+    PLV_CHECK_EQUAL(0UL, debouncer.glitches());
+    PLV_CHECK_EQUAL(TEST_START, debouncer.lastTipInMicros());
+    PLV_CHECK_EQUAL(PLV_TIP_IDLE, debouncer.state());
+}
+
+PLV_TEST(tipsJustOutsideTheRefractoryPeriod) {
+
+    PluviOnTipDebouncer debouncer;
+    startIdle(debouncer);
+
+    PLV_CHECK(tipAt(debouncer, TEST_START));
+    PLV_CHECK(tipAt(debouncer, TEST_START + PLV_TIP_REFRACTORY));
+    PLV_CHECK_EQUAL(TEST_START + PLV_TIP_REFRACTORY, debouncer.lastTipInMicros());
+
+    // Across the micros() wrap
+    uint32_t wrap = 0xFFFFFFFF - PLV_TIP_REFRACTORY / 2 + 1;
+    PLV_CHECK(tipAt(debouncer, wrap));
+    PLV_CHECK(!tipAt(debouncer, wrap + PLV_TIP_REFRACTORY - 2));
+    PLV_CHECK(tipAt(debouncer, wrap + PLV_TIP_REFRACTORY));
+
+    PLV_CHECK_EQUAL(4UL, debouncer.tips());
+    PLV_CHECK_EQUAL(1UL, debouncer.bounces());
+}
+
+PLV_TEST(activeEdgeWithoutReleaseRestartsThePulse) {
+
+    PluviOnTipDebouncer debouncer;
+    startIdle(debouncer);
+
+    // The release was lost: the pulse is measured from the second active edge
+    PLV_CHECK(!debouncer.edge(TEST_START, LOW));
+    PLV_CHECK(!debouncer.edge(TEST_START + 5000, LOW));
+    PLV_CHECK_EQUAL(PLV_TIP_PULSE, debouncer.state());
+    PLV_CHECK(debouncer.edge(TEST_START + 5000 + TEST_PULSE_WIDTH, HIGH));
+    PLV_CHECK_EQUAL(TEST_START + 5000, debouncer.lastTipInMicros());
+
+    // So a restart right before the release is a glitch
+    uint32_t next = TEST_START + PLV_TIP_REFRACTORY * 2;
+    PLV_CHECK(!debouncer.edge(next, LOW));
+    PLV_CHECK(!debouncer.edge(next + TEST_PULSE_WIDTH, LOW));
+    PLV_CHECK(!debouncer.edge(next + TEST_PULSE_WIDTH + 1000, HIGH));
+
+    PLV_CHECK_EQUAL(1UL, debouncer.tips());
+    PLV_CHECK_EQUAL(1UL, debouncer.glitches());
+}
+
+PLV_TEST(releaseWithoutActiveEdgeIsIgnored) {
+
+    PluviOnTipDebouncer debouncer;
+    startIdle(debouncer);
+
+    // The active edge was dropped with the event ring full
+    PLV_CHECK(!debouncer.edge(TEST_START, HIGH));
+    PLV_CHECK_EQUAL(PLV_TIP_IDLE, debouncer.state());
+    PLV_CHECK_EQUAL(0UL, debouncer.tips());
+    PLV_CHECK_EQUAL(0UL, debouncer.glitches());
+    PLV_CHECK_EQUAL(0UL, debouncer.bounces());
+
+    PLV_CHECK(tipAt(debouncer, TEST_START + 1000));
+    PLV_CHECK(!debouncer.edge(TEST_START + 2 * TEST_PULSE_WIDTH, HIGH));
+    PLV_CHECK_EQUAL(1UL, debouncer.tips());
+}
+
+PLV_TEST(beginWithTheSensorActive) {
+
+    // The bucket stopped over the sensor: the tip counts on the release
+    PluviOnTipDebouncer debouncer;
+    debouncer.setMinPulseWidth(TEST_MIN_PULSE_WIDTH);
+
+    uint32_t start = PLV_EDGE_TIME(micros());
+    debouncer.begin(LOW);
+    PLV_CHECK_EQUAL(PLV_TIP_PULSE, debouncer.state());
+
+    PLV_CHECK(debouncer.edge(start + TEST_PULSE_WIDTH, HIGH));
+    PLV_CHECK((uint32_t) (debouncer.lastTipInMicros() - start) < 1000);
+
+    // Released right after begin(): a glitch
+    PluviOnTipDebouncer released;
+    released.setMinPulseWidth(TEST_MIN_PULSE_WIDTH);
+
+    start = PLV_EDGE_TIME(micros());
+    released.begin(LOW);
+    PLV_CHECK(!released.edge(start + 100, HIGH));
+    PLV_CHECK_EQUAL(1UL, released.glitches());
+}
+
+PLV_TEST(maxTipRateSetsTheRefractoryPeriod) {
+
+    PluviOnTipDebouncer debouncer;
+    startIdle(debouncer);
+    debouncer.setMaxTipRate(2);
+
+    PLV_CHECK(tipAt(debouncer, TEST_START));
+    PLV_CHECK(!tipAt(debouncer, TEST_START + 499999));
+    PLV_CHECK(tipAt(debouncer, TEST_START + 500000));
+
+    // Not a rate: the period stays
+    debouncer.setMaxTipRate(0);
+    PLV_CHECK(!tipAt(debouncer, TEST_START + 999999));
+    PLV_CHECK(tipAt(debouncer, TEST_START + 1000000));
+
+    PLV_CHECK_EQUAL(3UL, debouncer.tips());
+    PLV_CHECK_EQUAL(2UL, debouncer.bounces());
+}
+
+PLV_TEST(tipTimeIsTheActiveEdge) {
+
+    PluviOnTipDebouncer debouncer;
+    debouncer.setMinPulseWidth(TEST_MIN_PULSE_WIDTH);
+    debouncer.begin(HIGH);
+
+    // Processed 3 s after the edge (a blocking request in the loop)
+    PLV_CHECK(pastTip(debouncer, 3000000UL));
+    PLV_CHECK(near(millis() - 3000, debouncer.lastTipInMillis()));
+
+    // Right away
+    PLV_CHECK(pastTip(debouncer, 50000UL));
+    PLV_CHECK(near(millis() - 50, debouncer.lastTipInMillis()));
+}
+
+PLV_TEST_MAIN()
@@ -0,0 +1,285 @@
+/**
+ * Pluvi.On is a library for the ESP8266/Arduino/Pluvi.On platform
+ *
+ *       FILE: test_udp_link.cpp
+ *    VERSION: 1.0.0
+ *    LICENSE: Creative Commons 4
+ *    AUTHORS:
+ *             Hugo Santos <hugo@pluvion.com.br>
+ *             Pedro Godoy <pedro@pluvion.com.br>
+ *
+ *       SITE: https://www.pluvion.com.br
+ *
+ * PluviOnUDPLink rounds against firmware/tools/pluvion_udp_server.py over a
+ * real UDP socket, with the server losing (--drop) and refusing (--refuse)
+ * datagrams: every seq acked once, the retransmit timeout and attempts, and
+ * duplicate acks. Needs python3 (PLV_TEST_PYTHON3, PLV_TEST_TOOLS_DIR).
+ */
+#include "PluviOnTest.h"
+#include <PluviOnMessageLog.h>
+#include <PluviOnUDPLink.h>
+#include "HostUDP.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_MESSAGES 20
+
+// Round limit, well above the retransmits of the tests
+#define TEST_ROUND_TIMEOUT 10000
+
+/**
+ * Start the server on a free port (--idle: it exits once the link stops sending)
+ *
+ * @param options Extra options (--drop, --refuse, --command)
+ * @return The server pipe, NULL if it didn't start
+ */
+static FILE *startServer(const char *options, uint16_t &port) {
+
+    char command[512];
+    snprintf(command, sizeof(command),
+             "%s %s/pluvion_udp_server.py --bind 127.0.0.1 --port 0 --idle 0.5 --seed 1 %s",
+             PLV_TEST_PYTHON3, PLV_TEST_TOOLS_DIR, options);
+
+    FILE *server = popen(command, "r");
+    if (!server) {
+        return NULL;
+    }
+
+    // "listening on 127.0.0.1:PORT/udp"
+    char     line[128];
+    unsigned value = 0;
+    if (!fgets(line, sizeof(line), server) || sscanf(line, "listening on 127.0.0.1:%u/udp", &value) != 1) {
+        pclose(server);
+        return NULL;
+    }
+
+    port = value;
+
+    return server;
+}
+
+struct TestServer {
+    int      messages;      // -1 without the summary line
+    unsigned duplicates;    // Retransmits it received
+    unsigned commands;      // Acks that carried the command
+};
+
+/**
+ * Wait for the server to exit and read what it printed
+ */
+static TestServer stopServer(FILE *server) {
+
+    TestServer result = { -1, 0, 0 };
+    char       line[128];
+    unsigned   messages;
+
+    while (fgets(line, sizeof(line), server)) {
+        if (strstr(line, " command sent: ")) {
+            result.commands++;
+        } else if (sscanf(line, "%u messages, %u duplicates", &messages, &result.duplicates) == 2) {
+            printf("  server: %s", line);
+            result.messages = messages;
+        }
+    }
+    pclose(server);
+
+    return result;
+}
+
+struct TestAcks {
+    unsigned count[TEST_MESSAGES + 1];  // Handler calls per seq
+    unsigned commands;                  // Acks with a command
+};
+
+static void countAck(unsigned long seq, const char *response, void *context) {
+
+    TestAcks *acks = (TestAcks *) context;
+
+    if (seq <= TEST_MESSAGES) {
+        acks->count[seq]++;
+    }
+
+    // "ok|<server time>|<time to reset>|<command>"
+    const char *command = strrchr(response, '|');
+    if (command && command[1]) {
+        acks->commands++;
+    }
+}
+
+static void appendMessages(PluviOnMessageLog &log, int count) {
+
+    char text[32];
+
+    for (int i = 0; i < count; i++) {
+        int length = snprintf(text, sizeof(text), "%d,23.50,65.00", 1539871200 + i * 60);
+        log.append(text, length);
+    }
+}
+
+/**
+ * Step the link as the firmware loop does, until the round ends
+ */
+static PluviOnUDPState runRound(PluviOnUDPLink &link) {
+
+    unsigned long   start = millis();
+    PluviOnUDPState state;
+
+    do {
+        state = link.step();
+        delay(1);
+    } while (state == PLV_UDP_SENDING && millis() - start < TEST_ROUND_TIMEOUT);
+
+    return state;
+}
+
+PLV_TEST(everySeqAckedOnce) {
+
+    uint16_t port;
+    FILE *server = startServer("--drop 0.3 --refuse 0.1", port);
+    PLV_CHECK(server);
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, TEST_MESSAGES);
+
+    HostUDP        udp;
+    PluviOnUDPLink link(udp, log);
+    TestAcks       acks;
+    memset(&acks, 0, sizeof(acks));
+
+    PLV_CHECK(link.begin(0));
+    link.setRetransmit(50, 20);
+    link.setAckHandler(countAck, &acks);
+
+    PLV_CHECK(link.start("127.0.0.1", port));
+    PLV_CHECK_EQUAL(PLV_UDP_DONE, runRound(link));
+    PLV_CHECK_EQUAL(PLV_UDP_IDLE, link.step());
+
+    for (int seq = 1; seq <= TEST_MESSAGES; seq++) {
+        PLV_CHECK_EQUAL(1U, acks.count[seq]);
+    }
+    PLV_CHECK_EQUAL((unsigned long) TEST_MESSAGES, link.acks());
+    PLV_CHECK_EQUAL(0UL, log.pending());
+    PLV_CHECK(link.retransmits() > 0);
+
+    PLV_CHECK_EQUAL(TEST_MESSAGES, stopServer(server).messages);
+}
+
+/**
+ * Without "ok" acks a message is sent _maxAttempts times, _timeout apart,
+ * then the round fails and the message stays in the log
+ */
+static void checkGivesUp(const char *options) {
+
+    uint16_t port;
+    FILE *server = startServer(options, port);
+    PLV_CHECK(server);
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 1);
+
+    HostUDP        udp;
+    PluviOnUDPLink link(udp, log);
+    TestAcks       acks;
+    memset(&acks, 0, sizeof(acks));
+
+    PLV_CHECK(link.begin(0));
+    link.setRetransmit(100, 3);
+    link.setAckHandler(countAck, &acks);
+
+    PLV_CHECK(link.start("127.0.0.1", port));
+
+    unsigned long   start    = millis();
+    unsigned long   lastSend = start;
+    unsigned long   sent     = 0;
+    PluviOnUDPState state;
+
+    do {
+        unsigned long before = millis();
+        state = link.step();
+
+        // Each send (the first one, then the retransmits) a timeout after the previous one
+        if (link.datagramsSent() != sent) {
+            if (sent) {
+                PLV_CHECK(millis() - lastSend >= 100);
+            }
+            sent     = link.datagramsSent();
+            lastSend = before;
+        }
+
+        delay(1);
+    } while (state == PLV_UDP_SENDING && millis() - start < TEST_ROUND_TIMEOUT);
+
+    PLV_CHECK_EQUAL(PLV_UDP_FAILED, state);
+    PLV_CHECK(millis() - start >= 300);
+    PLV_CHECK_EQUAL(3UL, link.datagramsSent());
+    PLV_CHECK_EQUAL(2UL, link.retransmits());
+    PLV_CHECK_EQUAL(0UL, link.acks());
+    PLV_CHECK_EQUAL(0U, acks.count[1]);
+    PLV_CHECK_EQUAL(1UL, log.pending());
+    PLV_CHECK_EQUAL(PLV_UDP_IDLE, link.step());
+
+    PLV_CHECK(stopServer(server).messages >= 0);
+}
+
+PLV_TEST(lostDatagramsFailTheRound) {
+    checkGivesUp("--drop 1");
+}
+
+PLV_TEST(refusedDatagramsFailTheRound) {
+    checkGivesUp("--refuse 1");
+}
+
+PLV_TEST(duplicateAckRunsTheHandlerOnce) {
+
+    uint16_t port;
+    FILE *server = startServer("--command reset", port);
+    PLV_CHECK(server);
+
+    PluviOnMessageLog log;
+    PLV_CHECK(log.begin());
+    appendMessages(log, 8);
+
+    HostUDP        udp;
+    PluviOnUDPLink link(udp, log);
+    TestAcks       acks;
+    memset(&acks, 0, sizeof(acks));
+
+    PLV_CHECK(link.begin(0));
+    link.setAckHandler(countAck, &acks);
+
+    PLV_CHECK(link.start("127.0.0.1", port));
+    PLV_CHECK_EQUAL(PLV_UDP_SENDING, link.step());
+
+    // Seq 1 sent again (as a retransmit whose ack was lost): acked twice
+    char datagram[PLV_UDP_DATAGRAM_SIZE];
+    int  prefix = snprintf(datagram, sizeof(datagram), "1|");
+    int  length = log.read(1, datagram + prefix, sizeof(datagram) - prefix);
+    PLV_CHECK(length > 0);
+    PLV_CHECK(udp.beginPacket("127.0.0.1", port));
+    PLV_CHECK_EQUAL((size_t) (prefix + length), udp.write((const uint8_t *) datagram, prefix + length));
+    PLV_CHECK(udp.endPacket());
+
+    PLV_CHECK_EQUAL(PLV_UDP_DONE, runRound(link));
+
+    // The duplicate acks still arriving find their messages acked
+    delay(100);
+    link.step();
+
+    for (int seq = 1; seq <= 8; seq++) {
+        PLV_CHECK_EQUAL(1U, acks.count[seq]);
+    }
+    PLV_CHECK_EQUAL(8UL, link.acks());
+
+    // The command went again with the duplicate ack, and still runs once
+    PLV_CHECK_EQUAL(1U, acks.commands);
+
+    TestServer summary = stopServer(server);
+    PLV_CHECK_EQUAL(8, summary.messages);
+    PLV_CHECK_EQUAL(1U, summary.duplicates);
+    PLV_CHECK_EQUAL(2U, summary.commands);
+}
+
+PLV_TEST_MAIN()
@@ -15,6 +15,14 @@
 #include <ESP8266WiFi.h>
 #include <WiFiUdp.h>
 #include <PluviOn.h>
+#include <PluviOnMessageWriter.h>
+#include <PluviOnUploader.h>
+#include <PluviOnDirSource.h>
+#include <PluviOnMessageLog.h>
+#include <PluviOnUDPLink.h>
+#include <PluviOnEventRing.h>
+#include <PluviOnTipDebouncer.h>
+#include <PluviOnRainRate.h>
 PluviOn utils;
 
 /////ATTENTION!!!! CHANGES SHOULD BE DONE IN COMPILATION TIME///
@@ -26,19 +34,41 @@ const String STATION_ID    = "31";
 #define  SLEEP_PERIOD      900000 //15 minutes
 #define SERVER_ADDR        "3.87.153.3"
 #define SERVER_PORT      10000
+#define SERVER_UDP       false // Send each reading in an acked datagram instead of the TCP backlog upload
+#define SERVER_UDP_PORT  10001
 ///END
 /////ATTENTION!!!! CHANGES SHOULD BE DONE IN COMPILATION TIME///
 
 // WIFI
 WiFiClient wf_client;
+#define SERVER_CONNECT_TIMEOUT 20000        // All connection attempts (ms)
+#define SERVER_CONNECT_RETRY_DELAY 1000     // Between connection attempts (ms)
+#define SERVER_CONNECT_ATTEMPT_TIMEOUT 2000 // One connection attempt, blocking (ms)
+#define SERVER_WRITE_TIMEOUT 10000          // Whole backlog (ms)
+#define SERVER_READ_TIMEOUT 5000            // Server result (ms)
+
+// UPLOAD (stepped from the loop)
+PluviOnUploader uploader(wf_client);
+PluviOnDirSource upload_source; // Data directory being streamed
+
+// UDP (SERVER_UDP, stepped from the loop)
+WiFiUDP wf_udp;
+PluviOnMessageLog message_log;  // Readings waiting for their ack
+PluviOnUDPLink udp_link(wf_udp, message_log);
+#define UDP_LOCAL_PORT 10001           // Acks arrive here
+#define UDP_RETRANSMIT_TIMEOUT 2000    // Without an ack (ms)
+#define UDP_MAX_ATTEMPTS 4             // Sends of a reading per cycle
 
 // SYSTEM SLEEP CONTROL
 unsigned long sleepCounter = 0; // Sleep time counter
+bool cycle_started = false;     // First cycle done
+#define LOOP_IDLE_DELAY 5       // Idle time per loop (ms), keeps the loop responsive
 
 
 // SYSTEM DEFINES
 #define SYSTEM_BAUDRATE 115200
 const String DATA_DIR = "/data";
+#define MESSAGE_SIZE 64 // i;id;bt;raining;tp;rh;sigs;crc
 bool fs_is_active = false;
 
 // PINS DEFINES
@@ -64,61 +94,76 @@ volatile float temperature = 0;       // Read temperature as Celsius
 volatile float computedHeatIndex = 0; // Compute heat index in Celsius
 
 // RAIN SENSOR
-#define DELAY_HALL_SENSOR_DEBOUNCING 100 // Delay in ms to debounce hall sensor
-volatile int tipCounter = 0;             // Store the bucket tip counter
-volatile int realTipCount = 0;           // Checked tip counter
-volatile int lastTipCount = 0;           // The last tip count total
-unsigned long curBucketReadingInMs = 0;  // Current rain sensor reading in millis
-unsigned long lastBucketReadingInMs = 0; // The last rain sensor reading time in ms
+#define DELAY_HALL_SENSOR_DEBOUNCING 250 // Refractory period in ms after a tip (4 tips/s max)
+#define HALL_SENSOR_MIN_PULSE_WIDTH 2000 // Shortest magnet pulse in us
+PluviOnEventRing tip_events;             // Hall sensor edges (PLV_EDGE), pushed by the ISR
+PluviOnTipDebouncer tip_debouncer;       // Turns the edges into tips
+int tipCounter = 0;                      // Hall sensor edges, bounces included
+int realTipCount = 0;                    // Checked tip counter
+unsigned long tipOverflows = 0;          // Edges lost with the ring full, last reported
 const float CONTRIBUTION_AREA = 7797.0; // Contribuition area in mm2
+const float BUCKET_VOLUME = 3.22;       // Bucket calibrated volume in ml
 volatile float rainVolume = 0;          // The rain accumulated volume
+PluviOnRainRate rain_rate;              // Rain intensity over the last 1, 5, 15 and 60 min
+#define RAINING_WINDOW PLV_RAIN_15_MIN  // Raining = any tip in this window
 
 void init_dht() {
   dht.begin();
 }
 
-void count_tip_bucket() {
-  tipCounter++;
-  Serial.print(F("[count_tip_bucket] - Tip counter: "));
-  Serial.println(tipCounter);
-  Serial.print(F("[count_tip_bucket] - Real tip count: "));
-  Serial.println(realTipCount);
-  Serial.print(F("[count_tip_bucket] - Last tip count: "));
-  Serial.println(lastTipCount);
-  detachInterrupt(PIN_HALL);
-  read_hall_sensor();
-  attach_interruption();
-  }
+void init_rain_rate() {
+  rain_rate.setBucket(BUCKET_VOLUME, CONTRIBUTION_AREA);
+}
+
+/**
+ * Hall sensor ISR: only store the edge (time and pin level), read_hall_sensor() does the rest
+ */
+void IRAM_ATTR count_tip_bucket() {
+  tip_events.push(PLV_EDGE(micros(), digitalRead(PIN_HALL)));
+}
 
 void attach_interruption() {
   Serial.println(F("[attach_interruption] - Attaching"));
-  attachInterrupt(PIN_HALL, count_tip_bucket, FALLING);
+  tip_debouncer.setMinPulseWidth(HALL_SENSOR_MIN_PULSE_WIDTH);
+  tip_debouncer.setRefractory(DELAY_HALL_SENSOR_DEBOUNCING * 1000UL);
+  tip_debouncer.begin(digitalRead(PIN_HALL));
+  attachInterrupt(PIN_HALL, count_tip_bucket, CHANGE);
   Serial.println(F("[attach_interruption] - Done"));
 }
 
+/**
+ * Take the hall sensor edges stored by the ISR and debounce them: a tip is
+ * a pulse of HALL_SENSOR_MIN_PULSE_WIDTH at least, both edges seen, and
+ * DELAY_HALL_SENSOR_DEBOUNCING after the last tip
+ */
 void read_hall_sensor() {
-  // Current millis mark
-  curBucketReadingInMs = millis();
+  uint32_t edge;
 
-  // Check if the configured delay has passed
-  if (
-      ((curBucketReadingInMs - lastBucketReadingInMs) > DELAY_HALL_SENSOR_DEBOUNCING) || // delay
-      (lastBucketReadingInMs == 0)                                                       // first time
-  ) {
-    // Any increment since the last time?
-    if (tipCounter > lastTipCount) {
-
-      // Increase the tip bucket count
-      realTipCount++;
-      Serial.print(F("REAL TIP COUNT: "));
-      Serial.println(realTipCount);
+  while (tip_events.pop(edge)) {
+    tipCounter++;
 
-      // Update last tip counter value
-      lastTipCount = tipCounter;
+    // Timestamps, not polling time: tips closer than a loop apart still count
+    if (!tip_debouncer.edge(PLV_EDGE_TIME(edge), PLV_EDGE_LEVEL(edge))) {
+      continue;
     }
 
-    // Store the current millis for the next iteration
-    lastBucketReadingInMs = curBucketReadingInMs;
+    // Increase the tip bucket count
+    realTipCount++;
+    rain_rate.tip(tip_debouncer.lastTipInMillis()); // Edge time, not when it's processed
+
+    Serial.print(F("REAL TIP COUNT: "));
+    Serial.print(realTipCount);
+    Serial.print(F(" (glitches: "));
+    Serial.print(tip_debouncer.glitches());
+    Serial.print(F(", bounces: "));
+    Serial.print(tip_debouncer.bounces());
+    Serial.println(F(")"));
+  }
+
+  if (tip_events.overflows() != tipOverflows) {
+    tipOverflows = tip_events.overflows();
+    Serial.print(F("[read_hall_sensor] - Edges lost, the loop fell behind (since boot): "));
+    Serial.println(tipOverflows);
   }
 }
 
@@ -200,7 +245,7 @@ void get_dht_data() {
 
 void print_fs_info() {
   FSInfo fs_info;
-  SPIFFS.info(fs_info);
+  PLV_FS.info(fs_info);
 
   float used_space = (float) fs_info.usedBytes/fs_info.totalBytes;
   float free_space = (float) (1 - used_space);
@@ -274,7 +319,7 @@ int wifi_quality() {
 
 float fs_free_space() {
   FSInfo fs_info;
-  SPIFFS.info(fs_info);
+  PLV_FS.info(fs_info);
 
   float used_space = (float) fs_info.usedBytes/fs_info.totalBytes;
   float free_space = (float) (1 - used_space);
@@ -288,8 +333,10 @@ float fs_free_space() {
   return free_space;
 }
 
-String build_message() {
-  String message = "i;";
+size_t build_message(char *buffer, size_t size) {
+  PluviOnMessageWriter message(buffer, size);
+
+  message += "i;";
 
   message += STATION_ID;
   message += ";";
@@ -297,7 +344,8 @@ String build_message() {
   message += realTipCount;
   message += ";";
 
-  message += "0;"; // Raining
+  rain_rate.update(millis());
+  message += rain_rate.rainInMm(RAINING_WINDOW) > 0 ? "1;" : "0;"; // Raining
 
   message += temperature;
   message += ";";
@@ -310,10 +358,25 @@ String build_message() {
 
   message += "0"; // crc
 
+  if (message.overflow()) {
+    Serial.println(F("[build_message] - Message doesn't fit in the buffer"));
+    return 0;
+  }
+
   Serial.print(F("[build_message] - Message (i;id;timestamp;bt;raining;tp;rh;sigs;crc): "));
-  Serial.println(message);
+  Serial.println(message.c_str());
+
+  for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++) {
+    Serial.print(F("[build_message] - Rain intensity, last "));
+    Serial.print(PluviOnRainRate::windowMinutes((PluviOnRainWindow) w));
+    Serial.print(F(" min (now / max, mm/h): "));
+    Serial.print(rain_rate.intensity((PluviOnRainWindow) w));
+    Serial.print(F(" / "));
+    Serial.println(rain_rate.maxIntensity((PluviOnRainWindow) w));
+  }
+  rain_rate.resetPeriod();
 
-  return message;
+  return message.length();
 }
 
 void delete_messages(String send_result){
@@ -338,99 +401,190 @@ String read_messages() {
   Serial.println(F("[read_messages]"));
 }
 
-String send_messages() {
-  if(fs_is_active){
-    // Open directory
-    Dir dir = SPIFFS.openDir(DATA_DIR);
-    Serial.print(F("[send_messages] - Files in \""));
-    Serial.print(DATA_DIR);
-    Serial.println(F("\" directory:"));
-    Serial.println(F("[send_messages] - ---------"));
-    File f;
-    String messages;
-    while (dir.next()) {
-      Serial.print(F("[send_messages] - "));
-      Serial.println(dir.fileName());
-      // Open file
-      f = SPIFFS.open(dir.fileName(), "r");
-
-      if (!f) {
-        Serial.print(F("[send_messages] - Unable To Open '"));
-        Serial.print(dir.fileName());
-        Serial.println(F("' for Reading"));
-      } else {
-
-        // Group messages
-        while (f.position() < f.size()) {
-          messages += f.readStringUntil('\n');
-          messages += '\n';
-        }
-
-        f.close();
-      }
+/**
+ * Start posting the backlog (the upload is stepped from the loop by step_upload())
+ *
+ * @return true if the upload started
+ */
+bool send_messages() {
+  if(utils.FSReclaimPending()){
+    Serial.println(F("[send_messages] - Filesystem wiped, old messages are being reclaimed"));
+    return false;
+  }
+
+  if(!fs_is_active){
+    Serial.println(F("[send_messages] - Filesystem is not mounted"));
+    return false;
+  }
+
+  if(uploader.busy()){
+    Serial.println(F("[send_messages] - Previous upload still running"));
+    return false;
+  }
+
+  // Size of the whole backlog, streamed file by file (constant RAM)
+  Serial.print(F("[send_messages] - Message payload: "));
+  Serial.print(PluviOnDirSource::length(DATA_DIR.c_str()));
+  Serial.print(F(" bytes in \""));
+  Serial.print(DATA_DIR);
+  Serial.println(F("\""));
+
+  Serial.print(F("[send_messages] - Connecting to "));
+  Serial.print(SERVER_ADDR);
+  Serial.print(":");
+  Serial.println(SERVER_PORT);
+
+  // Every file of the data directory, each one with its lines '\n' terminated
+  upload_source.begin(DATA_DIR.c_str());
+
+  return uploader.start(SERVER_ADDR, SERVER_PORT, PLV_UPLOAD_LINE, NULL, 0, PluviOnDirSource::source, &upload_source);
+}
+
+/**
+ * Run one step of the upload (each state has a deadline; only a connection
+ * attempt blocks, up to SERVER_CONNECT_ATTEMPT_TIMEOUT)
+ */
+void step_upload() {
+  PluviOnUploadState state = uploader.step();
+
+  if (state == PLV_UPLOAD_DONE) {
+    String send_result = uploader.response();
+
+    Serial.print(F("[step_upload] - Transmitted "));
+    Serial.print(uploader.bytesSent());
+    Serial.println(F(" bytes"));
+
+    Serial.print(F("[step_upload] - Return: "));
+    Serial.println(send_result);
+
+//    delete_messages(send_result);
+
+  } else if (state == PLV_UPLOAD_FAILED) {
+    if (uploader.failedState() == PLV_UPLOAD_CONNECT) {
+      Serial.println(F("[step_upload] - FAIL - Can't connect, can't transmit, aborted."));
+    } else {
+      Serial.print(F("[step_upload] - FAIL - Upload failed in state "));
+      Serial.print(uploader.failedState());
+      Serial.println(F(", aborted."));
     }
 
-    Serial.println(F("[send_messages] - Message payload:"));
-    Serial.print(messages);
-    
-    // Send all messages
-    return send_message(messages);
+    // Nothing left open between uploads
+    upload_source.end();
+  }
+}
 
-  } else {
-      Serial.println(F("[send_messages] - Filesystem is not mounted"));
-      return "not_mounted";
+/**
+ * Queue a reading for the UDP link (sent, and sent again, until the server acks it)
+ *
+ * @return true if queued
+ */
+bool queue_message(const char *message, size_t length) {
+  if (!length) {
+    return false;
+  }
+
+  unsigned long seq = message_log.append(message, length);
+
+  if (!seq) {
+    Serial.println(F("[queue_message] - FAIL - Unable to queue the message"));
+    return false;
   }
+
+  Serial.print(F("[queue_message] - Queued as seq "));
+  Serial.print(seq);
+  Serial.print(F(", pending: "));
+  Serial.println(message_log.pending());
+
+  return true;
 }
 
-String send_message(String message){
-  String result = "";
+/**
+ * Start sending the queued readings over UDP (stepped from the loop by step_udp())
+ *
+ * @return true if started
+ */
+bool send_messages_udp() {
+  if (udp_link.busy()) {
+    Serial.println(F("[send_messages_udp] - Previous round still running"));
+    return false;
+  }
 
-  Serial.print(F("[send_message] - Connecting to "));
+  Serial.print(F("[send_messages_udp] - Sending "));
+  Serial.print(message_log.pending());
+  Serial.print(F(" message(s) to "));
   Serial.print(SERVER_ADDR);
   Serial.print(":");
-  Serial.println(SERVER_PORT);
+  Serial.println(SERVER_UDP_PORT);
 
-  boolean wf_connected = wifi_connected();
+  return udp_link.start(SERVER_ADDR, SERVER_UDP_PORT);
+}
 
-  if(wf_connected > 0) {
-    Serial.println(F("[send_message] - Connected!"));
-    Serial.println(F("[send_message] - Transmitting message: "));
-    Serial.print(message);
-  
-    // Post Data
-    wf_client.print(message);
-
-    Serial.println(F("[send_message] - Handling response"));
-
-    // Handle result
-    while (wf_client.connected()) {
-      if (wf_client.available()) {
-        result = wf_client.readStringUntil('\r');
-        Serial.print(F("[send_message] - Return: "));
-        Serial.println(result);
-        break;
-      }
+/**
+ * Server ack of a reading: "ok|<server time>|<time to reset>|<command>"
+ */
+void process_ack(unsigned long seq, const char *response, void *context) {
+  char fields[PLV_UDP_RESPONSE_SIZE];
+  strncpy(fields, response, sizeof(fields) - 1);
+  fields[sizeof(fields) - 1] = '\0';
+
+  Serial.print(F("[process_ack] - seq "));
+  Serial.print(seq);
+  Serial.print(F(": "));
+  Serial.println(response);
+
+  // Fields may be empty ("ok|123||"), so no strtok
+  char *field = fields;
+  for (int index = 0; field; index++) {
+    char *end = strchr(field, '|');
+    if (end) {
+      *end = '\0';
     }
 
-    Serial.println(F("[send_message] - Closing connection"));
+    if (index == 1 && *field) {
+      Serial.print(F("[process_ack] - Server time: "));
+      Serial.println(field);
+    } else if (index == 2 && *field) {
+      Serial.print(F("[process_ack] - Time to reset: "));
+      Serial.println(field);
+    } else if (index == 3 && strcmp(field, "reset") == 0) {
+      Serial.println(F("[process_ack] - Server command: reset"));
+      reset_bucket_tip_counter();
+    }
 
-    // Close connection
-    wf_client.stop();
-    
-  } else {
-    Serial.println(F("[send_message] - FAIL - Can't connect, can't transmit, aborted."));
+    field = end ? end + 1 : NULL;
   }
+}
 
-  Serial.println(F("[send_message] - Done"));
-  return result;
+/**
+ * Run one step of the UDP link (reads the acks, sends again the lost datagrams)
+ */
+void step_udp() {
+  PluviOnUDPState state = udp_link.step();
+
+  if (state == PLV_UDP_DONE) {
+    Serial.print(F("[step_udp] - All acked. Sent: "));
+    Serial.print(udp_link.datagramsSent());
+    Serial.print(F(", retransmits: "));
+    Serial.print(udp_link.retransmits());
+    Serial.print(F(", last round trip (ms): "));
+    Serial.println(udp_link.lastRoundTripInMillis());
+  } else if (state == PLV_UDP_FAILED) {
+    Serial.print(F("[step_udp] - FAIL - No ack, kept for the next cycle: "));
+    Serial.println(message_log.pending());
+  }
 }
 
 void init_fs(){
   Serial.println(F("[init_fs] - Begin"));
 
-  if (SPIFFS.begin()) {
+  if (utils.begin()) {
     fs_is_active = true;
     Serial.println(F("[init_fs] - SPIFFS is active"));
+
+#if SERVER_UDP
+    // Readings not acked before the reset are sent again
+    message_log.begin();
+#endif
   } else {
     Serial.println(F("[init_fs] - FATAL! Unable to activate SPIFFS"));
     while(1);
@@ -441,7 +595,19 @@ void init_fs(){
 
 void wifi_init() {
   wifi_setup();
-  wifi_connected();
+
+  // Each connection attempt blocks up to this timeout, the uploader retries within its deadline
+  wf_client.setTimeout(SERVER_CONNECT_ATTEMPT_TIMEOUT);
+  uploader.setTimeouts(SERVER_CONNECT_TIMEOUT, SERVER_WRITE_TIMEOUT, SERVER_READ_TIMEOUT);
+  uploader.setConnectRetryDelay(SERVER_CONNECT_RETRY_DELAY);
+
+#if SERVER_UDP
+  if (!udp_link.begin(UDP_LOCAL_PORT)) {
+    Serial.println(F("[wifi_init] - FAIL - Unable to open the UDP port"));
+  }
+  udp_link.setRetransmit(UDP_RETRANSMIT_TIMEOUT, UDP_MAX_ATTEMPTS);
+  udp_link.setAckHandler(process_ack);
+#endif
 }
 
 void wifi_setup() {
@@ -454,45 +620,25 @@ void wifi_setup() {
   }
 }
 
-boolean wifi_connected() {
-  Serial.print(F("[wifi_connected] - Connecting to SSID: "));
-  Serial.println(ssid);
-
-  int conn_counter = 20;
-  while (!wf_client.connect(SERVER_ADDR, SERVER_PORT)) {
-    Serial.print(F("[wifi_connected] - Connection Failed ("));
-    Serial.print(conn_counter);
-    Serial.println(F(")"));
-
-    delay(1000);
-    
-    conn_counter--;
-
-    if(conn_counter < 0) break;
-  }
-  
-  if(conn_counter > 0) {
-    Serial.println(F("[wifi_connected] - WiFi Connected"));
-    return true;
-  } else {
-    Serial.println(F("[wifi_connected] - WiFi NOT Connected"));
-    return false;
-  }
-}
-
- 
 /**
- * Put the system to sleep
+ * Idle until the next loop (short, the upload and the sensors keep running)
  */
 void system_sleep() {
 //  wifi_set_sleep_type(LIGHT_SLEEP_T);
-  Serial.println(F("[system_sleep] - Modem is sleeping"));
+  delay(LOOP_IDLE_DELAY);
+}
 
-  delay(SLEEP_PERIOD);
-//  unsigned long sleepCounter = millis();
-//  while ((millis() - sleepCounter) < SLEEP_PERIOD);
+/**
+ * Check if a new cycle (read, build, send) is due, every SLEEP_PERIOD
+ */
+bool cycle_due() {
+  if (!cycle_started || (millis() - sleepCounter) >= SLEEP_PERIOD) {
+    cycle_started = true;
+    sleepCounter = millis();
+    return true;
+  }
 
-  Serial.println(F("[system_sleep] - Modem up and running"));
+  return false;
 }
 
 void init_ntp() {
@@ -504,8 +650,8 @@ void init_ntp() {
 }
 
 void format_fs() {
-  Serial.println(F("[format_fs] - Formatting File System, please wait..."));
-  utils.FSFormat();
+  Serial.println(F("[format_fs] - Wiping File System (older files are reclaimed in loop)..."));
+  utils.FSWipe();
   Serial.println(F("[format_fs] - Done."));
 }
 
@@ -534,10 +680,6 @@ void reset_bucket_tip_counter() {
   Serial.print(F("[reset_bucket_tip_counter] - Real tip count: "));
   Serial.println(realTipCount);
 
-  Serial.print(F("[reset_bucket_tip_counter] - Last tip count: "));
-  Serial.println(lastTipCount);
-
-  lastTipCount = 0;
   realTipCount = 0;
   tipCounter = 0;
   rainVolume = 0;
@@ -557,18 +699,42 @@ void setup() {
 //  format_fs();
 
   init_dht();
+
+  init_rain_rate();
     
   attach_interruption();
 }
 
 void loop() {
-  Serial.println(F("\n\n[loop] - Begin =========================="));
-  read_sensors();
-  String message = build_message();
-  reset_bucket_tip_counter();
-//  save_message(message);
-  String send_result = send_messages();
-//  delete_messages(send_result);
-  attach_interruption();
+  if (cycle_due()) {
+    Serial.println(F("\n\n[loop] - Begin =========================="));
+    read_sensors();
+    static char message[MESSAGE_SIZE];
+    size_t length = build_message(message, sizeof(message));
+    reset_bucket_tip_counter();
+//    save_message(message);
+#if SERVER_UDP
+    queue_message(message, length);
+    send_messages_udp();
+#else
+    send_messages();
+#endif
+    Serial.print(F("[loop] - Done, next cycle in (ms): "));
+    Serial.println(SLEEP_PERIOD);
+  }
+
+  // Debounce the tips stored by the ISR (drains the ring every iteration)
+  read_hall_sensor();
+
+  // Upload, one step
+#if SERVER_UDP
+  step_udp();
+#else
+  step_upload();
+#endif
+
+  // Reclaim the files left by a wipe, one step
+  utils.FSReclaimStep();
+
   system_sleep();
 }
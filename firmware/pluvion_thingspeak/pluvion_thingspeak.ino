@@ -30,9 +30,30 @@ const String apiKey = "VJXMP2062EHMRFT6"; // THINGSPEAK CHANNEL API KEY https://
 // System Config (must come before #include <PluviOn.h>)
 #define PLV_DEBUG_ENABLED true
 #define PLV_SYSTEM_BAUDRATE 115200
+#define PLV_MESSAGE_FS_STATS false // Append the file system stats to the weather message
+#define PLV_MESSAGE_RAIN_RATE true // Append the rain intensities (PluviOnRainRate) to the weather message
+#define PLV_MESSAGE_BINARY false   // Send the weather message as a binary frame (PluviOnTelemetry)
+#define PLV_MESSAGE_SAMPLE_BLOCK false // Queue only the sensor samples, sent as delta blocks (PluviOnSampleBlock)
+#define PLV_SAMPLES_PER_RECORD 32      // Samples per message log record, while no sink delivered it
+#define PLV_UPLOAD_COMPRESSION true // Compress the offline batches (PluviOnLZSS) once the API accepts it
 
 #include <PluviOn.h>
+#include <PluviOnConfigStore.h>
+#include <PluviOnMessageLog.h>
+#include <PluviOnMessageWriter.h>
+#include <PluviOnTelemetry.h>
+#include <PluviOnUploader.h>
+#include <PluviOnSink.h>
+#include <PluviOnLinkHealth.h>
+#include <PluviOnLZSS.h>
+#include <PluviOnRainRate.h>
+#include <PluviOnEventRing.h>
+#include <PluviOnTipDebouncer.h>
 PluviOn pluvion;
+PluviOnConfigStore config(pluvion);
+PluviOnMessageLog messageLog;
+PluviOnTelemetry telemetry;
+unsigned long sampleSeq = 0; // Message log record getting the next samples (PLV_MESSAGE_SAMPLE_BLOCK)
 
 // Debug voltage in (enable ESP.getVcc())
 ADC_MODE(ADC_VCC);
@@ -63,10 +84,49 @@ ADC_MODE(ADC_VCC);
 
 #define DHT_SENSOR_READING_DELAY 600000
 #define DHT_SENSOR_READING_FAILURE_DELAY 180000
-#define SEND_OFFLINE_MESSAGES_DELAY 120000
+#define SEND_OFFLINE_MESSAGES_BATCH_SIZE 10 // Max offline messages per request (1 = one message per request)
+
+// |------------------------------------------|
+// |            Telemetry Sinks               |
+// |------------------------------------------|
+// Each sink delivers the message log on its own. Rate limit = minimum time
+// between two requests, backoff = wait after a failure (doubled up to the max).
+// The enabled flags are the boot defaults ("sink <name>" toggles them).
+#define SINK_PLUVION_RATE_LIMIT 5000
+#define SINK_PLUVION_BACKOFF_MIN 15000
+#define SINK_PLUVION_BACKOFF_MAX 600000
+#define SINK_THINGSPEAK_ENABLED true       // Newest message only (live channel)
+#define SINK_THINGSPEAK_RATE_LIMIT 15000   // ThingSpeak accepts one update every 15 s
+#define SINK_THINGSPEAK_BACKOFF_MIN 30000
+#define SINK_THINGSPEAK_BACKOFF_MAX 600000
+#define SINK_TCP_ENABLED false             // Raw TCP server, one message per connection, "ok" reply
+#define SINK_TCP_SERVER_ADDR "3.87.153.3"
+#define SINK_TCP_SERVER_PORT 10000
+#define SINK_TCP_RATE_LIMIT 1000
+#define SINK_TCP_BACKOFF_MIN 15000
+#define SINK_TCP_BACKOFF_MAX 600000
+#define SINK_DEBUG_ENABLED false           // Print every message to serial
+
+// |------------------------------------------|
+// |     Network Link Health (WiFi sinks)     |
+// |------------------------------------------|
+// Each network sink has its own link (its server). After LINK_FAILURE_THRESHOLD
+// connection failures or timeouts in a row (AP or server down) the sink stops
+// for LINK_OPEN_MIN, doubled up to LINK_OPEN_MAX while the probe in between
+// keeps failing. A server answering, even refusing the messages, is a working
+// link. The open time gets +/- LINK_JITTER % (the sink backoffs get
+// PLV_BACKOFF_JITTER %).
+#define LINK_FAILURE_THRESHOLD 3
+#define LINK_OPEN_MIN 60000
+#define LINK_OPEN_MAX 1800000
+#define LINK_JITTER 20
 
 // READING PERIODS AND DEBOUNCE TIMERS
-#define DELAY_HALL_SENSOR_DEBOUNCING 1000 // Delay in ms to debounce hall sensor
+// A tip is a magnet pulse of at least HALL_SENSOR_MIN_PULSE_WIDTH, and no tip
+// follows another within DELAY_HALL_SENSOR_DEBOUNCING (the bucket can't swing
+// back faster: 250 ms = 4 tips/s, far above a 0.4 mm bucket in a cloudburst)
+#define DELAY_HALL_SENSOR_DEBOUNCING 250  // Refractory period in ms after a tip
+#define HALL_SENSOR_MIN_PULSE_WIDTH 2000  // Shortest magnet pulse in us
 
 /**
  * Station Information
@@ -84,18 +144,11 @@ const String FIRMWARE_VERSION = "0.0.3.C";
 
 /**
  * File system directories and variables
+ * (station configuration lives in the PluviOn config store, PLV_CONFIG_FILE,
+ * and weather messages are queued in the PluviOn message log, PLV_LOG_DIR)
  */
 const String DIR_SYSTEM_DATA = "/sys";
-const String DIR_WEATHER_DATA = "/weather";
-const String DIR_MESSAGE_COUNTER = "/msgcnt";
-const String DIR_FIRMWARE_VERSION = "/fmwver";
-const String DIR_STATION_ID = "/stt/id";
-const String DIR_STATION_NAME = "/stt/name";
-const String DIR_STATION_BUCKET_VOL = "/stt/bucketvol";
-const String DIR_STATION_TIME_TO_RESET = "/stt/ttr";
-const String DIR_STATION_TIME = "/stt/time";
-const String DIR_STATION_LATITUDE = "/stt/lat";
-const String DIR_STATION_LONGITUDE = "/stt/lon";
+const String DIR_WEATHER_DATA = "/weather"; // Legacy queue (one file per message), imported at boot
 const String FIELD_SEPARATOR = "|";
 
 // Station time and reset timer
@@ -108,13 +161,13 @@ boolean resetFlag = false; //
 
 // Tipping Bucket Configurations
 const float CONTRIBUTION_AREA = 7797.0; // Contribuition area in mm2
-volatile int tipCounter = 0;            // Store the bucket tip counter
+int tipCounter = 0;                     // Hall sensor edges, bounces included
 volatile float rainVolume = 0;          // The rain accumulated volume
+PluviOnRainRate rainRate;               // Rain intensity over the last 1, 5, 15 and 60 min
 
 // State Control Variables
-unsigned long lastTipBucketReadingInMillis = 0;    // The last tip bucket (hall sensor) reading time in ms
-unsigned long currentTipBucketReadingInMillis = 0; // Current tip bucket reading in millis
-volatile float lastTipCount = 0;                   // The last tip count total
+PluviOnEventRing tipEvents;                        // Hall sensor edges (PLV_EDGE), pushed by the ISR
+PluviOnTipDebouncer tipDebouncer;                  // Turns the edges into tips
 volatile int realTipCount = 0;                     // Checked tip counter
 
 // DHT22 Sensor Variables and initialization
@@ -146,6 +199,8 @@ int messageID = 0;
 float SYSAvailableDiskSpaceInPercent = 0.0;
 int SYSAvailableDiskSpaceInBytes = 0;
 int SYSAvailableHeapInBytes = 0;
+int SYSHeapFragmentationInPercent = 0; // 0 = all the free heap in a single block
+int SYSMaxFreeBlockInBytes = 0;        // Largest allocation that can succeed
 String SYSLastResetReason = "";
 String SYSWiFiHostname = "";
 String SYSWiFiLocalIp = "";
@@ -155,7 +210,8 @@ String SYSWiFiSSID = "";
 int SYSVCCInV = 0;
 
 // Initialize WiFiClient
-WiFiClientSecure WIFISecureClient;
+BearSSL::WiFiClientSecure WIFISecureClient;
+BearSSL::Session TLSSession; // TLS session cache, resumed on every new connection
 WiFiClient client;
 
 // Initialize WiFiManager
@@ -171,19 +227,69 @@ WiFiManager wifiManager;
  */
 const char *PLUVION_API_SERVER_ADDR = "api.community.pluvion.com.br";
 const char *PLUVION_API_RESOURCE_WEATHER = "/weather";
+const char *PLUVION_API_RESOURCE_WEATHER_BATCH = "/weather/batch";
 const int PLUVION_API_SERVER_PORT = 443;
 const int PLUVION_API_SERVER_REQ_TIMEOUT = 5000; // Request Timeout (ms)
+const int PLUVION_API_SERVER_CONNECT_TIMEOUT = 2000; // Each connection attempt, the loop is blocked meanwhile (ms)
+const int PLUVION_API_KEEP_ALIVE_TIMEOUT = 15000; // Idle time before closing the connection (ms)
+
+// Pluvi.On API client stats (since boot)
+unsigned long APILastRequestInMillis = 0;
+unsigned long APIRequests = 0;
+unsigned long APIHandshakes = 0;
+unsigned long APIHandshakeTimeInMillis = 0; // Total time spent in TLS handshakes
+unsigned long APIBytesSent = 0;
+unsigned long APIBytesReceived = 0;
+unsigned long APICompressedBytesIn = 0;  // Batch content before compression
+unsigned long APICompressedBytesOut = 0; // and after
 
 // Pluvi.On Media Types Standard
 //const String HTTP_HEADER_PLUVION_KEY = "X-PluviOn-Key: " + PLUVION_KEY;
 const char *HTTP_HEADER_ACCEPT = "Accept: application/vnd.community.pluvion.com.br.v1.text";
 const char *HTTP_HEADER_CONTENT_TYPE = "Content-Type: application/vnd.community.pluvion.com.br.v1.text";
+const char *HTTP_HEADER_CONTENT_TYPE_BINARY = "Content-Type: application/vnd.community.pluvion.com.br.v1.binary";
 const char *HTTP_HEADER_EOL = "\r\n";
 const char *HTTP_HEADER_USER_AGENT = "User-Agent: Pluvi.On Community Station/1.0";
 
-// Send offline messages
-unsigned long currentBatchReadingInMillis = 0;
-unsigned long lastBatchReadingInMillis = 0;
+// Uploads (stepped from the loop, one request in flight per server)
+PluviOnUploader uploader(WIFISecureClient);
+PluviOnUploader thingspeakUploader(client);
+unsigned long uploadSeqs[SEND_OFFLINE_MESSAGES_BATCH_SIZE];   // Messages in the request
+boolean uploadAcked[SEND_OFFLINE_MESSAGES_BATCH_SIZE];        // Messages accepted by the Pluvi.On API
+uint8_t uploadCount = 0;
+uint8_t uploadNext = 0;                                       // Next message to write
+boolean uploadOffline = false;
+uint8_t uploadRecord[PLV_LOG_PAYLOAD_SIZE + 6];               // Room for the "|off" suffix and the line break
+size_t uploadRecordLength = 0;
+size_t uploadRecordOffset = 0;
+boolean uploadSamples = false;                                // The request holds sample blocks
+char uploadHeader[320];
+
+#if PLV_UPLOAD_COMPRESSION
+// Batch compression (negotiated: the API lists it in the Accept-Encoding response header)
+PluviOnLZSS compressor;
+boolean APIAcceptsLZSS = false;
+boolean uploadCompressed = false;
+#endif
+
+// Raw TCP sink
+WiFiClient tcpClient;
+PluviOnUploader tcpUploader(tcpClient);
+uint8_t tcpRecord[PLV_LOG_PAYLOAD_SIZE + 1];
+unsigned long tcpSeq = 0;
+
+// ThingSpeak sink
+unsigned long thingspeakSeq = 0;
+
+// Telemetry sinks (stepped from the loop, each one marks the log records it delivered)
+PluviOnLinkHealth pluvionLink;
+PluviOnLinkHealth thingspeakLink;
+PluviOnLinkHealth tcpLink;
+PluviOnSinks sinks(messageLog);
+PluviOnSink pluvionSink("pluvion", startPluvionSink, stepPluvionSink);
+PluviOnSink thingspeakSink("thingspeak", startThingSpeakSink, stepThingSpeakSink);
+PluviOnSink tcpSink("tcp", startTCPSink, stepTCPSink);
+PluviOnSink debugSink("debug", startDebugSink, stepDebugSink);
 
 /**
  * Print system environment status to serial
@@ -199,6 +305,14 @@ void printSystemEnvironmentStatus()
     PLV_DEBUG_(pluvion.bytesConverter(ESP.getFreeHeap(), 'K'));
     PLV_DEBUG(F(" KB)"));
 
+    PLV_DEBUG_(F("Heap fragmentation: "));
+    PLV_DEBUG_(ESP.getHeapFragmentation());
+    PLV_DEBUG(F(" %"));
+
+    PLV_DEBUG_(F("Max free block size: "));
+    PLV_DEBUG_(ESP.getMaxFreeBlockSize());
+    PLV_DEBUG(F(" bytes"));
+
     float v = ESP.getVcc();
     v /= 1000;
     PLV_DEBUG_(F("VCC: "));
@@ -274,6 +388,10 @@ void printSystemConfigurations()
     PLV_DEBUG(PLUVION_API_SERVER_PORT);
     PLV_DEBUG_(F("API Server Request Timeout Limit (ms):   "));
     PLV_DEBUG(PLUVION_API_SERVER_REQ_TIMEOUT);
+    PLV_DEBUG_(F("API Server Connect Attempt Timeout (ms): "));
+    PLV_DEBUG(PLUVION_API_SERVER_CONNECT_TIMEOUT);
+    PLV_DEBUG_(F("API Server Keep-Alive Timeout (ms):      "));
+    PLV_DEBUG(PLUVION_API_KEEP_ALIVE_TIMEOUT);
     PLV_DEBUG(F("API Server Resources in use:              "));
     PLV_DEBUG_(F(" - "));
     PLV_DEBUG(PLUVION_API_RESOURCE_WEATHER);
@@ -289,20 +407,18 @@ void printSystemConfigurations()
     PLV_DEBUG(F("// File System Directories"));
     PLV_DEBUG_(F("System Data Directory:                   "));
     PLV_DEBUG(DIR_SYSTEM_DATA);
-    PLV_DEBUG_(F("Weather Data Directory :                 "));
-    PLV_DEBUG(DIR_WEATHER_DATA);
-    PLV_DEBUG_(F("Message Counter Directory:               "));
-    PLV_DEBUG(DIR_MESSAGE_COUNTER);
-    PLV_DEBUG_(F("Station ID Directory:                    "));
-    PLV_DEBUG(DIR_STATION_ID);
-    PLV_DEBUG_(F("Station Name Directory:                  "));
-    PLV_DEBUG(DIR_STATION_NAME);
-    PLV_DEBUG_(F("Station Bucket Volume Directory:         "));
-    PLV_DEBUG(DIR_STATION_BUCKET_VOL);
-    PLV_DEBUG_(F("Station Latitude Directory:              "));
-    PLV_DEBUG(DIR_STATION_LATITUDE);
-    PLV_DEBUG_(F("Station Longitude Directory:             "));
-    PLV_DEBUG(DIR_STATION_LONGITUDE);
+    PLV_DEBUG_(F("Message Log Directory:                   "));
+    PLV_DEBUG(F(PLV_LOG_DIR));
+    PLV_DEBUG_(F("Message Log Capacity (messages):         "));
+    PLV_DEBUG(messageLog.capacity());
+    PLV_DEBUG_(F("Message Log Pending Messages:            "));
+    PLV_DEBUG(messageLog.pending());
+    PLV_DEBUG_(F("Message Log Dropped Messages (since boot):"));
+    PLV_DEBUG(messageLog.dropped());
+    PLV_DEBUG_(F("Config File:                             "));
+    PLV_DEBUG(F(PLV_CONFIG_FILE));
+    PLV_DEBUG_(F("Config File Writes (since boot):         "));
+    PLV_DEBUG(config.writeCount());
     PLV_DEBUG_(F("Message Field Separator:                 "));
     PLV_DEBUG(FIELD_SEPARATOR);
 
@@ -323,6 +439,8 @@ void printSystemConfigurations()
     PLV_DEBUG(PIN_HALL);
     PLV_DEBUG_(F("Hall Sensor Debouncing Delay (ms):       "));
     PLV_DEBUG(DELAY_HALL_SENSOR_DEBOUNCING);
+    PLV_DEBUG_(F("Hall Sensor Min Pulse Width (us):        "));
+    PLV_DEBUG(HALL_SENSOR_MIN_PULSE_WIDTH);
     PLV_DEBUG_(F("Power Off PIN:                           "));
     PLV_DEBUG(PIN_POWER_OFF);
 }
@@ -341,6 +459,19 @@ void printCurrentWeatherData()
     PLV_DEBUG_(F("Rain volume:                             "));
     PLV_DEBUG_(rainVolume);
     PLV_DEBUG(F(" mm"));
+
+    PLV_DEBUG(F("// Rain Intensity (now / max since the last message)"));
+    rainRate.update(millis());
+    for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++)
+    {
+        PLV_DEBUG_(F("Last "));
+        PLV_DEBUG_(PluviOnRainRate::windowMinutes((PluviOnRainWindow)w));
+        PLV_DEBUG_(F(" min: "));
+        PLV_DEBUG_(rainRate.intensity((PluviOnRainWindow)w));
+        PLV_DEBUG_(F(" / "));
+        PLV_DEBUG_(rainRate.maxIntensity((PluviOnRainWindow)w));
+        PLV_DEBUG(F(" mm/h"));
+    }
     PLV_DEBUG(F("// Weather Info"));
     PLV_DEBUG_(F("Humidity:                                "));
     PLV_DEBUG_(humidity);
@@ -405,65 +536,193 @@ void printSystemWiFiStatus()
     PLV_DEBUG_(F("Hostname:                              "));
     PLV_DEBUG(WiFi.hostname());
 
+    PLV_DEBUG_(F("API requests / TLS handshakes:         "));
+    PLV_DEBUG_(APIRequests);
+    PLV_DEBUG_(F(" / "));
+    PLV_DEBUG(APIHandshakes);
+
+    PLV_DEBUG_(F("API handshake time (ms, avg):          "));
+    PLV_DEBUG(APIHandshakes ? APIHandshakeTimeInMillis / APIHandshakes : 0);
+
+    PLV_DEBUG_(F("API bytes sent / received:             "));
+    PLV_DEBUG_(APIBytesSent);
+    PLV_DEBUG_(F(" / "));
+    PLV_DEBUG(APIBytesReceived);
+
+#if PLV_UPLOAD_COMPRESSION
+    PLV_DEBUG_(F("API batch compression:                 "));
+    PLV_DEBUG_(APIAcceptsLZSS ? F(PLV_LZSS_ENCODING) : F("off (not accepted by the API)"));
+    PLV_DEBUG_(F(", "));
+    PLV_DEBUG_(APICompressedBytesIn);
+    PLV_DEBUG_(F(" -> "));
+    PLV_DEBUG_(APICompressedBytesOut);
+    PLV_DEBUG(F(" bytes"));
+#endif
+
+    printLinkHealth(pluvionSink.name(), pluvionLink);
+    printLinkHealth(thingspeakSink.name(), thingspeakLink);
+    printLinkHealth(tcpSink.name(), tcpLink);
+
     PLV_DEBUG_(F(""));
 }
 
 /**
- * Send all offline messages
+ * Print the link health of a network sink
  */
-void sendOfflineMessages()
+void printLinkHealth(const char *name, PluviOnLinkHealth &health)
 {
 
-    currentBatchReadingInMillis = millis();
+    PLV_DEBUG_(F("Link "));
+    PLV_DEBUG_(name);
+    PLV_DEBUG_(F(": "));
+    PLV_DEBUG_(health.stateName());
+    PLV_DEBUG_(F(", next probe in (ms): "));
+    PLV_DEBUG_(health.waitInMillis());
+    PLV_DEBUG_(F(", successes / failures: "));
+    PLV_DEBUG_(health.successes());
+    PLV_DEBUG_(F(" / "));
+    PLV_DEBUG_(health.failures());
+    PLV_DEBUG_(F(" ("));
+    PLV_DEBUG_(health.failuresInARow());
+    PLV_DEBUG_(F(" in a row), opens / probes / skipped: "));
+    PLV_DEBUG_(health.opens());
+    PLV_DEBUG_(F(" / "));
+    PLV_DEBUG_(health.probes());
+    PLV_DEBUG_(F(" / "));
+    PLV_DEBUG(health.skips());
+}
 
-    // Check if the configured delay has passed
-    if ((currentBatchReadingInMillis - lastBatchReadingInMillis) >= SEND_OFFLINE_MESSAGES_DELAY)
+/**
+ * Pluvi.On API sink: post the newest message alone, or up to
+ * SEND_OFFLINE_MESSAGES_BATCH_SIZE offline messages in one request.
+ * Text messages go one per line (with the "|off" suffix), binary frames and
+ * sample blocks are concatenated (they are self-delimiting). A batch holds a
+ * single kind.
+ * Every message in the response ack list is marked delivered, in any order;
+ * the refused ones are picked again by the next batch (the delivered ones
+ * after them are skipped).
+ *
+ * With a batch size of 1 the offline messages are posted alone to the weather resource.
+ *
+ * @param first Oldest message log seq not delivered to the Pluvi.On API
+ * @return true if the request started, otherwise false.
+ */
+boolean startPluvionSink(PluviOnSink &sink, unsigned long first, void *context)
+{
+
+    // Behind the newest message: offline
+    uploadOffline = messageLog.next(first) != 0;
+
+    if (uploadOffline)
     {
+        PLV_DEBUG_HEADER(F("SENDING OFFLINE MESSAGES"));
+    }
+    else
+    {
+        PLV_DEBUG_HEADER(F("POST WEATHER TO PLUVION API"));
+    }
 
-        // Mounts SPIFFS file system
-        if (!SPIFFS.begin())
+    uint8_t batchSize = uploadOffline ? SEND_OFFLINE_MESSAGES_BATCH_SIZE : 1;
+    uploadCount = 0;
+    uploadSamples = false;
+    size_t contentLength = 0;
+    boolean binary = false;
+
+    // Pick the messages and compute the content length
+    for (unsigned long seq = first; seq && uploadCount < batchSize; seq = sink.next(seq))
+    {
+        int length = readUploadRecord(seq);
+
+        if (length < 0)
         {
-            PLV_DEBUG(F("FATAL: Error mounting SPIFFS file system."));
+            // Unreadable record, do not retry it forever
+            PLV_DEBUG(F("ERROR: Fail reading message, dropping it."));
+            messageLog.ack(seq);
+            continue;
         }
 
-        Dir dir = SPIFFS.openDir(DIR_WEATHER_DATA);
-        File f;
+        boolean frame = PluviOnTelemetry::isFrame(uploadRecord, length);
+        boolean sample = PluviOnSampleBlock::isBlock(uploadRecord, length);
 
-        if (dir.next())
+        // One kind of record per request (text messages, frames or samples)
+        if (uploadCount == 0)
         {
+            binary = frame || sample;
+            uploadSamples = sample;
+        }
+        else if ((frame || sample) != binary || sample != uploadSamples)
+        {
+            break;
+        }
 
-            PLV_DEBUG_HEADER(F("SENDING OFFLINE MESSAGES"));
+        PLV_DEBUG_(F("seq:        "));
+        PLV_DEBUG(seq);
 
-            PLV_DEBUG_(F("FILE NAME: "));
-            PLV_DEBUG(dir.fileName());
+        contentLength += length;
+        uploadSeqs[uploadCount++] = seq;
+    }
+
+    if (!uploadCount)
+    {
+        return false;
+    }
 
-            f = dir.openFile("r");
+    return startUpload((uploadOffline && SEND_OFFLINE_MESSAGES_BATCH_SIZE > 1) ? PLUVION_API_RESOURCE_WEATHER_BATCH : PLUVION_API_RESOURCE_WEATHER,
+                       binary, contentLength);
+}
 
-            // Reads the file content and print to Serial monitor
-            if (f.available())
-            {
-                String line = f.readStringUntil('\n');
-                int messageID = dir.fileName().substring(DIR_WEATHER_DATA.length() + 1).toInt();
-                int lastChar = line.length() - 1;
-                String message = line.substring(0, line.length() - 1);
-                message += FIELD_SEPARATOR + "off";
+/**
+ * Print the telemetry sinks status
+ */
+void printSinkStatus()
+{
 
-                PLV_DEBUG_(F("Line:       "));
-                PLV_DEBUG(line);
-                PLV_DEBUG_(F("messageID:  "));
-                PLV_DEBUG(messageID);
-                PLV_DEBUG_(F("message:    "));
-                PLV_DEBUG(message);
+    PLV_DEBUG_HEADER(F("TELEMETRY SINKS STATUS"));
 
-                sendMessage(messageID, message);
-            }
+    PLV_DEBUG_(F("Pending messages: "));
+    PLV_DEBUG(messageLog.pending());
 
-            // Close file
-            f.close();
+    for (uint8_t i = 0; i < sinks.count(); i++)
+    {
+        PluviOnSink *sink = sinks.get(i);
+
+        PLV_DEBUG_(sink->name());
+        PLV_DEBUG_(sink->enabled() ? F(": enabled") : F(": disabled"));
+        PLV_DEBUG_(sink->latestOnly() ? F(" (newest only)") : F(""));
+        PLV_DEBUG_(F(", pending: "));
+        PLV_DEBUG_(sink->pending());
+        PLV_DEBUG_(F(", deliveries: "));
+        PLV_DEBUG_(sink->deliveries());
+        PLV_DEBUG_(F(", failures: "));
+        PLV_DEBUG_(sink->failures());
+        PLV_DEBUG_(F(" ("));
+        PLV_DEBUG_(sink->failuresInARow());
+        PLV_DEBUG_(F(" in a row), next in (ms): "));
+        PLV_DEBUG(sink->busy() ? 0 : sink->waitInMillis());
+    }
 
-            lastBatchReadingInMillis = currentBatchReadingInMillis;
-        }
+    PLV_DEBUG_(F(""));
+}
+
+/**
+ * Enable or disable a telemetry sink ("sink <name>" command)
+ */
+void toggleSink(String name)
+{
+
+    PluviOnSink *sink = sinks.find(name.c_str());
+
+    if (!sink)
+    {
+        PLV_DEBUG_(F("ERROR! Sink not found: "));
+        PLV_DEBUG(name);
+        return;
     }
+
+    sink->setEnabled(!sink->enabled());
+
+    PLV_DEBUG_(sink->name());
+    PLV_DEBUG(sink->enabled() ? F(" enabled.") : F(" disabled."));
 }
 
 /**
@@ -474,14 +733,21 @@ void printFileSystemStatus()
 
     PLV_DEBUG_HEADER(F("FILE SYSTEM STATUS"));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin())
+    // Mounts SPIFFS file system (once per session)
+    if (!pluvion.begin())
     {
         PLV_DEBUG(F("printFileSystemStatus() - FATAL! Error mounting SPIFFS file system!"));
     }
 
+    PLV_DEBUG_(F("Storage backend: "));
+    PLV_DEBUG(F(PLV_FS_NAME));
+
+    PLV_DEBUG_(F("Storage epoch: "));
+    PLV_DEBUG_(pluvion.FSEpoch());
+    PLV_DEBUG(pluvion.FSReclaimPending() ? F(" (reclaiming older files)") : F(""));
+
     FSInfo fs_info;
-    SPIFFS.info(fs_info);
+    PLV_FS.info(fs_info);
 
     float totalBytes = fs_info.totalBytes;
     float usedBytes = fs_info.usedBytes;
@@ -540,6 +806,27 @@ void printFileSystemStatus()
     PLV_DEBUG_(F(""));
 }
 
+/**
+ * Print the file system mount stats of the current loop() iteration
+ */
+void printFileSystemMountStats()
+{
+
+    // Nothing touched the file system in this iteration
+    if (!pluvion.FSMountRequests())
+    {
+        return;
+    }
+
+    PLV_DEBUG_(F("FS mounts (this iteration): "));
+    PLV_DEBUG_(pluvion.FSMountCount());
+    PLV_DEBUG_(F(" of "));
+    PLV_DEBUG_(pluvion.FSMountRequests());
+    PLV_DEBUG_(F(" requests, "));
+    PLV_DEBUG_(pluvion.FSMountTimeInMicros());
+    PLV_DEBUG(F(" us"));
+}
+
 /**
  * Print the system status
  */
@@ -563,6 +850,9 @@ void printSystemStatus()
 
     // Print Current Weather Data Information
     printCurrentWeatherData();
+
+    // Print the telemetry sinks status
+    printSinkStatus();
 }
 
 /**
@@ -584,8 +874,13 @@ void printCommands()
     PLV_DEBUG(F("filelist           Print the current system file list."));
     PLV_DEBUG(F("fsformat           Format File System. (WARNING: cannot be undone)"));
     PLV_DEBUG(F("fsstatus           Print the current file system status."));
+    PLV_DEBUG(F("fsstats            Print the file system operation stats (count, latency, bytes written)."));
     PLV_DEBUG(F("cleardatadir       Remove all data files."));
 
+    PLV_DEBUG(F("\nTelemetry sink commands:"));
+    PLV_DEBUG(F("sinks              Print the telemetry sinks status (pending, deliveries, failures)."));
+    PLV_DEBUG(F("sink <name>        Enable or disable a telemetry sink (pluvion, thingspeak, tcp, debug)."));
+
     PLV_DEBUG(F("\nWeather data commands:"));
     PLV_DEBUG(F("dump               Dump all data into serial monitor"));
     PLV_DEBUG(F("deletedata         Delete weather data files from local filesystem (WARNING: cannot be undone)"));
@@ -599,14 +894,14 @@ void printCommands()
 void getSystemInformation()
 {
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin())
+    // Mounts SPIFFS file system (once per session)
+    if (!pluvion.begin())
     {
         PLV_DEBUG(F("getSystemInformation() - FATAL! Error mounting SPIFFS file system!"));
     }
 
     FSInfo fs_info;
-    SPIFFS.info(fs_info);
+    PLV_FS.info(fs_info);
 
     float totalBytes = fs_info.totalBytes;
     float usedBytes = fs_info.usedBytes;
@@ -619,7 +914,8 @@ void getSystemInformation()
     SYSAvailableHeapInBytes = ESP.getFreeHeap();
     SYSAvailableDiskSpaceInBytes = freeBytes;
     SYSAvailableDiskSpaceInPercent = availablePercent;
-    SYSAvailableHeapInBytes = ESP.getFreeHeap();
+    SYSHeapFragmentationInPercent = ESP.getHeapFragmentation();
+    SYSMaxFreeBlockInBytes = ESP.getMaxFreeBlockSize();
     SYSVCCInV = ESP.getVcc();
     SYSLastResetReason = ESP.getResetReason();
 
@@ -635,6 +931,14 @@ void getSystemInformation()
     PLV_DEBUG_(SYSAvailableHeapInBytes);
     PLV_DEBUG(F(" bytes"));
 
+    PLV_DEBUG_(F("Heap Fragmentation: "));
+    PLV_DEBUG_(SYSHeapFragmentationInPercent);
+    PLV_DEBUG(F(" %"));
+
+    PLV_DEBUG_(F("Max Free Block: "));
+    PLV_DEBUG_(SYSMaxFreeBlockInBytes);
+    PLV_DEBUG(F(" bytes"));
+
     PLV_DEBUG_(F("Available Disk Space: "));
     PLV_DEBUG_(SYSAvailableDiskSpaceInBytes);
     PLV_DEBUG(F(" bytes"));
@@ -673,37 +977,51 @@ void dump()
 
     PLV_DEBUG_HEADER(F("DUMP WEATHER DATA TO SERIAL"));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin())
+    // Read all pending messages, oldest first
+    for (unsigned long seq = messageLog.first(); seq; seq = messageLog.next(seq))
     {
-        PLV_DEBUG(F("FATAL! Error mounting SPIFFS file system."));
+        printMessage(seq);
     }
+}
 
-    // Open data directory
-    Dir dir = SPIFFS.openDir(DIR_WEATHER_DATA);
+/**
+ * Print a message of the message log to serial
+ *
+ * @param seq Message log seq
+ */
+void printMessage(unsigned long seq)
+{
 
-    File f;
+    static char payload[PLV_LOG_PAYLOAD_SIZE + 1];
 
-    // Read all files
-    while (dir.next())
-    {
+    int length = messageLog.read(seq, payload, sizeof(payload) - 1);
 
-        PLV_DEBUG_(F("File name: "));
-        PLV_DEBUG(dir.fileName());
+    PLV_DEBUG_(F("Message "));
+    PLV_DEBUG_(seq);
+    PLV_DEBUG_(F(": "));
 
-        // Open file for reading
-        f = dir.openFile("r");
+    if (length < 0)
+    {
+        PLV_DEBUG(F("ERROR! Fail reading message."));
+        return;
+    }
 
-        // Reads the file content and print to Serial monitor
-        while (f.available())
+    // Binary frames and sample blocks as hex (decode with firmware/tools/pluvion_telemetry.py --hex)
+    if (PluviOnTelemetry::isFrame((uint8_t *)payload, length) ||
+        PluviOnSampleBlock::isBlock((uint8_t *)payload, length))
+    {
+        for (int i = 0; i < length; i++)
         {
-            String line = f.readStringUntil('\n');
-            PLV_DEBUG(line);
+            char hex[3];
+            snprintf(hex, sizeof(hex), "%02x", (uint8_t)payload[i]);
+            PLV_DEBUG_(hex);
         }
-
-        // Close file
-        f.close();
+        PLV_DEBUG(F(""));
+        return;
     }
+
+    payload[length] = '\0';
+    PLV_DEBUG(payload);
 }
 
 /**
@@ -720,8 +1038,15 @@ void fullReset()
     // Reset Rain Indicators
     resetRainIndicators();
 
-    // Format file system
-    pluvion.FSFormat();
+    // Wipe the file system (new storage epoch, older files are reclaimed in loop())
+    pluvion.FSWipe();
+
+    // Forget the configuration kept in RAM
+    config.clear();
+
+    // Recover the message log again, its segments belong to the old epoch (empty log)
+    messageLog.begin();
+    sinks.reset();
 
     // Reset WiFi Settings
     resetWiFiSettings();
@@ -759,6 +1084,9 @@ void initSystem()
 
     // Initialize DHT Sensor
     initDHTSensor();
+
+    // Initialize Hall Sensor
+    initHallSensor();
 }
 
 /**
@@ -769,18 +1097,15 @@ void deleteWeatherData()
 
     PLV_DEBUG_HEADER(F("DELETE WEATHER DATA"));
 
-    // Mounts SPIFFS file system
-    if (!SPIFFS.begin())
-    {
-        PLV_DEBUG(F("deleteWeatherData() - FATAL! Error mounting SPIFFS file system!"));
-    }
+    PLV_DEBUG_(F("Removing messages from ("));
+    PLV_DEBUG_(F(PLV_LOG_DIR));
+    PLV_DEBUG(F(") message log..."));
 
-    PLV_DEBUG_(F("Removing files from ("));
-    PLV_DEBUG_(DIR_WEATHER_DATA);
-    PLV_DEBUG(F(") directory..."));
+    // Drop all the queued messages (the deliveries in progress hold old seqs)
+    boolean cleared = messageLog.clear();
+    sinks.reset();
 
-    // Delete weather data dir
-    if (SPIFFS.remove(DIR_WEATHER_DATA))
+    if (cleared)
     {
 
         PLV_DEBUG(F("Weather data removed successfully."));
@@ -841,12 +1166,17 @@ void readSerialCommands()
         {
 
             PLV_DEBUG_HEADER(F("DELETING WEATHER DATA"));
-            pluvion.FSDeleteFiles(DIR_WEATHER_DATA);
+            messageLog.clear();
+            sinks.reset();
         }
         else if (serialCommand == "fsstatus")
         {
             printFileSystemStatus();
         }
+        else if (serialCommand == "fsstats")
+        {
+            pluvion.FSPrintStats();
+        }
         else if (serialCommand == "dump")
         {
             dump();
@@ -855,6 +1185,14 @@ void readSerialCommands()
         {
             deleteWeatherData();
         }
+        else if (serialCommand == "sinks")
+        {
+            printSinkStatus();
+        }
+        else if (serialCommand.startsWith("sink "))
+        {
+            toggleSink(serialCommand.substring(5));
+        }
         else
         {
 
@@ -875,24 +1213,26 @@ void initDHTSensor()
 }
 
 /**
- * Reads the hall sensor (tip bucket)
+ * Initialize Hall Sensor: both edges go to the ISR, readHallSensor() debounces them
  */
-void countTipBucket()
+void initHallSensor()
 {
+    pinMode(PIN_HALL, INPUT_PULLUP);
 
-    tipCounter++;
+    tipDebouncer.setMinPulseWidth(HALL_SENSOR_MIN_PULSE_WIDTH);
+    tipDebouncer.setRefractory(DELAY_HALL_SENSOR_DEBOUNCING * 1000UL);
+    tipDebouncer.begin(digitalRead(PIN_HALL));
 
-    PLV_DEBUG_HEADER(F("TIP BUCKET INCREASED"));
-
-    PLV_DEBUG_(F("Current value: "));
-    PLV_DEBUG(tipCounter);
-
-    PLV_DEBUG_(F("Real tip count: "));
-    PLV_DEBUG(realTipCount);
+    // CHANGE = trigger the interrupt whenever the pin changes value
+    attachInterrupt(PIN_HALL, countTipBucket, CHANGE);
+}
 
-    PLV_DEBUG_(F("Rain volume (mm): "));
-    PLV_DEBUG_(rainVolume);
-    PLV_DEBUG(F(" mm"));
+/**
+ * Hall sensor ISR: only record the edge (time and pin level)
+ */
+void IRAM_ATTR countTipBucket()
+{
+    tipEvents.push(PLV_EDGE(micros(), digitalRead(PIN_HALL)));
 }
 
 /**
@@ -905,7 +1245,6 @@ void resetRainIndicators()
 
     resetFlag = true;
     tipCounter = 0;
-    lastTipCount = 0;
     realTipCount = 0;
     rainVolume = 0;
 }
@@ -918,8 +1257,8 @@ void initFirmwareVersion()
 
     PLV_DEBUG_HEADER(F("INIT FIRMWARE VERSION"));
 
-    pluvion.FSDeleteFiles(DIR_FIRMWARE_VERSION);
-    pluvion.FSCreateFile(DIR_FIRMWARE_VERSION, FIRMWARE_VERSION);
+    // Only written if the version changed
+    config.setString(PLV_CFG_FIRMWARE_VERSION, FIRMWARE_VERSION.c_str());
 
     PLV_DEBUG_(F("FIRMWARE VERSION: "));
     PLV_DEBUG(FIRMWARE_VERSION);
@@ -933,7 +1272,7 @@ void initStationID()
 
     PLV_DEBUG_HEADER(F("INIT STATION ID"));
 
-    STATION_ID = pluvion.FSReadString(DIR_STATION_ID);
+    STATION_ID = config.getString(PLV_CFG_STATION_ID);
 
     if (!STATION_ID.length())
     {
@@ -943,7 +1282,7 @@ void initStationID()
         STATION_ID = STATION_ID_PREFIX;
         STATION_ID += ESP.getChipId();
 
-        pluvion.FSCreateFile(DIR_STATION_ID, STATION_ID);
+        config.setString(PLV_CFG_STATION_ID, STATION_ID.c_str());
     }
 
     PLV_DEBUG_(F("STATION ID: "));
@@ -958,14 +1297,14 @@ void initStationName()
 
     PLV_DEBUG_HEADER(F("INIT STATION NAME"));
 
-    String sttName = pluvion.FSReadString(DIR_STATION_NAME);
+    String sttName = config.getString(PLV_CFG_STATION_NAME);
 
     // If STATION NAME not found, set default
     if (!sttName.length())
     {
 
         PLV_DEBUG(F("STATION NAME not found.\nSetting default STATION NAME ..."));
-        pluvion.FSCreateFile(DIR_STATION_NAME, STATION_NAME);
+        config.setString(PLV_CFG_STATION_NAME, STATION_NAME.c_str());
     }
     else
     {
@@ -985,8 +1324,8 @@ void initStationCoordinates()
 
     PLV_DEBUG_HEADER(F("INIT STATION COORDINATES"));
 
-    STATION_LATITUDE = pluvion.FSReadString(DIR_STATION_LATITUDE);
-    STATION_LONGITUDE = pluvion.FSReadString(DIR_STATION_LONGITUDE);
+    STATION_LATITUDE = config.getString(PLV_CFG_LATITUDE);
+    STATION_LONGITUDE = config.getString(PLV_CFG_LONGITUDE);
 
     PLV_DEBUG_(F("STATION LATITUDE: "));
     PLV_DEBUG(STATION_LATITUDE);
@@ -1002,7 +1341,7 @@ void initBucketVolume()
 
     PLV_DEBUG_HEADER(F("INIT BUCKET VOLUME"));
 
-    float vol = pluvion.FSReadFloat(DIR_STATION_BUCKET_VOL);
+    float vol = config.getFloat(PLV_CFG_BUCKET_VOLUME);
 
     if (vol)
     {
@@ -1015,6 +1354,9 @@ void initBucketVolume()
 
     PLV_DEBUG_(F("STATION BUCKET VOLUME: "));
     PLV_DEBUG(PLV_STATION_BUCKET_VOLUME);
+
+    // mm per tip of the rain intensities
+    rainRate.setBucket(PLV_STATION_BUCKET_VOLUME, CONTRIBUTION_AREA);
 }
 
 /**
@@ -1025,17 +1367,15 @@ void initMessageID()
 
     PLV_DEBUG_HEADER(F("INITIALIZING SYSTEM MESSAGE COUNTER"));
 
-    // Read message counter
-    int counter = pluvion.FSReadInt(DIR_MESSAGE_COUNTER);
-
-    if (counter)
+    // Read message counter (a stored 0 is a valid counter, only a missing one means first boot)
+    if (config.has(PLV_CFG_MESSAGE_ID))
     {
 
         // Set the message counter
-        messageID = counter;
+        messageID = config.getInt(PLV_CFG_MESSAGE_ID);
     }
 
-    // No message counter directory (first system boot)
+    // No message counter (first system boot)
     else
     {
 
@@ -1060,7 +1400,7 @@ void initStationTime()
     PLV_DEBUG_HEADER(F("INIT STATION TIME"));
 
     // Read System Time
-    int sttTime = pluvion.FSReadInt(DIR_STATION_TIME);
+    int sttTime = config.getInt(PLV_CFG_STATION_TIME);
 
     if (sttTime)
     {
@@ -1087,7 +1427,7 @@ void initTimeToReset()
     PLV_DEBUG_HEADER(F("INIT TIME TO RESET"));
 
     // Read System Time To Reset
-    int ttr = pluvion.FSReadULong(DIR_STATION_TIME_TO_RESET);
+    int ttr = config.getInt(PLV_CFG_TIME_TO_RESET);
 
     if (ttr)
     {
@@ -1116,11 +1456,8 @@ void incrementStationTime()
     // Add millis to current Station Time
     STATION_TIME += seconds();
 
-    // Remove old Station Time
-    pluvion.FSDeleteFiles(DIR_STATION_TIME);
-
     // Save new Station Time
-    pluvion.FSCreateFile(DIR_STATION_TIME, STATION_TIME);
+    config.setInt(PLV_CFG_STATION_TIME, STATION_TIME);
 }
 
 /**
@@ -1139,11 +1476,8 @@ void updateStationTime(int sttTime)
 
         STATION_TIME = sttTime;
 
-        // Remove system time
-        pluvion.FSDeleteFiles(DIR_STATION_TIME);
-
         // Save new station time
-        pluvion.FSCreateFile(DIR_STATION_TIME, STATION_TIME);
+        config.setInt(PLV_CFG_STATION_TIME, STATION_TIME);
     }
 
     PLV_DEBUG_(F("STATION TIME: "));
@@ -1163,11 +1497,8 @@ void updateTimeToReset(int ttr)
 
         TIME_TO_RESET = ttr;
 
-        // Remove system counter
-        pluvion.FSDeleteFiles(DIR_STATION_TIME_TO_RESET);
-
-        // Save message id
-        pluvion.FSCreateFile(DIR_STATION_TIME_TO_RESET, TIME_TO_RESET);
+        // Save time to reset
+        config.setInt(PLV_CFG_TIME_TO_RESET, TIME_TO_RESET);
     }
 
     PLV_DEBUG_(F("TIME TO RESET: "));
@@ -1223,20 +1554,22 @@ void resetMessageID()
 
     messageID = 0;
 
-    // Remove system counter
-    pluvion.FSDeleteFiles(DIR_MESSAGE_COUNTER);
+    // Reset system counter
+    config.setInt(PLV_CFG_MESSAGE_ID, messageID);
 }
 
 /**
- * Remove the system messsage counter file
+ * Mark a message of the request as accepted by the Pluvi.On API (the message
+ * log drops it once every sink delivered it)
+ *
+ * @param position Message position in the request
  */
-void removeMessageByID(int messageID)
+void ackMessage(uint8_t position)
 {
 
-    PLV_DEBUG_HEADER(F("REMOVE WEATHER MESSAGE LOCALLY BY ID"));
+    PLV_DEBUG_HEADER(F("ACKNOWLEDGE WEATHER MESSAGE"));
 
-    // Remove message from file system
-    pluvion.FSDeleteFile(DIR_WEATHER_DATA, messageID);
+    uploadAcked[position] = true;
 }
 
 /**
@@ -1250,24 +1583,23 @@ void incrementMessageID()
     // Increment message id
     messageID++;
 
-    // Remove message id
-    pluvion.FSDeleteFiles(DIR_MESSAGE_COUNTER);
-
     // Save message id
-    pluvion.FSCreateFile(DIR_MESSAGE_COUNTER, messageID);
+    config.setInt(PLV_CFG_MESSAGE_ID, messageID);
 }
 
 /**
  * Build message
  * 
- * @return Message
+ * @param buffer Message buffer
+ * @param size Buffer size in bytes
+ * @return Message length in bytes, or 0 if it doesn't fit in the buffer
  */
-String buildMessage()
+size_t buildMessage(char *buffer, size_t size)
 {
 
     PLV_DEBUG(F("Building Message..."));
 
-    String message = "";
+    PluviOnMessageWriter message(buffer, size);
 
     // Message ID
     message += messageID;
@@ -1383,261 +1715,1049 @@ String buildMessage()
     // VCC (volts)
     message += SYSVCCInV;
 
+#if PLV_MESSAGE_RAIN_RATE
+    // RAIN RATE (mm/h) ====================================
+    rainRate.update(millis());
+
+    // Intensity over the last 1, 5, 15 and 60 minutes
+    for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++)
+    {
+        message += FIELD_SEPARATOR;
+        message += rainRate.intensity((PluviOnRainWindow)w);
+    }
+
+    // Peak of each window since the previous message
+    for (uint8_t w = 0; w < PLV_RAIN_WINDOWS; w++)
+    {
+        message += FIELD_SEPARATOR;
+        message += rainRate.maxIntensity((PluviOnRainWindow)w);
+    }
+    rainRate.resetPeriod();
+#endif
+
+#if PLV_MESSAGE_FS_STATS
+    // FILE SYSTEM STATS (since boot) ====================================
+    unsigned long FSTimeInMicros = 0;
+    for (uint8_t op = 0; op < PLV_FS_OP_COUNT; op++)
+    {
+        FSTimeInMicros += pluvion.FSOpStats((PluviOnFSOp) op).totalInMicros;
+    }
+
+    // Time spent in file system calls (ms)
+    message += FIELD_SEPARATOR;
+    message += FSTimeInMicros / 1000;
+
+    // Open latency p99 (us)
+    message += FIELD_SEPARATOR;
+    message += pluvion.FSOpPercentile(PLV_FS_OP_OPEN, 99);
+
+    // Writes
+    const PluviOnFSOpStats &writes = pluvion.FSOpStats(PLV_FS_OP_WRITE);
+    message += FIELD_SEPARATOR;
+    message += writes.count;
+
+    // Write latency avg and p99 (us)
+    message += FIELD_SEPARATOR;
+    message += writes.count ? writes.totalInMicros / writes.count : 0;
+    message += FIELD_SEPARATOR;
+    message += pluvion.FSOpPercentile(PLV_FS_OP_WRITE, 99);
+
+    // Bytes written and estimated erase blocks
+    message += FIELD_SEPARATOR;
+    message += pluvion.FSBytesWritten();
+    message += FIELD_SEPARATOR;
+    message += pluvion.FSEraseBlocks();
+#endif
+
+    if (message.overflow())
+    {
+        PLV_DEBUG(F("ERROR: Message doesn't fit in the buffer."));
+        return 0;
+    }
+
     PLV_DEBUG_(F("\nMESSAGE ("));
     PLV_DEBUG_(message.length());
     PLV_DEBUG(F(" bytes): "));
-    PLV_DEBUG(message);
+    PLV_DEBUG(message.c_str());
 
-    return message;
+    return message.length();
 }
 
 /**
- * Build the weather message and send to Pluvi.On API
+ * Build the weather message as a binary frame (same fields as buildMessage,
+ * config and infrastructure fields only in keyframes)
+ *
+ * @return Frame length in bytes, or 0 if it fails
  */
-void buildSaveAndSendMessage()
+size_t buildFrame(uint8_t *buffer, size_t size)
 {
 
-    PLV_DEBUG_HEADER(F("BUILD WEATHER MESSAGE AND SAVE"));
-
-    // Get System Environmental Information
-    getSystemInformation();
-
-    // Build Weather Message
-    String message = buildMessage();
-
-    // Save message locally
-    int id = messageID;
-
-    // Save message
-    saveMessage(id, message);
+    PLV_DEBUG(F("Building Frame..."));
+
+    PluviOnTelemetrySample sample;
+    sample.messageID = messageID;
+    sample.stationTime = STATION_TIME;
+    sample.rainVolume = rainVolume;
+    sample.tipCount = realTipCount;
+    sample.temperature = temperature;
+    sample.humidity = humidity;
+    sample.heatIndex = computedHeatIndex;
+    sample.freeHeap = SYSAvailableHeapInBytes;
+    sample.freeDiskBytes = SYSAvailableDiskSpaceInBytes;
+    sample.freeDiskPercent = SYSAvailableDiskSpaceInPercent;
+    sample.rssi = SYSWiFiRSSIindBm;
+    sample.vcc = SYSVCCInV;
+    sample.timeToReset = TIME_TO_RESET;
+    sample.reset = resetFlag;
+
+    PluviOnTelemetryConfig stationConfig;
+    stationConfig.stationName = STATION_NAME.c_str();
+    stationConfig.latitude = STATION_LATITUDE.c_str();
+    stationConfig.longitude = STATION_LONGITUDE.c_str();
+    stationConfig.bucketVolume = PLV_STATION_BUCKET_VOLUME;
+    stationConfig.dhtReadingDelay = DHT_SENSOR_READING_DELAY;
+    stationConfig.hallDebounceDelay = DELAY_HALL_SENSOR_DEBOUNCING;
+    stationConfig.firmwareVersion = FIRMWARE_VERSION.c_str();
+    stationConfig.resetReason = SYSLastResetReason.c_str();
+    stationConfig.ssid = SYSWiFiSSID.c_str();
+    stationConfig.localIp = SYSWiFiLocalIp.c_str();
+    stationConfig.hostname = SYSWiFiHostname.c_str();
+    stationConfig.macAddr = SYSWiFiMACAddr.c_str();
+
+    size_t length = telemetry.encode(STATION_ID.c_str(), sample, stationConfig, buffer, size);
+
+    if (length)
+    {
+        resetFlag = false;
+    }
 
-    // Increment MessageID
-    incrementMessageID();
+    PLV_DEBUG_(F("\nFRAME ("));
+    PLV_DEBUG_(length);
+    PLV_DEBUG(F(" bytes)"));
 
-    // Post
-    sendMessage(id, message);
+    return length;
 }
 
 /**
- * Post weather data to Pluvi.On API
+ * Save the sensor sample: added to the newest sample block of the message
+ * log while no sink delivered it (the station is offline), up to
+ * PLV_SAMPLES_PER_RECORD samples, otherwise in a new block
+ *
+ * @return The message log sequence number, or 0 if it fails
  */
-void sendMessage(int messageID, String message)
+unsigned long saveSample()
 {
 
-    PLV_DEBUG_HEADER(F("POST WEATHER TO PLUVION API"));
+    PLV_DEBUG(F("Building Sample Block..."));
 
-    PLV_DEBUG_(F("MessageID:           "));
-    PLV_DEBUG(messageID);
+    PluviOnSample sample;
+    sample.messageID = messageID;
+    sample.stationTime = STATION_TIME;
+    sample.tipCount = realTipCount;
+    sample.temperature = temperature;
+    sample.humidity = humidity;
 
-    PLV_DEBUG_(F("Message ("));
-    PLV_DEBUG_(message.length());
-    PLV_DEBUG_(F(" bytes): "));
-    PLV_DEBUG(message);
+    static uint8_t buffer[PLV_LOG_PAYLOAD_SIZE];
+    PluviOnSampleBlock block(buffer, sizeof(buffer));
 
-    // Check Connection
-    while (!WIFISecureClient.connect(PLUVION_API_SERVER_ADDR, PLUVION_API_SERVER_PORT))
+    // A delivery in progress may be reading the record
+    boolean busy = false;
+    for (uint8_t i = 0; i < sinks.count(); i++)
     {
-        PLV_DEBUG(F("CONNECTION FAILED!"));
-        return;
+        busy = busy || sinks.get(i)->busy();
     }
 
-    String requestHeader =
-        String("POST ") + PLUVION_API_RESOURCE_WEATHER + " HTTP/1.1" + HTTP_HEADER_EOL +
-        "Host: " + PLUVION_API_SERVER_ADDR + HTTP_HEADER_EOL +
-        HTTP_HEADER_USER_AGENT + HTTP_HEADER_EOL +
-        HTTP_HEADER_ACCEPT + HTTP_HEADER_EOL +
-        HTTP_HEADER_CONTENT_TYPE + HTTP_HEADER_EOL +
-//        HTTP_HEADER_PLUVION_KEY + HTTP_HEADER_EOL +
-        "Content-Length: " + message.length() + HTTP_HEADER_EOL +
-        "Connection: close" + HTTP_HEADER_EOL + HTTP_HEADER_EOL;
-
-    PLV_DEBUG(F("Request Header:"));
-    PLV_DEBUG(requestHeader);
+    if (sampleSeq && !busy && !messageLog.marks(sampleSeq))
+    {
+        int length = messageLog.read(sampleSeq, buffer, sizeof(buffer));
 
-    // Post Data
-    WIFISecureClient.print(requestHeader);
-    WIFISecureClient.print(message);
-    PLV_DEBUG(F("Response:"));
+        if (length > 0 && block.resume(length) && block.count() < PLV_SAMPLES_PER_RECORD &&
+            block.add(sample) && messageLog.update(sampleSeq, buffer, block.length()))
+        {
+            PLV_DEBUG_(F("\nSAMPLE BLOCK ("));
+            PLV_DEBUG_(block.count());
+            PLV_DEBUG_(F(" samples, "));
+            PLV_DEBUG_(block.length());
+            PLV_DEBUG(F(" bytes)"));
 
-    // Read server response
-    // SECTIONS:
-    // h - Headers
-    // r - Response
-    char section = 'x';
-    String line = "";
-    String response = "";
+            return sampleSeq;
+        }
+    }
 
-    while (WIFISecureClient.connected())
+    if (!block.begin(STATION_ID.c_str()) || !block.add(sample))
     {
-        if (WIFISecureClient.available())
-        {
-            line = WIFISecureClient.readStringUntil('\r');
-            PLV_DEBUG_(line);
-
-            // Body
-            if (line == "\n")
-            {
-                section = 'r';
-            }
-
-            if (section == 'r' && line.length() > 1)
-            {
-                response += line.substring(1);
-            }          
-        }
+        PLV_DEBUG(F("ERROR: Sample block doesn't fit in the buffer."));
+        return 0;
     }
 
-    PLV_DEBUG(F("\n\nClosing connection."));
-    WIFISecureClient.stop();
+    PLV_DEBUG_(F("\nSAMPLE BLOCK ("));
+    PLV_DEBUG_(block.length());
+    PLV_DEBUG(F(" bytes)"));
 
-    // Process the response and/or takes an action
-    processResponse(messageID, response);
-    connect2wifi_thingspeak();
-}
-
-void connect2wifi_thingspeak() {
-  if (client.connect("api.thingspeak.com",80)) {  //   "184.106.153.149" or api.thingspeak.com
-    String postStr = apiKey;
-           postStr +="&field1=";
-           postStr += String(temperature);
-           postStr +="&field2=";
-           postStr += String(humidity);
-           postStr +="&field3=";
-           postStr += String(computedHeatIndex);
-           postStr +="&field4=";
-           postStr += String(rainVolume);
-           postStr += "\r\n\r\n";
-           
-     client.print("POST /update HTTP/1.1\n");
-     client.print("Host: api.thingspeak.com\n");
-     client.print("Connection: close\n");
-     client.print("X-THINGSPEAKAPIKEY: "+apiKey+"\n");
-     client.print("Content-Type: application/x-www-form-urlencoded\n");
-     client.print("Content-Length: ");
-     client.print(postStr.length());
-     client.print("\n\n");
-     client.print(postStr);
-     client.stop();
-  }
+    sampleSeq = saveMessage((char *)buffer, block.length());
+
+    return sampleSeq;
 }
+
 /**
- * Process server response
+ * Build the weather message and send to Pluvi.On API
  */
-void processResponse(int messageID, String response)
+void buildSaveAndSendMessage()
 {
 
-    PLV_DEBUG_HEADER(F("PROCESS RESPONSE"));
+    PLV_DEBUG_HEADER(F("BUILD WEATHER MESSAGE AND SAVE"));
 
-    PLV_DEBUG_(F("MessageID: "));
-    PLV_DEBUG(messageID);
+    // Get System Environmental Information
+    getSystemInformation();
 
-    PLV_DEBUG_(F("Response:  "));
-    PLV_DEBUG(response);
+#if PLV_MESSAGE_SAMPLE_BLOCK
+    // Save sample locally
+    unsigned long seq = saveSample();
+
+    // Increment MessageID
+    incrementMessageID();
 
-    if (response.length() < 1 || response.indexOf('|') == -1)
+    // Delivered by the sinks, from the message log
+    if (!seq)
+    {
+        PLV_DEBUG(F("ERROR: Message not saved, it can't be posted."));
+    }
+#elif PLV_MESSAGE_BINARY
+    // Build Weather Frame
+    static uint8_t frame[PLV_LOG_PAYLOAD_SIZE];
+    size_t length = buildFrame(frame, sizeof(frame));
+
+    if (!length)
     {
-        PLV_DEBUG(F("Response empty! Nothing to do, keep walking :)"));
         return;
     }
 
-    // Get response as char array
-    char *res = (char *)response.c_str();
+    // Save frame locally
+    unsigned long seq = saveMessage((char *)frame, length);
 
-    // Read each command pair
-    char *msg = strtok(res, "|");
-    int index = 0;
+    // Increment MessageID
+    incrementMessageID();
 
-    do
+    // Delivered by the sinks, from the message log
+    if (!seq)
     {
-        PLV_DEBUG_(F(" ["));
-        PLV_DEBUG_(index);
-        PLV_DEBUG_(F("] "));
-        PLV_DEBUG(msg);
+        PLV_DEBUG(F("ERROR: Message not saved, it can't be posted."));
+    }
+#else
+    // Build Weather Message
+    static char message[PLV_LOG_PAYLOAD_SIZE + 1];
+    size_t length = buildMessage(message, sizeof(message));
 
-        // 0 - Result
-        if (index == 0)
-        {
+    if (!length)
+    {
+        return;
+    }
 
-            PLV_DEBUG_(F("Request Result: ["));
-            PLV_DEBUG_(msg);
-            PLV_DEBUG(F("]"));
+    // Save message locally
+    unsigned long seq = saveMessage(message, length);
 
-            if (String(msg) == "ok")
-            {
-                // Remove local file
-                removeMessageByID(messageID);
-            }
-            continue;
-        }
+    // Increment MessageID
+    incrementMessageID();
 
-        // 1 - System Time in millis
-        if (index == 1)
-        {
+    // Delivered by the sinks, from the message log
+    if (!seq)
+    {
+        PLV_DEBUG(F("ERROR: Message not saved, it can't be posted."));
+    }
+#endif
+}
 
-            PLV_DEBUG_(F("Server time: "));
-            PLV_DEBUG(msg);
-            updateStationTime(atoi(msg));
+/**
+ * Read a message log record as it goes in the request: offline messages
+ * get the "|off" suffix (and a line break in a batch), offline frames and
+ * sample blocks the offline flag
+ *
+ * @param seq Message log seq
+ * @return Record length in bytes (in uploadRecord), or -1 if it can't be read
+ */
+int readUploadRecord(unsigned long seq)
+{
 
-            continue;
-        }
+    int length = messageLog.read(seq, uploadRecord, PLV_LOG_PAYLOAD_SIZE);
 
-        // 2 - Time to Reset System
-        if (index == 2)
-        {
+    if (length < 0 || !uploadOffline)
+    {
+        return length;
+    }
 
-            PLV_DEBUG_(F("Time to reset: "));
-            PLV_DEBUG(msg);
-            resetStartTime = seconds();
-            updateTimeToReset(atoi(msg));
+    if (PluviOnTelemetry::isFrame(uploadRecord, length))
+    {
+        PluviOnTelemetry::markOffline(uploadRecord, length);
+        return length;
+    }
 
-            continue;
-        }
+    if (PluviOnSampleBlock::isBlock(uploadRecord, length))
+    {
+        PluviOnSampleBlock::markOffline(uploadRecord, length);
+        return length;
+    }
 
-        // 3 - Server Command
-        if (index == 3)
-        {
+    PluviOnMessageWriter message((char *)uploadRecord + length, sizeof(uploadRecord) - length);
+    message += FIELD_SEPARATOR;
+    message += "off";
+#if SEND_OFFLINE_MESSAGES_BATCH_SIZE > 1
+    message += '\n';
+#endif
 
-            PLV_DEBUG_(F("Server Command: "));
-            PLV_DEBUG(msg);
+    return length + message.length();
+}
 
-            if (msg == "reset")
-            {
-                // Reset Appliance
-                PLV_DEBUG(F("RESET !!!!"));
-                resetRainIndicators();
-            }
+/**
+ * Upload content source: the records of the request, one at a time
+ */
+size_t readUploadContent(uint8_t *buffer, size_t size, void *context)
+{
 
-            continue;
+    // Next record
+    while (uploadRecordOffset >= uploadRecordLength)
+    {
+        if (uploadNext >= uploadCount)
+        {
+            return 0;
         }
 
-    } while (
-        (msg = strtok(0, "|")) // Find the next command in input string
-        && ++index             // Increment the command index
-        );
+        int length = readUploadRecord(uploadSeqs[uploadNext++]);
+
+        if (length < 0)
+        {
+            // The content length is already sent, the request can't be completed
+            PLV_DEBUG(F("ERROR: Fail reading message, aborting the upload."));
+            return PLV_UPLOAD_SOURCE_ERROR;
+        }
+
+        uploadRecordLength = length;
+        uploadRecordOffset = 0;
+    }
+
+    size_t length = min(size, uploadRecordLength - uploadRecordOffset);
+    memcpy(buffer, uploadRecord + uploadRecordOffset, length);
+    uploadRecordOffset += length;
+
+    return length;
 }
 
 /**
- * Write weather data to file system
+ * Restart the upload content from the first record
  */
-boolean saveMessage(int messageID, String message)
+void rewindUploadContent()
 {
-
-    PLV_DEBUG_HEADER(F("SAVE WEATHER DATA LOCALLY"));
-
-    // Save message
-    return pluvion.FSWriteToFile(DIR_WEATHER_DATA, messageID, message);
+    uploadNext = 0;
+    uploadRecordLength = 0;
+    uploadRecordOffset = 0;
 }
 
+#if PLV_UPLOAD_COMPRESSION
 /**
- * Read DHT Sensor
+ * Compress the records once to get the compressed content length
+ * (the content is compressed again while it's written)
+ *
+ * @return Compressed length in bytes, or 0 if a record can't be read
  */
-void readDHTSensor()
+size_t compressedUploadLength()
 {
 
-    // Current millis mark
-    currentDHTReadingInMillis = millis();
+    static uint8_t scratch[PLV_UPLOAD_CHUNK_SIZE];
+    size_t length = 0;
 
-    // Check if the past reading has failed and the time
+    rewindUploadContent();
+    compressor.begin(readUploadContent, NULL);
+
+    while (true)
+    {
+        size_t chunk = compressor.read(scratch, sizeof(scratch));
+
+        if (chunk == PLV_UPLOAD_SOURCE_ERROR)
+        {
+            return 0;
+        }
+
+        if (!chunk)
+        {
+            return length;
+        }
+
+        length += chunk;
+        yield();
+    }
+}
+#endif
+
+/**
+ * Start posting the records in uploadSeqs (an offline batch is compressed
+ * when the API accepts it and it gets smaller)
+ *
+ * @param resource API resource
+ * @param binary true for binary frames, false for text messages
+ * @param length Content length in bytes
+ * @return true if started, otherwise false.
+ */
+boolean startUpload(const char *resource, boolean binary, size_t length)
+{
+
+    PluviOnUploadSource source = readUploadContent;
+    void *context = NULL;
+
+#if PLV_UPLOAD_COMPRESSION
+    uploadCompressed = false;
+
+    // Sample blocks are already delta encoded
+    if (APIAcceptsLZSS && uploadOffline && uploadCount > 1 && !uploadSamples)
+    {
+        size_t compressedLength = compressedUploadLength();
+
+        PLV_DEBUG_(F("Compression: "));
+        PLV_DEBUG_(length);
+        PLV_DEBUG_(F(" -> "));
+        PLV_DEBUG_(compressedLength);
+        PLV_DEBUG(F(" bytes"));
+
+        if (compressedLength > 0 && compressedLength < length)
+        {
+            APICompressedBytesIn += length;
+            APICompressedBytesOut += compressedLength;
+
+            uploadCompressed = true;
+            length = compressedLength;
+        }
+    }
+#endif
+
+    PluviOnMessageWriter requestHeader(uploadHeader, sizeof(uploadHeader));
+    requestHeader += "POST ";
+    requestHeader += resource;
+    requestHeader += " HTTP/1.1";
+    requestHeader += HTTP_HEADER_EOL;
+    requestHeader += "Host: ";
+    requestHeader += PLUVION_API_SERVER_ADDR;
+    requestHeader += HTTP_HEADER_EOL;
+    requestHeader += HTTP_HEADER_USER_AGENT;
+    requestHeader += HTTP_HEADER_EOL;
+    requestHeader += HTTP_HEADER_ACCEPT;
+    requestHeader += HTTP_HEADER_EOL;
+    requestHeader += (binary ? HTTP_HEADER_CONTENT_TYPE_BINARY : HTTP_HEADER_CONTENT_TYPE);
+    requestHeader += HTTP_HEADER_EOL;
+#if PLV_UPLOAD_COMPRESSION
+    if (uploadCompressed)
+    {
+        requestHeader += "Content-Encoding: ";
+        requestHeader += PLV_LZSS_ENCODING;
+        requestHeader += HTTP_HEADER_EOL;
+    }
+#endif
+//    requestHeader += HTTP_HEADER_PLUVION_KEY;
+//    requestHeader += HTTP_HEADER_EOL;
+    requestHeader += "Content-Length: ";
+    requestHeader += length;
+    requestHeader += HTTP_HEADER_EOL;
+    requestHeader += "Connection: keep-alive";
+    requestHeader += HTTP_HEADER_EOL;
+    requestHeader += HTTP_HEADER_EOL;
+
+    if (requestHeader.overflow())
+    {
+        PLV_DEBUG(F("ERROR: Request header doesn't fit in the buffer."));
+        return false;
+    }
+
+    PLV_DEBUG(F("Request Header:"));
+    PLV_DEBUG(uploadHeader);
+
+    rewindUploadContent();
+
+#if PLV_UPLOAD_COMPRESSION
+    if (uploadCompressed)
+    {
+        compressor.begin(readUploadContent, NULL);
+        source = PluviOnLZSS::source;
+        context = &compressor;
+    }
+#endif
+
+    APIRequests++;
+    APILastRequestInMillis = millis();
+
+    return uploader.start(PLUVION_API_SERVER_ADDR, PLUVION_API_SERVER_PORT, PLV_UPLOAD_HTTP,
+                          uploadHeader, requestHeader.length(), source, context);
+}
+
+/**
+ * Pluvi.On API sink: one step of the request. Only a new connection blocks:
+ * TCP connect and TLS handshake, seconds for a full handshake (see
+ * initAPIClient()); a kept-alive connection skips it.
+ */
+PluviOnSinkStatus stepPluvionSink(PluviOnSink &sink, void *context)
+{
+
+    PluviOnUploadState state = uploader.step();
+
+    if (state != PLV_UPLOAD_DONE && state != PLV_UPLOAD_FAILED)
+    {
+        return PLV_SINK_BUSY;
+    }
+
+    unsigned long connectTime = uploader.connectTimeInMillis();
+    if (connectTime)
+    {
+        APIHandshakes++;
+        APIHandshakeTimeInMillis += connectTime;
+    }
+
+    APIBytesSent += uploader.bytesSent();
+    APIBytesReceived += uploader.bytesReceived();
+    APILastRequestInMillis = millis();
+
+    PLV_DEBUG_(F("Handshake:  "));
+    if (connectTime)
+    {
+        PLV_DEBUG_(connectTime);
+        PLV_DEBUG(F(" ms"));
+    }
+    else
+    {
+        PLV_DEBUG(F("none (connection reused)"));
+    }
+
+    PLV_DEBUG_(F("Bytes:      "));
+    PLV_DEBUG_(uploader.bytesSent());
+    PLV_DEBUG_(F(" sent, "));
+    PLV_DEBUG_(uploader.bytesReceived());
+    PLV_DEBUG(F(" received"));
+
+    if (state == PLV_UPLOAD_FAILED)
+    {
+        PLV_DEBUG(F("CONNECTION FAILED!"));
+        return PLV_SINK_FAILED;
+    }
+
+#if PLV_UPLOAD_COMPRESSION
+    // The API lists the request encodings it decodes (RFC 7694); 415 if it can't decode this one
+    if (*uploader.acceptEncoding())
+    {
+        APIAcceptsLZSS = strstr(uploader.acceptEncoding(), PLV_LZSS_ENCODING) != NULL;
+    }
+
+    // Refused by the server, not a link failure: nothing delivered
+    if (uploadCompressed && uploader.status() == 415)
+    {
+        PLV_DEBUG(F("Compressed batch refused, sending it uncompressed."));
+        APIAcceptsLZSS = false;
+        return PLV_SINK_DONE;
+    }
+#endif
+
+    // Process the response and/or takes an action
+    memset(uploadAcked, 0, sizeof(uploadAcked));
+    processResponse(uploadSeqs, uploadCount, uploader.response());
+
+    // Mark each accepted message, the refused ones are posted again
+    for (uint8_t i = 0; i < uploadCount; i++)
+    {
+        if (uploadAcked[i])
+        {
+            sink.deliver(uploadSeqs[i]);
+        }
+    }
+
+    return PLV_SINK_DONE;
+}
+
+/**
+ * Close the Pluvi.On API connection once it's idle (end of a burst of requests)
+ */
+void closeIdleConnection()
+{
+
+    if (!uploader.busy() && WIFISecureClient.connected() &&
+        (millis() - APILastRequestInMillis) >= (unsigned long)PLUVION_API_KEEP_ALIVE_TIMEOUT)
+    {
+        PLV_DEBUG(F("Closing idle Pluvi.On API connection."));
+        WIFISecureClient.stop();
+    }
+}
+
+/**
+ * Setup the Pluvi.On API client
+ */
+void initAPIClient()
+{
+
+    PLV_DEBUG_HEADER(F("SETUP PLUVION API CLIENT"));
+
+    // Same trust as the previous (axTLS) client, which did not verify the certificate
+    WIFISecureClient.setInsecure();
+
+    // Resume the TLS session on reconnection (skips the full handshake)
+    WIFISecureClient.setSession(&TLSSession);
+
+    // Bounds each connection attempt (connect() blocks the loop), retried within the request timeout.
+    // The TLS handshake runs in connect() too: its I/O waits are bounded, its
+    // crypto is not (seconds, unless the session above is resumed)
+    WIFISecureClient.setTimeout(PLUVION_API_SERVER_CONNECT_TIMEOUT);
+    client.setTimeout(PLUVION_API_SERVER_CONNECT_TIMEOUT);
+
+    uploader.setKeepAlive(true);
+    uploader.setTimeouts(PLUVION_API_SERVER_REQ_TIMEOUT, PLUVION_API_SERVER_REQ_TIMEOUT, PLUVION_API_SERVER_REQ_TIMEOUT);
+    thingspeakUploader.setTimeouts(PLUVION_API_SERVER_REQ_TIMEOUT, PLUVION_API_SERVER_REQ_TIMEOUT, PLUVION_API_SERVER_REQ_TIMEOUT);
+
+    PLV_DEBUG(F("Done."));
+}
+
+/**
+ * Post the current readings to ThingSpeak (stepped from the loop)
+ *
+ * @return true if the request started, otherwise false.
+ */
+boolean connect2wifi_thingspeak() {
+  static char postStr[128];
+  static char request[256];
+
+  if (thingspeakUploader.busy()) {
+    return false;
+  }
+
+  PluviOnMessageWriter body(postStr, sizeof(postStr));
+  body += apiKey;
+  body +="&field1=";
+  body += temperature;
+  body +="&field2=";
+  body += humidity;
+  body +="&field3=";
+  body += computedHeatIndex;
+  body +="&field4=";
+  body += rainVolume;
+  body += "\r\n\r\n";
+
+  PluviOnMessageWriter header(request, sizeof(request));
+  header += "POST /update HTTP/1.1\n";
+  header += "Host: api.thingspeak.com\n";
+  header += "Connection: close\n";
+  header += "X-THINGSPEAKAPIKEY: ";
+  header += apiKey;
+  header += "\n";
+  header += "Content-Type: application/x-www-form-urlencoded\n";
+  header += "Content-Length: ";
+  header += body.length();
+  header += "\n\n";
+
+  if (body.overflow() || header.overflow()) {
+    return false;
+  }
+
+  //   "184.106.153.149" or api.thingspeak.com
+  return thingspeakUploader.start("api.thingspeak.com", 80, PLV_UPLOAD_HTTP,
+                                  request, header.length(), (uint8_t *)postStr, body.length());
+}
+
+/**
+ * ThingSpeak sink: post the current readings once there is a new message
+ */
+boolean startThingSpeakSink(PluviOnSink &sink, unsigned long seq, void *context)
+{
+
+    thingspeakSeq = seq;
+
+    return connect2wifi_thingspeak();
+}
+
+/**
+ * ThingSpeak sink: one step of the request (the channel answers the entry id, "0" if refused)
+ */
+PluviOnSinkStatus stepThingSpeakSink(PluviOnSink &sink, void *context)
+{
+
+    PluviOnUploadState state = thingspeakUploader.step();
+
+    if (state == PLV_UPLOAD_FAILED)
+    {
+        return PLV_SINK_FAILED;
+    }
+
+    if (state != PLV_UPLOAD_DONE)
+    {
+        return PLV_SINK_BUSY;
+    }
+
+    if (thingspeakUploader.status() == 200 && strcmp(thingspeakUploader.response(), "0") != 0)
+    {
+        sink.deliver(thingspeakSeq);
+    }
+
+    return PLV_SINK_DONE;
+}
+
+/**
+ * Raw TCP sink: send one message (text messages '\n' terminated), the server replies "ok"
+ */
+boolean startTCPSink(PluviOnSink &sink, unsigned long seq, void *context)
+{
+
+    int length = messageLog.read(seq, tcpRecord, PLV_LOG_PAYLOAD_SIZE);
+
+    if (length < 0)
+    {
+        return false;
+    }
+
+    if (!PluviOnTelemetry::isFrame(tcpRecord, length) && !PluviOnSampleBlock::isBlock(tcpRecord, length))
+    {
+        tcpRecord[length++] = '\n';
+    }
+
+    tcpSeq = seq;
+
+    return tcpUploader.start(SINK_TCP_SERVER_ADDR, SINK_TCP_SERVER_PORT, PLV_UPLOAD_LINE,
+                             NULL, 0, tcpRecord, length);
+}
+
+/**
+ * Raw TCP sink: one step of the upload
+ */
+PluviOnSinkStatus stepTCPSink(PluviOnSink &sink, void *context)
+{
+
+    PluviOnUploadState state = tcpUploader.step();
+
+    if (state == PLV_UPLOAD_FAILED)
+    {
+        return PLV_SINK_FAILED;
+    }
+
+    if (state != PLV_UPLOAD_DONE)
+    {
+        return PLV_SINK_BUSY;
+    }
+
+    if (strcmp(tcpUploader.response(), "ok") == 0)
+    {
+        sink.deliver(tcpSeq);
+    }
+
+    return PLV_SINK_DONE;
+}
+
+/**
+ * Debug sink: print the message to serial
+ */
+boolean startDebugSink(PluviOnSink &sink, unsigned long seq, void *context)
+{
+
+    printMessage(seq);
+    sink.deliver(seq);
+
+    return true;
+}
+
+PluviOnSinkStatus stepDebugSink(PluviOnSink &sink, void *context)
+{
+    return PLV_SINK_DONE;
+}
+
+/**
+ * Register the telemetry sinks
+ */
+void initSinks()
+{
+
+    PLV_DEBUG_HEADER(F("SETUP TELEMETRY SINKS"));
+
+    PluviOnLinkHealth *links[] = { &pluvionLink, &thingspeakLink, &tcpLink };
+    for (uint8_t i = 0; i < sizeof(links) / sizeof(links[0]); i++)
+    {
+        links[i]->setThreshold(LINK_FAILURE_THRESHOLD);
+        links[i]->setBackoff(LINK_OPEN_MIN, LINK_OPEN_MAX);
+        links[i]->setJitter(LINK_JITTER);
+    }
+
+    pluvionSink.setLinkHealth(&pluvionLink);
+    pluvionSink.setRateLimit(SINK_PLUVION_RATE_LIMIT);
+    pluvionSink.setBackoff(SINK_PLUVION_BACKOFF_MIN, SINK_PLUVION_BACKOFF_MAX);
+    sinks.add(pluvionSink);
+
+    thingspeakSink.setEnabled(SINK_THINGSPEAK_ENABLED);
+    thingspeakSink.setLatestOnly(true);
+    thingspeakSink.setLinkHealth(&thingspeakLink);
+    thingspeakSink.setRateLimit(SINK_THINGSPEAK_RATE_LIMIT);
+    thingspeakSink.setBackoff(SINK_THINGSPEAK_BACKOFF_MIN, SINK_THINGSPEAK_BACKOFF_MAX);
+    sinks.add(thingspeakSink);
+
+    tcpClient.setTimeout(PLUVION_API_SERVER_CONNECT_TIMEOUT);
+    tcpUploader.setTimeouts(PLUVION_API_SERVER_REQ_TIMEOUT, PLUVION_API_SERVER_REQ_TIMEOUT, PLUVION_API_SERVER_REQ_TIMEOUT);
+    tcpSink.setEnabled(SINK_TCP_ENABLED);
+    tcpSink.setLinkHealth(&tcpLink);
+    tcpSink.setRateLimit(SINK_TCP_RATE_LIMIT);
+    tcpSink.setBackoff(SINK_TCP_BACKOFF_MIN, SINK_TCP_BACKOFF_MAX);
+    sinks.add(tcpSink);
+
+    debugSink.setEnabled(SINK_DEBUG_ENABLED);
+    sinks.add(debugSink);
+
+    PLV_DEBUG(F("Done."));
+}
+/**
+ * Print a response field (fields are not NUL terminated)
+ */
+void printResponseField(const char *value, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        PLV_DEBUG_(value[i]);
+    }
+    PLV_DEBUG(F(""));
+}
+
+/**
+ * @return true if the field is exactly the given text
+ */
+boolean responseFieldIs(const char *value, size_t length, const char *text)
+{
+    return strlen(text) == length && strncmp(value, text, length) == 0;
+}
+
+/**
+ * Server command "reset": reset the rain indicators
+ */
+void commandReset()
+{
+    // Reset Appliance
+    PLV_DEBUG(F("RESET !!!!"));
+    resetRainIndicators();
+}
+
+typedef void (*ServerCommandHandler)();
+
+struct ServerCommand
+{
+    const char *name;
+    ServerCommandHandler handler;
+};
+
+// Server commands (field 3 of the response), new ones go here
+const ServerCommand SERVER_COMMANDS[] = {
+    {"reset", commandReset},
+};
+
+/**
+ * 0 - Request result ("ok" accepts a single message)
+ */
+void responseResult(const char *value, size_t length, uint8_t count)
+{
+    if (responseFieldIs(value, length, "ok") && count == 1)
+    {
+        // Accepted
+        ackMessage(0);
+    }
+}
+
+/**
+ * 1 - Server time
+ */
+void responseServerTime(const char *value, size_t length, uint8_t count)
+{
+    updateStationTime(atoi(value));
+}
+
+/**
+ * 2 - Time to reset system
+ */
+void responseTimeToReset(const char *value, size_t length, uint8_t count)
+{
+    resetStartTime = seconds();
+    updateTimeToReset(atoi(value));
+}
+
+/**
+ * 3 - Server command
+ */
+void responseCommand(const char *value, size_t length, uint8_t count)
+{
+    if (length == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(SERVER_COMMANDS) / sizeof(SERVER_COMMANDS[0]); i++)
+    {
+        if (responseFieldIs(value, length, SERVER_COMMANDS[i].name))
+        {
+            SERVER_COMMANDS[i].handler();
+            return;
+        }
+    }
+
+    PLV_DEBUG(F("Unknown command, ignored."));
+}
+
+/**
+ * 4 - Ack list: positions in the request, e.g. "0,1,3"
+ */
+void responseAckList(const char *value, size_t length, uint8_t count)
+{
+    const char *position = value;
+    const char *fieldEnd = value + length;
+
+    while (position < fieldEnd)
+    {
+        char *end;
+        long i = strtol(position, &end, 10);
+
+        if (end == position || end > fieldEnd)
+        {
+            break;
+        }
+
+        if (i >= 0 && i < count)
+        {
+            // Accepted
+            ackMessage(i);
+        }
+
+        position = end < fieldEnd ? end + 1 : end;
+    }
+}
+
+typedef void (*ResponseFieldHandler)(const char *value, size_t length, uint8_t count);
+
+struct ResponseField
+{
+    const char *name;
+    ResponseFieldHandler handler;
+};
+
+// Response fields, in order
+const ResponseField RESPONSE_FIELDS[] = {
+    {"Request result", responseResult},
+    {"Server time",    responseServerTime},
+    {"Time to reset",  responseTimeToReset},
+    {"Server command", responseCommand},
+    {"Ack list",       responseAckList},
+};
+
+/**
+ * Process server response
+ *
+ * Fields: result|server time|time to reset|command|ack list. The ack list
+ * holds the comma separated positions (0 based) of the accepted messages;
+ * a single message is also acknowledged by an "ok" result alone.
+ *
+ * The fields are read in place (empty fields keep their position) and
+ * handed to RESPONSE_FIELDS; the command goes to SERVER_COMMANDS.
+ *
+ * @param seqs Message log seqs of the messages in the request
+ * @param count Number of messages in the request
+ * @param response Response body
+ */
+void processResponse(const unsigned long *seqs, uint8_t count, const char *response)
+{
+
+    PLV_DEBUG_HEADER(F("PROCESS RESPONSE"));
+
+    PLV_DEBUG_(F("Seqs:      "));
+    PLV_DEBUG_(seqs[0]);
+    if (count > 1)
+    {
+        PLV_DEBUG_(F(" .. "));
+        PLV_DEBUG_(seqs[count - 1]);
+    }
+    PLV_DEBUG(F(""));
+
+    PLV_DEBUG_(F("Response:  "));
+    PLV_DEBUG(response);
+
+    if (!strchr(response, '|'))
+    {
+        PLV_DEBUG(F("Response empty! Nothing to do, keep walking :)"));
+        return;
+    }
+
+    const char *field = response;
+
+    for (size_t index = 0; index < sizeof(RESPONSE_FIELDS) / sizeof(RESPONSE_FIELDS[0]); index++)
+    {
+        const char *end = strchr(field, '|');
+        size_t length = end ? end - field : strlen(field);
+
+        PLV_DEBUG_(F(" ["));
+        PLV_DEBUG_(index);
+        PLV_DEBUG_(F("] "));
+        PLV_DEBUG_(RESPONSE_FIELDS[index].name);
+        PLV_DEBUG_(F(": "));
+        printResponseField(field, length);
+
+        RESPONSE_FIELDS[index].handler(field, length, count);
+
+        if (!end)
+        {
+            break;
+        }
+
+        field = end + 1;
+    }
+}
+
+/**
+ * Write weather data to the message log
+ *
+ * @return The message log sequence number, or 0 if it fails
+ */
+unsigned long saveMessage(const char *message, size_t length)
+{
+
+    PLV_DEBUG_HEADER(F("SAVE WEATHER DATA LOCALLY"));
+
+    // Save message
+    return messageLog.append(message, length);
+}
+
+/**
+ * Import the messages queued by previous firmware versions (one file per message)
+ */
+void importLegacyMessages()
+{
+
+    Dir dir = pluvion.FSOpenDir(DIR_WEATHER_DATA.c_str());
+
+    while (dir.next())
+    {
+
+        File f = dir.openFile("r");
+        String message = f.readStringUntil('\n');
+        f.close();
+
+        // Legacy files were written with println ("\r\n")
+        message.trim();
+
+        char filepath[PLV_FS_PATH_SIZE];
+        if (!PluviOn::FSEntryPath(filepath, DIR_WEATHER_DATA.c_str(), dir))
+        {
+            continue;
+        }
+
+        PLV_DEBUG_(F("Importing legacy message: "));
+        PLV_DEBUG(filepath);
+
+        // Only remove the file once the message is safe in the log
+        if (message.length() == 0 || messageLog.append(message.c_str(), message.length()))
+        {
+            pluvion.FSRemove(filepath);
+        }
+    }
+}
+
+/**
+ * Read DHT Sensor
+ */
+void readDHTSensor()
+{
+
+    // Current millis mark
+    currentDHTReadingInMillis = millis();
+
+    // Check if the past reading has failed and the time
     if (
         DHTSensorReadingFailure &&                                                                    // Fail
         ((currentDHTReadingInMillis - lastDHTReadingInMillis) >= DHT_SENSOR_READING_FAILURE_DELAY) && // The time hasn' passed yet
@@ -1735,49 +2855,63 @@ void getDHTData()
 }
 
 /**
- * Reads the hall sensor (tip bucket)
+ * Reads the hall sensor (tip bucket): debounce the edges recorded by the ISR
  */
 void readHallSensor()
 {
 
-    // Current millis mark
-    currentTipBucketReadingInMillis = millis();
+    uint32_t edge;
+    int tips = 0;
 
-    // Check if the configured delay has passed
-    if (
-        ((currentTipBucketReadingInMillis - lastTipBucketReadingInMillis) >= DELAY_HALL_SENSOR_DEBOUNCING) || // delay
-        (lastTipBucketReadingInMillis == 0)                                                                   // first time
-        )
+    while (tipEvents.pop(edge))
     {
-        // Disable interrupt when calculating
-        detachInterrupt(PIN_HALL);
+        tipCounter++;
 
-        // Any increment since the last time?
-        if (tipCounter > lastTipCount)
+        if (!tipDebouncer.edge(PLV_EDGE_TIME(edge), PLV_EDGE_LEVEL(edge)))
         {
+            continue;
+        }
 
-            // Increase the tip bucket count
-            realTipCount++;
+        // Increase the tip bucket count
+        realTipCount++;
+        tips++;
 
-            // Update last tip counter value
-            lastTipCount = tipCounter;
+        // Calculate the rain volume, converting tips into mm
+        rainVolume = realTipCount * PLV_STATION_BUCKET_VOLUME * 1000 / CONTRIBUTION_AREA;
 
-            // Calculate the rain volume, converting tips into mm
-            rainVolume = realTipCount * PLV_STATION_BUCKET_VOLUME * 1000 / CONTRIBUTION_AREA;
+        // Rain intensity windows, at the edge time (not when it's processed)
+        rainRate.tip(tipDebouncer.lastTipInMillis());
+    }
 
-            // Get DHT Sensor Data
-            getDHTData();
+    if (!tips)
+    {
+        return;
+    }
 
-            // Build the weather message and send to Pluvi.On API
-            buildSaveAndSendMessage();
-        }
+    PLV_DEBUG_HEADER(F("TIP BUCKET INCREASED"));
 
-        // Store the current millis for the next iteration
-        lastTipBucketReadingInMillis = currentTipBucketReadingInMillis;
+    PLV_DEBUG_(F("Edges: "));
+    PLV_DEBUG(tipCounter);
 
-        // Enable interrupt again, CHANGE = trigger the interrupt whenever the pin changes value
-        attachInterrupt(PIN_HALL, countTipBucket, CHANGE);
-    }
+    PLV_DEBUG_(F("Real tip count: "));
+    PLV_DEBUG(realTipCount);
+
+    PLV_DEBUG_(F("Rain volume (mm): "));
+    PLV_DEBUG_(rainVolume);
+    PLV_DEBUG(F(" mm"));
+
+    PLV_DEBUG_(F("Rejected (glitches / bounces / lost edges): "));
+    PLV_DEBUG_(tipDebouncer.glitches());
+    PLV_DEBUG_(F(" / "));
+    PLV_DEBUG_(tipDebouncer.bounces());
+    PLV_DEBUG_(F(" / "));
+    PLV_DEBUG(tipEvents.overflows());
+
+    // Get DHT Sensor Data
+    getDHTData();
+
+    // Build the weather message and send to Pluvi.On API
+    buildSaveAndSendMessage();
 }
 
 /**
@@ -1793,6 +2927,19 @@ void resetWiFiSettings()
     wifiManager.resetSettings();
 }
 
+/**
+ * Write the staged config changes now (before a restart, a sleep or a
+ * blocking wait that may end in a power cycle)
+ */
+void flushConfig()
+{
+
+    if (!config.flush())
+    {
+        PLV_DEBUG(F("ERROR: Fail writing the config, the changes stay staged."));
+    }
+}
+
 /**
  * Setup WiFi module
  */
@@ -1801,6 +2948,9 @@ void setupWiFiModule()
 
     PLV_DEBUG_HEADER(F("SETUP WIFI MODULE"));
 
+    // Write the staged config: the config portal blocks until the station is configured or power cycled
+    flushConfig();
+
     int count = 0;
     while (true)
     {
@@ -1860,6 +3010,9 @@ void connectWiFi()
 
     printSystemWiFiStatus();
 
+    // Write the staged config: the config portal blocks until the station is configured or power cycled
+    flushConfig();
+
     // Connect to WiFi
     wifiManager.autoConnect(STATION_ID.c_str());
 }
@@ -1891,6 +3044,33 @@ void setup()
     PLV_DEBUG_(F("\n\nPLUVI.ON WIFI FIRMWARE (Version "));
     PLV_DEBUG_(FIRMWARE_VERSION);
     PLV_DEBUG(F(")"));
+
+    // Mount the file system once for the whole session
+    if (!pluvion.begin())
+    {
+        PLV_DEBUG(F("FATAL! Error mounting SPIFFS file system."));
+    }
+
+    unsigned long recoveryStart = millis();
+
+    // Load the station configuration (finishes an interrupted save, migrates the legacy directories on first boot)
+    config.begin();
+
+    // Config portal reads and writes the same store
+    wifiManager.setConfigStore(&config);
+
+    // Recover the message queue and import the legacy one (unless it was wiped)
+    messageLog.begin();
+    sinks.reset();
+    if (!pluvion.FSReclaimPending())
+    {
+        importLegacyMessages();
+    }
+
+    PLV_DEBUG_(F("Storage recovery time: "));
+    PLV_DEBUG_(millis() - recoveryStart);
+    PLV_DEBUG(F(" ms"));
+
     //HACK PEDRAO
     pinMode(PIN_HALL, INPUT_PULLUP); //Para facilitar RST do wifi (vire o pluvi de ponta cabeça e de rst)
     if (digitalRead(PIN_HALL) == 0){
@@ -1908,6 +3088,12 @@ void setup()
     // Setup WiFi Module
     setupWiFiModule();
 
+    // Setup the Pluvi.On API client
+    initAPIClient();
+
+    // Register the telemetry sinks
+    initSinks();
+
     // Init all system configurations
     initSystem();
 
@@ -1932,6 +3118,9 @@ void setup()
 void loop()
 {
 
+    // Reset the file system mount stats for this iteration
+    pluvion.FSResetMountStats();
+
     // Enables command on serial
     readSerialCommands();
 
@@ -1944,6 +3133,18 @@ void loop()
     // Reset System
     resetSystem();
 
-    // Send Offline messages
-    sendOfflineMessages();
+    // Deliver the messages to every sink (one step each; only a new connection blocks, the ISR timestamps the tips meanwhile)
+    sinks.step();
+
+    // Close the API connection after a burst of requests
+    closeIdleConnection();
+
+    // Write the config changes of this iteration at once
+    config.commit();
+
+    // Remove one file left by a wipe (if any)
+    pluvion.FSReclaimStep();
+
+    // Print the file system mount stats for this iteration
+    printFileSystemMountStats();
 }
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""
+Pluvi.On API server (local stand-in)
+
+      FILE: pluvion_api_server.py
+   VERSION: 1.0.0
+   LICENSE: Creative Commons 4
+   AUTHORS:
+            Hugo Santos <hugo@pluvion.com.br>
+            Pedro Godoy <pedro@pluvion.com.br>
+
+      SITE: https://www.pluvion.com.br
+
+Answers the weather posts of the station over plain HTTP/1.1 (keep-alive):
+
+    POST /weather          one message        -> ok|time|ttr|command|
+    POST /weather/batch    messages of a batch -> ok|time|ttr|command|0,1,...
+
+A text batch holds one message per line, a binary batch concatenated frames
+or sample blocks (decoded with pluvion_telemetry.py, a block is one message
+of the batch); "Content-Encoding: x-plv-lzss" bodies are decompressed first
+(pluvion_lzss.py). The ack list holds the positions of the accepted
+messages. Prints a line per request and the messages/s on exit.
+
+    python3 pluvion_api_server.py --port 8080
+
+--refuse leaves random messages out of the ack list (the station posts
+them again), --handshake delays every new connection (stands in for the
+TLS handshake of the cloud), --close answers "Connection: close", --port 0
+picks a free port (printed on the first line) and --requests exits after
+that many requests:
+
+    python3 pluvion_api_server.py --port 0 --handshake 300 --refuse 0.1
+"""
+import argparse
+import os
+import random
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import pluvion_lzss  # noqa: E402
+import pluvion_telemetry  # noqa: E402
+
+ENCODING = "x-plv-lzss"
+
+
+def count_messages(body, binary):
+    """Messages in a request body"""
+    if binary:
+        return len(pluvion_telemetry.decode_all(body))
+
+    return len([line for line in body.split(b"\n") if line.strip()])
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    disable_nagle_algorithm = True  # The reply goes in several writes
+
+    def setup(self):
+        # New connection: the handshake of the cloud
+        if self.server.args.handshake:
+            time.sleep(self.server.args.handshake / 1000.0)
+        BaseHTTPRequestHandler.setup(self)
+
+    def log_message(self, format, *args):
+        pass
+
+    def reply(self, status, body):
+        data = body.encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Content-Length", str(len(data)))
+        self.send_header("Accept-Encoding", ENCODING)
+        if self.server.args.close:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        self.end_headers()
+        self.wfile.write(data)
+
+    def do_POST(self):
+        args = self.server.args
+        if self.server.first is None:
+            self.server.first = time.time()
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+
+        if self.path not in ("/weather", "/weather/batch"):
+            self.reply(404, "error|||")
+            return self.done()
+
+        encoding = self.headers.get("Content-Encoding", "")
+        if encoding and encoding != ENCODING:
+            self.reply(415, "error|||")
+            return self.done()
+
+        try:
+            if encoding:
+                body = pluvion_lzss.decompress(body)
+            count = count_messages(body, "binary" in self.headers.get("Content-Type", ""))
+        except ValueError as error:
+            print("%s invalid body: %s" % (self.path, error), flush=True)
+            self.reply(400, "error|||")
+            return self.done()
+
+        acks = [i for i in range(count) if random.random() >= args.refuse]
+        now = int(time.time())
+        command, self.server.command = self.server.command, ""
+
+        if self.path == "/weather":
+            result = "ok" if acks else "error"
+            self.reply(200, "%s|%d|%d|%s|" % (result, now, args.ttr, command))
+        else:
+            self.reply(200, "ok|%d|%d|%s|%s" % (now, args.ttr, command, ",".join(str(i) for i in acks)))
+
+        self.server.messages += count
+        self.server.acked += len(acks)
+        print("%s %d messages, %d bytes%s, %d acked" %
+              (self.path, count, len(body), " (" + encoding + ")" if encoding else "", len(acks)), flush=True)
+        self.done()
+
+    def done(self):
+        server = self.server
+        server.requests += 1
+        server.last = time.time()
+
+        if server.args.requests and server.requests >= server.args.requests:
+            self.close_connection = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pluvi.On API stand-in server")
+    parser.add_argument("--bind", default="0.0.0.0", help="local address")
+    parser.add_argument("--port", type=int, default=8080, help="HTTP port (0 = any free port)")
+    parser.add_argument("--ttr", type=int, default=86400, help="time to reset sent in the responses (s)")
+    parser.add_argument("--command", default="", help="command sent once, in the next response (e.g. reset)")
+    parser.add_argument("--refuse", type=float, default=0.0, help="probability of leaving a message out of the acks")
+    parser.add_argument("--handshake", type=int, default=0, help="delay of every new connection (ms)")
+    parser.add_argument("--close", action="store_true", help="close the connection after every response")
+    parser.add_argument("--requests", type=int, default=0, help="exit after this many requests")
+    args = parser.parse_args()
+
+    server = HTTPServer((args.bind, args.port), Handler)
+    server.args = args
+    server.command = args.command
+    server.requests = server.messages = server.acked = 0
+    server.first = server.last = None
+    print("listening on %s:%d/http" % (args.bind, server.server_address[1]), flush=True)
+
+    try:
+        while not args.requests or server.requests < args.requests:
+            server.handle_request()
+    except KeyboardInterrupt:
+        pass
+
+    elapsed = (server.last - server.first) if server.first is not None else 0
+    print("%d requests, %d messages, %d acked%s" %
+          (server.requests, server.messages, server.acked,
+           ", %.1f messages/s" % (server.messages / elapsed) if elapsed > 0 else ""), flush=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
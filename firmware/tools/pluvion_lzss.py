@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Pluvi.On LZSS codec
+
+      FILE: pluvion_lzss.py
+   VERSION: 1.0.0
+   LICENSE: Creative Commons 4
+   AUTHORS:
+            Hugo Santos <hugo@pluvion.com.br>
+            Pedro Godoy <pedro@pluvion.com.br>
+
+      SITE: https://www.pluvion.com.br
+
+Decodes the "x-plv-lzss" content coding of the batch uploads (see
+PluviOnLZSS.h for the stream layout), and compresses with the same
+parameters as the station.
+
+    python3 pluvion_lzss.py -d batch.lz > batch.txt
+    python3 pluvion_lzss.py batch.txt > batch.lz
+
+With --bench, reads a "dump" serial command capture (real weather messages)
+and reports the compression ratio of the batches the station would upload:
+
+    python3 pluvion_lzss.py --bench dump.txt --batch 10
+"""
+import argparse
+import re
+import sys
+import time
+
+ENCODING = "x-plv-lzss"
+
+WINDOW_SIZE = 512
+MIN_MATCH = 3
+MAX_MATCH = 130
+CHAIN_DEPTH = 16
+
+
+def decompress(data):
+    """Decode a whole stream, raises ValueError if it's invalid"""
+    out = bytearray()
+    pos = 0
+
+    while pos < len(data):
+        flags = data[pos]
+        pos += 1
+
+        for item in range(8):
+            if pos >= len(data):
+                break
+
+            if not flags & (1 << item):
+                out.append(data[pos])
+                pos += 1
+                continue
+
+            if pos + 2 > len(data):
+                raise ValueError("truncated match at %d" % pos)
+
+            token = data[pos] | (data[pos + 1] << 8)
+            pos += 2
+
+            distance = (token & (WINDOW_SIZE - 1)) + 1
+            length = (token >> 9) + MIN_MATCH
+
+            if distance > len(out):
+                raise ValueError("match distance %d before the start" % distance)
+
+            # Byte by byte, a match may overlap its own output
+            for _ in range(length):
+                out.append(out[-distance])
+
+    return bytes(out)
+
+
+def compress(data):
+    """Greedy encoder, same window, lengths and chain depth as the station"""
+    out = bytearray()
+    chains = {}
+    pos = 0
+
+    while pos < len(data):
+        flag_at = len(out)
+        out.append(0)
+
+        for item in range(8):
+            if pos >= len(data):
+                break
+
+            best, distance = 0, 0
+            key = data[pos:pos + MIN_MATCH]
+
+            if len(key) == MIN_MATCH:
+                limit = min(MAX_MATCH, len(data) - pos)
+                for candidate in reversed(chains.get(key, [])[-CHAIN_DEPTH:]):
+                    if pos - candidate > WINDOW_SIZE:
+                        break
+                    length = 0
+                    while length < limit and data[candidate + length] == data[pos + length]:
+                        length += 1
+                    if length > best:
+                        best, distance = length, pos - candidate
+                        if best == limit:
+                            break
+
+            if best >= MIN_MATCH:
+                token = (distance - 1) | ((best - MIN_MATCH) << 9)
+                out[flag_at] |= 1 << item
+                out += bytes((token & 0xFF, token >> 8))
+            else:
+                best = 1
+                out.append(data[pos])
+
+            for p in range(pos, pos + best):
+                chains.setdefault(data[p:p + MIN_MATCH], []).append(p)
+            pos += best
+
+    return bytes(out)
+
+
+def read_dump(path):
+    """Text messages of a "dump" capture ("Message <seq>: <message>" lines)"""
+    messages = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            match = re.match(r"\s*Message \d+: (.*\|.*)$", line.rstrip("\r\n"))
+            if match:
+                messages.append(match.group(1))
+    return messages
+
+
+def bench(path, batch_size):
+    messages = read_dump(path)
+    if not messages:
+        print("no text messages in %s" % path, file=sys.stderr)
+        return 1
+
+    total_in = total_out = 0
+    start = time.perf_counter()
+
+    # Offline batches: one message per line with the "|off" suffix
+    for first in range(0, len(messages), batch_size):
+        batch = "".join(m + "|off\n" for m in messages[first:first + batch_size]).encode()
+        packed = compress(batch)
+        assert decompress(packed) == batch
+
+        total_in += len(batch)
+        total_out += len(packed)
+
+    elapsed = time.perf_counter() - start
+
+    print("messages:      %d (avg %d bytes)" % (len(messages), sum(map(len, messages)) / len(messages)))
+    print("batch size:    %d" % batch_size)
+    print("content:       %d -> %d bytes (%.1f %%, %.2fx)" %
+          (total_in, total_out, 100.0 * total_out / total_in, total_in / total_out))
+    print("host encode:   %.1f us/byte (Python reference, see CompressionBenchmark for the station)" %
+          (1e6 * elapsed / total_in))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pluvi.On LZSS (%s) codec" % ENCODING)
+    parser.add_argument("file", help="input file ('-' for stdin)")
+    parser.add_argument("-d", "--decompress", action="store_true", help="decompress")
+    parser.add_argument("--bench", action="store_true", help="compression ratio of a dump capture")
+    parser.add_argument("--batch", type=int, default=10, help="messages per batch (--bench)")
+    args = parser.parse_args()
+
+    if args.bench:
+        return bench(args.file, max(1, args.batch))
+
+    data = sys.stdin.buffer.read() if args.file == "-" else open(args.file, "rb").read()
+    sys.stdout.buffer.write(decompress(data) if args.decompress else compress(data))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""
+Pluvi.On TCP backlog server (local stand-in)
+
+      FILE: pluvion_tcp_server.py
+   VERSION: 1.0.0
+   LICENSE: Creative Commons 4
+   AUTHORS:
+            Hugo Santos <hugo@pluvion.com.br>
+            Pedro Godoy <pedro@pluvion.com.br>
+
+      SITE: https://www.pluvion.com.br
+
+Receives the backlog uploads of the WiFi firmware (every message of the data
+directory, one per line, PLV_UPLOAD_LINE) and replies "ok\\r" once the
+station stops sending. Prints the messages count and size of every upload.
+
+    python3 pluvion_tcp_server.py --port 10000
+
+Point the station at the computer (SERVER_ADDR) to test without the cloud.
+--save keeps the bytes of the last upload, --reply changes the reply (the
+station keeps its files unless it's "ok"), --port 0 picks a free port
+(printed on the first line), --once exits after one upload:
+
+    python3 pluvion_tcp_server.py --port 0 --once --save upload.txt
+"""
+import argparse
+import socket
+import sys
+
+
+def receive(conn, idle):
+    """Bytes sent until the station stops for idle seconds (or closes)"""
+    conn.settimeout(idle)
+    data = bytearray()
+
+    while True:
+        try:
+            chunk = conn.recv(4096)
+        except socket.timeout:
+            break
+
+        if not chunk:
+            break
+
+        data += chunk
+
+    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pluvi.On TCP backlog stand-in server")
+    parser.add_argument("--bind", default="0.0.0.0", help="local address")
+    parser.add_argument("--port", type=int, default=10000, help="TCP port (0 = any free port)")
+    parser.add_argument("--idle", type=float, default=1.0, help="end of an upload: seconds without data")
+    parser.add_argument("--reply", default="ok", help="reply line sent after an upload")
+    parser.add_argument("--save", help="file for the bytes of the last upload")
+    parser.add_argument("--once", action="store_true", help="exit after one upload")
+    args = parser.parse_args()
+
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((args.bind, args.port))
+    server.listen(1)
+    print("listening on %s:%d/tcp" % (args.bind, server.getsockname()[1]), flush=True)
+
+    while True:
+        conn, peer = server.accept()
+
+        with conn:
+            data = receive(conn, args.idle)
+            lines = data.split(b"\n")
+            messages = len(lines) - 1 if data.endswith(b"\n") else len(lines)
+
+            if args.save:
+                with open(args.save, "wb") as f:
+                    f.write(data)
+
+            # Single reply line, '\r' terminated
+            try:
+                conn.sendall((args.reply + "\r").encode())
+            except OSError:
+                pass
+
+            print("%s %d messages, %d bytes, replied %s" % (peer[0], messages if data else 0, len(data), args.reply),
+                  flush=True)
+
+        if args.once:
+            return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
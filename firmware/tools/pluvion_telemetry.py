@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""
+Pluvi.On binary telemetry decoder
+
+      FILE: pluvion_telemetry.py
+   VERSION: 1.0.0
+   LICENSE: Creative Commons 4
+   AUTHORS:
+            Hugo Santos <hugo@pluvion.com.br>
+            Pedro Godoy <pedro@pluvion.com.br>
+
+      SITE: https://www.pluvion.com.br
+
+Decodes the frames and the sensor sample blocks built by PluviOnTelemetry
+(see PluviOnTelemetry.h for the layouts). Reads raw frames from a file (one
+frame, or several concatenated as in a batch upload), or hex frames (one per
+line, as printed by the "dump" serial command) with --hex.
+
+    python3 pluvion_telemetry.py frame.bin
+    python3 pluvion_telemetry.py --hex dump.txt
+"""
+import argparse
+import sys
+
+MAGIC = 0xB1
+SCHEMA_VERSION = 1
+
+FLAG_KEYFRAME = 0x01
+FLAG_RESET = 0x02
+FLAG_OFFLINE = 0x04
+
+INVALID_FIXED = -0x80000000
+
+BLOCK_MAGIC = 0xB2
+BLOCK_SCHEMA_VERSION = 1
+BLOCK_INVALID_FIXED = -32768
+
+# (name, type) in PluviOnSample order, x10 floats
+BLOCK_FIELDS = [
+    ("messageID", "uvarint"),
+    ("stationTime", "svarint"),
+    ("tipCount", "uvarint"),
+    ("temperature", "svarint"),
+    ("humidity", "svarint"),
+]
+
+# (name, type) in PluviOnTelemetrySample order
+SAMPLE_FIELDS = [
+    ("messageID", "uvarint"),
+    ("stationTime", "svarint"),
+    ("rainVolume", "fixed"),
+    ("tipCount", "uvarint"),
+    ("temperature", "fixed"),
+    ("humidity", "fixed"),
+    ("heatIndex", "fixed"),
+    ("freeHeap", "uvarint"),
+    ("freeDiskBytes", "uvarint"),
+    ("freeDiskPercent", "fixed"),
+    ("rssi", "svarint"),
+    ("vcc", "uvarint"),
+    ("timeToReset", "svarint"),
+]
+
+# (name, type) in PluviOnTelemetryConfig order
+CONFIG_FIELDS = [
+    ("stationName", "str"),
+    ("latitude", "str"),
+    ("longitude", "str"),
+    ("bucketVolume", "fixed"),
+    ("dhtReadingDelay", "uvarint"),
+    ("hallDebounceDelay", "uvarint"),
+    ("firmwareVersion", "str"),
+    ("resetReason", "str"),
+    ("ssid", "str"),
+    ("localIp", "str"),
+    ("hostname", "str"),
+    ("macAddr", "str"),
+]
+
+
+class Reader:
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise ValueError("truncated frame")
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def uvarint(self):
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value
+            shift += 7
+            if shift > 35:
+                raise ValueError("varint too long")
+
+    def svarint(self):
+        value = self.uvarint()
+        return (value >> 1) ^ -(value & 1)
+
+    def fixed(self):
+        value = self.svarint()
+        return float("nan") if value == INVALID_FIXED else value / 100.0
+
+    def str(self):
+        length = self.uvarint()
+        if self.pos + length > len(self.data):
+            raise ValueError("truncated frame")
+        value = self.data[self.pos:self.pos + length].decode("utf-8", "replace")
+        self.pos += length
+        return value
+
+
+def decode(data):
+    """Decode one frame into a dict."""
+    frame, end = decode_at(data, 0)
+
+    if end != len(data):
+        raise ValueError("%d trailing bytes" % (len(data) - end))
+
+    return frame
+
+
+def decode_all(data):
+    """Decode concatenated frames (batch upload body) into a list of dicts."""
+    frames = []
+    pos = 0
+
+    while pos < len(data):
+        frame, pos = decode_at(data, pos)
+        frames.append(frame)
+
+    return frames
+
+
+def decode_at(data, pos):
+    """Decode the frame starting at pos, return it with the position after it."""
+    reader = Reader(data)
+    reader.pos = pos
+
+    magic = reader.byte()
+    if magic == BLOCK_MAGIC:
+        return decode_block(reader)
+
+    if magic != MAGIC:
+        raise ValueError("not a telemetry frame")
+
+    version = reader.byte()
+    if version != SCHEMA_VERSION:
+        raise ValueError("unsupported schema version %d" % version)
+
+    flags = reader.byte()
+    frame = {
+        "version": version,
+        "keyframe": bool(flags & FLAG_KEYFRAME),
+        "reset": bool(flags & FLAG_RESET),
+        "offline": bool(flags & FLAG_OFFLINE),
+        "stationID": reader.str(),
+    }
+
+    fields = SAMPLE_FIELDS + (CONFIG_FIELDS if flags & FLAG_KEYFRAME else [])
+    for name, kind in fields:
+        frame[name] = getattr(reader, kind)()
+
+    return frame, reader.pos
+
+
+def decode_block(reader):
+    """Decode a sample block (after its magic), return it with the position after it."""
+    version = reader.byte()
+    if version != BLOCK_SCHEMA_VERSION:
+        raise ValueError("unsupported block schema version %d" % version)
+
+    flags = reader.byte()
+    count = reader.byte()
+    block = {
+        "version": version,
+        "block": True,
+        "offline": bool(flags & FLAG_OFFLINE),
+        "stationID": reader.str(),
+        "samples": [],
+    }
+
+    # Base sample, then 32 bit wrapping deltas
+    fields = []
+    for n in range(count):
+        if n == 0:
+            fields = [getattr(reader, kind)() for _, kind in BLOCK_FIELDS]
+        else:
+            fields = [(value + reader.svarint()) & 0xFFFFFFFF for value in fields]
+
+        sample = {}
+        for (name, kind), value in zip(BLOCK_FIELDS, fields):
+            value &= 0xFFFFFFFF
+            if kind == "svarint" and value & 0x80000000:
+                value -= 0x100000000
+            if name in ("temperature", "humidity"):
+                value = float("nan") if value == BLOCK_INVALID_FIXED else value / 10.0
+            sample[name] = value
+        block["samples"].append(sample)
+
+    return block, reader.pos
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode Pluvi.On binary telemetry frames")
+    parser.add_argument("file", help="frame file ('-' for stdin)")
+    parser.add_argument("--hex", action="store_true", help="one hex frame per line")
+    args = parser.parse_args()
+
+    stream = sys.stdin.buffer if args.file == "-" else open(args.file, "rb")
+    with stream:
+        content = stream.read()
+
+    if args.hex:
+        payloads = [bytes.fromhex(line) for line in content.decode().split() if line]
+    else:
+        payloads = [content]
+
+    for data in payloads:
+        try:
+            frames = decode_all(data)
+        except ValueError as e:
+            print("ERROR: %s" % e)
+            continue
+
+        for frame in frames:
+            print("---")
+            for name, value in frame.items():
+                if name != "samples":
+                    print("%s: %s" % (name, value))
+            for sample in frame.get("samples", []):
+                print("  " + " ".join("%s=%s" % item for item in sample.items()))
+
+
+if __name__ == "__main__":
+    main()
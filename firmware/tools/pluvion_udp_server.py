@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+Pluvi.On UDP telemetry server (local stand-in)
+
+      FILE: pluvion_udp_server.py
+   VERSION: 1.0.0
+   LICENSE: Creative Commons 4
+   AUTHORS:
+            Hugo Santos <hugo@pluvion.com.br>
+            Pedro Godoy <pedro@pluvion.com.br>
+
+      SITE: https://www.pluvion.com.br
+
+Receives the datagrams of PluviOnUDPLink (see PluviOnUDPLink.h for the
+format) and acks each one with the fields the station processes: result,
+server time, time to reset and command. Prints every message once, and the
+duplicates (retransmits whose ack was lost) separately.
+
+    python3 pluvion_udp_server.py --port 10001
+
+Point the station at the computer (SERVER_ADDR) to test without the cloud.
+--drop and --refuse lose or refuse datagrams, to exercise the retransmits:
+
+    python3 pluvion_udp_server.py --drop 0.3 --refuse 0.1 --command reset
+
+The command goes in the ack of one message and again in the acks of its
+duplicates, so a lost ack doesn't lose it. --port 0 takes a free port
+(printed on the first line), --idle exits once the station stops sending:
+
+    python3 pluvion_udp_server.py --port 0 --idle 1 --seed 1 --drop 0.3
+"""
+import argparse
+import random
+import socket
+import sys
+import time
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pluvi.On UDP telemetry stand-in server")
+    parser.add_argument("--bind", default="0.0.0.0", help="local address")
+    parser.add_argument("--port", type=int, default=10001, help="UDP port")
+    parser.add_argument("--ttr", type=int, default=86400, help="time to reset sent in the acks (s)")
+    parser.add_argument("--command", default="", help="command sent once, in the next ack (e.g. reset)")
+    parser.add_argument("--drop", type=float, default=0.0, help="probability of ignoring a datagram")
+    parser.add_argument("--refuse", type=float, default=0.0, help="probability of an \"error\" ack")
+    parser.add_argument("--seed", type=int, default=None, help="seed of --drop and --refuse (repeatable runs)")
+    parser.add_argument("--idle", type=float, default=0.0, help="exit after seconds without datagrams (0: never)")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    print("listening on %s:%d/udp" % (args.bind, sock.getsockname()[1]), flush=True)
+
+    if args.idle > 0:
+        sock.settimeout(args.idle)
+
+    random.seed(args.seed)
+
+    command = args.command
+    carrier = None  # (peer, seq) of the ack that carried the command
+    seen = set()
+    duplicates = 0
+
+    while True:
+        try:
+            data, peer = sock.recvfrom(2048)
+        except socket.timeout:
+            break
+
+        text = data.decode("utf-8", "replace")
+        seq, sep, message = text.partition("|")
+
+        if not sep or not seq.isdigit():
+            print("%s invalid datagram: %r" % (peer[0], text))
+            continue
+
+        if random.random() < args.drop:
+            print("%s seq %s dropped" % (peer[0], seq))
+            continue
+
+        if random.random() < args.refuse:
+            sock.sendto(("%s|error" % seq).encode(), peer)
+            print("%s seq %s refused" % (peer[0], seq))
+            continue
+
+        key = (peer[0], int(seq))
+        if key in seen:
+            duplicates += 1
+            print("%s seq %s duplicate" % (peer[0], seq))
+        else:
+            seen.add(key)
+            print("%s seq %s: %s" % (peer[0], seq, message))
+
+        # The command stays with the seq that carried it: sent again in the
+        # acks of its duplicates (the station didn't get the first one)
+        if command and carrier is None:
+            carrier = key
+        pending = command if carrier == key else ""
+
+        # Same fields as the Pluvi.On API response: result|time|ttr|command
+        ack = "%s|ok|%d|%d|%s" % (seq, int(time.time()), args.ttr, pending)
+        sock.sendto(ack.encode(), peer)
+
+        if pending:
+            print("%s command sent: %s" % (peer[0], pending))
+
+    print("%d messages, %d duplicates" % (len(seen), duplicates), flush=True)
+
+
+if __name__ == "__main__":
+    sys.exit(main())